@@ -0,0 +1,105 @@
+// Copyright 2026 Daniel McGuire
+// Licensed under the Apache License (with LLVM-Exceptions), Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// https://llvm.org/LICENSE.txt
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// README
+//
+// This file is the interface between the VM and the headers `phasornative` generates.
+// Every generated header defines an EmbeddedImage, constexpr tables of the program's
+// instructions and constants that the VM runs from in place, as PHASOR_EMBEDDED_IMAGE.
+// With `--aot` it also translates every bytecode function into a C++ function taking a
+// CompiledFrame, and defines PHASOR_COMPILED_PROGRAM as the entry point. The native stub
+// hands both to execImage() (see PhasorRT.h).
+// Only Value.hpp is needed to compile generated code; everything else goes through
+// the frame.
+
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <stdexcept>
+#include <vector>
+
+#include "../Value.hpp"
+
+namespace Phasor
+{
+class VM;
+
+/**
+ * @struct CompiledFrame
+ * @brief The VM state a compiled program runs against
+ *
+ * The stack, variables and registers are the VM's own, so compiled code and
+ * the instructions it leaves to the interpreter through operation() see the
+ * same state.
+ */
+struct CompiledFrame
+{
+	VM                      *vm;
+	std::pmr::vector<Value> &stack;
+	std::vector<Value>      &variables;
+	Value                   *registers;
+
+	/// @brief Run one instruction on the VM, for opcodes the translator doesn't handle itself
+	void (*operation)(VM *vm, int op, int operand1, int operand2, int operand3);
+
+	/// @brief Instruction index a SWITCH_TABLE (hash false) or SWITCH_HASH (hash true) jumps to
+	int (*resolveSwitch)(VM *vm, int table, bool hash, const Value &value);
+
+	Value pop()
+	{
+		if (stack.empty()) [[unlikely]]
+			throw std::runtime_error("Stack underflow in compiled code");
+		Value value = std::move(stack.back());
+		stack.pop_back();
+		return value;
+	}
+};
+
+/// @brief Entry point of a compiled program
+using CompiledProgram = void (*)(CompiledFrame &frame);
+
+/// @brief An instruction, laid out like the VM's own and like a .phsb version 4 record
+struct EmbeddedInstruction
+{
+	u8  op;
+	i32 operand1;
+	i32 operand2;
+	i32 operand3;
+};
+
+/// @brief A constant pool entry, turned into a Value on first use
+struct EmbeddedConstant
+{
+	ValueType   type;
+	i64         integer; ///< Bool and Int
+	f64         number;  ///< Float
+	const char *string;  ///< String, length bytes, not null-terminated
+	size_t      length;
+};
+
+/**
+ * @struct EmbeddedImage
+ * @brief Instructions and constants of a program, as constexpr tables in a generated header
+ *
+ * The embedded bytecode still supplies the small tables (variables, functions,
+ * structs, switches), but the VM executes these instructions where they are and
+ * never parses the instruction or constant sections.
+ */
+struct EmbeddedImage
+{
+	const EmbeddedInstruction *instructions;
+	size_t                     instructionCount;
+	const EmbeddedConstant    *constants; ///< Null if there are none
+	size_t                     constantCount;
+};
+
+} // namespace Phasor
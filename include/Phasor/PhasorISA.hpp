@@ -178,7 +178,15 @@ enum class OpCode : u8
 	READLINE_R,   ///< Read line into register: readline(R[rA])
 	SYSTEM_R,     ///< Run an operating system shell command: system(R[rA])
 	SYSTEM_OUT_R, /// Run shell command and get output: system_out(R[rA], R[rB])
-	SYSTEM_ERR_R  /// Run shell command and get error output: system_err(R[rA], R[rB])
+	SYSTEM_ERR_R, /// Run shell command and get error output: system_err(R[rA], R[rB])
+
+	// Immediate operands
+	PUSH_INT_IMM,  ///< Push integer encoded in operand1 (no constant pool lookup)
+	LOAD_INT_IMM_R, ///< Load integer immediate to register: R[rA] = operand2
+
+	// Multi-way branches
+	SWITCH_TABLE, ///< Pop value, jump through dense jump table switchTables[operand1]
+	SWITCH_HASH   ///< Pop value, jump through hashed jump table switchTables[operand1]
 };
 
 /// @brief Instruction with up to 5 operands
@@ -25,6 +25,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #endif
+#include "PhasorFFI.h"
 
 #ifdef _WIN32
 #ifdef PHASOR_EXPORTS
@@ -68,6 +69,27 @@ extern "C"
 	PHASOR_API int exec(void *state, const unsigned char *bytecode, size_t bytecodeSize, const char *moduleName,
 	                    int argc, const char **argv);
 
+	/**
+	 * @brief Executes a program embedded by phasornative, in place.
+	 *
+	 * @param state                A pointer to an state to execute the script within. If null, new state will be
+	 * created and managed for you.
+	 * @param bytecode             The embedded bytecode, which supplies the program's small tables. Not copied, must
+	 * stay valid while the program runs.
+	 * @param bytecodeSize         The size of the bytecode array.
+	 * @param image                The Phasor::EmbeddedImage defined as PHASOR_EMBEDDED_IMAGE by the generated header,
+	 * holding the instructions and constants of the same program.
+	 * @param moduleName           The name of the module, used for error reporting.
+	 * @param argc                 Argument count.
+	 * @param argv                 Argument vector.
+	 * @param program              The Phasor::CompiledProgram defined as PHASOR_COMPILED_PROGRAM by a header generated
+	 * with --aot, or null to interpret.
+	 * @return                     The exit code of the program given from script (-1 might be an unhandled exception in
+	 * VM).
+	 */
+	PHASOR_API int execImage(void *state, const unsigned char *bytecode, size_t bytecodeSize, const void *image,
+	                         const char *moduleName, int argc, const char **argv, void *program);
+
 	/**
 	 * @brief Executes a function from pre-compiled Phasor bytecode, and casts return to an integer.
 	 *
@@ -166,6 +188,117 @@ extern "C"
 	PHASOR_API bool compilePUL(const char *script, const char *moduleName, unsigned char *buffer, size_t bufferSize,
 	                           size_t *outSize);
 
+	/**
+	 * @brief A program compiled or loaded once, to be executed any number of times.
+	 *
+	 * Opaque to the host. Made by compileProgramPHS(), compileProgramPUL() or loadProgram(), released with
+	 * freeProgram(). Executing one never changes it, so it can be run on any state, including several states at once.
+	 */
+	typedef struct PhasorProgram PhasorProgram;
+
+	/**
+	 * @brief Compiles a Phasor Programming Language script into a program, resolving its imports now.
+	 *
+	 * @param script     A string containing the Phasor source to compile.
+	 * @param moduleName The name of the module, used for error reporting.
+	 * @param modulePath A path to the parent folder for the script, used for resolving compile time imports.
+	 * @return           The program, or null if compilation failed. Free with freeProgram().
+	 */
+	PHASOR_API PhasorProgram *compileProgramPHS(const char *script, const char *moduleName, const char *modulePath);
+
+	/**
+	 * @brief Compiles a Pulsar Scripting Language script into a program.
+	 *
+	 * @param script     A string containing the Pulsar source to compile.
+	 * @param moduleName The name of the module, used for error reporting.
+	 * @return           The program, or null if compilation failed. Free with freeProgram().
+	 */
+	PHASOR_API PhasorProgram *compileProgramPUL(const char *script, const char *moduleName);
+
+	/**
+	 * @brief Loads pre-compiled Phasor bytecode into a program.
+	 *
+	 * @param bytecode     An array of unsigned chars containing the Phasor bytecode, not needed after the call.
+	 * @param bytecodeSize The size of the bytecode array.
+	 * @param moduleName   The name of the module, used for error reporting.
+	 * @return             The program, or null if the bytecode is invalid. Free with freeProgram().
+	 */
+	PHASOR_API PhasorProgram *loadProgram(const unsigned char *bytecode, size_t bytecodeSize, const char *moduleName);
+
+	/**
+	 * @brief Executes a program.
+	 *
+	 * @param state   A pointer to an state to execute the program within. If null, new state will be created and
+	 * managed for you. A given state loads its FFI plugins on its first program only.
+	 * @param program The program to execute.
+	 * @param argc    Argument count.
+	 * @param argv    Argument vector.
+	 * @return        The exit code of the program given from script (-1 might be an unhandled exception in VM).
+	 */
+	PHASOR_API int execProgram(void *state, const PhasorProgram *program, int argc, const char **argv);
+
+	/**
+	 * @brief Executes a function from a program, and casts return to an integer.
+	 *
+	 * @param state        As for execProgram().
+	 * @param program      The program defining the function.
+	 * @param argc         Argument count.
+	 * @param argv         Argument vector.
+	 * @param functionName The name of the function to execute.
+	 * @return             The return from the function call (-1 might be an unhandled exception in VM).
+	 */
+	PHASOR_API int execProgramFuncInt(void *state, const PhasorProgram *program, int argc, const char **argv,
+	                                  const char *functionName);
+
+	/**
+	 * @brief Executes a function from a program, and casts return to an string.
+	 *
+	 * @param state        As for execProgram().
+	 * @param program      The program defining the function.
+	 * @param argc         Argument count.
+	 * @param argv         Argument vector.
+	 * @param functionName The name of the function to execute.
+	 * @return             The return from the function call, nullptr on error. Overwritten by the next call, as for
+	 * execFuncString().
+	 */
+	PHASOR_API const char *execProgramFuncString(void *state, const PhasorProgram *program, int argc,
+	                                             const char **argv, const char *functionName);
+
+	/**
+	 * @brief Looks a function of a program up once, for callProgramFunction().
+	 *
+	 * @param program      The program defining the function.
+	 * @param functionName The name of the function.
+	 * @return             The function, or -1 if the program has no function of that name.
+	 */
+	PHASOR_API long long findProgramFunction(const PhasorProgram *program, const char *functionName);
+
+	/**
+	 * @brief Calls a function of a program with arguments, keeping the state's variables between calls.
+	 *
+	 * Meant for calling into a script many times: the program is loaded on the state by the first call, or by
+	 * execProgram() (whose top level code then sets the variables up), and stays loaded until the state runs something
+	 * else. Nothing is allocated per call once the state has seen the largest argument list and string result.
+	 *
+	 * @param state     A state created by createState(); may not be null.
+	 * @param program   The program defining the function.
+	 * @param function  The function, from findProgramFunction().
+	 * @param args      The arguments, in order, as for plugin functions (see PhasorFFI.h). They are copied.
+	 * @param argCount  The number of arguments.
+	 * @param[out] result The function's return value, may be null. A string result is valid until the next call on the
+	 * same thread; structs and arrays are returned as a string of their printed form.
+	 * @return          True if the function ran and returned, false on an error, which is reported as for exec().
+	 */
+	PHASOR_API bool callProgramFunction(void *state, const PhasorProgram *program, long long function,
+	                                    const PhasorValue *args, size_t argCount, PhasorValue *result);
+
+	/**
+	 * @brief Frees a program.
+	 *
+	 * @param program The program to free, may be null. It must not be running on any state.
+	 */
+	PHASOR_API void freeProgram(PhasorProgram *program);
+
 	/**
 	 * @brief Creates a new state instance.
 	 *
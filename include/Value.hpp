@@ -28,6 +28,7 @@
 #include <string>
 #include <variant>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
 #include <vector>
 #include <format>
@@ -113,8 +114,17 @@ class Value
 	{
 		PhsString structName;
 		PhsOrderedMap<PhsString, Value> fields;
+		bool frozen = false; ///< Set by freeze(), never cleared
+	};
+	struct ArrayInstance : std::vector<Value>
+	{
+		using std::vector<Value>::vector;
+		ArrayInstance() = default;
+		ArrayInstance(std::vector<Value> elements) : std::vector<Value>(std::move(elements))
+		{
+		}
+		bool frozen = false; ///< Set by freeze(), never cleared
 	};
-	using ArrayInstance = std::vector<Value>;
 
   private:
 	using DataType = std::variant<std::monostate, bool, i64, f64, PhsString,
@@ -308,6 +318,8 @@ class Value
 			throw std::runtime_error("Value is not an array");
 
 		auto arr = asArray();
+		if (arr->frozen)
+			throw std::runtime_error("Cannot modify a frozen array");
 		if (index >= arr->size())
 			arr->resize(index + 1);
 
@@ -323,7 +335,10 @@ class Value
 		if (!std::holds_alternative<std::shared_ptr<StructInstance>>(data))
 			throw std::runtime_error("Value is not a struct");
 
-		return std::get<std::shared_ptr<StructInstance>>(data)->fields[PhsString(key)];
+		auto &instance = std::get<std::shared_ptr<StructInstance>>(data);
+		if (instance->frozen)
+			throw std::runtime_error("Cannot modify a frozen struct");
+		return instance->fields[PhsString(key)];
 	}
 
 	Value operator[](const std::string& key) const
@@ -815,6 +830,60 @@ class Value
 		return {std::make_shared<ArrayInstance>(std::move(elements))};
 	}
 
+	/// @brief Copy that shares no arrays or structs with this value, to hand to another thread
+	/// Frozen arrays and structs can't change, so any thread may read them and they are shared instead.
+	/// An array or struct reached twice, as through a cycle, is copied once and the copy referenced twice.
+	[[nodiscard]] Value clone() const
+	{
+		if (!isArray() && !isStruct())
+			return *this;
+		std::unordered_map<const void *, Value> copies;
+		return clone(copies);
+	}
+
+	/// @brief Make this value's arrays and structs, and every one they hold, immutable for good
+	/// Each is frozen in place, so other references to them see it too.
+	void freeze() noexcept
+	{
+		if (const auto *array = std::get_if<std::shared_ptr<ArrayInstance>>(&data))
+		{
+			if ((*array)->frozen)
+				return;
+			(*array)->frozen = true;
+			for (Value &element : **array)
+				element.freeze();
+		}
+		else if (const auto *instance = std::get_if<std::shared_ptr<StructInstance>>(&data))
+		{
+			if ((*instance)->frozen)
+				return;
+			(*instance)->frozen = true;
+			for (auto &[name, field] : (*instance)->fields)
+				field.freeze();
+		}
+	}
+
+	/// @brief Whether this value can't change: a frozen array or struct, or anything else
+	[[nodiscard]] bool isFrozen() const noexcept
+	{
+		if (const auto *array = std::get_if<std::shared_ptr<ArrayInstance>>(&data))
+			return (*array)->frozen;
+		if (const auto *instance = std::get_if<std::shared_ptr<StructInstance>>(&data))
+			return (*instance)->frozen;
+		return true;
+	}
+
+	/// @brief Whether nothing else references this value's arrays and structs
+	/// Such a value can be moved to another thread as it is, where a shared one has to be clone()d.
+	/// Values holding a cycle count as shared.
+	[[nodiscard]] bool isUnique() const
+	{
+		if (!isArray() && !isStruct())
+			return true;
+		std::unordered_set<const void *> seen;
+		return isUnique(seen);
+	}
+
 	[[nodiscard]] Value getField(const PhsString &name) const
 	{
 		if (!std::holds_alternative<std::shared_ptr<StructInstance>>(data))
@@ -837,6 +906,10 @@ class Value
 			[[unlikely]] throw std::runtime_error("setField() called on non-struct value");
 		}
 		auto s = std::get<std::shared_ptr<StructInstance>>(data);
+		if (s->frozen)
+		{
+			[[unlikely]] throw std::runtime_error("Cannot set field '" + name.str() + "' of a frozen struct");
+		}
 		s->fields[name] = std::move(value);
 	}
 
@@ -849,6 +922,56 @@ class Value
 		auto s = std::get<std::shared_ptr<StructInstance>>(data);
 		return s->fields.contains(name);
 	}
+
+  private:
+	/// @brief clone(), with the copies made so far by source array or struct
+	[[nodiscard]] Value clone(std::unordered_map<const void *, Value> &copies) const
+	{
+		if (isFrozen())
+			return *this;
+		if (const auto *array = std::get_if<std::shared_ptr<ArrayInstance>>(&data))
+		{
+			if (auto it = copies.find(array->get()); it != copies.end())
+				return it->second;
+			auto copy = std::make_shared<ArrayInstance>();
+			copies.emplace(array->get(), Value(copy));
+			copy->reserve((*array)->size());
+			for (const Value &element : **array)
+				copy->push_back(element.clone(copies));
+			return Value(std::move(copy));
+		}
+		const auto &instance = std::get<std::shared_ptr<StructInstance>>(data);
+		if (auto it = copies.find(instance.get()); it != copies.end())
+			return it->second;
+		auto copy = std::make_shared<StructInstance>();
+		copies.emplace(instance.get(), Value(copy));
+		copy->structName = instance->structName;
+		for (const auto &[name, field] : instance->fields)
+			copy->fields[name] = field.clone(copies);
+		return Value(std::move(copy));
+	}
+
+	/// @brief isUnique(), with the arrays and structs already reached
+	[[nodiscard]] bool isUnique(std::unordered_set<const void *> &seen) const
+	{
+		if (const auto *array = std::get_if<std::shared_ptr<ArrayInstance>>(&data))
+		{
+			if (array->use_count() != 1 || !seen.insert(array->get()).second)
+				return false;
+			for (const Value &element : **array)
+				if (!element.isUnique(seen))
+					return false;
+		}
+		else if (const auto *instance = std::get_if<std::shared_ptr<StructInstance>>(&data))
+		{
+			if (instance->use_count() != 1 || !seen.insert(instance->get()).second)
+				return false;
+			for (const auto &[name, field] : (*instance)->fields)
+				if (!field.isUnique(seen))
+					return false;
+		}
+		return true;
+	}
 };
 
 namespace json {
@@ -1,7 +1,12 @@
 #pragma once
 #include <iostream>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <new>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 #include <filesystem>
@@ -22,13 +27,25 @@ enum class TokenType : u8
 	EndOfFile,
 	Unknown
 };
+/// @brief How a String token's lexeme relates to the literal's value
+enum class StringForm : u8
+{
+	Verbatim, ///< The lexeme is the value
+	Escaped,  ///< "..." body still holding escape sequences
+	Raw       ///< `...` body still holding carriage returns
+};
 /// @brief Token structure
+///
+/// Lexemes are views into the buffer handed to the lexer, which must outlive
+/// the tokens. String literal lexemes are the body between the delimiters,
+/// Lexer::stringValue() turns them into the value.
 struct Token
 {
-	TokenType   type;
-	std::string lexeme;
-	size_t      line;
-	size_t      column;
+	TokenType        type;
+	std::string_view lexeme;
+	size_t           line;
+	size_t           column;
+	StringForm       form = StringForm::Verbatim;
 };
 
 /// @brief Abstract Syntax Tree (AST) namespace
@@ -41,30 +58,163 @@ struct Expression;
 struct Statement;
 struct Program;
 
+/// @brief Concrete node type, for switch dispatch instead of dynamic_cast chains
+enum class NodeKind : u8
+{
+	Program,
+	TypeNode,
+	NumberExpr,
+	StringExpr,
+	IdentifierExpr,
+	BooleanExpr,
+	NullExpr,
+	PostfixExpr,
+	UnaryExpr,
+	BinaryExpr,
+	ArrayAccessExpr,
+	ArrayLiteralExpr,
+	MemberAccessExpr,
+	CallExpr,
+	AssignmentExpr,
+	StructInstanceExpr,
+	FieldAccessExpr,
+	VarDecl,
+	ExpressionStmt,
+	PrintStmt,
+	IncludeStmt,
+	ImportStmt,
+	ExportStmt,
+	BlockStmt,
+	ReturnStmt,
+	BreakStmt,
+	ContinueStmt,
+	IfStmt,
+	WhileStmt,
+	ForStmt,
+	UnsafeBlockStmt,
+	FunctionDecl,
+	StructDecl,
+	SwitchStmt
+};
+
 /// @brief AST Node
 struct Node
 {
+	explicit Node(NodeKind kind) : kind(kind)
+	{
+	}
 	virtual ~Node() = default;
-	virtual void print(int indent = 0) const = 0;
-	size_t       line = 0;
-	size_t       column = 0;
+	virtual void   print(int indent = 0) const = 0;
+	const NodeKind kind;
+	size_t         line = 0;
+	size_t         column = 0;
+};
+
+/// @brief Checked downcast by kind tag, nullptr when node is null or of another kind
+template <typename T> T *as(Node *node)
+{
+	return node != nullptr && node->kind == T::Kind ? static_cast<T *>(node) : nullptr;
+}
+
+/// @brief Checked downcast by kind tag, nullptr when node is null or of another kind
+template <typename T> const T *as(const Node *node)
+{
+	return node != nullptr && node->kind == T::Kind ? static_cast<const T *>(node) : nullptr;
+}
+
+/// @brief Runs a node's destructor without freeing it, the arena owns the memory
+struct Destroy
+{
+	void operator()(const Node *node) const
+	{
+		node->~Node();
+	}
+};
+
+/// @brief Owning pointer to an arena-allocated node
+template <typename T> using Ptr = std::unique_ptr<T, Destroy>;
+
+/**
+ * @brief Bump allocator backing every node of a Program
+ *
+ * Nodes are carved out of large blocks instead of one heap allocation each,
+ * which keeps a tree close together in memory and makes building and
+ * dropping it cheap. Ptr still runs each node's destructor, so strings and
+ * vectors inside nodes are released normally; the blocks go with the arena.
+ */
+class Arena
+{
+  public:
+	Arena() = default;
+	Arena(const Arena &) = delete;
+	Arena &operator=(const Arena &) = delete;
+
+	/// @brief Construct a node in the arena
+	template <typename T, typename... Args> Ptr<T> make(Args &&...args)
+	{
+		return Ptr<T>(new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...));
+	}
+
+	/// @brief Take over another arena's blocks, e.g. when an included file's statements are spliced in
+	void absorb(Arena &&other)
+	{
+		for (auto &block : other.blocks)
+		{
+			blocks.push_back(std::move(block));
+		}
+		other.blocks.clear();
+		other.cursor = other.limit = nullptr;
+	}
+
+  private:
+	static constexpr size_t blockSize = 64 * 1024;
+
+	std::vector<std::unique_ptr<std::byte[]>> blocks;
+	std::byte                                *cursor = nullptr;
+	std::byte                                *limit = nullptr;
+
+	void *allocate(size_t size, size_t align)
+	{
+		auto address = reinterpret_cast<std::uintptr_t>(cursor);
+		auto aligned = (address + align - 1) & ~(std::uintptr_t(align) - 1);
+		if (cursor == nullptr || aligned + size > reinterpret_cast<std::uintptr_t>(limit))
+		{
+			size_t bytes = std::max(blockSize, size + align);
+			blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(bytes));
+			cursor = blocks.back().get();
+			limit = cursor + bytes;
+			address = reinterpret_cast<std::uintptr_t>(cursor);
+			aligned = (address + align - 1) & ~(std::uintptr_t(align) - 1);
+		}
+		cursor += (aligned - address) + size;
+		return reinterpret_cast<void *>(aligned);
+	}
 };
 
 /// @brief Expression Node
 struct Expression : public Node
 {
+	using Node::Node;
 };
 
 /// @brief Statement Node
 struct Statement : public Node
 {
+	using Node::Node;
 };
 
-/// @brief Program Node
+/// @brief Program Node, owns the arena its nodes live in
 struct Program : public Node
 {
-	std::vector<std::unique_ptr<Statement>> statements;
-	void                                    print(int indent = 0) const override
+	static constexpr NodeKind Kind = NodeKind::Program;
+
+	Program() : Node(Kind)
+	{
+	}
+
+	std::unique_ptr<Arena>      arena = std::make_unique<Arena>(); ///< Declared first so it outlives statements
+	std::vector<Ptr<Statement>> statements;
+	void                        print(int indent = 0) const override
 	{
 		for (const auto &stmt : statements)
 		{
@@ -76,12 +226,14 @@ struct Program : public Node
 /// @brief Type Node
 struct TypeNode : public Node
 {
+	static constexpr NodeKind Kind = NodeKind::TypeNode;
+
 	std::string      name;
 	bool             isPointer = false;
 	std::vector<int> arrayDimensions;
 
 	TypeNode(std::string n, bool ptr = false, std::vector<int> dims = {})
-	    : name(std::move(n)), isPointer(ptr), arrayDimensions(std::move(dims))
+	    : Node(Kind), name(std::move(n)), isPointer(ptr), arrayDimensions(std::move(dims))
 	{
 	}
 	void print(int indent = 0) const override
@@ -97,8 +249,10 @@ struct TypeNode : public Node
 /// @brief Numeral Expression Node
 struct NumberExpr : public Expression
 {
+	static constexpr NodeKind Kind = NodeKind::NumberExpr;
+
 	std::string value;
-	NumberExpr(std::string v) : value(std::move(v))
+	NumberExpr(std::string v) : Expression(Kind), value(std::move(v))
 	{
 	}
 	void print(int indent = 0) const override
@@ -110,8 +264,10 @@ struct NumberExpr : public Expression
 /// @brief String Expression Node
 struct StringExpr : public Expression
 {
+	static constexpr NodeKind Kind = NodeKind::StringExpr;
+
 	std::string value;
-	StringExpr(std::string v) : value(std::move(v))
+	StringExpr(std::string v) : Expression(Kind), value(std::move(v))
 	{
 	}
 	void print(int indent = 0) const override
@@ -124,8 +280,10 @@ struct StringExpr : public Expression
 /// @brief Identifier Expression Node
 struct IdentifierExpr : public Expression
 {
+	static constexpr NodeKind Kind = NodeKind::IdentifierExpr;
+
 	std::string name;
-	IdentifierExpr(std::string n) : name(std::move(n))
+	IdentifierExpr(std::string n) : Expression(Kind), name(std::move(n))
 	{
 	}
 	void print(int indent = 0) const override
@@ -137,8 +295,10 @@ struct IdentifierExpr : public Expression
 /// @brief Boolean Expression Node
 struct BooleanExpr : public Expression
 {
+	static constexpr NodeKind Kind = NodeKind::BooleanExpr;
+
 	bool value;
-	BooleanExpr(bool v) : value(v)
+	BooleanExpr(bool v) : Expression(Kind), value(v)
 	{
 	}
 	void print(int indent = 0) const override
@@ -150,6 +310,11 @@ struct BooleanExpr : public Expression
 /// @brief NULL Expression Node
 struct NullExpr : public Expression
 {
+	static constexpr NodeKind Kind = NodeKind::NullExpr;
+
+	NullExpr() : Expression(Kind)
+	{
+	}
 	void print(int indent = 0) const override
 	{
 		std::cout << std::string(indent, ' ') << "Null\n";
@@ -193,10 +358,12 @@ enum class PostfixOp : u8
 /// @brief Postfix Expression Node
 struct PostfixExpr : public Expression
 {
-	PostfixOp                   op;
-	std::unique_ptr<Expression> operand;
+	static constexpr NodeKind Kind = NodeKind::PostfixExpr;
+
+	PostfixOp       op;
+	Ptr<Expression> operand;
 
-	PostfixExpr(PostfixOp o, std::unique_ptr<Expression> expr) : op(o), operand(std::move(expr))
+	PostfixExpr(PostfixOp o, Ptr<Expression> expr) : Expression(Kind), op(o), operand(std::move(expr))
 	{
 	}
 
@@ -219,10 +386,12 @@ struct PostfixExpr : public Expression
 /// @brief Unary Expression Node
 struct UnaryExpr : public Expression
 {
-	UnaryOp                     op;
-	std::unique_ptr<Expression> operand;
+	static constexpr NodeKind Kind = NodeKind::UnaryExpr;
 
-	UnaryExpr(UnaryOp o, std::unique_ptr<Expression> expr) : op(o), operand(std::move(expr))
+	UnaryOp         op;
+	Ptr<Expression> operand;
+
+	UnaryExpr(UnaryOp o, Ptr<Expression> expr) : Expression(Kind), op(o), operand(std::move(expr))
 	{
 	}
 
@@ -251,12 +420,14 @@ struct UnaryExpr : public Expression
 /// @brief Binary Expression Node
 struct BinaryExpr : public Expression
 {
-	std::unique_ptr<Expression> left;
-	BinaryOp                    op;
-	std::unique_ptr<Expression> right;
+	static constexpr NodeKind Kind = NodeKind::BinaryExpr;
+
+	Ptr<Expression> left;
+	BinaryOp        op;
+	Ptr<Expression> right;
 
-	BinaryExpr(std::unique_ptr<Expression> l, BinaryOp o, std::unique_ptr<Expression> r)
-	    : left(std::move(l)), op(o), right(std::move(r))
+	BinaryExpr(Ptr<Expression> l, BinaryOp o, Ptr<Expression> r)
+	    : Expression(Kind), left(std::move(l)), op(o), right(std::move(r))
 	{
 	}
 
@@ -313,11 +484,13 @@ struct BinaryExpr : public Expression
 /// @brief Array Access Expression Node
 struct ArrayAccessExpr : public Expression
 {
-	std::unique_ptr<Expression> array;
-	std::unique_ptr<Expression> index;
+	static constexpr NodeKind Kind = NodeKind::ArrayAccessExpr;
 
-	ArrayAccessExpr(std::unique_ptr<Expression> arr, std::unique_ptr<Expression> idx)
-	    : array(std::move(arr)), index(std::move(idx))
+	Ptr<Expression> array;
+	Ptr<Expression> index;
+
+	ArrayAccessExpr(Ptr<Expression> arr, Ptr<Expression> idx)
+	    : Expression(Kind), array(std::move(arr)), index(std::move(idx))
 	{
 	}
 
@@ -333,8 +506,10 @@ struct ArrayAccessExpr : public Expression
 /// @brief Array Literal Expression Node
 struct ArrayLiteralExpr : public Expression
 {
-	std::vector<std::unique_ptr<Expression>> elements;
-	ArrayLiteralExpr(std::vector<std::unique_ptr<Expression>> elems) : elements(std::move(elems))
+	static constexpr NodeKind Kind = NodeKind::ArrayLiteralExpr;
+
+	std::vector<Ptr<Expression>> elements;
+	ArrayLiteralExpr(std::vector<Ptr<Expression>> elems) : Expression(Kind), elements(std::move(elems))
 	{
 	}
 	void print(int indent = 0) const override
@@ -350,10 +525,13 @@ struct ArrayLiteralExpr : public Expression
 /// @brief Member Access Expression Node
 struct MemberAccessExpr : public Expression
 {
-	std::unique_ptr<Expression> object;
-	std::string                 member;
+	static constexpr NodeKind Kind = NodeKind::MemberAccessExpr;
+
+	Ptr<Expression> object;
+	std::string     member;
 
-	MemberAccessExpr(std::unique_ptr<Expression> obj, std::string mem) : object(std::move(obj)), member(std::move(mem))
+	MemberAccessExpr(Ptr<Expression> obj, std::string mem)
+	    : Expression(Kind), object(std::move(obj)), member(std::move(mem))
 	{
 	}
 
@@ -367,11 +545,13 @@ struct MemberAccessExpr : public Expression
 /// @brief Call Expression Node
 struct CallExpr : public Expression
 {
-	std::string                              callee;
-	std::vector<std::unique_ptr<Expression>> arguments;
+	static constexpr NodeKind Kind = NodeKind::CallExpr;
 
-	CallExpr(std::string name, std::vector<std::unique_ptr<Expression>> args)
-	    : callee(std::move(name)), arguments(std::move(args))
+	std::string                  callee;
+	std::vector<Ptr<Expression>> arguments;
+
+	CallExpr(std::string name, std::vector<Ptr<Expression>> args)
+	    : Expression(Kind), callee(std::move(name)), arguments(std::move(args))
 	{
 	}
 
@@ -388,11 +568,13 @@ struct CallExpr : public Expression
 /// @brief Assignment Expression Node
 struct AssignmentExpr : public Expression
 {
-	std::unique_ptr<Expression> target;
-	std::unique_ptr<Expression> value;
+	static constexpr NodeKind Kind = NodeKind::AssignmentExpr;
+
+	Ptr<Expression> target;
+	Ptr<Expression> value;
 
-	AssignmentExpr(std::unique_ptr<Expression> t, std::unique_ptr<Expression> v)
-	    : target(std::move(t)), value(std::move(v))
+	AssignmentExpr(Ptr<Expression> t, Ptr<Expression> v)
+	    : Expression(Kind), target(std::move(t)), value(std::move(v))
 	{
 	}
 
@@ -410,15 +592,17 @@ struct AssignmentExpr : public Expression
 class VarDecl : public Statement
 {
 public:
+    static constexpr NodeKind Kind = NodeKind::VarDecl;
+
     std::string name;
-    std::unique_ptr<TypeNode> type;
-    std::unique_ptr<Expression> initializer;
+    Ptr<TypeNode> type;
+    Ptr<Expression> initializer;
 
-    VarDecl(std::string name, std::unique_ptr<Expression> initializer)
-        : name(std::move(name)), type(nullptr), initializer(std::move(initializer)) {}
+    VarDecl(std::string name, Ptr<Expression> initializer)
+        : Statement(Kind), name(std::move(name)), type(nullptr), initializer(std::move(initializer)) {}
 
-    VarDecl(std::string name, std::unique_ptr<TypeNode> type, std::unique_ptr<Expression> initializer)
-        : name(std::move(name)), type(std::move(type)), initializer(std::move(initializer)) {}
+    VarDecl(std::string name, Ptr<TypeNode> type, Ptr<Expression> initializer)
+        : Statement(Kind), name(std::move(name)), type(std::move(type)), initializer(std::move(initializer)) {}
 
     void print(int indent = 0) const override
     {
@@ -438,8 +622,10 @@ public:
 /// @brief Expression Statement Node
 struct ExpressionStmt : public Statement
 {
-	std::unique_ptr<Expression> expression;
-	ExpressionStmt(std::unique_ptr<Expression> expr) : expression(std::move(expr))
+	static constexpr NodeKind Kind = NodeKind::ExpressionStmt;
+
+	Ptr<Expression> expression;
+	ExpressionStmt(Ptr<Expression> expr) : Statement(Kind), expression(std::move(expr))
 	{
 	}
 	void print(int indent = 0) const override
@@ -451,8 +637,10 @@ struct ExpressionStmt : public Statement
 /// @brief Print Statement Node
 struct PrintStmt : public Statement
 {
-	std::unique_ptr<Expression> expression;
-	PrintStmt(std::unique_ptr<Expression> expr) : expression(std::move(expr))
+	static constexpr NodeKind Kind = NodeKind::PrintStmt;
+
+	Ptr<Expression> expression;
+	PrintStmt(Ptr<Expression> expr) : Statement(Kind), expression(std::move(expr))
 	{
 	}
 	void print(int indent = 0) const override
@@ -465,8 +653,10 @@ struct PrintStmt : public Statement
 /// @brief Include Statement Node
 struct IncludeStmt : public Statement
 {
+	static constexpr NodeKind Kind = NodeKind::IncludeStmt;
+
 	std::filesystem::path modulePath;
-	IncludeStmt(std::filesystem::path path) : modulePath(std::move(path))
+	IncludeStmt(std::filesystem::path path) : Statement(Kind), modulePath(std::move(path))
 	{
 	}
 	void print(int indent = 0) const override
@@ -478,8 +668,10 @@ struct IncludeStmt : public Statement
 /// @brief Import Statement Node
 struct ImportStmt : public Statement
 {
+	static constexpr NodeKind Kind = NodeKind::ImportStmt;
+
 	std::string modulePath;
-	ImportStmt(std::string path) : modulePath(std::move(path))
+	ImportStmt(std::string path) : Statement(Kind), modulePath(std::move(path))
 	{
 	}
 	void print(int indent = 0) const override
@@ -491,8 +683,10 @@ struct ImportStmt : public Statement
 /// @brief Export Statement Node
 struct ExportStmt : public Statement
 {
-	std::unique_ptr<Statement> declaration;
-	ExportStmt(std::unique_ptr<Statement> decl) : declaration(std::move(decl))
+	static constexpr NodeKind Kind = NodeKind::ExportStmt;
+
+	Ptr<Statement> declaration;
+	ExportStmt(Ptr<Statement> decl) : Statement(Kind), declaration(std::move(decl))
 	{
 	}
 	void print(int indent = 0) const override
@@ -505,8 +699,10 @@ struct ExportStmt : public Statement
 /// @brief Block Statement Node
 struct BlockStmt : public Statement
 {
-	std::vector<std::unique_ptr<Statement>> statements;
-	BlockStmt(std::vector<std::unique_ptr<Statement>> stmts) : statements(std::move(stmts))
+	static constexpr NodeKind Kind = NodeKind::BlockStmt;
+
+	std::vector<Ptr<Statement>> statements;
+	BlockStmt(std::vector<Ptr<Statement>> stmts) : Statement(Kind), statements(std::move(stmts))
 	{
 	}
 	void print(int indent = 0) const override
@@ -522,8 +718,10 @@ struct BlockStmt : public Statement
 /// @brief Return Statement Node
 struct ReturnStmt : public Statement
 {
-	std::unique_ptr<Expression> value;
-	ReturnStmt(std::unique_ptr<Expression> val) : value(std::move(val))
+	static constexpr NodeKind Kind = NodeKind::ReturnStmt;
+
+	Ptr<Expression> value;
+	ReturnStmt(Ptr<Expression> val) : Statement(Kind), value(std::move(val))
 	{
 	}
 	void print(int indent = 0) const override
@@ -539,6 +737,11 @@ struct ReturnStmt : public Statement
 /// @brief Break Statement Node
 struct BreakStmt : public Statement
 {
+	static constexpr NodeKind Kind = NodeKind::BreakStmt;
+
+	BreakStmt() : Statement(Kind)
+	{
+	}
 	void print(int indent = 0) const override
 	{
 		std::cout << std::string(indent, ' ') << "BreakStmt\n";
@@ -548,6 +751,11 @@ struct BreakStmt : public Statement
 /// @brief Continue Statement Node
 struct ContinueStmt : public Statement
 {
+	static constexpr NodeKind Kind = NodeKind::ContinueStmt;
+
+	ContinueStmt() : Statement(Kind)
+	{
+	}
 	void print(int indent = 0) const override
 	{
 		std::cout << std::string(indent, ' ') << "ContinueStmt\n";
@@ -557,12 +765,14 @@ struct ContinueStmt : public Statement
 /// @brief If Statement Node
 struct IfStmt : public Statement
 {
-	std::unique_ptr<Expression> condition;
-	std::unique_ptr<Statement>  thenBranch;
-	std::unique_ptr<Statement>  elseBranch;
+	static constexpr NodeKind Kind = NodeKind::IfStmt;
 
-	IfStmt(std::unique_ptr<Expression> cond, std::unique_ptr<Statement> thenB, std::unique_ptr<Statement> elseB)
-	    : condition(std::move(cond)), thenBranch(std::move(thenB)), elseBranch(std::move(elseB))
+	Ptr<Expression> condition;
+	Ptr<Statement>  thenBranch;
+	Ptr<Statement>  elseBranch;
+
+	IfStmt(Ptr<Expression> cond, Ptr<Statement> thenB, Ptr<Statement> elseB)
+	    : Statement(Kind), condition(std::move(cond)), thenBranch(std::move(thenB)), elseBranch(std::move(elseB))
 	{
 	}
 
@@ -582,11 +792,13 @@ struct IfStmt : public Statement
 /// @brief While Statement Node
 struct WhileStmt : public Statement
 {
-	std::unique_ptr<Expression> condition;
-	std::unique_ptr<Statement>  body;
+	static constexpr NodeKind Kind = NodeKind::WhileStmt;
+
+	Ptr<Expression> condition;
+	Ptr<Statement>  body;
 
-	WhileStmt(std::unique_ptr<Expression> cond, std::unique_ptr<Statement> b)
-	    : condition(std::move(cond)), body(std::move(b))
+	WhileStmt(Ptr<Expression> cond, Ptr<Statement> b)
+	    : Statement(Kind), condition(std::move(cond)), body(std::move(b))
 	{
 	}
 
@@ -601,14 +813,16 @@ struct WhileStmt : public Statement
 /// @brief For Statement Node
 struct ForStmt : public Statement
 {
-	std::unique_ptr<Statement>  initializer;
-	std::unique_ptr<Expression> condition;
-	std::unique_ptr<Expression> increment;
-	std::unique_ptr<Statement>  body;
+	static constexpr NodeKind Kind = NodeKind::ForStmt;
+
+	Ptr<Statement>  initializer;
+	Ptr<Expression> condition;
+	Ptr<Expression> increment;
+	Ptr<Statement>  body;
 
-	ForStmt(std::unique_ptr<Statement> init, std::unique_ptr<Expression> cond, std::unique_ptr<Expression> incr,
-	        std::unique_ptr<Statement> b)
-	    : initializer(std::move(init)), condition(std::move(cond)), increment(std::move(incr)), body(std::move(b))
+	ForStmt(Ptr<Statement> init, Ptr<Expression> cond, Ptr<Expression> incr, Ptr<Statement> b)
+	    : Statement(Kind), initializer(std::move(init)), condition(std::move(cond)), increment(std::move(incr)),
+	      body(std::move(b))
 	{
 	}
 
@@ -634,8 +848,10 @@ struct ForStmt : public Statement
 /// @brief Unsafe Block Statement Node
 struct UnsafeBlockStmt : public Statement
 {
-	std::unique_ptr<BlockStmt> block;
-	UnsafeBlockStmt(std::unique_ptr<BlockStmt> b) : block(std::move(b))
+	static constexpr NodeKind Kind = NodeKind::UnsafeBlockStmt;
+
+	Ptr<BlockStmt> block;
+	UnsafeBlockStmt(Ptr<BlockStmt> b) : Statement(Kind), block(std::move(b))
 	{
 	}
 	void print(int indent = 0) const override
@@ -648,18 +864,20 @@ struct UnsafeBlockStmt : public Statement
 /// @brief Function Declaration Node
 struct FunctionDecl : public Statement
 {
+	static constexpr NodeKind Kind = NodeKind::FunctionDecl;
+
 	std::string name;
 	struct Param
 	{
 		std::string               name;
-		std::unique_ptr<TypeNode> type;
+		Ptr<TypeNode> type;
 	};
-	std::vector<Param>         params;
-	std::unique_ptr<TypeNode>  returnType;
-	std::unique_ptr<BlockStmt> body;
+	std::vector<Param> params;
+	Ptr<TypeNode>      returnType;
+	Ptr<BlockStmt>     body;
 
-	FunctionDecl(std::string n, std::vector<Param> p, std::unique_ptr<TypeNode> rt, std::unique_ptr<BlockStmt> b)
-	    : name(std::move(n)), params(std::move(p)), returnType(std::move(rt)), body(std::move(b))
+	FunctionDecl(std::string n, std::vector<Param> p, Ptr<TypeNode> rt, Ptr<BlockStmt> b)
+	    : Statement(Kind), name(std::move(n)), params(std::move(p)), returnType(std::move(rt)), body(std::move(b))
 	{
 	}
 
@@ -690,10 +908,10 @@ struct FunctionDecl : public Statement
 /// @brief Struct Field Node
 struct StructField
 {
-	std::string               name;
-	std::unique_ptr<TypeNode> type;
+	std::string   name;
+	Ptr<TypeNode> type;
 
-	StructField(std::string n, std::unique_ptr<TypeNode> t) : name(std::move(n)), type(std::move(t))
+	StructField(std::string n, Ptr<TypeNode> t) : name(std::move(n)), type(std::move(t))
 	{
 	}
 };
@@ -701,10 +919,12 @@ struct StructField
 /// @brief Struct Declaration Node
 struct StructDecl : public Statement
 {
+	static constexpr NodeKind Kind = NodeKind::StructDecl;
+
 	std::string              name;
 	std::vector<StructField> fields;
 
-	StructDecl(std::string n, std::vector<StructField> f) : name(std::move(n)), fields(std::move(f))
+	StructDecl(std::string n, std::vector<StructField> f) : Statement(Kind), name(std::move(n)), fields(std::move(f))
 	{
 	}
 
@@ -722,11 +942,13 @@ struct StructDecl : public Statement
 /// @brief Struct Instance Expression Node
 struct StructInstanceExpr : public Expression
 {
-	std::string                                                      structName;
-	std::vector<std::pair<std::string, std::unique_ptr<Expression>>> fieldValues;
+	static constexpr NodeKind Kind = NodeKind::StructInstanceExpr;
+
+	std::string                                          structName;
+	std::vector<std::pair<std::string, Ptr<Expression>>> fieldValues;
 
-	StructInstanceExpr(std::string name, std::vector<std::pair<std::string, std::unique_ptr<Expression>>> fields)
-	    : structName(std::move(name)), fieldValues(std::move(fields))
+	StructInstanceExpr(std::string name, std::vector<std::pair<std::string, Ptr<Expression>>> fields)
+	    : Expression(Kind), structName(std::move(name)), fieldValues(std::move(fields))
 	{
 	}
 
@@ -744,11 +966,13 @@ struct StructInstanceExpr : public Expression
 /// @brief Field Access Expression Node
 struct FieldAccessExpr : public Expression
 {
-	std::unique_ptr<Expression> object;
-	std::string                 fieldName;
+	static constexpr NodeKind Kind = NodeKind::FieldAccessExpr;
 
-	FieldAccessExpr(std::unique_ptr<Expression> obj, std::string field)
-	    : object(std::move(obj)), fieldName(std::move(field))
+	Ptr<Expression> object;
+	std::string     fieldName;
+
+	FieldAccessExpr(Ptr<Expression> obj, std::string field)
+	    : Expression(Kind), object(std::move(obj)), fieldName(std::move(field))
 	{
 	}
 
@@ -762,10 +986,10 @@ struct FieldAccessExpr : public Expression
 /// @brief Case Clause Node
 struct CaseClause
 {
-	std::unique_ptr<Expression>             value;
-	std::vector<std::unique_ptr<Statement>> statements;
+	Ptr<Expression>             value;
+	std::vector<Ptr<Statement>> statements;
 
-	CaseClause(std::unique_ptr<Expression> v, std::vector<std::unique_ptr<Statement>> stmts)
+	CaseClause(Ptr<Expression> v, std::vector<Ptr<Statement>> stmts)
 	    : value(std::move(v)), statements(std::move(stmts))
 	{
 	}
@@ -774,12 +998,14 @@ struct CaseClause
 /// @brief Switch Statement Node
 struct SwitchStmt : public Statement
 {
-	std::unique_ptr<Expression>             expr;
-	std::vector<CaseClause>                 cases;
-	std::vector<std::unique_ptr<Statement>> defaultStmts;
+	static constexpr NodeKind Kind = NodeKind::SwitchStmt;
+
+	Ptr<Expression>             expr;
+	std::vector<CaseClause>     cases;
+	std::vector<Ptr<Statement>> defaultStmts;
 
-	SwitchStmt(std::unique_ptr<Expression> e, std::vector<CaseClause> c, std::vector<std::unique_ptr<Statement>> d)
-	    : expr(std::move(e)), cases(std::move(c)), defaultStmts(std::move(d))
+	SwitchStmt(Ptr<Expression> e, std::vector<CaseClause> c, std::vector<Ptr<Statement>> d)
+	    : Statement(Kind), expr(std::move(e)), cases(std::move(c)), defaultStmts(std::move(d))
 	{
 	}
 
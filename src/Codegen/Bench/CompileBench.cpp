@@ -0,0 +1,111 @@
+// Front-end compile-time benchmark, built with -DBENCHMARKS=ON
+//
+//   phasor_compile_bench [megabytes] [iterations] [file.phs]
+//
+// Times lexing, parsing and bytecode generation separately. Without a file,
+// compiles a generated multi-megabyte script of functions, structs, loops,
+// switches and nested expressions.
+#include "../CodeGen.hpp"
+#include "../../Language/Phasor/Lexer/Lexer.hpp"
+#include "../../Language/Phasor/Parser/Parser.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <print>
+#include <string>
+
+static std::string generateSource(size_t bytes)
+{
+	std::string source = "struct Vec { x: int, y: int }\n\n";
+	source.reserve(bytes + 1024);
+	for (size_t i = 0; source.size() < bytes; ++i)
+	{
+		std::string n = std::to_string(i);
+		source += "fn step_" + n + "(seed: int) -> int {\n";
+		source += "    var total: int = seed * " + n + " + (seed - 3) * (seed + 7) / 2;\n";
+		source += "    var point: Vec = Vec { x: seed, y: total % 11 };\n";
+		source += "    var items: int[4] = [1, 2, 3, 4];\n";
+		source += "    for (var k: int = 0; k < 4; k++) {\n";
+		source += "        total = total + items[k] * point.x - point.y;\n";
+		source += "        if (total > 1000 && k != 2 || total < -1000) { total = total / 2; } else { total = total + 1; }\n";
+		source += "    }\n";
+		source += "    switch (total % 3) {\n";
+		source += "        case 0: total = total + 1;\n";
+		source += "        case 1: total = total - 1;\n";
+		source += "        default: total = -total;\n";
+		source += "    }\n";
+		source += "    return total;\n";
+		source += "}\n\n";
+	}
+	source += "print(step_0(5));\n";
+	return source;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4;
+	int    iterations = argc > 2 ? std::atoi(argv[2]) : 5;
+	iterations = std::max(iterations, 1);
+
+	std::string source;
+	if (argc > 3)
+	{
+		std::ifstream file(argv[3], std::ios::binary);
+		if (!file.is_open())
+		{
+			std::println(stderr, "Could not open file {}", argv[3]);
+			return 1;
+		}
+		source.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+	else
+	{
+		source = generateSource(megabytes * 1024 * 1024);
+	}
+
+	using Clock = std::chrono::steady_clock;
+	auto since = [](Clock::time_point start) { return std::chrono::duration<double>(Clock::now() - start).count(); };
+
+	double bestLex = 0, bestParse = 0, bestCodegen = 0, bestTotal = 0;
+	size_t instructions = 0;
+	for (int i = 0; i < iterations; ++i)
+	{
+		auto start = Clock::now();
+
+		auto          phase = Clock::now();
+		Phasor::Lexer lexer(source);
+		auto          tokens = lexer.tokenize();
+		double        lex = since(phase);
+
+		phase = Clock::now();
+		Phasor::Parser parser(std::move(tokens));
+		auto           program = parser.parse();
+		double         parse = since(phase);
+
+		phase = Clock::now();
+		Phasor::CodeGenerator codegen;
+		auto                  bytecode = codegen.generate(*program);
+		double                generate = since(phase);
+
+		// Tearing the AST down is part of the cost of a compile
+		program.reset();
+		double total = since(start);
+
+		instructions = bytecode.instructions.size();
+		bool first = i == 0;
+		bestLex = first ? lex : std::min(bestLex, lex);
+		bestParse = first ? parse : std::min(bestParse, parse);
+		bestCodegen = first ? generate : std::min(bestCodegen, generate);
+		bestTotal = first ? total : std::min(bestTotal, total);
+	}
+
+	double mb = static_cast<double>(source.size()) / (1024.0 * 1024.0);
+	std::println("{:.2f} MiB, {} instructions, best of {}:", mb, instructions, iterations);
+	std::println("  lex      {:8.2f} ms", bestLex * 1000.0);
+	std::println("  parse    {:8.2f} ms", bestParse * 1000.0);
+	std::println("  codegen  {:8.2f} ms", bestCodegen * 1000.0);
+	std::println("  total    {:8.2f} ms ({:.1f} MiB/s)", bestTotal * 1000.0, mb / bestTotal);
+	return 0;
+}
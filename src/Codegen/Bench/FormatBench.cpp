@@ -0,0 +1,96 @@
+// Bytecode format benchmark, built with -DBENCHMARKS=ON
+//
+//   phasor_format_bench [functions] [iterations]
+//
+// Serializes and deserializes a generated program with fixed-width instruction
+// records, which phasorvm runs in place, and with compact varint instructions
+// (phasorcompiler --compact), and prints the file size of each.
+#include "../Bytecode/BytecodeDeserializer.hpp"
+#include "../Bytecode/BytecodeSerializer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <print>
+#include <string>
+
+// Roughly what the compiler emits for small functions: a few locals, arithmetic in both
+// the stack and register forms, a branch and a call, plus a name and two numbers per function
+static Phasor::Bytecode generateBytecode(size_t functions)
+{
+	using Phasor::OpCode;
+	Phasor::Bytecode bytecode;
+	bytecode.instructions.reserve(functions * 12 + 1);
+	for (size_t f = 0; f < functions; ++f)
+	{
+		std::string name = "function_" + std::to_string(f);
+		int         self = bytecode.addStringConstant(name);
+		int         number = bytecode.addConstant(Phasor::Value(static_cast<Phasor::i64>(f * 37)));
+		int         ratio = bytecode.addConstant(Phasor::Value(static_cast<Phasor::f64>(f) / 3.0));
+		int         local = bytecode.nextVarIndex++;
+		bytecode.variables[name + "_local"] = local;
+
+		int entry = static_cast<int>(bytecode.instructions.size());
+		bytecode.functionEntries[name] = entry;
+		bytecode.functionParamCounts[name] = 1;
+		bytecode.functionParamTypeNames[name] = {"int"};
+		bytecode.functionReturnTypeNames[name] = "int";
+
+		bytecode.instructions.emplace_back(OpCode::STORE_VAR, local);
+		bytecode.instructions.emplace_back(OpCode::LOAD_VAR, local);
+		bytecode.instructions.emplace_back(OpCode::PUSH_CONST, number);
+		bytecode.instructions.emplace_back(OpCode::IADD);
+		bytecode.instructions.emplace_back(OpCode::JUMP_IF_FALSE, entry + 11);
+		bytecode.instructions.emplace_back(OpCode::LOAD_CONST_R, 1, ratio);
+		bytecode.instructions.emplace_back(OpCode::LOAD_VAR_R, 2, local);
+		bytecode.instructions.emplace_back(OpCode::IADD_R, 0, 1, 2);
+		bytecode.instructions.emplace_back(OpCode::STORE_VAR_R, 0, local);
+		bytecode.instructions.emplace_back(OpCode::LOAD_VAR, local);
+		bytecode.instructions.emplace_back(OpCode::CALL, self);
+		bytecode.instructions.emplace_back(OpCode::RETURN);
+	}
+	bytecode.instructions.emplace_back(OpCode::HALT);
+	return bytecode;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t functions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+	int    iterations = argc > 2 ? std::atoi(argv[2]) : 5;
+	iterations = std::max(iterations, 1);
+
+	Phasor::Bytecode bytecode = generateBytecode(functions);
+
+	using Clock = std::chrono::steady_clock;
+	auto since = [](Clock::time_point start) { return std::chrono::duration<double>(Clock::now() - start).count(); };
+
+	std::println("{} functions, {} instructions, {} constants, best of {}:", functions, bytecode.instructions.size(),
+	             bytecode.constants.size(), iterations);
+	for (bool compact : {false, true})
+	{
+		double                  bestWrite = 0, bestRead = 0;
+		std::vector<Phasor::u8> data;
+		for (int i = 0; i < iterations; ++i)
+		{
+			auto                       start = Clock::now();
+			Phasor::BytecodeSerializer serializer({.compactInstructions = compact});
+			data = serializer.serialize(bytecode);
+			double write = since(start);
+
+			start = Clock::now();
+			Phasor::BytecodeDeserializer deserializer;
+			auto                         decoded = deserializer.deserialize(data);
+			double                       read = since(start);
+			if (decoded.instructions.size() != bytecode.instructions.size())
+			{
+				std::println(stderr, "Round trip lost instructions");
+				return 1;
+			}
+
+			bestWrite = i == 0 ? write : std::min(bestWrite, write);
+			bestRead = i == 0 ? read : std::min(bestRead, read);
+		}
+		std::println("  {:<8} {:8.2f} MiB  serialize {:8.2f} ms  deserialize {:8.2f} ms", compact ? "compact" : "fixed",
+		             static_cast<double>(data.size()) / (1024.0 * 1024.0), bestWrite * 1000.0, bestRead * 1000.0);
+	}
+	return 0;
+}
@@ -0,0 +1,136 @@
+// Bytecode load-time benchmark, built with -DBENCHMARKS=ON
+//
+//   phasor_load_bench [instructions] [iterations] [file.phsb]
+//
+// Compares decoding a whole .phsb with BytecodeDeserializer against mapping it
+// with BytecodeImage, which is what phasorvm does, and shows how much of the
+// mapped load is checksum verification. Without a file, writes a generated
+// image with one string constant per four instructions.
+#include "../Bytecode/BytecodeDeserializer.hpp"
+#include "../Bytecode/BytecodeImage.hpp"
+#include "../Bytecode/BytecodeSerializer.hpp"
+#include "../Bytecode/Checksum.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <print>
+#include <string>
+#include <vector>
+
+static Phasor::Bytecode generateBytecode(size_t instructions)
+{
+	Phasor::Bytecode bytecode;
+	bytecode.instructions.reserve(instructions);
+	for (size_t i = 0; i < instructions; ++i)
+	{
+		if (i % 4 == 0)
+		{
+			int index = static_cast<int>(bytecode.constants.size());
+			bytecode.constants.emplace_back("constant string number " + std::to_string(i));
+			bytecode.instructions.emplace_back(Phasor::OpCode::PUSH_CONST, index);
+		}
+		else
+		{
+			bytecode.instructions.emplace_back(Phasor::OpCode::POP);
+		}
+	}
+	bytecode.instructions.emplace_back(Phasor::OpCode::HALT);
+	return bytecode;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+	int    iterations = argc > 2 ? std::atoi(argv[2]) : 5;
+	iterations = std::max(iterations, 1);
+
+	std::filesystem::path path;
+	bool                  generated = argc <= 3;
+	if (generated)
+	{
+		path = std::filesystem::temp_directory_path() / "phasor_load_bench.phsb";
+		Phasor::BytecodeSerializer serializer;
+		if (!serializer.saveToFile(generateBytecode(count), path))
+		{
+			std::println(stderr, "Could not write {}", path.string());
+			return 1;
+		}
+	}
+	else
+	{
+		path = argv[3];
+	}
+
+	using Clock = std::chrono::steady_clock;
+	auto since = [](Clock::time_point start) { return std::chrono::duration<double>(Clock::now() - start).count(); };
+
+	std::ifstream           file(path, std::ios::binary);
+	std::vector<Phasor::u8> bytes{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+	// Results go here so the checksums can't be optimized away
+	volatile size_t sink = 0;
+	double          bestDecode = 0, bestMap = 0, bestFirst = 0, bestTrusted = 0, bestCrc32c = 0, bestSoftware = 0;
+	size_t instructions = 0;
+	bool   mapped = false;
+	for (int i = 0; i < iterations; ++i)
+	{
+		auto                         start = Clock::now();
+		Phasor::BytecodeDeserializer deserializer;
+		auto                         bytecode = deserializer.loadFromFile(path);
+		double                       decode = since(start);
+
+		start = Clock::now();
+		Phasor::BytecodeImage image(path);
+		double                map = since(start);
+
+		// What a short run pays on top: the first instruction and a few constants
+		start = Clock::now();
+		size_t touched = 0;
+		for (size_t c = 0; c < image.constantCount(); c += std::max<size_t>(image.constantCount() / 16, 1))
+			touched += image.constant(c).isString() ? 1 : 0;
+		if (image.instructionCount() > 0)
+			touched += static_cast<size_t>(image.instructions()[0].op);
+		double first = since(start) + map;
+
+		start = Clock::now();
+		Phasor::BytecodeImage trustedImage(path, {.verifyChecksums = false});
+		double                trusted = since(start);
+
+		start = Clock::now();
+		touched += Phasor::Checksum::crc32c(bytes.data(), bytes.size());
+		double crc32c = since(start);
+
+		start = Clock::now();
+		touched += Phasor::Checksum::crc32cSoftware(bytes.data(), bytes.size());
+		double software = since(start);
+
+		instructions = bytecode.instructions.size();
+		mapped = image.isMapped();
+		bool firstRun = i == 0;
+		bestDecode = firstRun ? decode : std::min(bestDecode, decode);
+		bestMap = firstRun ? map : std::min(bestMap, map);
+		bestFirst = firstRun ? first : std::min(bestFirst, first);
+		bestTrusted = firstRun ? trusted : std::min(bestTrusted, trusted);
+		bestCrc32c = firstRun ? crc32c : std::min(bestCrc32c, crc32c);
+		bestSoftware = firstRun ? software : std::min(bestSoftware, software);
+		sink = sink + touched;
+	}
+
+	double mb = static_cast<double>(std::filesystem::file_size(path)) / (1024.0 * 1024.0);
+	std::println("{:.2f} MiB, {} instructions, best of {}{}:", mb, instructions, iterations,
+	             mapped ? "" : " (image not mapped in place)");
+	std::println("  decode   {:8.2f} ms  BytecodeDeserializer::loadFromFile", bestDecode * 1000.0);
+	std::println("  map      {:8.2f} ms  BytecodeImage", bestMap * 1000.0);
+	std::println("  +touch   {:8.2f} ms  BytecodeImage, first instruction and 16 constants", bestFirst * 1000.0);
+	std::println("  trusted  {:8.2f} ms  BytecodeImage without checksum verification", bestTrusted * 1000.0);
+	std::println("  crc32c   {:8.2f} ms  whole file, {} ({:.0f}% of map)", bestCrc32c * 1000.0,
+	             Phasor::Checksum::crc32cImplementation(), bestMap > 0 ? 100.0 * bestCrc32c / bestMap : 0.0);
+	std::println("  software {:8.2f} ms  whole file, slicing-by-8", bestSoftware * 1000.0);
+
+	if (generated)
+		std::filesystem::remove(path);
+	return 0;
+}
@@ -1,9 +1,12 @@
 #include "BytecodeDeserializer.hpp"
+#include "Checksum.hpp"
 #include <cstring>
 #include <stdexcept>
 #include <filesystem>
 #include <phsint.hpp>
 #include "metadata.h"
+#include "../IR/PhasorIR.hpp"
+#include <limits>
 
 // Section IDs — must match BytecodeSerializer.cpp
 const Phasor::u8 SECTION_CONSTANTS    = 0x01;
@@ -12,39 +15,37 @@ const Phasor::u8 SECTION_INSTRUCTIONS = 0x03;
 const Phasor::u8 SECTION_FUNCTIONS    = 0x04;
 const Phasor::u8 SECTION_STRUCTS      = 0x05;
 const Phasor::u8 SECTION_FUNC_TYPES   = 0x06;
+const Phasor::u8 SECTION_SWITCHES     = 0x07;
+const Phasor::u8 SECTION_INDEX        = 0x08;
 
-static Phasor::u32 crc32_table[256];
-static bool        crc32_table_initialized = false;
+namespace Phasor
+{
 
-void init_crc32_table_deserializer()
+static const char *sectionName(u8 id)
 {
-	for (Phasor::u32 i = 0; i < 256; i++)
+	switch (id)
 	{
-		Phasor::u32 crc = i;
-		for (int j = 0; j < 8; j++)
-		{
-			if ((crc & 1) != 0u)
-				crc = (crc >> 1) ^ 0xEDB88320;
-			else
-				crc >>= 1;
-		}
-		crc32_table[i] = crc;
+	case SECTION_CONSTANTS:
+		return "constant pool";
+	case SECTION_VARIABLES:
+		return "variables";
+	case SECTION_INSTRUCTIONS:
+		return "instructions";
+	case SECTION_FUNCTIONS:
+		return "functions";
+	case SECTION_STRUCTS:
+		return "structs";
+	case SECTION_FUNC_TYPES:
+		return "function types";
+	case SECTION_SWITCHES:
+		return "switch tables";
+	default:
+		return "unknown";
 	}
-	crc32_table_initialized = true;
 }
 
-namespace Phasor
-{
-
-u32 BytecodeDeserializer::calculateCRC32(const u8 *data, size_t size)
+BytecodeDeserializer::BytecodeDeserializer(Options options) : options(options)
 {
-	if (!crc32_table_initialized)
-		init_crc32_table_deserializer();
-
-	u32 crc = 0xFFFFFFFF;
-	for (size_t i = 0; i < size; i++)
-		crc = (crc >> 8) ^ crc32_table[(crc ^ data[i]) & 0xFF];
-	return crc ^ 0xFFFFFFFF;
 }
 
 // ---------------------------------------------------------------------------
@@ -89,6 +90,50 @@ i64 BytecodeDeserializer::readInt64()
 	return value;
 }
 
+u64 BytecodeDeserializer::readVarUInt()
+{
+	u64 value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		u8 byte = readUInt8();
+		value |= static_cast<u64>(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+			return value;
+	}
+	throw std::runtime_error("Bytecode file corrupted: varint too long");
+}
+
+i64 BytecodeDeserializer::readVarInt()
+{
+	u64 zigzag = readVarUInt();
+	return static_cast<i64>(zigzag >> 1) ^ -static_cast<i64>(zigzag & 1);
+}
+
+u32 BytecodeDeserializer::readCount()
+{
+	if (version == VERSION_3)
+		return readUInt32();
+	u64 value = readVarUInt();
+	if (value > std::numeric_limits<u32>::max())
+		throw std::runtime_error("Bytecode file corrupted: count out of range");
+	return static_cast<u32>(value);
+}
+
+i32 BytecodeDeserializer::readIndex()
+{
+	if (version == VERSION_3)
+		return readInt32();
+	i64 value = readVarInt();
+	if (value < std::numeric_limits<i32>::min() || value > std::numeric_limits<i32>::max())
+		throw std::runtime_error("Bytecode file corrupted: index out of range");
+	return static_cast<i32>(value);
+}
+
+i64 BytecodeDeserializer::readInteger()
+{
+	return version == VERSION_3 ? readInt64() : readVarInt();
+}
+
 f64 BytecodeDeserializer::readDouble()
 {
 	u64 bits = 0;
@@ -101,11 +146,11 @@ f64 BytecodeDeserializer::readDouble()
 
 std::string BytecodeDeserializer::readString()
 {
-	u16         length = readUInt16();
-	std::string str;
-	str.reserve(length);
-	for (u16 i = 0; i < length; i++)
-		str.push_back(static_cast<char>(readUInt8()));
+	u32 length = version == VERSION_3 ? readUInt16() : readCount();
+	if (length > dataSize - position)
+		throw std::runtime_error("Unexpected end of bytecode data");
+	std::string str(reinterpret_cast<const char *>(_data + position), length);
+	position += length;
 	return str;
 }
 
@@ -125,7 +170,7 @@ Value BytecodeDeserializer::readValue()
 		return Value{readUInt8() != 0};
 
 	case 2: // Int
-		return Value{readInt64()};
+		return Value{readInteger()};
 
 	case 3: // Float
 		return Value{readDouble()};
@@ -136,7 +181,7 @@ Value BytecodeDeserializer::readValue()
 	case 5: // Struct
 	{
 		std::string typeName   = readString();
-		u32         fieldCount = readUInt32();
+		u32         fieldCount = readCount();
 
 		Value structVal = Value::createStruct(PhsString(typeName));
 		for (u32 i = 0; i < fieldCount; ++i)
@@ -150,7 +195,7 @@ Value BytecodeDeserializer::readValue()
 
 	case 6: // Array
 	{
-		u32                elementCount = readUInt32();
+		u32                elementCount = readCount();
 		std::vector<Value> elements;
 		elements.reserve(elementCount);
 		for (u32 i = 0; i < elementCount; ++i)
@@ -174,26 +219,135 @@ void BytecodeDeserializer::readHeader(u32 &checksum)
 	if (magic != MAGIC_NUMBER)
 		throw std::runtime_error("Invalid bytecode file: incorrect magic number");
 
-	u32 version = readUInt32();
-	if (version != VERSION)
+	version = readUInt32();
+	if (version != VERSION && version != VERSION_4_1 && version != VERSION_3)
 		throw std::runtime_error("Incompatible bytecode version");
 
-	u32 flags = readUInt32(); // Reserved
-	(void)flags;
+	flags = readUInt32();
+	if (version == VERSION_3)
+		flags = 0; // Reserved
+	else if ((flags & ~(FLAG_SECTION_INDEX | FLAG_COMPACT_INSTRUCTIONS)) != 0)
+		throw std::runtime_error("Incompatible bytecode: unknown flags");
 
 	checksum = readUInt32();
 }
 
+/**
+ * @brief Read the section index (0x08), present when FLAG_SECTION_INDEX is set.
+ *
+ * Sections are then read from their recorded offsets, so ones this reader
+ * doesn't know are skipped. Version 4.1 entries have no checksum.
+ */
+void BytecodeDeserializer::readSectionIndex()
+{
+	sections.clear();
+	if ((flags & FLAG_SECTION_INDEX) == 0)
+		return;
+
+	u8 sectionId = readUInt8();
+	if (sectionId != SECTION_INDEX)
+		throw std::runtime_error("Expected section index");
+
+	u8 count = readUInt8();
+	sections.reserve(count);
+	for (u8 i = 0; i < count; i++)
+	{
+		SectionEntry entry{};
+		entry.id = readUInt8();
+		entry.offset = readUInt32();
+		entry.size = readUInt32();
+		entry.checksum = version == VERSION_4_1 ? 0 : readUInt32();
+		sections.push_back(entry);
+	}
+}
+
+bool BytecodeDeserializer::inRange(const SectionEntry &entry) const
+{
+	return entry.offset >= indexEnd && entry.offset <= dataSize && entry.size <= dataSize - entry.offset;
+}
+
+/**
+ * @brief Check the header checksum, and with a section index every section's.
+ *
+ * Versions 3 and 4.1 have one CRC32 over everything after the header. Since
+ * then it is a CRC32C, and with an index it covers only the index, whose
+ * entries carry the CRC32C of each section.
+ */
+void BytecodeDeserializer::verifyChecksums(size_t dataStart, u32 checksum)
+{
+	if (version != VERSION)
+	{
+		if (Checksum::crc32(_data + dataStart, dataSize - dataStart) != checksum)
+			throw std::runtime_error("Bytecode file corrupted: checksum mismatch");
+		return;
+	}
+
+	size_t checked = sections.empty() ? dataSize - dataStart : indexEnd - dataStart;
+	if (Checksum::crc32c(_data + dataStart, checked) != checksum)
+		throw std::runtime_error(sections.empty() ? "Bytecode file corrupted: checksum mismatch"
+		                                          : "Bytecode file corrupted: checksum mismatch in section index");
+	for (const auto &entry : sections)
+	{
+		// Bad ranges in an index that passed its checksum are reported by read()
+		if (inRange(entry) && Checksum::crc32c(_data + entry.offset, entry.size) != entry.checksum)
+			throw std::runtime_error(std::string("Bytecode file corrupted: checksum mismatch in ") +
+			                         sectionName(entry.id) + " section");
+	}
+}
+
+bool BytecodeDeserializer::seekSection(u8 id)
+{
+	if (sections.empty())
+		return position < dataSize && _data[position] == id;
+
+	for (const auto &entry : sections)
+	{
+		if (entry.id == id)
+		{
+			position = entry.offset;
+			return true;
+		}
+	}
+	return false;
+}
+
 void BytecodeDeserializer::readConstantPool(Bytecode &bytecode)
 {
 	u8 sectionId = readUInt8();
 	if (sectionId != SECTION_CONSTANTS)
 		throw std::runtime_error("Expected constant pool section");
 
-	u32 count = readUInt32();
-	bytecode.constants.reserve(count);
-	for (u32 i = 0; i < count; i++)
-		bytecode.constants.push_back(readValue());
+	u32 count = readCount();
+	if (version == VERSION_3)
+	{
+		bytecode.constants.reserve(count);
+		for (u32 i = 0; i < count; i++)
+			bytecode.constants.push_back(readValue());
+		return;
+	}
+
+	u32    payloadSize = readCount();
+	size_t tableStart = position;
+	if (count > (dataSize - tableStart) / sizeof(u32) || payloadSize > dataSize - tableStart - count * sizeof(u32))
+		throw std::runtime_error("Unexpected end of bytecode data");
+	size_t payloadStart = tableStart + count * sizeof(u32);
+
+	if (layout != nullptr)
+	{
+		layout->constantCount = count;
+		layout->constantOffsets = _data + tableStart;
+		layout->constantData = _data + payloadStart;
+		layout->constantDataSize = payloadSize;
+	}
+	else
+	{
+		// Values are stored back to back in index order, the table is only needed for random access
+		position = payloadStart;
+		bytecode.constants.reserve(count);
+		for (u32 i = 0; i < count; i++)
+			bytecode.constants.push_back(readValue());
+	}
+	position = payloadStart + payloadSize;
 }
 
 void BytecodeDeserializer::readVariableMapping(Bytecode &bytecode)
@@ -202,12 +356,12 @@ void BytecodeDeserializer::readVariableMapping(Bytecode &bytecode)
 	if (sectionId != SECTION_VARIABLES)
 		throw std::runtime_error("Expected variable mapping section");
 
-	u32 count = readUInt32();
-	bytecode.nextVarIndex = readInt32();
+	u32 count = readCount();
+	bytecode.nextVarIndex = readIndex();
 	for (u32 i = 0; i < count; i++)
 	{
 		std::string name  = readString();
-		i32         index = readInt32();
+		i32         index = readIndex();
 		bytecode.variables[name] = index;
 	}
 }
@@ -218,16 +372,55 @@ void BytecodeDeserializer::readInstructions(Bytecode &bytecode)
 	if (sectionId != SECTION_INSTRUCTIONS)
 		throw std::runtime_error("Expected instructions section");
 
-	u32 count = readUInt32();
-	bytecode.instructions.reserve(count);
-	for (u32 i = 0; i < count; i++)
+	u32 count = readCount();
+	if (version == VERSION_3)
+	{
+		bytecode.instructions.reserve(count);
+		for (u32 i = 0; i < count; i++)
+		{
+			u8  opcode = readUInt8();
+			i32 op1    = readInt32();
+			i32 op2    = readInt32();
+			i32 op3    = readInt32();
+			bytecode.instructions.emplace_back(static_cast<OpCode>(opcode), op1, op2, op3);
+		}
+		return;
+	}
+
+	if ((flags & FLAG_COMPACT_INSTRUCTIONS) != 0)
 	{
-		u8  opcode = readUInt8();
-		i32 op1    = readInt32();
-		i32 op2    = readInt32();
-		i32 op3    = readInt32();
-		bytecode.instructions.emplace_back(static_cast<OpCode>(opcode), op1, op2, op3);
+		bytecode.instructions.reserve(count);
+		for (u32 i = 0; i < count; i++)
+		{
+			auto opcode = static_cast<OpCode>(readUInt8());
+			i32  operands[3] = {0, 0, 0};
+			for (int o = 0; o < PhasorIR::getOperandCount(opcode); o++)
+				operands[o] = readIndex();
+			bytecode.instructions.emplace_back(opcode, operands[0], operands[1], operands[2]);
+		}
+		return;
 	}
+
+	position = (position + INSTRUCTION_ALIGNMENT - 1) / INSTRUCTION_ALIGNMENT * INSTRUCTION_ALIGNMENT;
+	if (position > dataSize || count > (dataSize - position) / INSTRUCTION_RECORD_SIZE)
+		throw std::runtime_error("Unexpected end of bytecode data");
+	const u8 *records = _data + position;
+	position += static_cast<size_t>(count) * INSTRUCTION_RECORD_SIZE;
+	if (layout != nullptr)
+	{
+		layout->instructionCount = count;
+		layout->instructions = records;
+		return;
+	}
+
+	auto operand = [](const u8 *p) {
+		return static_cast<i32>(static_cast<u32>(p[0]) | static_cast<u32>(p[1]) << 8 | static_cast<u32>(p[2]) << 16 |
+		                        static_cast<u32>(p[3]) << 24);
+	};
+	bytecode.instructions.reserve(count);
+	for (u32 i = 0; i < count; i++, records += INSTRUCTION_RECORD_SIZE)
+		bytecode.instructions.emplace_back(static_cast<OpCode>(records[0]), operand(records + 4), operand(records + 8),
+		                                   operand(records + 12));
 }
 
 void BytecodeDeserializer::readFunctionEntries(Bytecode &bytecode)
@@ -236,11 +429,11 @@ void BytecodeDeserializer::readFunctionEntries(Bytecode &bytecode)
 	if (sectionId != SECTION_FUNCTIONS)
 		throw std::runtime_error("Expected function entries section");
 
-	u32 count = readUInt32();
+	u32 count = readCount();
 	for (u32 i = 0; i < count; i++)
 	{
 		std::string name    = readString();
-		i32         address = readInt32();
+		i32         address = readIndex();
 		bytecode.functionEntries[name] = address;
 	}
 }
@@ -257,12 +450,12 @@ void BytecodeDeserializer::readFunctionTypes(Bytecode &bytecode)
 	if (sectionId != SECTION_FUNC_TYPES)
 		throw std::runtime_error("Expected function type signatures section");
 
-	u32 count = readUInt32();
+	u32 count = readCount();
 	for (u32 i = 0; i < count; i++)
 	{
 		std::string name           = readString();
 		std::string returnTypeName = readString();
-		u32         paramCount     = readUInt32();
+		u32         paramCount     = readCount();
 
 		std::vector<std::string> paramTypes;
 		paramTypes.reserve(paramCount);
@@ -286,15 +479,15 @@ void BytecodeDeserializer::readStructSection(Bytecode &bytecode)
 	if (sectionId != SECTION_STRUCTS)
 		throw std::runtime_error("Expected struct definitions section");
 
-	u32 structCount = readUInt32();
+	u32 structCount = readCount();
 	bytecode.structs.reserve(structCount);
 
 	for (u32 i = 0; i < structCount; i++)
 	{
 		StructInfo info;
 		info.name            = readString();
-		info.firstConstIndex = readInt32();
-		info.fieldCount      = readInt32();
+		info.firstConstIndex = readIndex();
+		info.fieldCount      = readIndex();
 
 		info.fieldNames.reserve(static_cast<size_t>(info.fieldCount));
 		for (int f = 0; f < info.fieldCount; f++)
@@ -306,14 +499,80 @@ void BytecodeDeserializer::readStructSection(Bytecode &bytecode)
 	}
 }
 
+/**
+ * @brief Read switch jump tables section (0x07).
+ *
+ * Layout mirrors BytecodeSerializer::writeSwitchSection. Rebuilds the hash
+ * index of every table so SWITCH_HASH lookups are ready to run.
+ */
+void BytecodeDeserializer::readSwitchSection(Bytecode &bytecode)
+{
+	u8 sectionId = readUInt8();
+	if (sectionId != SECTION_SWITCHES)
+		throw std::runtime_error("Expected switch tables section");
+
+	u32 tableCount = readCount();
+	bytecode.switchTables.reserve(tableCount);
+
+	for (u32 i = 0; i < tableCount; i++)
+	{
+		SwitchTable table;
+		table.defaultTarget = readIndex();
+		table.low           = readInteger();
+
+		u32 denseCount = readCount();
+		table.denseTargets.reserve(denseCount);
+		for (u32 d = 0; d < denseCount; d++)
+			table.denseTargets.push_back(readIndex());
+
+		u32 caseCount = readCount();
+		table.cases.reserve(caseCount);
+		for (u32 c = 0; c < caseCount; c++)
+		{
+			Value value  = readValue();
+			int   target = readIndex();
+			table.cases.emplace_back(std::move(value), target);
+		}
+
+		table.buildIndex();
+		bytecode.switchTables.push_back(std::move(table));
+	}
+}
+
 // ---------------------------------------------------------------------------
 // Top-level deserialize / loadFromFile
 // ---------------------------------------------------------------------------
 
 Bytecode BytecodeDeserializer::deserialize(const std::vector<u8> &buffer)
 {
-	_data    = buffer.data();
-	dataSize = buffer.size();
+	layout = nullptr;
+	return read(buffer.data(), buffer.size());
+}
+
+Bytecode BytecodeDeserializer::deserializeTables(const u8 *data, size_t size, Layout &result)
+{
+	result = Layout{};
+	layout = &result;
+	Bytecode bytecode = read(data, size);
+	layout = nullptr;
+	result.indexed = version != VERSION_3;
+	return bytecode;
+}
+
+Value BytecodeDeserializer::decodeValue(const u8 *data, size_t size)
+{
+	BytecodeDeserializer reader;
+	reader._data = data;
+	reader.dataSize = size;
+	reader.position = 0;
+	reader.version = VERSION;
+	return reader.readValue();
+}
+
+Bytecode BytecodeDeserializer::read(const u8 *data, size_t size)
+{
+	_data    = data;
+	dataSize = size;
 	position = 0;
 
 	Bytecode bytecode;
@@ -321,17 +580,30 @@ Bytecode BytecodeDeserializer::deserialize(const std::vector<u8> &buffer)
 	u32 expectedChecksum;
 	readHeader(expectedChecksum);
 
-	size_t dataStart      = position;
-	u32    actualChecksum = calculateCRC32(_data + dataStart, dataSize - dataStart);
-	if (actualChecksum != expectedChecksum)
-		throw std::runtime_error("Bytecode file corrupted: checksum mismatch");
-
-	// Sections must be read in the same order they were written.
+	// Without a section index, sections must be read in the same order they were written.
+	size_t dataStart = position;
+	readSectionIndex();
+	indexEnd = position;
+	if (options.verifyChecksums)
+		verifyChecksums(dataStart, expectedChecksum);
+	for (const auto &entry : sections)
+	{
+		if (!inRange(entry))
+			throw std::runtime_error("Bytecode file corrupted: section out of range");
+	}
+	seekSection(SECTION_CONSTANTS);
 	readConstantPool(bytecode);
+	seekSection(SECTION_VARIABLES);
 	readVariableMapping(bytecode);
+	seekSection(SECTION_FUNCTIONS);
 	readFunctionEntries(bytecode);
+	seekSection(SECTION_FUNC_TYPES);
 	readFunctionTypes(bytecode);
+	seekSection(SECTION_STRUCTS);
 	readStructSection(bytecode);
+	if (seekSection(SECTION_SWITCHES))
+		readSwitchSection(bytecode);
+	seekSection(SECTION_INSTRUCTIONS);
 	readInstructions(bytecode);
 
 	return bytecode;
@@ -18,37 +18,108 @@ namespace Phasor
 class BytecodeDeserializer
 {
   public:
+	/**
+	 * @brief Where the constant pool and instructions of a version 4 image are
+	 *
+	 * Filled in by deserializeTables(). Pointers are into the buffer passed
+	 * to it. indexed is false for version 3 images, which have no constant
+	 * offset table and are decoded in full. instructions is null when the
+	 * records aren't fixed-width (version 3, compact instructions), those are
+	 * decoded into the returned bytecode instead.
+	 */
+	struct Layout
+	{
+		bool      indexed = false;
+		u32       constantCount = 0;
+		const u8 *constantOffsets = nullptr; ///< constantCount little-endian u32, relative to constantData
+		const u8 *constantData = nullptr;
+		u32       constantDataSize = 0;
+		u32       instructionCount = 0;
+		const u8 *instructions = nullptr; ///< instructionCount records of INSTRUCTION_RECORD_SIZE bytes
+	};
+
+	struct Options
+	{
+		/// @brief Check the header and section checksums. Turn off only for trusted images, e.g.
+		/// ones produced and checked by the same build; structural bounds checks still apply
+		bool verifyChecksums = true;
+	};
+
+	BytecodeDeserializer() = default;
+	explicit BytecodeDeserializer(Options options);
+
 	/// @brief Deserialize bytecode from binary buffer
 	Bytecode deserialize(const std::vector<u8> &data);
 
 	/// @brief Load bytecode from .phsb file
 	Bytecode loadFromFile(const std::filesystem::path &filename);
 
+	/**
+	 * @brief Check and decode everything but the constant pool and instructions
+	 *
+	 * For version 4 the two are only located and described in layout. Older
+	 * versions are decoded in full into the returned bytecode.
+	 */
+	Bytecode deserializeTables(const u8 *data, size_t size, Layout &layout);
+
+	/// @brief Decode the value encoded at data, as found in the constant pool
+	static Value decodeValue(const u8 *data, size_t size);
+
   private:
+	Options   options;
 	const u8 *_data;
 	size_t    position;
 	size_t    dataSize;
+	u32       version;
+	u32       flags;
+	Layout   *layout = nullptr; ///< Set while deserializeTables() runs
+
+	/// @brief Where a section starts, how long it is and its checksum, from the section index
+	struct SectionEntry
+	{
+		u8  id;
+		u32 offset;
+		u32 size;
+		u32 checksum; ///< CRC32C, unused in version 4.1
+	};
+	std::vector<SectionEntry> sections;     ///< Empty when the file has no section index
+	size_t                    indexEnd = 0; ///< Offset just past the header and section index
+
+	bool inRange(const SectionEntry &entry) const; ///< Whether a section lies after the index and inside the file
+
+	/// @brief Read every section of the buffer
+	Bytecode read(const u8 *data, size_t size);
+
+	u8          readUInt8();   ///< Helper method to read UInt8
+	u16         readUInt16();  ///< Helper method to read UInt16
+	u32         readUInt32();  ///< Helper method to read UInt32
+	i32         readInt32();   ///< Helper method to read Int32
+	i64         readInt64();   ///< Helper method to read Int64
+	u64         readVarUInt(); ///< Helper method to read an unsigned LEB128 varint
+	i64         readVarInt();  ///< Helper method to read a zigzag LEB128 varint
+	f64         readDouble();  ///< Helper method to read Double
+	std::string readString();  ///< Helper method to read String
 
-	u8          readUInt8();  ///< Helper method to read UInt8
-	u16         readUInt16(); ///< Helper method to read UInt16
-	u32         readUInt32(); ///< Helper method to read UInt32
-	i32         readInt32();  ///< Helper method to read Int32
-	i64         readInt64();  ///< Helper method to read Int64
-	f64         readDouble(); ///< Helper method to read Double
-	std::string readString(); ///< Helper method to read String
+	/// @brief Fields whose encoding changed after version 3: fixed-width there, varints since
+	u32 readCount();   ///< Element count, u32 / uvarint
+	i32 readIndex();   ///< Index or jump target, i32 / varint
+	i64 readInteger(); ///< Integer value, i64 / varint
 
 	/// @brief Read a single Value (recursive — handles nested structs/arrays)
 	Value readValue();
 
 	void readHeader(u32 &checksum);               ///< Helper method to read Header
+	void readSectionIndex();                      ///< Helper method to read the optional Section Index
+	bool seekSection(u8 id);                      ///< Move to a section, false if the file has none
 	void readConstantPool(Bytecode &bytecode);    ///< Helper method to read Constants Table
 	void readVariableMapping(Bytecode &bytecode); ///< Helper method to read Variable Table
 	void readInstructions(Bytecode &bytecode);    ///< Helper method to read Instructions Table
 	void readFunctionEntries(Bytecode &bytecode); ///< Helper method to read Function Entries
 	void readFunctionTypes(Bytecode &bytecode);   ///< Helper method to read Function Type Table
 	void readStructSection(Bytecode &bytecode);   ///< Helper method to read Struct Section
+	void readSwitchSection(Bytecode &bytecode);   ///< Helper method to read Switch Table Section
 
-	/// @brief Calculate CRC32 checksum
-	static u32 calculateCRC32(const u8 *data, size_t size);
+	/// @brief Check the checksums after the header, throwing with the damaged section's name
+	void verifyChecksums(size_t dataStart, u32 checksum);
 };
 } // namespace Phasor
\ No newline at end of file
@@ -0,0 +1,230 @@
+#include "BytecodeImage.hpp"
+#include "metadata.h"
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Phasor
+{
+
+// A version 4 record is an Instruction as laid out by the compiler on little-endian targets
+static_assert(sizeof(Instruction) == INSTRUCTION_RECORD_SIZE);
+static_assert(offsetof(Instruction, op) == 0 && offsetof(Instruction, operand1) == 4 &&
+              offsetof(Instruction, operand2) == 8 && offsetof(Instruction, operand3) == 12);
+
+// ...and so is an EmbeddedInstruction
+static_assert(sizeof(EmbeddedInstruction) == sizeof(Instruction) && alignof(EmbeddedInstruction) == alignof(Instruction));
+static_assert(offsetof(EmbeddedInstruction, operand1) == 4 && offsetof(EmbeddedInstruction, operand2) == 8 &&
+              offsetof(EmbeddedInstruction, operand3) == 12);
+
+BytecodeImage::BytecodeImage(const std::filesystem::path &filename, BytecodeDeserializer::Options options)
+{
+#if defined(_WIN32)
+	HANDLE file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+	                          FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("Failed to open bytecode file: " + filename.string());
+	LARGE_INTEGER fileSize{};
+	GetFileSizeEx(file, &fileSize);
+	m_size = static_cast<size_t>(fileSize.QuadPart);
+	if (m_size > 0)
+	{
+		m_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_mapping != nullptr)
+			m_data = static_cast<const u8 *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	}
+	CloseHandle(file);
+	m_mapped = m_data != nullptr;
+#else
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error("Failed to open bytecode file: " + filename.string());
+	struct stat info{};
+	if (fstat(fd, &info) == 0)
+		m_size = static_cast<size_t>(info.st_size);
+	if (m_size > 0)
+	{
+		void *view = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (view != MAP_FAILED)
+			m_data = static_cast<const u8 *>(view);
+	}
+	::close(fd);
+	m_mapped = m_data != nullptr;
+#endif
+	if (m_size > 0 && m_data == nullptr)
+	{
+		unmap();
+		throw std::runtime_error("Failed to map bytecode file: " + filename.string());
+	}
+
+	try
+	{
+		BytecodeDeserializer deserializer(options);
+		m_tables = deserializer.deserializeTables(m_data, m_size, m_layout);
+	}
+	catch (...)
+	{
+		unmap();
+		throw;
+	}
+
+	if (m_layout.instructions == nullptr)
+	{
+		// Version 3 and compact instructions were decoded already
+		m_ownedCode = std::move(m_tables.instructions);
+		m_tables.instructions.clear();
+	}
+	else
+	{
+		m_codeSize = m_layout.instructionCount;
+		bool inPlace = std::endian::native == std::endian::little &&
+		               reinterpret_cast<std::uintptr_t>(m_layout.instructions) % alignof(Instruction) == 0;
+		if (inPlace)
+			m_code = reinterpret_cast<const Instruction *>(m_layout.instructions);
+		else
+		{
+			m_ownedCode.reserve(m_codeSize);
+			for (size_t i = 0; i < m_codeSize; i++)
+			{
+				const u8 *record = m_layout.instructions + i * INSTRUCTION_RECORD_SIZE;
+				auto      operand = [record](int n) {
+					const u8 *p = record + 4 * n;
+					return static_cast<i32>(static_cast<u32>(p[0]) | static_cast<u32>(p[1]) << 8 |
+					                        static_cast<u32>(p[2]) << 16 | static_cast<u32>(p[3]) << 24);
+				};
+				m_ownedCode.emplace_back(static_cast<OpCode>(record[0]), operand(1), operand(2), operand(3));
+			}
+		}
+	}
+	if (m_code == nullptr)
+	{
+		m_code = m_ownedCode.data();
+		m_codeSize = m_ownedCode.size();
+	}
+
+	if (!m_layout.indexed)
+	{
+		// Version 3: constants were decoded already too
+		m_constantCount = m_tables.constants.size();
+		m_slots = std::make_unique<Slot[]>(m_constantCount);
+		for (size_t i = 0; i < m_constantCount; i++)
+		{
+			m_slots[i].value = std::move(m_tables.constants[i]);
+			m_slots[i].ready.store(true, std::memory_order_relaxed);
+		}
+		m_tables.constants.clear();
+		return;
+	}
+	m_constantCount = m_layout.constantCount;
+	m_slots = std::make_unique<Slot[]>(m_constantCount);
+}
+
+BytecodeImage::BytecodeImage(std::span<const u8> bytecode, const EmbeddedImage &embedded,
+                             BytecodeDeserializer::Options options)
+    : m_data(bytecode.data()), m_size(bytecode.size())
+{
+	BytecodeDeserializer deserializer(options);
+	m_tables = deserializer.deserializeTables(m_data, m_size, m_layout);
+	if (embedded.instructionCount != (m_layout.instructions != nullptr ? m_layout.instructionCount
+	                                                                   : m_tables.instructions.size()) ||
+	    embedded.constantCount != (m_layout.indexed ? m_layout.constantCount : m_tables.constants.size()))
+		throw std::runtime_error("Embedded tables don't match the embedded bytecode");
+	m_tables.instructions.clear();
+	m_tables.constants.clear();
+
+	m_code = reinterpret_cast<const Instruction *>(embedded.instructions);
+	m_codeSize = embedded.instructionCount;
+	m_constantCount = embedded.constantCount;
+	m_embeddedConstants = embedded.constants;
+	m_slots = std::make_unique<Slot[]>(m_constantCount);
+}
+
+BytecodeImage::~BytecodeImage()
+{
+	unmap();
+}
+
+void BytecodeImage::unmap()
+{
+#if defined(_WIN32)
+	if (m_mapped)
+		UnmapViewOfFile(m_data);
+	if (m_mapping != nullptr)
+		CloseHandle(m_mapping);
+	m_mapping = nullptr;
+#else
+	if (m_mapped)
+		munmap(const_cast<u8 *>(m_data), m_size);
+#endif
+	m_data = nullptr;
+	m_mapped = false;
+}
+
+const Value &BytecodeImage::decode(size_t index) const
+{
+	std::lock_guard lock(m_decodeMutex);
+	Slot           &slot = m_slots[index];
+	if (slot.ready.load(std::memory_order_relaxed))
+		return slot.value;
+
+	if (m_embeddedConstants != nullptr)
+	{
+		const EmbeddedConstant &embedded = m_embeddedConstants[index];
+		switch (embedded.type)
+		{
+		case ValueType::Null:
+			slot.value = Value();
+			break;
+		case ValueType::Bool:
+			slot.value = Value(embedded.integer != 0);
+			break;
+		case ValueType::Int:
+			slot.value = Value(embedded.integer);
+			break;
+		case ValueType::Float:
+			slot.value = Value(embedded.number);
+			break;
+		case ValueType::String:
+			slot.value = Value(PhsString(std::string_view(embedded.string, embedded.length)));
+			break;
+		default:
+			throw std::runtime_error("Embedded constant has an invalid type");
+		}
+		slot.ready.store(true, std::memory_order_release);
+		return slot.value;
+	}
+
+	const u8 *entry = m_layout.constantOffsets + index * sizeof(u32);
+	u32       offset = 0;
+	for (int i = 0; i < 4; i++)
+		offset |= static_cast<u32>(entry[i]) << (i * 8);
+	if (offset >= m_layout.constantDataSize)
+		throw std::runtime_error("Bytecode file corrupted: constant offset out of range");
+
+	slot.value = BytecodeDeserializer::decodeValue(m_layout.constantData + offset, m_layout.constantDataSize - offset);
+	slot.ready.store(true, std::memory_order_release);
+	return slot.value;
+}
+
+Bytecode BytecodeImage::materialize() const
+{
+	Bytecode bytecode = m_tables;
+	bytecode.instructions.assign(m_code, m_code + m_codeSize);
+	bytecode.constants.reserve(m_constantCount);
+	for (size_t i = 0; i < m_constantCount; i++)
+		bytecode.constants.push_back(constant(i));
+	return bytecode;
+}
+
+} // namespace Phasor
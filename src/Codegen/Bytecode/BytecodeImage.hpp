@@ -0,0 +1,122 @@
+#pragma once
+#include "../CodeGen.hpp"
+#include "BytecodeDeserializer.hpp"
+#include <Phasor/PhasorAOT.hpp>
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <phsint.hpp>
+#include <span>
+
+/// @brief The Phasor Programming Language and Runtime
+namespace Phasor
+{
+
+/**
+ * @class BytecodeImage
+ * @brief A .phsb file mapped into memory and executed in place
+ *
+ * Opening an image checks the header and checksums and decodes the small
+ * tables (variables, functions, structs, switches), but not the constant pool
+ * or the instructions. Instruction records of a version 4 file already have
+ * the in-memory layout of Instruction on little-endian hosts and are used
+ * straight from the mapping. Constants are decoded on first use through the
+ * pool's offset table and kept; concurrent first uses of a constant are safe.
+ *
+ * Version 3 files, compact instructions, big-endian hosts and misaligned
+ * mappings fall back to decoding into owned vectors, so every .phsb the
+ * deserializer accepts can be opened here.
+ *
+ * An image can also be built over bytecode compiled into the executable, with
+ * the EmbeddedImage tables phasornative generates next to it supplying the
+ * instructions and constants; then nothing is mapped or copied at all.
+ */
+class BytecodeImage
+{
+  public:
+	/// @throws std::runtime_error if the file can't be mapped or isn't valid bytecode
+	explicit BytecodeImage(const std::filesystem::path &filename, BytecodeDeserializer::Options options = {});
+
+	/**
+	 * @brief An image over embedded bytecode and the generated tables for it
+	 * @param bytecode Serialized program, only read for its small tables; must outlive the image
+	 * @param embedded Instructions and constants of the same program; must outlive the image
+	 * @throws std::runtime_error if the bytecode isn't valid or doesn't match the tables
+	 */
+	BytecodeImage(std::span<const u8> bytecode, const EmbeddedImage &embedded,
+	              BytecodeDeserializer::Options options = {});
+
+	~BytecodeImage();
+
+	BytecodeImage(const BytecodeImage &) = delete;
+	BytecodeImage &operator=(const BytecodeImage &) = delete;
+
+	/// @brief Everything but the constant pool and instructions, which are left empty
+	const Bytecode &tables() const
+	{
+		return m_tables;
+	}
+
+	const Instruction *instructions() const
+	{
+		return m_code;
+	}
+
+	size_t instructionCount() const
+	{
+		return m_codeSize;
+	}
+
+	size_t constantCount() const
+	{
+		return m_constantCount;
+	}
+
+	/// @brief Constant at index, decoded on first use. index must be below constantCount()
+	const Value &constant(size_t index) const
+	{
+		const Slot &slot = m_slots[index];
+		if (slot.ready.load(std::memory_order_acquire))
+			return slot.value;
+		return decode(index);
+	}
+
+	/// @brief Whether instructions are executed from the mapping rather than a copy
+	bool isMapped() const
+	{
+		return m_code != nullptr && m_ownedCode.empty();
+	}
+
+	/// @brief A standalone copy with every constant and instruction decoded
+	Bytecode materialize() const;
+
+  private:
+	struct Slot
+	{
+		std::atomic<bool> ready{false};
+		Value             value;
+	};
+
+	const u8 *m_data = nullptr;
+	size_t    m_size = 0;
+	bool      m_mapped = false; ///< m_data is a mapping of ours rather than embedded bytecode
+#if defined(_WIN32)
+	void *m_mapping = nullptr; ///< File mapping object handle
+#endif
+
+	Bytecode                     m_tables;
+	BytecodeDeserializer::Layout m_layout;
+	std::vector<Instruction>     m_ownedCode; ///< Decoded instructions when they can't be used in place
+	const Instruction           *m_code = nullptr;
+	size_t                       m_codeSize = 0;
+	size_t                       m_constantCount = 0;
+	std::unique_ptr<Slot[]>      m_slots;
+	const EmbeddedConstant      *m_embeddedConstants = nullptr;
+	mutable std::mutex           m_decodeMutex;
+
+	const Value &decode(size_t index) const;
+	void         unmap();
+};
+
+} // namespace Phasor
@@ -1,9 +1,12 @@
 #include "BytecodeSerializer.hpp"
+#include "Checksum.hpp"
 #include <cstring>
 #include <stdexcept>
 #include <filesystem>
 #include <fstream>
 #include "metadata.h"
+#include "../IR/PhasorIR.hpp"
+#include <limits>
 #include <phsint.hpp>
 
 // Section IDs
@@ -13,39 +16,14 @@ const Phasor::u8 SECTION_INSTRUCTIONS = 0x03;
 const Phasor::u8 SECTION_FUNCTIONS    = 0x04;
 const Phasor::u8 SECTION_STRUCTS      = 0x05;
 const Phasor::u8 SECTION_FUNC_TYPES   = 0x06; ///< param+return type table
-
-static Phasor::u32 crc32_table[256];
-static bool        crc32_table_initialized = false;
-
-void init_crc32_table()
-{
-	for (Phasor::u32 i = 0; i < 256; i++)
-	{
-		Phasor::u32 crc = i;
-		for (int j = 0; j < 8; j++)
-		{
-			if ((crc & 1) != 0u)
-				crc = (crc >> 1) ^ 0xEDB88320;
-			else
-				crc >>= 1;
-		}
-		crc32_table[i] = crc;
-	}
-	crc32_table_initialized = true;
-}
+const Phasor::u8 SECTION_SWITCHES     = 0x07; ///< SWITCH_TABLE / SWITCH_HASH jump tables (optional)
+const Phasor::u8 SECTION_INDEX        = 0x08; ///< Offsets of the other sections (optional)
 
 namespace Phasor
 {
 
-u32 BytecodeSerializer::calculateCRC32(const std::vector<u8> &data)
+BytecodeSerializer::BytecodeSerializer(Options options) : options(options)
 {
-	if (!crc32_table_initialized)
-		init_crc32_table();
-
-	u32 crc = 0xFFFFFFFF;
-	for (u8 byte : data)
-		crc = (crc >> 8) ^ crc32_table[(crc ^ byte) & 0xFF];
-	return crc ^ 0xFFFFFFFF;
 }
 
 // ---------------------------------------------------------------------------
@@ -57,12 +35,6 @@ void BytecodeSerializer::writeUInt8(u8 value)
 	buffer.push_back(value);
 }
 
-void BytecodeSerializer::writeUInt16(u16 value)
-{
-	buffer.push_back(static_cast<u8>(value & 0xFF));
-	buffer.push_back(static_cast<u8>((value >> 8) & 0xFF));
-}
-
 void BytecodeSerializer::writeUInt32(u32 value)
 {
 	buffer.push_back(static_cast<u8>(value & 0xFF));
@@ -71,15 +43,32 @@ void BytecodeSerializer::writeUInt32(u32 value)
 	buffer.push_back(static_cast<u8>((value >> 24) & 0xFF));
 }
 
+void BytecodeSerializer::patchUInt32(size_t position, u32 value)
+{
+	for (int i = 0; i < 4; i++)
+		buffer[position + i] = static_cast<u8>((value >> (i * 8)) & 0xFF);
+}
+
 void BytecodeSerializer::writeInt32(i32 value)
 {
 	writeUInt32(static_cast<u32>(value));
 }
 
-void BytecodeSerializer::writeInt64(i64 value)
+/// LEB128: seven bits per byte, low group first, high bit set on all but the last byte
+void BytecodeSerializer::writeVarUInt(u64 value)
 {
-	for (int i = 0; i < 8; i++)
-		buffer.push_back(static_cast<u8>((value >> (i * 8)) & 0xFF));
+	while (value >= 0x80)
+	{
+		buffer.push_back(static_cast<u8>(value | 0x80));
+		value >>= 7;
+	}
+	buffer.push_back(static_cast<u8>(value));
+}
+
+/// Zigzag first, so small negative numbers stay short: 0, -1, 1, -2 -> 0, 1, 2, 3
+void BytecodeSerializer::writeVarInt(i64 value)
+{
+	writeVarUInt((static_cast<u64>(value) << 1) ^ static_cast<u64>(value >> 63));
 }
 
 void BytecodeSerializer::writeDouble(f64 value)
@@ -92,9 +81,10 @@ void BytecodeSerializer::writeDouble(f64 value)
 
 void BytecodeSerializer::writeString(const std::string &str)
 {
-	writeUInt16(static_cast<u16>(str.length()));
-	for (char c : str)
-		buffer.push_back(static_cast<u8>(c));
+	if (str.size() > std::numeric_limits<u32>::max())
+		throw std::runtime_error("BytecodeSerializer::writeString: string longer than 4 GiB");
+	writeVarUInt(str.size());
+	buffer.insert(buffer.end(), str.begin(), str.end());
 }
 
 // ---------------------------------------------------------------------------
@@ -103,11 +93,13 @@ void BytecodeSerializer::writeString(const std::string &str)
 // Binary layout per value:
 //   Null   : u8(0)
 //   Bool   : u8(1)  u8(0|1)
-//   Int    : u8(2)  i64
+//   Int    : u8(2)  varint
 //   Float  : u8(3)  f64
-//   String : u8(4)  u16(len) chars...
-//   Struct : u8(5)  string(structName) u32(fieldCount) [string(fieldName) value]...
-//   Array  : u8(6)  u32(elementCount) [value]...
+//   String : u8(4)  string
+//   Struct : u8(5)  string(structName) uvarint(fieldCount) [string(fieldName) value]...
+//   Array  : u8(6)  uvarint(elementCount) [value]...
+//
+// uvarint is LEB128, varint zigzag LEB128, string a uvarint length then the bytes.
 // ---------------------------------------------------------------------------
 void BytecodeSerializer::writeValue(const Value &val)
 {
@@ -124,7 +116,7 @@ void BytecodeSerializer::writeValue(const Value &val)
 
 	case ValueType::Int:
 		writeUInt8(2);
-		writeInt64(val.asInt());
+		writeVarInt(val.asInt());
 		break;
 
 	case ValueType::Float:
@@ -142,7 +134,7 @@ void BytecodeSerializer::writeValue(const Value &val)
 		auto s = val.asStruct();
 		writeUInt8(5);
 		writeString(s->structName.str());
-		writeUInt32(static_cast<u32>(s->fields.size()));
+		writeVarUInt(s->fields.size());
 		for (const auto &[fieldName, fieldVal] : s->fields)
 		{
 			writeString(fieldName.str());
@@ -155,7 +147,7 @@ void BytecodeSerializer::writeValue(const Value &val)
 	{
 		auto a = val.asArray();
 		writeUInt8(6);
-		writeUInt32(static_cast<u32>(a->size()));
+		writeVarUInt(a->size());
 		for (const auto &elem : *a)
 			writeValue(elem); // recurse
 		break;
@@ -170,56 +162,169 @@ void BytecodeSerializer::writeValue(const Value &val)
 // Section writers
 // ---------------------------------------------------------------------------
 
-void BytecodeSerializer::writeHeader(u32 dataChecksum)
+/// Fills in the 16 bytes reserved at the start of the buffer
+void BytecodeSerializer::writeHeader(u32 flags, u32 dataChecksum)
 {
-	writeUInt32(MAGIC_NUMBER);
-	writeUInt32(VERSION);
-	writeUInt32(0); // Flags (reserved)
-	writeUInt32(dataChecksum);
+	patchUInt32(0, MAGIC_NUMBER);
+	patchUInt32(4, VERSION);
+	patchUInt32(8, flags);
+	patchUInt32(12, dataChecksum);
 }
 
+/**
+ * @brief Reserve the section index (0x08), filled in by patchSectionIndex().
+ *
+ * Entries are fixed-width so the index can be written before the sections.
+ * Each carries the CRC32C of its section, so a loader can tell which one is
+ * damaged; the header checksum then covers only the index.
+ *
+ * Binary layout:
+ *   u8     section_id = 0x08
+ *   u8     sectionCount
+ *   for each section, in file order:
+ *     u8   section_id
+ *     u32  offset                       from the start of the file
+ *     u32  size                         including its section_id byte
+ *     u32  checksum                     CRC32C of those size bytes
+ */
+void BytecodeSerializer::writeSectionIndex(size_t sectionCount)
+{
+	writeUInt8(SECTION_INDEX);
+	writeUInt8(static_cast<u8>(sectionCount));
+	buffer.resize(buffer.size() + sectionCount * SECTION_INDEX_ENTRY_SIZE);
+}
+
+void BytecodeSerializer::patchSectionIndex(size_t indexPos, const std::vector<size_t> &sectionStarts)
+{
+	size_t entry = indexPos + 2;
+	for (size_t i = 0; i < sectionStarts.size(); i++, entry += SECTION_INDEX_ENTRY_SIZE)
+	{
+		size_t start = sectionStarts[i];
+		size_t end = i + 1 < sectionStarts.size() ? sectionStarts[i + 1] : buffer.size();
+		buffer[entry] = buffer[start];
+		patchUInt32(entry + 1, static_cast<u32>(start));
+		patchUInt32(entry + 5, static_cast<u32>(end - start));
+		patchUInt32(entry + 9, Checksum::crc32c(buffer.data() + start, end - start));
+	}
+}
+
+/**
+ * @brief Write the constant pool section (0x01).
+ *
+ * The offset table lets a mapped image decode any one constant on first use
+ * without walking the ones before it.
+ *
+ * Binary layout:
+ *   u8       section_id = 0x01
+ *   uvarint  constantCount
+ *   uvarint  dataSize
+ *   u32      offset[0..constantCount-1]   from the start of data
+ *   value    data[...]
+ */
 void BytecodeSerializer::writeConstantPool(const std::vector<Value> &constants)
 {
+	// Values go to the end of the buffer first, then move behind the table once its size is known
+	size_t           dataPos = buffer.size();
+	std::vector<u32> offsets;
+	offsets.reserve(constants.size());
+	for (const auto &constant : constants)
+	{
+		offsets.push_back(static_cast<u32>(buffer.size() - dataPos));
+		writeValue(constant);
+	}
+	std::vector<u8> data(buffer.begin() + static_cast<std::ptrdiff_t>(dataPos), buffer.end());
+	buffer.resize(dataPos);
+
 	writeUInt8(SECTION_CONSTANTS);
-	writeUInt32(static_cast<u32>(constants.size()));
-	for (const auto &val : constants)
-		writeValue(val);
+	writeVarUInt(constants.size());
+	writeVarUInt(data.size());
+	for (u32 offset : offsets)
+		writeUInt32(offset);
+	buffer.insert(buffer.end(), data.begin(), data.end());
 }
 
 void BytecodeSerializer::writeVariableMapping(const std::unordered_map<std::string, int> &variables,
                                               int nextVarIndex)
 {
 	writeUInt8(SECTION_VARIABLES);
-	writeUInt32(static_cast<u32>(variables.size()));
-	writeInt32(nextVarIndex);
+	writeVarUInt(variables.size());
+	writeVarInt(nextVarIndex);
 	for (const auto &[name, index] : variables)
 	{
 		writeString(name);
-		writeInt32(index);
+		writeVarInt(index);
 	}
 }
 
-void BytecodeSerializer::writeInstructions(const std::vector<Instruction> &instructions)
+/**
+ * @brief Write the instruction section (0x03).
+ *
+ * Records are fixed-width and start on a 16-byte file offset, laid out like
+ * Instruction in memory on little-endian hosts, so a mapped file can be
+ * executed without decoding. Always the last section.
+ *
+ * Binary layout:
+ *   u8       section_id = 0x03
+ *   uvarint  instructionCount
+ *   u8       0[...]                     padding to a 16-byte offset
+ *   for each instruction (16 bytes):
+ *     u8     opcode
+ *     u8     0[3]
+ *     i32    operand1, operand2, operand3
+ *
+ * With FLAG_COMPACT_INSTRUCTIONS there is no padding and each instruction is
+ * its opcode followed by PhasorIR::getOperandCount(opcode) varint operands.
+ */
+void BytecodeSerializer::writeInstructions(const std::vector<Instruction> &instructions, bool compact)
 {
 	writeUInt8(SECTION_INSTRUCTIONS);
-	writeUInt32(static_cast<u32>(instructions.size()));
+	writeVarUInt(instructions.size());
+
+	if (compact)
+	{
+		for (const auto &instr : instructions)
+		{
+			writeUInt8(static_cast<u8>(instr.op));
+			const i32 operands[3] = {instr.operand1, instr.operand2, instr.operand3};
+			for (int i = 0; i < PhasorIR::getOperandCount(instr.op); i++)
+				writeVarInt(operands[i]);
+		}
+		return;
+	}
+
+	while (buffer.size() % INSTRUCTION_ALIGNMENT != 0)
+		writeUInt8(0);
+	buffer.reserve(buffer.size() + instructions.size() * INSTRUCTION_RECORD_SIZE);
 	for (const auto &instr : instructions)
 	{
 		writeUInt8(static_cast<u8>(instr.op));
+		buffer.insert(buffer.end(), 3, 0);
 		writeInt32(instr.operand1);
 		writeInt32(instr.operand2);
 		writeInt32(instr.operand3);
 	}
 }
 
+bool BytecodeSerializer::fitsCompact(const std::vector<Instruction> &instructions)
+{
+	for (const auto &instr : instructions)
+	{
+		const i32 operands[3] = {instr.operand1, instr.operand2, instr.operand3};
+		for (int i = PhasorIR::getOperandCount(instr.op); i < 3; i++)
+			if (operands[i] != 0)
+				return false;
+	}
+	return true;
+}
+
 void BytecodeSerializer::writeFunctionEntries(const std::unordered_map<std::string, int> &functionEntries)
 {
 	writeUInt8(SECTION_FUNCTIONS);
-	writeUInt32(static_cast<u32>(functionEntries.size()));
+	writeVarUInt(functionEntries.size());
 	for (const auto &[name, address] : functionEntries)
 	{
 		writeString(name);
-		writeInt32(address);
+		writeVarInt(address);
 	}
 }
 
@@ -228,11 +333,11 @@ void BytecodeSerializer::writeFunctionEntries(const std::unordered_map<std::stri
  *
  * Binary layout:
  *   u8     section_id = 0x06
- *   u32    functionCount
+ *   uvarint functionCount
  *   for each function:
  *     string  name
  *     string  returnTypeName   ("any" when unspecified)
- *     u32     paramCount
+ *     uvarint paramCount
  *     string  paramTypeName[0..paramCount-1]
  */
 void BytecodeSerializer::writeFunctionTypes(
@@ -242,7 +347,7 @@ void BytecodeSerializer::writeFunctionTypes(
 	writeUInt8(SECTION_FUNC_TYPES);
 
 	// Only emit entries that have param type info; functions without entries are unknown-typed.
-	writeUInt32(static_cast<u32>(paramTypeNames.size()));
+	writeVarUInt(paramTypeNames.size());
 	for (const auto &[name, paramTypes] : paramTypeNames)
 	{
 		writeString(name);
@@ -250,7 +355,7 @@ void BytecodeSerializer::writeFunctionTypes(
 		auto retIt = returnTypeNames.find(name);
 		writeString(retIt != returnTypeNames.end() ? retIt->second : "any");
 
-		writeUInt32(static_cast<u32>(paramTypes.size()));
+		writeVarUInt(paramTypes.size());
 		for (const auto &typeName : paramTypes)
 			writeString(typeName);
 	}
@@ -261,27 +366,66 @@ void BytecodeSerializer::writeFunctionTypes(
  *
  * Binary layout:
  *   u8     section_id = 0x05
- *   u32    structCount
+ *   uvarint structCount
  *   for each StructInfo:
  *     string  name
- *     i32     firstConstIndex
- *     i32     fieldCount
+ *     varint  firstConstIndex
+ *     varint  fieldCount
  *     string  fieldName[0..fieldCount-1]
  */
 void BytecodeSerializer::writeStructSection(const std::vector<StructInfo> &structs)
 {
 	writeUInt8(SECTION_STRUCTS);
-	writeUInt32(static_cast<u32>(structs.size()));
+	writeVarUInt(structs.size());
 	for (const auto &info : structs)
 	{
 		writeString(info.name);
-		writeInt32(info.firstConstIndex);
-		writeInt32(info.fieldCount);
+		writeVarInt(info.firstConstIndex);
+		writeVarInt(info.fieldCount);
 		for (const auto &fieldName : info.fieldNames)
 			writeString(fieldName);
 	}
 }
 
+/**
+ * @brief Write switch jump tables section (0x07).
+ *
+ * Only emitted when the program has switch tables, so files without them
+ * stay readable by older loaders.
+ *
+ * Binary layout:
+ *   u8     section_id = 0x07
+ *   uvarint tableCount
+ *   for each SwitchTable:
+ *     varint  defaultTarget
+ *     varint  low
+ *     uvarint denseCount
+ *     varint  denseTarget[0..denseCount-1]
+ *     uvarint caseCount
+ *     for each case:
+ *       value   caseValue
+ *       varint  target
+ */
+void BytecodeSerializer::writeSwitchSection(const std::vector<SwitchTable> &switchTables)
+{
+	writeUInt8(SECTION_SWITCHES);
+	writeVarUInt(switchTables.size());
+	for (const auto &table : switchTables)
+	{
+		writeVarInt(table.defaultTarget);
+		writeVarInt(table.low);
+		writeVarUInt(table.denseTargets.size());
+		for (int target : table.denseTargets)
+			writeVarInt(target);
+		writeVarUInt(table.cases.size());
+		for (const auto &[value, target] : table.cases)
+		{
+			writeValue(value);
+			writeVarInt(target);
+		}
+	}
+}
+
 // ---------------------------------------------------------------------------
 // Top-level serialize / saveToFile
 // ---------------------------------------------------------------------------
@@ -289,27 +433,50 @@ void BytecodeSerializer::writeStructSection(const std::vector<StructInfo> &struc
 std::vector<u8> BytecodeSerializer::serialize(const Bytecode &bytecode)
 {
 	buffer.clear();
+	buffer.reserve(64 + bytecode.instructions.size() * INSTRUCTION_RECORD_SIZE + bytecode.constants.size() * 16);
+
+	// Instructions whose unused operands aren't zero can only be stored as full records
+	bool compact = options.compactInstructions && fitsCompact(bytecode.instructions);
+	u32  flags = (options.sectionIndex ? FLAG_SECTION_INDEX : 0) | (compact ? FLAG_COMPACT_INSTRUCTIONS : 0);
 
 	// Reserve 16 bytes for the header (written after checksum is known).
-	for (int i = 0; i < 16; i++)
-		buffer.push_back(0);
+	buffer.resize(16);
+
+	size_t indexPos = buffer.size();
+	if (options.sectionIndex)
+		writeSectionIndex(bytecode.switchTables.empty() ? 6 : 7);
 
-	size_t dataStartPos = buffer.size();
+	std::vector<size_t> sectionStarts;
+	auto                section = [&] { sectionStarts.push_back(buffer.size()); };
+	section();
 	writeConstantPool(bytecode.constants);
+	section();
 	writeVariableMapping(bytecode.variables, bytecode.nextVarIndex);
+	section();
 	writeFunctionEntries(bytecode.functionEntries);
+	section();
 	writeFunctionTypes(bytecode.functionParamTypeNames, bytecode.functionReturnTypeNames);
+	section();
 	writeStructSection(bytecode.structs);
-	writeInstructions(bytecode.instructions);
-
-	std::vector<u8> dataSection(buffer.begin() + dataStartPos, buffer.end());
-	u32             checksum = calculateCRC32(dataSection);
-
-	std::vector<u8> tempBuffer = buffer;
-	buffer.clear();
-	writeHeader(checksum);
-	buffer.insert(buffer.end(), tempBuffer.begin() + 16, tempBuffer.end());
+	if (!bytecode.switchTables.empty())
+	{
+		section();
+		writeSwitchSection(bytecode.switchTables);
+	}
+	section();
+	writeInstructions(bytecode.instructions, compact);
+
+	if (buffer.size() > std::numeric_limits<u32>::max())
+		throw std::runtime_error("BytecodeSerializer::serialize: bytecode larger than 4 GiB");
+	// With an index the header checksum covers just the index, each section has its own
+	size_t checked = buffer.size() - 16;
+	if (options.sectionIndex)
+	{
+		patchSectionIndex(indexPos, sectionStarts);
+		checked = sectionStarts.front() - 16;
+	}
 
+	writeHeader(flags, Checksum::crc32c(buffer.data() + 16, checked));
 	return buffer;
 }
 
@@ -19,6 +19,19 @@ namespace Phasor
 class BytecodeSerializer
 {
   public:
+	/// @brief Layout choices for the written file, readers accept every combination
+	struct Options
+	{
+		/// Varint operands, only as many as the opcode takes. Smaller, but phasorvm has to decode
+		/// them on load instead of running the file in place
+		bool compactInstructions = false;
+		/// Table of section offsets after the header, for tools that want to seek
+		bool sectionIndex = true;
+	};
+
+	BytecodeSerializer() = default;
+	explicit BytecodeSerializer(Options options);
+
 	/// @brief Serialize bytecode to binary buffer
 	std::vector<u8> serialize(const Bytecode &bytecode);
 
@@ -26,33 +39,42 @@ class BytecodeSerializer
 	bool saveToFile(const Bytecode &bytecode, const std::filesystem::path &filename);
 
   private:
+	Options         options;
 	std::vector<u8> buffer;
 
 	void writeUInt8(u8 value);                ///< Helper method to write UInt8
-	void writeUInt16(u16 value);              ///< Helper method to write UInt16
 	void writeUInt32(u32 value);              ///< Helper method to write UInt32
 	void writeInt32(i32 value);               ///< Helper method to write Int32
-	void writeInt64(i64 value);               ///< Helper method to write Int64
+	void writeVarUInt(u64 value);             ///< Helper method to write an unsigned LEB128 varint
+	void writeVarInt(i64 value);              ///< Helper method to write a zigzag LEB128 varint
 	void writeDouble(f64 value);              ///< Helper method to write Double
 	void writeString(const std::string &str); ///< Helper method to write String
 
+	/// @brief Overwrite a UInt32 written earlier at position
+	void patchUInt32(size_t position, u32 value);
+
 	/// @brief Write a single Value (recursive — handles nested structs/arrays)
 	void writeValue(const Value &val);
 
 	/// @brief Section writers
-	void writeHeader(u32 dataChecksum);                          ///< Helper method to write header
+	void writeHeader(u32 flags, u32 dataChecksum);               ///< Helper method to write header
 	void writeConstantPool(const std::vector<Value> &constants); ///< Helper method to write Constants Table
 	void writeVariableMapping(const std::unordered_map<std::string, int> &variables,
 	                          int nextVarIndex);                          ///< Helper method to write Variable Map Table
-	void writeInstructions(const std::vector<Instruction> &instructions); ///< Helper method to write Instruction Table
+	void writeInstructions(const std::vector<Instruction> &instructions,
+	                       bool compact); ///< Helper method to write Instruction Table
 	void writeFunctionEntries(
 	    const std::unordered_map<std::string, int> &functionEntries); ///< Helper method to write Function Table
 	void writeFunctionTypes(
 	    const std::unordered_map<std::string, std::vector<std::string>> &paramTypeNames,
 	    const std::unordered_map<std::string, std::string>              &returnTypeNames); ///< Helper method to write Function Type Table
 	void writeStructSection(const std::vector<StructInfo> &structs);  ///< Helper method to write Struct Section
+	void writeSwitchSection(const std::vector<SwitchTable> &switchTables); ///< Helper method to write Switch Table Section
+
+	void writeSectionIndex(size_t sectionCount); ///< Helper method to reserve the Section Index
+	void patchSectionIndex(size_t indexPos, const std::vector<size_t> &sectionStarts); ///< Fill in the Section Index
 
-	/// @brief Calculate CRC32 checksum
-	static u32 calculateCRC32(const std::vector<u8> &data);
+	/// @brief Whether every instruction's operands past its operand count are zero
+	static bool fitsCompact(const std::vector<Instruction> &instructions);
 };
 } // namespace Phasor
\ No newline at end of file
@@ -0,0 +1,274 @@
+#include "Checksum.hpp"
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define PHASOR_CRC32C_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__ARM_FEATURE_CRC32)
+#define PHASOR_CRC32C_ARM 1
+#include <arm_acle.h>
+#endif
+
+// GCC and Clang only allow intrinsics in functions compiled for the instruction set
+#if defined(__GNUC__) || defined(__clang__)
+#define PHASOR_TARGET(features) __attribute__((target(features)))
+#else
+#define PHASOR_TARGET(features)
+#endif
+
+namespace Phasor
+{
+
+namespace
+{
+
+using Tables = std::array<std::array<u32, 256>, 8>;
+
+/// tables[k][b] is the CRC of byte b followed by k zero bytes
+constexpr Tables makeTables(u32 polynomial)
+{
+	Tables tables{};
+	for (u32 i = 0; i < 256; i++)
+	{
+		u32 crc = i;
+		for (int bit = 0; bit < 8; bit++)
+			crc = (crc & 1) != 0 ? (crc >> 1) ^ polynomial : crc >> 1;
+		tables[0][i] = crc;
+	}
+	for (size_t k = 1; k < 8; k++)
+		for (size_t i = 0; i < 256; i++)
+			tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xFF];
+	return tables;
+}
+
+constexpr u32    CRC32_POLYNOMIAL = 0xEDB88320;  // Reflected 0x04C11DB7
+constexpr u32    CRC32C_POLYNOMIAL = 0x82F63B78; // Reflected 0x1EDC6F41
+constexpr Tables crc32Tables = makeTables(CRC32_POLYNOMIAL);
+constexpr Tables crc32cTables = makeTables(CRC32C_POLYNOMIAL);
+
+inline u32 load32(const u8 *p)
+{
+	return static_cast<u32>(p[0]) | static_cast<u32>(p[1]) << 8 | static_cast<u32>(p[2]) << 16 |
+	       static_cast<u32>(p[3]) << 24;
+}
+
+/// Unconditioned CRC, the caller inverts before and after
+u32 sliceBy8(const Tables &t, const u8 *data, size_t size, u32 crc)
+{
+	for (; size >= 8; data += 8, size -= 8)
+	{
+		u32 low = load32(data) ^ crc;
+		u32 high = load32(data + 4);
+		crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+		      t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+	}
+	for (; size > 0; data++, size--)
+		crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xFF];
+	return crc;
+}
+
+#if defined(PHASOR_CRC32C_X86) || defined(PHASOR_CRC32C_ARM)
+
+// Polynomials modulo the Castagnoli polynomial, bit-reflected like the CRC: bit 31 is x^0
+
+constexpr u32 multiplyModP(u32 a, u32 b)
+{
+	u32 product = 0;
+	for (u32 bit = 1u << 31; bit != 0; bit >>= 1)
+	{
+		if ((a & bit) != 0)
+			product ^= b;
+		b = (b & 1) != 0 ? (b >> 1) ^ CRC32C_POLYNOMIAL : b >> 1;
+	}
+	return product;
+}
+
+constexpr u32 xPowerModP(u64 n)
+{
+	u32 result = 1u << 31; // x^0
+	u32 square = 1u << 30; // x^(2^i) for bit i of n
+	for (; n != 0; n >>= 1)
+	{
+		if ((n & 1) != 0)
+			result = multiplyModP(square, result);
+		square = multiplyModP(square, square);
+	}
+	return result;
+}
+
+inline u64 load64(const u8 *p)
+{
+	u64 value;
+	std::memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+#endif
+
+#if defined(PHASOR_CRC32C_X86)
+
+// Three streams hide the three-cycle latency of the crc32 instruction. Each block's streams are
+// joined by shifting: crc(A B) = crc(A) * x^(8 |B|) ^ crc(B), for unconditioned CRCs.
+constexpr size_t LONG_BLOCK = 8192;
+constexpr size_t SHORT_BLOCK = 256;
+
+/// Multipliers for shifting a CRC over block bytes
+struct Shift
+{
+	u32 software; ///< x^(8 block), for multiplyModP
+	u32 clmul;    ///< x^(8 block - 33): a carry-less product has one extra factor x, crc32 adds x^32
+};
+
+constexpr Shift makeShift(size_t block)
+{
+	return {xPowerModP(8 * block), xPowerModP(8 * block - 33)};
+}
+
+constexpr Shift LONG_SHIFT = makeShift(LONG_BLOCK);
+constexpr Shift SHORT_SHIFT = makeShift(SHORT_BLOCK);
+
+PHASOR_TARGET("sse4.2,pclmul")
+u32 shiftCrc(u32 crc, const Shift &shift, bool clmul)
+{
+	if (!clmul)
+		return multiplyModP(shift.software, crc);
+	__m128i product = _mm_clmulepi64_si128(_mm_cvtsi32_si128(static_cast<int>(crc)),
+	                                       _mm_cvtsi32_si128(static_cast<int>(shift.clmul)), 0);
+	return static_cast<u32>(_mm_crc32_u64(0, static_cast<u64>(_mm_cvtsi128_si64(product))));
+}
+
+PHASOR_TARGET("sse4.2,pclmul")
+u32 crc32cBlocks(const u8 *&data, size_t &size, u32 crc, size_t block, const Shift &shift, bool clmul)
+{
+	for (; size >= 3 * block; data += 3 * block, size -= 3 * block)
+	{
+		u64 a = crc, b = 0, c = 0;
+		for (size_t i = 0; i < block; i += 8)
+		{
+			a = _mm_crc32_u64(a, load64(data + i));
+			b = _mm_crc32_u64(b, load64(data + block + i));
+			c = _mm_crc32_u64(c, load64(data + 2 * block + i));
+		}
+		crc = shiftCrc(static_cast<u32>(a), shift, clmul) ^ static_cast<u32>(b);
+		crc = shiftCrc(crc, shift, clmul) ^ static_cast<u32>(c);
+	}
+	return crc;
+}
+
+PHASOR_TARGET("sse4.2,pclmul")
+u32 crc32cX86(const u8 *data, size_t size, u32 crc, bool clmul)
+{
+	for (; size > 0 && reinterpret_cast<std::uintptr_t>(data) % 8 != 0; data++, size--)
+		crc = _mm_crc32_u8(crc, *data);
+	crc = crc32cBlocks(data, size, crc, LONG_BLOCK, LONG_SHIFT, clmul);
+	crc = crc32cBlocks(data, size, crc, SHORT_BLOCK, SHORT_SHIFT, clmul);
+	u64 wide = crc;
+	for (; size >= 8; data += 8, size -= 8)
+		wide = _mm_crc32_u64(wide, load64(data));
+	crc = static_cast<u32>(wide);
+	for (; size > 0; data++, size--)
+		crc = _mm_crc32_u8(crc, *data);
+	return crc;
+}
+
+#elif defined(PHASOR_CRC32C_ARM)
+
+u32 crc32cArm(const u8 *data, size_t size, u32 crc)
+{
+	for (; size >= 8; data += 8, size -= 8)
+		crc = __crc32cd(crc, load64(data));
+	for (; size > 0; data++, size--)
+		crc = __crc32cb(crc, *data);
+	return crc;
+}
+
+#endif
+
+enum class Implementation
+{
+	Software,
+	Sse42,
+	Sse42Clmul,
+	Arm,
+};
+
+Implementation detect()
+{
+#if defined(PHASOR_CRC32C_X86)
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool sse42 = (info[2] & (1 << 20)) != 0;
+	bool clmul = (info[2] & (1 << 1)) != 0;
+#else
+	__builtin_cpu_init();
+	bool sse42 = __builtin_cpu_supports("sse4.2");
+	bool clmul = __builtin_cpu_supports("pclmul");
+#endif
+	if (sse42)
+		return clmul ? Implementation::Sse42Clmul : Implementation::Sse42;
+	return Implementation::Software;
+#elif defined(PHASOR_CRC32C_ARM)
+	return Implementation::Arm;
+#else
+	return Implementation::Software;
+#endif
+}
+
+Implementation implementation()
+{
+	static const Implementation detected = detect();
+	return detected;
+}
+
+} // namespace
+
+u32 Checksum::crc32(const u8 *data, size_t size, u32 crc)
+{
+	return ~sliceBy8(crc32Tables, data, size, ~crc);
+}
+
+u32 Checksum::crc32cSoftware(const u8 *data, size_t size, u32 crc)
+{
+	return ~sliceBy8(crc32cTables, data, size, ~crc);
+}
+
+u32 Checksum::crc32c(const u8 *data, size_t size, u32 crc)
+{
+	switch (implementation())
+	{
+#if defined(PHASOR_CRC32C_X86)
+	case Implementation::Sse42:
+		return ~crc32cX86(data, size, ~crc, false);
+	case Implementation::Sse42Clmul:
+		return ~crc32cX86(data, size, ~crc, true);
+#elif defined(PHASOR_CRC32C_ARM)
+	case Implementation::Arm:
+		return ~crc32cArm(data, size, ~crc);
+#endif
+	default:
+		return crc32cSoftware(data, size, crc);
+	}
+}
+
+const char *Checksum::crc32cImplementation()
+{
+	switch (implementation())
+	{
+	case Implementation::Sse42:
+		return "sse4.2";
+	case Implementation::Sse42Clmul:
+		return "sse4.2+pclmul";
+	case Implementation::Arm:
+		return "armv8-crc";
+	default:
+		return "slicing-by-8";
+	}
+}
+
+} // namespace Phasor
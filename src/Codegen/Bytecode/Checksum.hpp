@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <phsint.hpp>
+
+/// @brief The Phasor Programming Language and Runtime
+namespace Phasor
+{
+
+/**
+ * @class Checksum
+ * @brief CRC checksums of bytecode images
+ *
+ * crc32() is the zlib / IEEE 802.3 CRC used by version 3 and 4.1 images,
+ * crc32c() the Castagnoli CRC used since. Both process eight bytes per step
+ * with slicing-by-8 tables. On x86-64 CPUs with SSE4.2, crc32c() instead
+ * runs three interleaved streams through the crc32 instruction and joins
+ * them with a carry-less multiply when PCLMULQDQ is available too; on ARM
+ * builds with the CRC extension it uses __crc32cd.
+ *
+ * Passing a previous result as crc continues the checksum, so
+ * crc32c(b, n, crc32c(a, m)) is the checksum of a followed by b.
+ */
+class Checksum
+{
+  public:
+	static u32 crc32(const u8 *data, size_t size, u32 crc = 0);
+	static u32 crc32c(const u8 *data, size_t size, u32 crc = 0);
+
+	/// @brief Portable crc32c(), for comparison with the accelerated one
+	static u32 crc32cSoftware(const u8 *data, size_t size, u32 crc = 0);
+
+	/// @brief Which crc32c() implementation this CPU uses: "sse4.2+pclmul", "sse4.2", "armv8-crc" or "slicing-by-8"
+	static const char *crc32cImplementation();
+};
+
+} // namespace Phasor
@@ -17,6 +17,28 @@ static constexpr uint32_t ascii_to_u32_le(const char s[4])
 /**
  * @brief Version number
  *
- * '3.0.0.0'
+ * '4.2.0.0': varint-encoded tables and values, indexed constant pool, aligned
+ * fixed-width instruction records, CRC32C checksums per section
  */
-const uint32_t VERSION = 0x03000000;
\ No newline at end of file
+const uint32_t VERSION = 0x04020000;
+
+/// @brief Same layout with 9-byte section index entries and a single CRC32 checksum, still readable
+const uint32_t VERSION_4_1 = 0x04010000;
+
+/// @brief Last version with fixed-width tables and 16-bit string lengths, still readable
+const uint32_t VERSION_3 = 0x03000000;
+
+/// @brief Header flag: a section index follows the header
+const uint32_t FLAG_SECTION_INDEX = 0x1;
+
+/// @brief Header flag: instructions are varint-encoded, one operand per PhasorIR::getOperandCount
+const uint32_t FLAG_COMPACT_INSTRUCTIONS = 0x2;
+
+/// @brief Bytes per section index entry: id, offset, size and CRC32C of the section (9 in 4.1, without CRC32C)
+const uint32_t SECTION_INDEX_ENTRY_SIZE = 13;
+
+/// @brief Bytes per instruction record from version 4 on, unless compact
+const uint32_t INSTRUCTION_RECORD_SIZE = 16;
+
+/// @brief File offset alignment of the first instruction record from version 4 on, unless compact
+const uint32_t INSTRUCTION_ALIGNMENT = 16;
@@ -0,0 +1,236 @@
+#include "ModuleCache.hpp"
+#include "../Bytecode/BytecodeDeserializer.hpp"
+#include "../Bytecode/BytecodeSerializer.hpp"
+#include "../Bytecode/metadata.h"
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <version.h>
+
+namespace Phasor
+{
+
+namespace
+{
+
+constexpr std::string_view entryMagic = "PHSC";
+
+/// 64-bit FNV-1a, plenty to tell sources apart and cheap next to lexing them
+u64 contentHash(std::string_view data, u64 hash = 0xcbf29ce484222325ULL)
+{
+	for (unsigned char c : data)
+	{
+		hash ^= c;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+std::optional<std::string> readText(const std::filesystem::path &path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return std::nullopt;
+	return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void writeU32(std::vector<u8> &out, u32 value)
+{
+	for (int i = 0; i < 4; i++)
+		out.push_back(static_cast<u8>(value >> (i * 8)));
+}
+
+void writeU64(std::vector<u8> &out, u64 value)
+{
+	for (int i = 0; i < 8; i++)
+		out.push_back(static_cast<u8>(value >> (i * 8)));
+}
+
+/// Bounds-checked little-endian reader over an entry
+struct EntryReader
+{
+	const std::vector<u8> &data;
+	size_t                 position = 0;
+
+	bool has(size_t n) const
+	{
+		return data.size() - position >= n;
+	}
+	u64 read(int bytes)
+	{
+		u64 value = 0;
+		for (int i = 0; i < bytes; i++)
+			value |= static_cast<u64>(data[position++]) << (i * 8);
+		return value;
+	}
+};
+
+/// Length of the ".<key>.phsc" an entry's name adds to its module's file name
+constexpr size_t entrySuffixLength = 1 + 16 + 5;
+
+/// Whether a file name is "<module>.<16 hex digits>.phsc", a cache entry of that module file
+bool isEntryOf(std::string_view name, std::string_view module)
+{
+	if (name.size() != module.size() + entrySuffixLength || !name.starts_with(module) || !name.ends_with(".phsc") ||
+	    name[module.size()] != '.')
+		return false;
+	return name.substr(module.size() + 1, 16).find_first_not_of("0123456789abcdef") == std::string_view::npos;
+}
+
+} // namespace
+
+ModuleCache::ModuleCache(std::string language) : language(std::move(language))
+{
+}
+
+bool ModuleCache::enabled()
+{
+	return std::getenv("PHASOR_NO_CACHE") == nullptr;
+}
+
+std::filesystem::path ModuleCache::directoryFor(const std::filesystem::path &path)
+{
+	return path.parent_path() / "__phasorcache__";
+}
+
+Bytecode ModuleCache::load(const std::filesystem::path &path, const Compiler &compile) const
+{
+	auto source = readText(path);
+	if (!source)
+		throw std::runtime_error("Could not open imported file: " + path.string());
+
+	std::vector<std::filesystem::path> dependencies;
+	if (!enabled())
+		return compile(*source, dependencies);
+
+	std::error_code ec;
+	auto            module = std::filesystem::absolute(path, ec).lexically_normal();
+	if (ec)
+		return compile(*source, dependencies);
+
+	u64 key = contentHash(language);
+	key = contentHash(std::format("\n{}\n{:08x}\n", PHASOR_VERSION_STRING, VERSION), key);
+	key = contentHash(module.generic_string(), key);
+	key = contentHash(*source, key);
+
+	auto entry = directoryFor(module) / std::format("{}.{:016x}.phsc", module.filename().string(), key);
+	if (auto cached = readEntry(entry))
+		return std::move(*cached);
+
+	Bytecode bytecode = compile(*source, dependencies);
+	writeEntry(entry, bytecode, dependencies);
+	return bytecode;
+}
+
+std::optional<Bytecode> ModuleCache::readEntry(const std::filesystem::path &entry)
+{
+	std::ifstream file(entry, std::ios::binary);
+	if (!file.is_open())
+		return std::nullopt;
+	std::vector<u8> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	EntryReader reader{data};
+	if (!reader.has(entryMagic.size() + 4) ||
+	    std::string_view(reinterpret_cast<const char *>(data.data()), entryMagic.size()) != entryMagic)
+		return std::nullopt;
+	reader.position = entryMagic.size();
+
+	// Any include that changed or disappeared since the entry was written makes it stale
+	u64 dependencyCount = reader.read(4);
+	for (u64 i = 0; i < dependencyCount; i++)
+	{
+		if (!reader.has(4))
+			return std::nullopt;
+		u64 length = reader.read(4);
+		if (!reader.has(length + 8))
+			return std::nullopt;
+		std::string dependency(reinterpret_cast<const char *>(data.data() + reader.position), length);
+		reader.position += length;
+		u64  expected = reader.read(8);
+		auto text = readText(std::filesystem::path(dependency));
+		if (!text || contentHash(*text) != expected)
+			return std::nullopt;
+	}
+
+	try
+	{
+		BytecodeDeserializer deserializer;
+		return deserializer.deserialize(std::vector<u8>(data.begin() + reader.position, data.end()));
+	}
+	catch (const std::exception &)
+	{
+		// Truncated or corrupted entry, compile again and overwrite it
+		return std::nullopt;
+	}
+}
+
+void ModuleCache::writeEntry(const std::filesystem::path &entry, const Bytecode &bytecode,
+                             const std::vector<std::filesystem::path> &dependencies)
+{
+	// Failing to write an entry only costs a recompile, so filesystem errors skip it instead of throwing
+	std::error_code ec;
+	std::vector<u8> data(entryMagic.begin(), entryMagic.end());
+	writeU32(data, static_cast<u32>(dependencies.size()));
+	for (const auto &dependency : dependencies)
+	{
+		auto text = readText(dependency);
+		if (!text)
+			return;
+		auto absolute = std::filesystem::absolute(dependency, ec);
+		if (ec)
+			return;
+		std::string name = absolute.lexically_normal().generic_string();
+		writeU32(data, static_cast<u32>(name.size()));
+		data.insert(data.end(), name.begin(), name.end());
+		writeU64(data, contentHash(*text));
+	}
+
+	BytecodeSerializer serializer;
+	auto               phsb = serializer.serialize(bytecode);
+	data.insert(data.end(), phsb.begin(), phsb.end());
+
+	// Write under a temporary name and rename, so a concurrent run never sees half an entry
+	std::filesystem::create_directories(entry.parent_path(), ec);
+	if (ec)
+		return;
+	auto temporary = entry;
+	temporary += std::format(".{:08x}.tmp", std::random_device{}());
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return;
+		file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+		if (!file)
+		{
+			file.close();
+			std::filesystem::remove(temporary, ec);
+			return;
+		}
+	}
+	std::filesystem::rename(temporary, entry, ec);
+	if (ec)
+	{
+		std::filesystem::remove(temporary, ec);
+		return;
+	}
+
+	// Entries for earlier versions of the module can't be hit again, so only this one is kept
+	std::string      name = entry.filename().string();
+	std::string_view module = std::string_view(name).substr(0, name.size() - entrySuffixLength);
+	for (std::filesystem::directory_iterator it(entry.parent_path(), ec), end; !ec && it != end; it.increment(ec))
+	{
+		std::string otherName = it->path().filename().string();
+		if (otherName != name && isEntryOf(otherName, module))
+		{
+			std::error_code removeError;
+			std::filesystem::remove(it->path(), removeError);
+		}
+	}
+}
+
+} // namespace Phasor
@@ -0,0 +1,56 @@
+#pragma once
+#include "../CodeGen.hpp"
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+#include <phsint.hpp>
+
+/// @brief The Phasor Programming Language and Runtime
+namespace Phasor
+{
+
+/**
+ * @class ModuleCache
+ * @brief On-disk cache of compiled modules, in the spirit of __pycache__
+ *
+ * Bytecode for a module is kept in `__phasorcache__/` next to it as
+ * `<file>.<key>.phsc`. The key hashes the language, the compiler and bytecode
+ * format versions, the module path and its source text, so an edited module or
+ * an upgraded toolchain simply misses; writing an entry removes the module's
+ * other entries, so one per module is kept. Files the compiler read besides the
+ * module (`include`) are recorded in the entry with their content hashes and
+ * rechecked on every hit.
+ *
+ * Set PHASOR_NO_CACHE to bypass the cache. Directories that can't be written
+ * are skipped silently, the module is still compiled and run.
+ */
+class ModuleCache
+{
+  public:
+	/// @brief Compiles a module, appending the other files it read to dependencies
+	using Compiler =
+	    std::function<Bytecode(const std::string &source, std::vector<std::filesystem::path> &dependencies)>;
+
+	/// @param language Mixed into the key so front ends never share entries
+	explicit ModuleCache(std::string language);
+
+	/// @brief Load the module at path from the cache, compiling and storing it on a miss
+	Bytecode load(const std::filesystem::path &path, const Compiler &compile) const;
+
+	/// @brief Cache directory for a module
+	static std::filesystem::path directoryFor(const std::filesystem::path &path);
+
+	/// @brief False when PHASOR_NO_CACHE is set
+	static bool enabled();
+
+  private:
+	std::string language;
+
+	static std::optional<Bytecode> readEntry(const std::filesystem::path &entry);
+	static void writeEntry(const std::filesystem::path &entry, const Bytecode &bytecode,
+	                       const std::vector<std::filesystem::path> &dependencies);
+};
+
+} // namespace Phasor
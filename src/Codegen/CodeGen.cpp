@@ -1,6 +1,10 @@
 #include "CodeGen.hpp"
+#include "Optimizer/StructEscapeAnalysis.hpp"
+#include <algorithm>
 #include <iostream>
+#include <limits>
 #include <unordered_map>
+#include <unordered_set>
 #include <phsint.hpp>
 
 namespace Phasor
@@ -13,6 +17,17 @@ Bytecode CodeGenerator::generate(const AST::Program &program, const std::unorder
 	bytecode.variables = existingVars;
 	bytecode.nextVarIndex = nextVarIdx;
 	isRepl = replMode;
+	// REPL lines keep the modules earlier lines imported
+	if (!replMode)
+	{
+		importedModules.clear();
+	}
+	// Later REPL lines may use a struct variable as a whole, so only analyze whole programs
+	scalarReplacedStructs.clear();
+	if (!replMode)
+	{
+		scalarReplacedStructs = StructEscapeAnalysis::findReplaceable(program);
+	}
 
 	for (const auto &stmt : program.statements)
 	{
@@ -22,9 +37,43 @@ Bytecode CodeGenerator::generate(const AST::Program &program, const std::unorder
 	return bytecode;
 }
 
+void CodeGenerator::emitPushConstant(const Value &value)
+{
+	switch (value.getType())
+	{
+	case ValueType::Null:
+		bytecode.emit(OpCode::NULL_VAL);
+		return;
+	case ValueType::Bool:
+		bytecode.emit(value.asBool() ? OpCode::TRUE_P : OpCode::FALSE_P);
+		return;
+	case ValueType::Int:
+		if (value.asInt() >= std::numeric_limits<i32>::min() && value.asInt() <= std::numeric_limits<i32>::max())
+		{
+			bytecode.emit(OpCode::PUSH_INT_IMM, static_cast<i32>(value.asInt()));
+			return;
+		}
+		break;
+	default:
+		break;
+	}
+	bytecode.emit(OpCode::PUSH_CONST, bytecode.addConstant(value));
+}
+
+void CodeGenerator::emitLoadConstant(u8 reg, const Value &value)
+{
+	if (value.isInt() && value.asInt() >= std::numeric_limits<i32>::min() &&
+	    value.asInt() <= std::numeric_limits<i32>::max())
+	{
+		bytecode.emit(OpCode::LOAD_INT_IMM_R, reg, static_cast<i32>(value.asInt()));
+		return;
+	}
+	bytecode.emit(OpCode::LOAD_CONST_R, reg, bytecode.addConstant(value));
+}
+
 bool CodeGenerator::isLiteralExpression(const AST::Expression *expr, Value &outValue)
 {
-	if (const auto *numExpr = dynamic_cast<const AST::NumberExpr *>(expr))
+	if (const auto *numExpr = AST::as<AST::NumberExpr>(expr))
 	{
 		try
 		{
@@ -43,17 +92,17 @@ bool CodeGenerator::isLiteralExpression(const AST::Expression *expr, Value &outV
 			return false;
 		}
 	}
-	if (const auto *strExpr = dynamic_cast<const AST::StringExpr *>(expr))
+	if (const auto *strExpr = AST::as<AST::StringExpr>(expr))
 	{
 		outValue = Value(strExpr->value);
 		return true;
 	}
-	if (const auto *boolExpr = dynamic_cast<const AST::BooleanExpr *>(expr))
+	if (const auto *boolExpr = AST::as<AST::BooleanExpr>(expr))
 	{
 		outValue = Value(boolExpr->value);
 		return true;
 	}
-	if (dynamic_cast<const AST::NullExpr *>(expr) != nullptr)
+	if (AST::as<AST::NullExpr>(expr) != nullptr)
 	{
 		outValue = Value();
 		return true;
@@ -61,6 +110,40 @@ bool CodeGenerator::isLiteralExpression(const AST::Expression *expr, Value &outV
 	return false;
 }
 
+bool CodeGenerator::evaluatePureCall(const AST::CallExpr *callExpr, Value &outValue)
+{
+	// User functions shadow natives of the same name
+	if (!pureCallEvaluator || bytecode.functionEntries.contains(callExpr->callee))
+	{
+		return false;
+	}
+
+	std::vector<Value> args;
+	args.reserve(callExpr->arguments.size());
+	for (const auto &arg : callExpr->arguments)
+	{
+		Value value;
+		if (!isLiteralExpression(arg.get(), value))
+		{
+			const auto *nested = AST::as<AST::CallExpr>(arg.get());
+			if (nested == nullptr || !evaluatePureCall(nested, value))
+			{
+				return false;
+			}
+		}
+		args.push_back(std::move(value));
+	}
+
+	std::optional<Value> result = pureCallEvaluator(callExpr->callee, args, importedModules);
+	// Arrays and structs are mutable, so they can't be shared through the constant pool
+	if (!result || !(result->isNull() || result->isBool() || result->isInt() || result->isFloat() || result->isString()))
+	{
+		return false;
+	}
+	outValue = std::move(*result);
+	return true;
+}
+
 ValueType CodeGenerator::inferExpressionType(const AST::Expression *expr, bool &known)
 {
 	// If literal, we know the type immediately
@@ -72,7 +155,7 @@ ValueType CodeGenerator::inferExpressionType(const AST::Expression *expr, bool &
 	}
 
 	// If identifier and we've inferred its type previously, return that
-	if (const auto *ident = dynamic_cast<const AST::IdentifierExpr *>(expr))
+	if (const auto *ident = AST::as<AST::IdentifierExpr>(expr))
 	{
 		auto it = inferredTypes.find(ident->name);
 		if (it != inferredTypes.end())
@@ -83,7 +166,7 @@ ValueType CodeGenerator::inferExpressionType(const AST::Expression *expr, bool &
 	}
 
 	// Unary expression
-	if (const auto *unaryExpr = dynamic_cast<const AST::UnaryExpr *>(expr))
+	if (const auto *unaryExpr = AST::as<AST::UnaryExpr>(expr))
 	{
 		if (unaryExpr->op == AST::UnaryOp::Not)
 		{
@@ -97,7 +180,7 @@ ValueType CodeGenerator::inferExpressionType(const AST::Expression *expr, bool &
 	}
 
 	// Binary expression
-	if (const auto *binExpr = dynamic_cast<const AST::BinaryExpr *>(expr))
+	if (const auto *binExpr = AST::as<AST::BinaryExpr>(expr))
 	{
 		if (binExpr->op == AST::BinaryOp::And || binExpr->op == AST::BinaryOp::Or ||
 		    binExpr->op == AST::BinaryOp::Equal || binExpr->op == AST::BinaryOp::NotEqual ||
@@ -149,19 +232,19 @@ ValueType CodeGenerator::inferExpressionType(const AST::Expression *expr, bool &
 	}
 
 	// Postfix expression
-	if (const auto *postfixExpr = dynamic_cast<const AST::PostfixExpr *>(expr))
+	if (const auto *postfixExpr = AST::as<AST::PostfixExpr>(expr))
 	{
 		return inferExpressionType(postfixExpr->operand.get(), known);
 	}
 
 	// Assignment expression
-	if (const auto *assignExpr = dynamic_cast<const AST::AssignmentExpr *>(expr))
+	if (const auto *assignExpr = AST::as<AST::AssignmentExpr>(expr))
 	{
 		return inferExpressionType(assignExpr->value.get(), known);
 	}
 
 	// Call expression
-	if (const auto *callExpr = dynamic_cast<const AST::CallExpr *>(expr))
+	if (const auto *callExpr = AST::as<AST::CallExpr>(expr))
 	{
 		if (callExpr->callee == "len")
 		{
@@ -175,22 +258,22 @@ ValueType CodeGenerator::inferExpressionType(const AST::Expression *expr, bool &
 		}
 	}
 
-	if (dynamic_cast<const AST::ArrayLiteralExpr *>(expr))
+	if (AST::as<AST::ArrayLiteralExpr>(expr))
 	{
 		known = true;
 		return ValueType::Array;
 	}
 
-	if (dynamic_cast<const AST::StructInstanceExpr *>(expr))
+	if (AST::as<AST::StructInstanceExpr>(expr))
 	{
 		known = true;
 		return ValueType::Struct;
 	}
 
-	if (const auto *fieldExpr = dynamic_cast<const AST::FieldAccessExpr *>(expr))
+	if (const auto *fieldExpr = AST::as<AST::FieldAccessExpr>(expr))
 	{
 		// field on a named variable we have field-type records for
-		if (const auto *objIdent = dynamic_cast<const AST::IdentifierExpr *>(fieldExpr->object.get()))
+		if (const auto *objIdent = AST::as<AST::IdentifierExpr>(fieldExpr->object.get()))
 		{
 			auto varIt = inferredFieldTypes.find(objIdent->name);
 			if (varIt != inferredFieldTypes.end())
@@ -229,140 +312,111 @@ ValueType CodeGenerator::inferExpressionType(const AST::Expression *expr, bool &
 
 void CodeGenerator::generateStatement(const AST::Statement *stmt)
 {
-	if (const auto *varDecl = dynamic_cast<const AST::VarDecl *>(stmt))
-	{
-		generateVarDecl(varDecl);
-	}
-	else if (const auto *exprStmt = dynamic_cast<const AST::ExpressionStmt *>(stmt))
-	{
-		generateExpressionStmt(exprStmt);
-	}
-	else if (const auto *printStmt = dynamic_cast<const AST::PrintStmt *>(stmt))
-	{
-		generatePrintStmt(printStmt);
-	}
-	else if (dynamic_cast<const AST::IncludeStmt *>(stmt) != nullptr)
+	switch (stmt->kind)
 	{
+	case AST::NodeKind::VarDecl:
+		generateVarDecl(static_cast<const AST::VarDecl *>(stmt));
+		break;
+	case AST::NodeKind::ExpressionStmt:
+		generateExpressionStmt(static_cast<const AST::ExpressionStmt *>(stmt));
+		break;
+	case AST::NodeKind::PrintStmt:
+		generatePrintStmt(static_cast<const AST::PrintStmt *>(stmt));
+		break;
+	case AST::NodeKind::IncludeStmt:
 		// preprocessor include
-	}
-	else if (const auto *importStmt = dynamic_cast<const AST::ImportStmt *>(stmt))
-	{
-		generateImportStmt(importStmt);
-	}
-	else if (const auto *exportStmt = dynamic_cast<const AST::ExportStmt *>(stmt))
-	{
-		generateExportStmt(exportStmt);
-	}
-	else if (const auto *blockStmt = dynamic_cast<const AST::BlockStmt *>(stmt))
-	{
-		generateBlockStmt(blockStmt);
-	}
-	else if (const auto *ifStmt = dynamic_cast<const AST::IfStmt *>(stmt))
-	{
-		generateIfStmt(ifStmt);
-	}
-	else if (const auto *whileStmt = dynamic_cast<const AST::WhileStmt *>(stmt))
-	{
-		generateWhileStmt(whileStmt);
-	}
-	else if (const auto *forStmt = dynamic_cast<const AST::ForStmt *>(stmt))
-	{
-		generateForStmt(forStmt);
-	}
-	else if (const auto *returnStmt = dynamic_cast<const AST::ReturnStmt *>(stmt))
-	{
-		generateReturnStmt(returnStmt);
-	}
-	else if (const auto *unsafeStmt = dynamic_cast<const AST::UnsafeBlockStmt *>(stmt))
-	{
-		generateUnsafeBlockStmt(unsafeStmt);
-	}
-	else if (const auto *funcDecl = dynamic_cast<const AST::FunctionDecl *>(stmt))
-	{
-		generateFunctionDecl(funcDecl);
-	}
-	else if (const auto *structDecl = dynamic_cast<const AST::StructDecl *>(stmt))
-	{
-		generateStructDecl(structDecl);
-	}
-	else if (dynamic_cast<const AST::BreakStmt *>(stmt) != nullptr)
-	{
+		break;
+	case AST::NodeKind::ImportStmt:
+		generateImportStmt(static_cast<const AST::ImportStmt *>(stmt));
+		break;
+	case AST::NodeKind::ExportStmt:
+		generateExportStmt(static_cast<const AST::ExportStmt *>(stmt));
+		break;
+	case AST::NodeKind::BlockStmt:
+		generateBlockStmt(static_cast<const AST::BlockStmt *>(stmt));
+		break;
+	case AST::NodeKind::IfStmt:
+		generateIfStmt(static_cast<const AST::IfStmt *>(stmt));
+		break;
+	case AST::NodeKind::WhileStmt:
+		generateWhileStmt(static_cast<const AST::WhileStmt *>(stmt));
+		break;
+	case AST::NodeKind::ForStmt:
+		generateForStmt(static_cast<const AST::ForStmt *>(stmt));
+		break;
+	case AST::NodeKind::ReturnStmt:
+		generateReturnStmt(static_cast<const AST::ReturnStmt *>(stmt));
+		break;
+	case AST::NodeKind::UnsafeBlockStmt:
+		generateUnsafeBlockStmt(static_cast<const AST::UnsafeBlockStmt *>(stmt));
+		break;
+	case AST::NodeKind::FunctionDecl:
+		generateFunctionDecl(static_cast<const AST::FunctionDecl *>(stmt));
+		break;
+	case AST::NodeKind::StructDecl:
+		generateStructDecl(static_cast<const AST::StructDecl *>(stmt));
+		break;
+	case AST::NodeKind::BreakStmt:
 		generateBreakStmt();
-	}
-	else if (dynamic_cast<const AST::ContinueStmt *>(stmt) != nullptr)
-	{
+		break;
+	case AST::NodeKind::ContinueStmt:
 		generateContinueStmt();
-	}
-	else if (const auto *switchStmt = dynamic_cast<const AST::SwitchStmt *>(stmt))
-	{
-		generateSwitchStmt(switchStmt);
-	}
-	else
-	{
+		break;
+	case AST::NodeKind::SwitchStmt:
+		generateSwitchStmt(static_cast<const AST::SwitchStmt *>(stmt));
+		break;
+	default:
 		throw std::runtime_error("Unknown statement type in code generation");
 	}
 }
 
 void CodeGenerator::generateExpression(const AST::Expression *expr, bool resultNeeded)
 {
-	if (const auto *numExpr = dynamic_cast<const AST::NumberExpr *>(expr))
-	{
-		generateNumberExpr(numExpr);
-	}
-	else if (const auto *strExpr = dynamic_cast<const AST::StringExpr *>(expr))
-	{
-		generateStringExpr(strExpr);
-	}
-	else if (const auto *identExpr = dynamic_cast<const AST::IdentifierExpr *>(expr))
-	{
-		generateIdentifierExpr(identExpr);
-	}
-	else if (const auto *unaryExpr = dynamic_cast<const AST::UnaryExpr *>(expr))
-	{
-		generateUnaryExpr(unaryExpr);
-	}
-	else if (const auto *callExpr = dynamic_cast<const AST::CallExpr *>(expr))
-	{
-		generateCallExpr(callExpr);
-	}
-	else if (const auto *binExpr = dynamic_cast<const AST::BinaryExpr *>(expr))
-	{
-		generateBinaryExpr(binExpr);
-	}
-	else if (const auto *boolExpr = dynamic_cast<const AST::BooleanExpr *>(expr))
-	{
-		generateBooleanExpr(boolExpr);
-	}
-	else if (const auto *nullExpr = dynamic_cast<const AST::NullExpr *>(expr))
-	{
-		generateNullExpr(nullExpr);
-	}
-	else if (const auto *assignExpr = dynamic_cast<const AST::AssignmentExpr *>(expr))
-	{
-		generateAssignmentExpr(assignExpr);
-	}
-	else if (const auto *structExpr = dynamic_cast<const AST::StructInstanceExpr *>(expr))
-	{
-		generateStructInstanceExpr(structExpr);
-	}
-	else if (const auto *fieldAccessExpr = dynamic_cast<const AST::FieldAccessExpr *>(expr))
-	{
-		generateFieldAccessExpr(fieldAccessExpr);
-	}
-	else if (const auto *postfixExpr = dynamic_cast<const AST::PostfixExpr *>(expr))
-	{
-		generatePostfixExpr(postfixExpr, resultNeeded);
-	}
-	else if (const auto *arrayLit = dynamic_cast<const AST::ArrayLiteralExpr *>(expr))
-	{
-		generateArrayLiteralExpr(arrayLit, resultNeeded);
-	}
-	else if (const auto *arrayAccess = dynamic_cast<const AST::ArrayAccessExpr *>(expr))
-	{
-		generateArrayAccessExpr(arrayAccess, resultNeeded);
-	}
-	else
+	switch (expr->kind)
 	{
+	case AST::NodeKind::NumberExpr:
+		generateNumberExpr(static_cast<const AST::NumberExpr *>(expr));
+		break;
+	case AST::NodeKind::StringExpr:
+		generateStringExpr(static_cast<const AST::StringExpr *>(expr));
+		break;
+	case AST::NodeKind::IdentifierExpr:
+		generateIdentifierExpr(static_cast<const AST::IdentifierExpr *>(expr));
+		break;
+	case AST::NodeKind::UnaryExpr:
+		generateUnaryExpr(static_cast<const AST::UnaryExpr *>(expr));
+		break;
+	case AST::NodeKind::CallExpr:
+		generateCallExpr(static_cast<const AST::CallExpr *>(expr));
+		break;
+	case AST::NodeKind::BinaryExpr:
+		generateBinaryExpr(static_cast<const AST::BinaryExpr *>(expr));
+		break;
+	case AST::NodeKind::BooleanExpr:
+		generateBooleanExpr(static_cast<const AST::BooleanExpr *>(expr));
+		break;
+	case AST::NodeKind::NullExpr:
+		generateNullExpr(static_cast<const AST::NullExpr *>(expr));
+		break;
+	case AST::NodeKind::AssignmentExpr:
+		generateAssignmentExpr(static_cast<const AST::AssignmentExpr *>(expr));
+		break;
+	case AST::NodeKind::StructInstanceExpr:
+		generateStructInstanceExpr(static_cast<const AST::StructInstanceExpr *>(expr));
+		break;
+	case AST::NodeKind::FieldAccessExpr:
+		generateFieldAccessExpr(static_cast<const AST::FieldAccessExpr *>(expr));
+		break;
+	case AST::NodeKind::PostfixExpr:
+		generatePostfixExpr(static_cast<const AST::PostfixExpr *>(expr), resultNeeded);
+		break;
+	case AST::NodeKind::ArrayLiteralExpr:
+		generateArrayLiteralExpr(static_cast<const AST::ArrayLiteralExpr *>(expr), resultNeeded);
+		break;
+	case AST::NodeKind::ArrayAccessExpr:
+		generateArrayAccessExpr(static_cast<const AST::ArrayAccessExpr *>(expr), resultNeeded);
+		break;
+	default:
 		throw std::runtime_error("Unknown expression type in code generation");
 	}
 }
@@ -388,7 +442,7 @@ void CodeGenerator::generateVarDecl(const AST::VarDecl *varDecl)
 				if (known)
 					inferredTypes[varDecl->name] = inferred;
 
-				if (const auto *structExpr = dynamic_cast<const AST::StructInstanceExpr *>(varDecl->initializer.get()))
+				if (const auto *structExpr = AST::as<AST::StructInstanceExpr>(varDecl->initializer.get()))
 				{
 					inferredTypes[varDecl->name] = ValueType::Struct;
 					for (const auto &[fieldName, fieldValue] : structExpr->fieldValues)
@@ -420,9 +474,15 @@ void CodeGenerator::generateVarDecl(const AST::VarDecl *varDecl)
 		}
 	}
 
+	if (auto it = scalarReplacedStructs.find(varDecl->name); it != scalarReplacedStructs.end())
+	{
+		generateScalarReplacedDecl(varDecl, it->second);
+		return;
+	}
+
 	if (varDecl->initializer)
 	{
-		const auto *arrayLit = dynamic_cast<const AST::ArrayLiteralExpr *>(varDecl->initializer.get());
+		const auto *arrayLit = AST::as<AST::ArrayLiteralExpr>(varDecl->initializer.get());
 
 		if (hasExplicitType && !isAny)
 		{
@@ -452,7 +512,7 @@ void CodeGenerator::generateVarDecl(const AST::VarDecl *varDecl)
 
 					for (size_t i = 0; i < arrayLit->elements.size(); ++i)
 					{
-						auto *anon = dynamic_cast<AST::StructInstanceExpr *>(arrayLit->elements[i].get());
+						auto *anon = AST::as<AST::StructInstanceExpr>(arrayLit->elements[i].get());
 						if (!anon || anon->structName != "__anon")
 							throw std::runtime_error("Array element must be an anonymous struct literal");
 
@@ -489,7 +549,7 @@ void CodeGenerator::generateVarDecl(const AST::VarDecl *varDecl)
 		}
 
 		// Pass declared type as hint to binary expressions so float targets use float ops
-		if (const auto *binExpr = dynamic_cast<const AST::BinaryExpr *>(varDecl->initializer.get()))
+		if (const auto *binExpr = AST::as<AST::BinaryExpr>(varDecl->initializer.get()))
 		{
 			generateBinaryExpr(binExpr, declaredType);
 		}
@@ -503,13 +563,68 @@ void CodeGenerator::generateVarDecl(const AST::VarDecl *varDecl)
 	}
 	else
 	{
-		int constIndex = bytecode.addConstant(Value());
-		bytecode.emit(OpCode::PUSH_CONST, constIndex);
+		bytecode.emit(OpCode::NULL_VAL);
 		int varIndex = bytecode.getOrCreateVar(varDecl->name);
 		bytecode.emit(OpCode::STORE_VAR, varIndex);
 	}
 }
 
+void CodeGenerator::generateScalarReplacedDecl(const AST::VarDecl *varDecl, const std::vector<std::string> &fields)
+{
+	const auto *literal = static_cast<const AST::StructInstanceExpr *>(varDecl->initializer.get());
+
+	// Evaluate every initializer before storing, so they still see the previous field values
+	for (const auto &[fieldName, fieldValue] : literal->fieldValues)
+	{
+		generateExpression(fieldValue.get());
+	}
+
+	std::unordered_set<std::string> assigned;
+	for (auto it = literal->fieldValues.rbegin(); it != literal->fieldValues.rend(); ++it)
+	{
+		if (assigned.insert(it->first).second)
+		{
+			bytecode.emit(OpCode::STORE_VAR, bytecode.getOrCreateVar(scalarFieldVar(varDecl->name, it->first)));
+		}
+		else
+		{
+			bytecode.emit(OpCode::POP); // repeated field, the later initializer wins as with SET_FIELD
+		}
+	}
+
+	// Remaining fields take the struct defaults NEW_STRUCT_INSTANCE_STATIC would have copied
+	auto structIt = bytecode.structEntries.find(literal->structName);
+	for (size_t i = 0; i < fields.size(); ++i)
+	{
+		if (assigned.contains(fields[i]))
+		{
+			continue;
+		}
+		Value defaultValue;
+		if (structIt != bytecode.structEntries.end())
+		{
+			const StructInfo &info = bytecode.structs[structIt->second];
+			int               constIndex = info.firstConstIndex + static_cast<int>(i);
+			if (constIndex >= 0 && constIndex < static_cast<int>(bytecode.constants.size()))
+			{
+				defaultValue = bytecode.constants[constIndex];
+			}
+		}
+		emitPushConstant(defaultValue);
+		bytecode.emit(OpCode::STORE_VAR, bytecode.getOrCreateVar(scalarFieldVar(varDecl->name, fields[i])));
+	}
+}
+
+const std::string *CodeGenerator::scalarReplacedObject(const AST::FieldAccessExpr *expr) const
+{
+	const auto *object = AST::as<AST::IdentifierExpr>(expr->object.get());
+	if (object == nullptr || !scalarReplacedStructs.contains(object->name))
+	{
+		return nullptr;
+	}
+	return &object->name;
+}
+
 void CodeGenerator::generateExpressionStmt(const AST::ExpressionStmt *exprStmt)
 {
 	if (isRepl)
@@ -518,7 +633,7 @@ void CodeGenerator::generateExpressionStmt(const AST::ExpressionStmt *exprStmt)
 		bytecode.emit(OpCode::PRINT);
 		return;
 	}
-	if (const auto *postfix = dynamic_cast<const AST::PostfixExpr *>(exprStmt->expression.get()))
+	if (const auto *postfix = AST::as<AST::PostfixExpr>(exprStmt->expression.get()))
 	{
 		generatePostfixExpr(postfix, false);
 	}
@@ -556,14 +671,12 @@ void CodeGenerator::generateNumberExpr(const AST::NumberExpr *numExpr)
 		if (numExpr->value.find('.') != std::string::npos)
 		{
 			f64 d = std::stod(numExpr->value);
-			int constIndex = bytecode.addConstant(Value(d));
-			bytecode.emit(OpCode::PUSH_CONST, constIndex);
+			emitPushConstant(Value(d));
 		}
 		else
 		{
 			i64 i = std::stoll(numExpr->value);
-			int     constIndex = bytecode.addConstant(Value(i));
-			bytecode.emit(OpCode::PUSH_CONST, constIndex);
+			emitPushConstant(Value(i));
 		}
 	}
 	catch (...)
@@ -607,14 +720,56 @@ void CodeGenerator::generateUnaryExpr(const AST::UnaryExpr *unaryExpr)
 
 void CodeGenerator::generateCallExpr(const AST::CallExpr *callExpr)
 {
+	// Natives of the modules a using() with literal names imports can be folded from here on
+	if (callExpr->callee == "using" && !bytecode.functionEntries.contains("using"))
+	{
+		for (const auto &arg : callExpr->arguments)
+		{
+			if (const auto *name = AST::as<AST::StringExpr>(arg.get()))
+			{
+				importedModules.insert(name->value);
+			}
+		}
+	}
+
 	// Optimizations
+	// Literal string tests fold whatever using() said, as they always have
+	if (callExpr->callee == "starts_with" && callExpr->arguments.size() == 2)
+	{
+		const auto *s = AST::as<AST::StringExpr>(callExpr->arguments[0].get());
+		const auto *p = AST::as<AST::StringExpr>(callExpr->arguments[1].get());
+		if ((s != nullptr) && (p != nullptr))
+		{
+			bool result = s->value.length() >= p->value.length() && s->value.starts_with(p->value);
+			bytecode.emit(result ? OpCode::TRUE_P : OpCode::FALSE_P);
+			return;
+		}
+	}
+
+	if (callExpr->callee == "ends_with" && callExpr->arguments.size() == 2)
+	{
+		const auto *s = AST::as<AST::StringExpr>(callExpr->arguments[0].get());
+		const auto *suffix = AST::as<AST::StringExpr>(callExpr->arguments[1].get());
+		if ((s != nullptr) && (suffix != nullptr))
+		{
+			bool result = s->value.length() >= suffix->value.length() && s->value.ends_with(suffix->value);
+			bytecode.emit(result ? OpCode::TRUE_P : OpCode::FALSE_P);
+			return;
+		}
+	}
+
+	if (Value folded; evaluatePureCall(callExpr, folded))
+	{
+		emitPushConstant(folded);
+		return;
+	}
+
 	if (callExpr->callee == "len" && callExpr->arguments.size() == 1)
 	{
-		if (const auto *strExpr = dynamic_cast<const AST::StringExpr *>(callExpr->arguments[0].get()))
+		if (const auto *strExpr = AST::as<AST::StringExpr>(callExpr->arguments[0].get()))
 		{
 			auto len = (i64)strExpr->value.length();
-			int  constIndex = bytecode.addConstant(Value(len));
-			bytecode.emit(OpCode::PUSH_CONST, constIndex);
+			emitPushConstant(Value(len));
 			return;
 		}
 		generateExpression(callExpr->arguments[0].get());
@@ -624,7 +779,7 @@ void CodeGenerator::generateCallExpr(const AST::CallExpr *callExpr)
 
 	if (callExpr->callee == "substr" && callExpr->arguments.size() == 3)
 	{
-		if (const auto *numExpr = dynamic_cast<const AST::NumberExpr *>(callExpr->arguments[2].get()))
+		if (const auto *numExpr = AST::as<AST::NumberExpr>(callExpr->arguments[2].get()))
 		{
 			if (numExpr->value == "1" || numExpr->value == "1.0")
 			{
@@ -644,30 +799,6 @@ void CodeGenerator::generateCallExpr(const AST::CallExpr *callExpr)
 		return;
 	}
 
-	if (callExpr->callee == "starts_with" && callExpr->arguments.size() == 2)
-	{
-		const auto *s = dynamic_cast<const AST::StringExpr *>(callExpr->arguments[0].get());
-		const auto *p = dynamic_cast<const AST::StringExpr *>(callExpr->arguments[1].get());
-		if ((s != nullptr) && (p != nullptr))
-		{
-			bool result = s->value.length() >= p->value.length() && s->value.starts_with(p->value);
-			bytecode.emit(result ? OpCode::TRUE_P : OpCode::FALSE_P);
-			return;
-		}
-	}
-
-	if (callExpr->callee == "ends_with" && callExpr->arguments.size() == 2)
-	{
-		const auto *s = dynamic_cast<const AST::StringExpr *>(callExpr->arguments[0].get());
-		const auto *suffix = dynamic_cast<const AST::StringExpr *>(callExpr->arguments[1].get());
-		if ((s != nullptr) && (suffix != nullptr))
-		{
-			bool result = s->value.length() >= suffix->value.length() && s->value.ends_with(suffix->value);
-			bytecode.emit(result ? OpCode::TRUE_P : OpCode::FALSE_P);
-			return;
-		}
-	}
-
 	// Push arguments
 	for (const auto &arg : callExpr->arguments)
 	{
@@ -675,8 +806,7 @@ void CodeGenerator::generateCallExpr(const AST::CallExpr *callExpr)
 	}
 
 	// Push argument count
-	int constIndex = bytecode.addConstant(Value(static_cast<i64>(callExpr->arguments.size())));
-	bytecode.emit(OpCode::PUSH_CONST, constIndex);
+	emitPushConstant(Value(static_cast<i64>(callExpr->arguments.size())));
 
 	// Check if it's a user function
 	auto entryIt = bytecode.functionEntries.find(callExpr->callee);
@@ -716,7 +846,7 @@ void CodeGenerator::generateCallExpr(const AST::CallExpr *callExpr)
 						const auto &expectedDims = dimsIt->second[i];
 						if (!expectedDims.empty() && expectedDims[0] != -1)
 						{
-							if (const auto *arrayLit = dynamic_cast<const AST::ArrayLiteralExpr *>(callExpr->arguments[i].get()))
+							if (const auto *arrayLit = AST::as<AST::ArrayLiteralExpr>(callExpr->arguments[i].get()))
 							{
 								if (arrayLit->elements.size() != static_cast<size_t>(expectedDims[0]))
 								{
@@ -818,8 +948,7 @@ void CodeGenerator::generateBinaryExpr(const AST::BinaryExpr *binExpr, ValueType
 			}
 			else
 			{
-				int constIndex = bytecode.addConstant(result);
-				bytecode.emit(OpCode::PUSH_CONST, constIndex);
+				emitPushConstant(result);
 			}
 			return;
 		}
@@ -864,8 +993,7 @@ void CodeGenerator::generateBinaryExpr(const AST::BinaryExpr *binExpr, ValueType
 	bool  leftIsLiteral = isLiteralExpression(binExpr->left.get(), leftLiteral);
 	if (leftIsLiteral)
 	{
-		int constIndex = bytecode.addConstant(leftLiteral);
-		bytecode.emit(OpCode::LOAD_CONST_R, rLeft, constIndex);
+		emitLoadConstant(rLeft, leftLiteral);
 	}
 	else
 	{
@@ -877,8 +1005,7 @@ void CodeGenerator::generateBinaryExpr(const AST::BinaryExpr *binExpr, ValueType
 	bool  rightIsLiteral = isLiteralExpression(binExpr->right.get(), rightLiteral);
 	if (rightIsLiteral)
 	{
-		int constIndex = bytecode.addConstant(rightLiteral);
-		bytecode.emit(OpCode::LOAD_CONST_R, rRight, constIndex);
+		emitLoadConstant(rRight, rightLiteral);
 	}
 	else
 	{
@@ -1106,7 +1233,7 @@ void CodeGenerator::generateForStmt(const AST::ForStmt *forStmt)
 	// Generate increment
 	if (forStmt->increment)
 	{
-		if (const auto *postfix = dynamic_cast<const AST::PostfixExpr *>(forStmt->increment.get()))
+		if (const auto *postfix = AST::as<AST::PostfixExpr>(forStmt->increment.get()))
 		{
 			// resultNeeded=false: skips the old-value LOAD_VAR, and STORE_VAR
 			// already pops the result — stack is clean, no POP needed.
@@ -1298,7 +1425,7 @@ void CodeGenerator::generateNullExpr(const AST::NullExpr *)
 
 void CodeGenerator::generateAssignmentExpr(const AST::AssignmentExpr *assignExpr)
 {
-    if (const auto *identExpr = dynamic_cast<const AST::IdentifierExpr *>(assignExpr->target.get()))
+    if (const auto *identExpr = AST::as<AST::IdentifierExpr>(assignExpr->target.get()))
     {
         auto arrayIt = arrayBaseTypes.find(identExpr->name);
         if (arrayIt != arrayBaseTypes.end())
@@ -1307,7 +1434,7 @@ void CodeGenerator::generateAssignmentExpr(const AST::AssignmentExpr *assignExpr
             if (expectedBaseType != "any")
             {
                 ValueType expectedElemType = mapTypeNameToValueType(expectedBaseType);
-                if (const auto *arrayLit = dynamic_cast<const AST::ArrayLiteralExpr *>(assignExpr->value.get()))
+                if (const auto *arrayLit = AST::as<AST::ArrayLiteralExpr>(assignExpr->value.get()))
                 {
                     auto dimsIt = arrayDimensions.find(identExpr->name);
                     if (dimsIt != arrayDimensions.end() && !dimsIt->second.empty() && dimsIt->second[0] != -1)
@@ -1339,7 +1466,7 @@ void CodeGenerator::generateAssignmentExpr(const AST::AssignmentExpr *assignExpr
             targetType = typeIt->second;
 
         // Pass target type as hint to binary expressions so float targets use float ops
-        if (const auto *binExpr = dynamic_cast<const AST::BinaryExpr *>(assignExpr->value.get()))
+        if (const auto *binExpr = AST::as<AST::BinaryExpr>(assignExpr->value.get()))
         {
             generateBinaryExpr(binExpr, targetType);
         }
@@ -1359,8 +1486,17 @@ void CodeGenerator::generateAssignmentExpr(const AST::AssignmentExpr *assignExpr
         bytecode.emit(OpCode::STORE_VAR, varIndex);
         bytecode.emit(OpCode::LOAD_VAR, varIndex);
     }
-    else if (const auto *fieldExpr = dynamic_cast<const AST::FieldAccessExpr *>(assignExpr->target.get()))
+    else if (const auto *fieldExpr = AST::as<AST::FieldAccessExpr>(assignExpr->target.get()))
     {
+        if (const std::string *object = scalarReplacedObject(fieldExpr))
+        {
+            generateExpression(assignExpr->value.get());
+            int varIndex = bytecode.getOrCreateVar(scalarFieldVar(*object, fieldExpr->fieldName));
+            bytecode.emit(OpCode::STORE_VAR, varIndex);
+            bytecode.emit(OpCode::LOAD_VAR, varIndex);
+            return;
+        }
+
         generateExpression(fieldExpr->object.get());
         generateExpression(assignExpr->value.get());
 
@@ -1368,9 +1504,9 @@ void CodeGenerator::generateAssignmentExpr(const AST::AssignmentExpr *assignExpr
         bytecode.emit(OpCode::SET_FIELD, fieldNameIndex);
         bytecode.emit(OpCode::GET_FIELD, fieldNameIndex);
     }
-    else if (const auto *arrayAccess = dynamic_cast<const AST::ArrayAccessExpr *>(assignExpr->target.get()))
+    else if (const auto *arrayAccess = AST::as<AST::ArrayAccessExpr>(assignExpr->target.get()))
     {
-        if (const auto *identExpr = dynamic_cast<const AST::IdentifierExpr *>(arrayAccess->array.get()))
+        if (const auto *identExpr = AST::as<AST::IdentifierExpr>(arrayAccess->array.get()))
         {
             auto dimsIt = arrayDimensions.find(identExpr->name);
             if (dimsIt != arrayDimensions.end() && !dimsIt->second.empty() && dimsIt->second[0] != -1)
@@ -1410,8 +1546,7 @@ void CodeGenerator::generateAssignmentExpr(const AST::AssignmentExpr *assignExpr
         generateExpression(arrayAccess->index.get());
         generateExpression(assignExpr->value.get());
 
-        int countIdx = bytecode.addConstant(Value(static_cast<i64>(3)));
-        bytecode.emit(OpCode::PUSH_CONST, countIdx);
+        emitPushConstant(Value(static_cast<i64>(3)));
 
         int setIdx = bytecode.addStringConstant("__set_elem");
         bytecode.emit(OpCode::CALL_NATIVE, setIdx);
@@ -1457,6 +1592,12 @@ void CodeGenerator::generateStructInstanceExpr(const AST::StructInstanceExpr *ex
 }
 void CodeGenerator::generateFieldAccessExpr(const AST::FieldAccessExpr *expr)
 {
+	if (const std::string *object = scalarReplacedObject(expr))
+	{
+		bytecode.emit(OpCode::LOAD_VAR, bytecode.getOrCreateVar(scalarFieldVar(*object, expr->fieldName)));
+		return;
+	}
+
 	generateExpression(expr->object.get());
 	int fieldNameIndex = bytecode.addStringConstant(expr->fieldName);
 	bytecode.emit(OpCode::GET_FIELD, fieldNameIndex);
@@ -1464,7 +1605,7 @@ void CodeGenerator::generateFieldAccessExpr(const AST::FieldAccessExpr *expr)
 
 void CodeGenerator::generatePostfixExpr(const AST::PostfixExpr *expr, bool resultNeeded)
 {
-    const auto *identExpr = dynamic_cast<const AST::IdentifierExpr *>(expr->operand.get());
+    const auto *identExpr = AST::as<AST::IdentifierExpr>(expr->operand.get());
     if (identExpr == nullptr)
         throw std::runtime_error("Postfix operators only supported on variables");
 
@@ -1475,8 +1616,7 @@ void CodeGenerator::generatePostfixExpr(const AST::PostfixExpr *expr, bool resul
 
     bytecode.emit(OpCode::LOAD_VAR, varIndex);
 
-    int oneIndex = bytecode.addConstant(Value(static_cast<i64>(1)));
-    bytecode.emit(OpCode::PUSH_CONST, oneIndex);
+    emitPushConstant(Value(static_cast<i64>(1)));
 
     auto it = inferredTypes.find(identExpr->name);
     bool varIsInt = (it != inferredTypes.end() && it->second == ValueType::Int);
@@ -1506,7 +1646,7 @@ void CodeGenerator::generateStructDecl(const AST::StructDecl *decl)
 	for (const auto &field : decl->fields)
 	{
 		(void)field;
-		bytecode.addConstant(Value());
+		bytecode.appendConstant(Value());
 	}
 
 	StructInfo info;
@@ -1530,6 +1670,11 @@ void CodeGenerator::generateStructDecl(const AST::StructDecl *decl)
 
 void CodeGenerator::generateSwitchStmt(const AST::SwitchStmt *switchStmt)
 {
+	if (generateSwitchTable(switchStmt))
+	{
+		return;
+	}
+
 	generateExpression(switchStmt->expr.get());
 	std::string tempName = "__switch_" + std::to_string(switchCounter++);
 	int         tempVarIndex = bytecode.getOrCreateVar(tempName);
@@ -1580,14 +1725,116 @@ void CodeGenerator::generateSwitchStmt(const AST::SwitchStmt *switchStmt)
 	}
 }
 
+bool CodeGenerator::generateSwitchTable(const AST::SwitchStmt *switchStmt)
+{
+	// Below this the compare chain is as cheap as a table lookup
+	constexpr size_t minTableCases = 4;
+	if (switchStmt->cases.size() < minTableCases)
+	{
+		return false;
+	}
+
+	std::vector<Value> caseValues;
+	caseValues.reserve(switchStmt->cases.size());
+	bool allInt = true;
+	for (const auto &caseClause : switchStmt->cases)
+	{
+		Value value;
+		if (!isLiteralExpression(caseClause.value.get(), value))
+		{
+			return false;
+		}
+		if (!value.isInt() && !value.isFloat() && !value.isString())
+		{
+			return false;
+		}
+		allInt = allInt && value.isInt();
+		caseValues.push_back(std::move(value));
+	}
+
+	// Integer cases covering at least half of their range get a dense table
+	bool dense = false;
+	i64  low = 0;
+	u64  span = 0;
+	if (allInt)
+	{
+		low = caseValues.front().asInt();
+		i64 high = low;
+		for (const auto &value : caseValues)
+		{
+			low = std::min(low, value.asInt());
+			high = std::max(high, value.asInt());
+		}
+		span = static_cast<u64>(high) - static_cast<u64>(low);
+		dense = span < 2 * static_cast<u64>(caseValues.size());
+	}
+
+	generateExpression(switchStmt->expr.get());
+	int tableIndex = static_cast<int>(bytecode.switchTables.size());
+	bytecode.switchTables.emplace_back();
+	bytecode.emit(dense ? OpCode::SWITCH_TABLE : OpCode::SWITCH_HASH, tableIndex);
+
+	std::vector<int> caseTargets;
+	std::vector<int> endJumps;
+	for (const auto &caseClause : switchStmt->cases)
+	{
+		caseTargets.push_back(static_cast<int>(bytecode.instructions.size()));
+		for (const auto &stmt : caseClause.statements)
+		{
+			generateStatement(stmt.get());
+		}
+		endJumps.push_back(static_cast<int>(bytecode.instructions.size()));
+		bytecode.emit(OpCode::JUMP, 0);
+	}
+
+	int defaultTarget = static_cast<int>(bytecode.instructions.size());
+	for (const auto &stmt : switchStmt->defaultStmts)
+	{
+		generateStatement(stmt.get());
+	}
+
+	int endIndex = static_cast<int>(bytecode.instructions.size());
+	for (int jumpIdx : endJumps)
+	{
+		bytecode.instructions[jumpIdx].operand1 = endIndex;
+	}
+
+	// Nested switches may have grown switchTables, so index it only now
+	SwitchTable &table = bytecode.switchTables[tableIndex];
+	table.defaultTarget = defaultTarget;
+	if (dense)
+	{
+		table.low = low;
+		table.denseTargets.assign(static_cast<size_t>(span) + 1, defaultTarget);
+		std::vector<bool> filled(table.denseTargets.size(), false);
+		for (size_t i = 0; i < caseValues.size(); ++i)
+		{
+			auto slot = static_cast<size_t>(static_cast<u64>(caseValues[i].asInt()) - static_cast<u64>(low));
+			if (!filled[slot]) // first matching case wins, as in the compare chain
+			{
+				table.denseTargets[slot] = caseTargets[i];
+				filled[slot] = true;
+			}
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < caseValues.size(); ++i)
+		{
+			table.cases.emplace_back(std::move(caseValues[i]), caseTargets[i]);
+		}
+		table.buildIndex();
+	}
+	return true;
+}
+
 void CodeGenerator::generateArrayLiteralExpr(const AST::ArrayLiteralExpr *arrayLit, bool resultNeeded)
 {
     for (const auto &elem : arrayLit->elements)
         generateExpression(elem.get());
 
     int count = static_cast<int>(arrayLit->elements.size());
-    int countIdx = bytecode.addConstant(Value(static_cast<i64>(count)));
-    bytecode.emit(OpCode::PUSH_CONST, countIdx);
+    emitPushConstant(Value(static_cast<i64>(count)));
 
     int funcNameIdx = bytecode.addStringConstant("__array_literal");
     bytecode.emit(OpCode::CALL_NATIVE, funcNameIdx);
@@ -1598,7 +1845,7 @@ void CodeGenerator::generateArrayLiteralExpr(const AST::ArrayLiteralExpr *arrayL
 
 void CodeGenerator::generateArrayAccessExpr(const AST::ArrayAccessExpr *arrayAccess, bool resultNeeded)
 {
-    if (const auto *identExpr = dynamic_cast<const AST::IdentifierExpr *>(arrayAccess->array.get())) {
+    if (const auto *identExpr = AST::as<AST::IdentifierExpr>(arrayAccess->array.get())) {
         auto dimsIt = arrayDimensions.find(identExpr->name);
         if (dimsIt != arrayDimensions.end() && !dimsIt->second.empty() && dimsIt->second[0] != -1) {
             Value idxVal;
@@ -1615,8 +1862,7 @@ void CodeGenerator::generateArrayAccessExpr(const AST::ArrayAccessExpr *arrayAcc
 
     generateExpression(arrayAccess->array.get());   // array
     generateExpression(arrayAccess->index.get());   // index
-    int countIdx = bytecode.addConstant(Value(static_cast<i64>(2)));
-    bytecode.emit(OpCode::PUSH_CONST, countIdx);    // count for __get_elem
+    emitPushConstant(Value(static_cast<i64>(2)));    // count for __get_elem
     int funcIdx = bytecode.addStringConstant("__get_elem");
     bytecode.emit(OpCode::CALL_NATIVE, funcIdx);
     if (!resultNeeded)
@@ -5,9 +5,15 @@
 #endif
 #include "../ISA/ISA.hpp"
 #include <phsint.hpp>
+#include <algorithm>
+#include <bit>
+#include <functional>
 #include <map>
+#include <optional>
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <platform.h>
@@ -47,6 +53,96 @@ struct StructInfo
     std::vector<std::string>      fieldTypeNames;
 };
 
+/// @brief Jump table used by SWITCH_TABLE / SWITCH_HASH (switch section)
+struct SwitchTable
+{
+	/// @brief Transparent hash so lookups can use a string_view into the scrutinee
+	struct StringHash
+	{
+		using is_transparent = void;
+		size_t operator()(std::string_view sv) const noexcept
+		{
+			return std::hash<std::string_view>{}(sv);
+		}
+	};
+
+	int                                defaultTarget = 0; ///< Instruction index taken when no case matches
+	i64                                low = 0;           ///< SWITCH_TABLE: case value mapped to denseTargets[0]
+	std::vector<int>                   denseTargets;      ///< SWITCH_TABLE: targets for low, low + 1, ...
+	std::vector<std::pair<Value, int>> cases;             ///< SWITCH_HASH: case value -> target, first match wins
+
+	std::unordered_map<std::string, int, StringHash, std::equal_to<>> stringTargets; ///< SWITCH_HASH lookup for string cases (see buildIndex)
+	std::unordered_map<i64, size_t>      intCases;   ///< SWITCH_HASH: integer case -> index in cases, exact beyond 2^53
+	std::unordered_map<f64, size_t>      floatCases; ///< SWITCH_HASH: float case -> index in cases
+
+	/// @brief Rebuild the hash lookup from cases (after codegen or load)
+	void buildIndex()
+	{
+		stringTargets.clear();
+		intCases.clear();
+		floatCases.clear();
+		for (size_t i = 0; i < cases.size(); ++i)
+		{
+			const auto &[value, target] = cases[i];
+			if (value.isString())
+				stringTargets.try_emplace(std::string(value.asString().view()), target);
+			else if (value.isInt())
+				intCases.try_emplace(value.asInt(), i);
+			else if (value.isFloat())
+				floatCases.try_emplace(value.asFloat() + 0.0, i); // + 0.0 folds -0.0 into 0.0
+		}
+	}
+
+	/// @brief SWITCH_TABLE target; numbers compare like FLEQUAL, anything else takes the default
+	[[nodiscard]] int resolveDense(const Value &value) const noexcept
+	{
+		const auto size = static_cast<i64>(denseTargets.size());
+		if (value.isInt())
+		{
+			i64 offset = value.asInt() - low;
+			if (offset >= 0 && offset < size)
+				return denseTargets[static_cast<size_t>(offset)];
+		}
+		else if (value.isFloat())
+		{
+			f64 offset = value.asFloat() - static_cast<f64>(low);
+			if (offset >= 0.0 && offset < static_cast<f64>(size) && offset == static_cast<f64>(static_cast<i64>(offset)))
+				return denseTargets[static_cast<size_t>(offset)];
+		}
+		return defaultTarget;
+	}
+
+	/// @brief SWITCH_HASH target; numbers compare like FLEQUAL, except that integers compare exactly
+	/// with integer cases, as in SWITCH_TABLE; strings by content
+	[[nodiscard]] int resolveHash(const Value &value) const
+	{
+		if (value.isString())
+		{
+			auto it = stringTargets.find(value.asString().view());
+			return it != stringTargets.end() ? it->second : defaultTarget;
+		}
+		if (!value.isInt() && !value.isFloat())
+			return defaultTarget;
+
+		// An integer and a float case can both match, the first one written wins
+		size_t    match = cases.size();
+		const f64 number = value.asFloat() + 0.0;
+		if (auto it = floatCases.empty() ? floatCases.end() : floatCases.find(number); it != floatCases.end())
+			match = it->second;
+		if (value.isInt())
+		{
+			if (auto it = intCases.find(value.asInt()); it != intCases.end())
+				match = std::min(match, it->second);
+		}
+		else if (number >= -0x1p63 && number < 0x1p63 && number == static_cast<f64>(static_cast<i64>(number)))
+		{
+			if (auto it = intCases.find(static_cast<i64>(number)); it != intCases.end())
+				match = std::min(match, it->second);
+		}
+		return match < cases.size() ? cases[match].second : defaultTarget;
+	}
+};
+
 /// @brief Complete bytecode structure
 struct Bytecode
 {
@@ -64,8 +160,45 @@ struct Bytecode
 	std::vector<StructInfo>              structs;       ///< List of struct descriptors
 	std::unordered_map<std::string, int> structEntries; ///< Struct name -> index in structs
 
+	std::vector<SwitchTable>             switchTables;  ///< Switch section, indexed by SWITCH_TABLE / SWITCH_HASH operand1
+
 	/// @brief Add a constant to the pool and return its index
+	/// Scalars (null, bool, int, float, string) are deduplicated by value
 	int addConstant(const Value &value)
+	{
+		if (value.isString())
+			return addStringConstant(value.asString());
+
+		std::pair<ValueType, u64> key{value.getType(), 0};
+		switch (value.getType())
+		{
+		case ValueType::Null:
+			break;
+		case ValueType::Bool:
+			key.second = value.asBool() ? 1 : 0;
+			break;
+		case ValueType::Int:
+			key.second = static_cast<u64>(value.asInt());
+			break;
+		case ValueType::Float:
+			key.second = std::bit_cast<u64>(value.asFloat()); // keeps 0.0 / -0.0 and NaN payloads apart
+			break;
+		default:
+			return appendConstant(value);
+		}
+
+		auto it = scalarConstantCache.find(key);
+		if (it != scalarConstantCache.end())
+		{
+			return it->second;
+		}
+		int idx = appendConstant(value);
+		scalarConstantCache[key] = idx;
+		return idx;
+	}
+
+	/// @brief Append a constant without deduplication (for ranges that must stay contiguous, e.g. struct defaults)
+	int appendConstant(const Value &value)
 	{
 		constants.push_back(value);
 		return static_cast<int>(constants.size()) - 1;
@@ -79,12 +212,13 @@ struct Bytecode
 		{
 			return it->second;
 		}
-		int idx = addConstant(Value(s));
+		int idx = appendConstant(Value(s));
 		stringConstantCache[s] = idx;
 		return idx;
 	}
 
 	std::unordered_map<std::string, int> stringConstantCache; ///< Dedup cache for string constants
+	std::map<std::pair<ValueType, u64>, int> scalarConstantCache; ///< Dedup cache for null/bool/int/float constants
 
 	/// @brief Get or create a variable index
 	int getOrCreateVar(const std::string &name)
@@ -124,9 +258,24 @@ class CodeGenerator
 	Bytecode generate(const AST::Program &program, const std::unordered_map<std::string, int> &existingVars = {},
 	                  int nextVarIdx = 0, bool replMode = false);
 
+	/// @brief Evaluates a pure native call on constant arguments, std::nullopt when it can't be folded
+	/// @param modules Modules the program has imported with `using()` before the call
+	using PureCallEvaluator = std::function<std::optional<Value>(
+	    const std::string &name, const std::vector<Value> &args, const std::unordered_set<std::string> &modules)>;
+
+	/// @brief Fold calls to pure natives with constant arguments (see StdLib::pureCallEvaluator)
+	void setPureCallEvaluator(PureCallEvaluator evaluator)
+	{
+		pureCallEvaluator = std::move(evaluator);
+	}
+
   private:
 	Bytecode bytecode;       ///< Generated bytecode
 	bool     isRepl = false; ///< REPL mode
+	PureCallEvaluator pureCallEvaluator; ///< Compile-time evaluator for pure natives, may be empty
+	std::unordered_set<std::string> importedModules; ///< Modules named by `using()` calls so far, for pureCallEvaluator
+	/// Non-escaping struct variables stored as one variable per field, name -> field names (see StructEscapeAnalysis)
+	std::unordered_map<std::string, std::vector<std::string>> scalarReplacedStructs;
 	// Inferred types for variables (simple, flow-insensitive mapping)
 	std::unordered_map<std::string, ValueType> inferredTypes;
 	std::unordered_map<std::string, std::unordered_map<std::string, ValueType>> inferredFieldTypes;
@@ -171,9 +320,31 @@ class CodeGenerator
 		nextRegister = 0;
 	}
 
+	/// @brief Push a literal, using PUSH_INT_IMM / TRUE_P / FALSE_P / NULL_VAL instead of the pool where possible
+	void emitPushConstant(const Value &value);
+
+	/// @brief Load a literal into a register, using LOAD_INT_IMM_R for integers that fit in an operand
+	void emitLoadConstant(u8 reg, const Value &value);
+
+	/// @brief Variable holding one field of a scalar-replaced struct
+	static std::string scalarFieldVar(const std::string &varName, const std::string &fieldName)
+	{
+		return varName + "." + fieldName; // '.' can't appear in identifiers, so this never collides
+	}
+
+	/// @brief Look up the scalar-replaced struct variable a field access reads or writes, nullptr if none
+	const std::string *scalarReplacedObject(const AST::FieldAccessExpr *expr) const;
+
+	/// @brief Initialize the per-field variables of a scalar-replaced struct declaration
+	void generateScalarReplacedDecl(const AST::VarDecl *varDecl, const std::vector<std::string> &fields);
+
 	/// @brief Check if expression is a compile-time literal
 	static bool isLiteralExpression(const AST::Expression *expr, Value &outValue);
 
+	/// @brief Evaluate a call to a pure native whose arguments are literals or foldable calls
+	/// @return false if the call has to run at runtime
+	bool evaluatePureCall(const AST::CallExpr *callExpr, Value &outValue);
+
 	/// @brief Simple expression type inference (conservative)
 	/// @param expr expression to inspect
 	/// @param known set to true when a type is known
@@ -212,6 +383,7 @@ class CodeGenerator
 	void generateBreakStmt();
 	void generateContinueStmt();
 	void generateSwitchStmt(const AST::SwitchStmt *switchStmt);
+	bool generateSwitchTable(const AST::SwitchStmt *switchStmt); ///< SWITCH_TABLE / SWITCH_HASH form, false if cases aren't all literals
 	void generateArrayLiteralExpr(const AST::ArrayLiteralExpr *arrayLit, bool resultNeeded);
 	void generateArrayAccessExpr(const AST::ArrayAccessExpr *arrayAccess, bool resultNeeded);
 
@@ -3,11 +3,16 @@
 #include "../Bytecode/BytecodeDeserializer.hpp"
 #include <fstream>
 #include <iomanip>
+#include <stdexcept>
 #include <sstream>
 
 namespace Phasor
 {
 
+CppCodeGenerator::CppCodeGenerator(Options options) : options(options)
+{
+}
+
 bool CppCodeGenerator::generate(const Bytecode &bc, const std::filesystem::path &outputPath, const std::string &modName)
 {
 	try
@@ -34,6 +39,9 @@ bool CppCodeGenerator::generate(const Bytecode &bc, const std::filesystem::path
 		generateFileHeader();
 		generateModuleName();
 		generateEmbeddedBytecode();
+		generateEmbeddedImage();
+		if (options.aot)
+			generateCompiledProgram();
 
 		// Write to file
 		std::ofstream file(outputPath);
@@ -66,7 +74,11 @@ void CppCodeGenerator::generateFileHeader()
 	output << "// Module: " << moduleName << "\n";
 	output << "#pragma once\n";
 	output << "#include <cstddef>\n";
-	output << "#include <string>\n\n";
+	output << "#include <limits>\n";
+	output << "#include <string>\n";
+	if (options.aot)
+		output << "#include <cmath>\n";
+	output << "#include <Phasor/PhasorAOT.hpp>\n\n";
 }
 
 void CppCodeGenerator::generateModuleName()
@@ -126,12 +138,86 @@ void CppCodeGenerator::generateEmbeddedBytecode()
 	output << std::dec << "\n};\n";
 }
 
+void CppCodeGenerator::generateEmbeddedImage()
+{
+	output << "\nnamespace\n{\nusing namespace Phasor;\n\n";
+
+	output << "constexpr EmbeddedInstruction embeddedInstructions[] = {\n";
+	for (size_t i = 0; i < bytecode->instructions.size(); i++)
+	{
+		const Instruction &instr = bytecode->instructions[i];
+		output << (i % 4 == 0 ? "\t" : " ") << "{" << static_cast<int>(instr.op) << ", " << instr.operand1 << ", "
+		       << instr.operand2 << ", " << instr.operand3 << "},";
+		if (i % 4 == 3 || i + 1 == bytecode->instructions.size())
+			output << "\n";
+	}
+	output << "};\n\n";
+
+	// A zero-length array isn't valid C++, an empty pool is a null pointer instead
+	if (!bytecode->constants.empty())
+	{
+		output << "constexpr EmbeddedConstant embeddedConstants[] = {\n";
+		for (const Value &constant : bytecode->constants)
+		{
+			switch (constant.getType())
+			{
+			case ValueType::Null:
+				output << "\t{ValueType::Null, 0, 0.0, nullptr, 0},\n";
+				break;
+			case ValueType::Bool:
+				output << "\t{ValueType::Bool, " << (constant.asBool() ? 1 : 0) << ", 0.0, nullptr, 0},\n";
+				break;
+			case ValueType::Int:
+				output << "\t{ValueType::Int, " << NativeTranslator::literal(constant.asInt())
+				       << ", 0.0, nullptr, 0},\n";
+				break;
+			case ValueType::Float:
+				output << "\t{ValueType::Float, 0, " << NativeTranslator::literal(constant.asFloat())
+				       << ", nullptr, 0},\n";
+				break;
+			case ValueType::String: {
+				std::string text(constant.asString().view());
+				output << "\t{ValueType::String, 0, 0.0, " << NativeTranslator::literal(text) << ", " << text.size()
+				       << "},\n";
+				break;
+			}
+			default:
+				throw std::runtime_error("Cannot embed constant of type " + getValueTypeString(constant.getType()));
+			}
+		}
+		output << "};\n\n";
+	}
+
+	output << "constexpr EmbeddedImage embeddedImage{embeddedInstructions, " << bytecode->instructions.size() << ", "
+	       << (bytecode->constants.empty() ? "nullptr" : "embeddedConstants") << ", " << bytecode->constants.size()
+	       << "};\n";
+	output << "} // namespace\n\n";
+	output << "#define PHASOR_EMBEDDED_IMAGE embeddedImage\n";
+}
+
+void CppCodeGenerator::generateCompiledProgram()
+{
+	stats = {};
+	output << "\n" << NativeTranslator::translate(*bytecode, "compiledProgram", &stats);
+	output << "\n#define PHASOR_COMPILED_PROGRAM compiledProgram\n";
+}
+
 std::vector<unsigned char> CppCodeGenerator::parseEmbeddedBytecode(const std::string &input)
 {
 	std::vector<unsigned char> result;
-	std::istringstream         stream(input);
+	std::string_view           bytes = input;
 	std::string                token;
 
+	// Generated headers hold other tables and code, only the bytecode array's initializer is wanted
+	if (size_t array = bytes.find("embeddedBytecode[]"); array != std::string_view::npos)
+	{
+		size_t open = bytes.find('{', array);
+		size_t close = bytes.find('}', open);
+		if (open != std::string_view::npos)
+			bytes = bytes.substr(open + 1, close == std::string_view::npos ? close : close - open - 1);
+	}
+	std::istringstream stream{std::string(bytes)};
+
 	while (stream >> token)
 	{
 		// Only process tokens starting with "0x"
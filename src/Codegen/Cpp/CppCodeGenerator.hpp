@@ -1,5 +1,6 @@
 #pragma once
 #include "../CodeGen.hpp"
+#include "NativeTranslator.hpp"
 #include <filesystem>
 #include <sstream>
 #include <string>
@@ -17,10 +18,25 @@ namespace Phasor
  * that embeds the bytecode as inline data. The header is designed to be
  * included in CppRuntime_main.cpp to provide the module name, bytecode array,
  * and bytecode size.
+ *
+ * The instructions and constants are also emitted as constexpr tables (an
+ * EmbeddedImage, see include/Phasor/PhasorAOT.hpp), which the runtime executes
+ * from directly instead of deserializing the bytecode at startup.
  */
 class CppCodeGenerator
 {
   public:
+	/// @brief What goes into the header besides the embedded bytecode
+	struct Options
+	{
+		/// Translate the program to C++ as well (see NativeTranslator) and define
+		/// PHASOR_COMPILED_PROGRAM, so the stub runs it natively instead of interpreting
+		bool aot = false;
+	};
+
+	CppCodeGenerator() = default;
+	explicit CppCodeGenerator(Options options);
+
 	/**
 	 * @brief Generate C++ header file from bytecode
 	 *
@@ -40,7 +56,15 @@ class CppCodeGenerator
 	 */
 	Bytecode generateBytecodeFromEmbedded(const std::string &input);
 
+	/// @brief What the last AOT generate() translated
+	const NativeTranslator::Stats &translationStats() const
+	{
+		return stats;
+	}
+
   private:
+	Options                 options;
+	NativeTranslator::Stats stats;
 	std::ostringstream   output; ///< Output stream for generated code
 	const Bytecode      *bytecode = nullptr;
 	std::string          moduleName;
@@ -51,6 +75,8 @@ class CppCodeGenerator
 	void generateModuleName();
 	void generateIncludes();
 	void generateEmbeddedBytecode();
+	void generateEmbeddedImage();
+	void generateCompiledProgram();
 	void generateTempFileWriter();
 	void generateMainFunction();
 
@@ -0,0 +1,1162 @@
+#include "NativeTranslator.hpp"
+#include "../../ISA/map.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <format>
+#include <limits>
+#include <map>
+#include <optional>
+#include <set>
+#include <sstream>
+
+namespace Phasor
+{
+
+namespace
+{
+
+// One bit per VM register
+using RegisterSet = u64;
+static_assert(MAX_REGISTERS <= 64, "RegisterSet needs a bit per register");
+constexpr RegisterSet ALL_REGISTERS = MAX_REGISTERS == 64 ? ~RegisterSet{0} : (RegisterSet{1} << MAX_REGISTERS) - 1;
+
+RegisterSet bit(int reg)
+{
+	return RegisterSet{1} << reg;
+}
+
+/// C++ type of an operand; anything but Value is known statically
+enum class Kind
+{
+	Value,
+	Int,
+	Float,
+	Bool,
+};
+
+/// A stack slot or register held in a C++ expression instead of the VM
+struct Operand
+{
+	std::string expr;
+	Kind        kind = Kind::Value;
+	int         variable = -1; ///< expr reads this variable, so a store to it must not overtake the read
+	int         reg = -1;      ///< expr reads this register from the frame
+	std::string truth;         ///< Cheaper isTruthy() of a Value comparison, if set
+
+	bool dependent() const
+	{
+		return variable >= 0 || reg >= 0;
+	}
+};
+
+/// A bytecode function or the top-level code
+struct Function
+{
+	int                      entry = 0;
+	bool                     topLevel = false;
+	std::string              symbol;
+	std::vector<std::string> names;
+	std::vector<char>        reachable;
+	std::vector<char>        labelled;
+	std::vector<RegisterSet> liveIn;     ///< Registers that may be read from each instruction on
+	RegisterSet              liveOut = 0; ///< Registers callers may read after a RETURN
+};
+
+constexpr int EXIT = -1; ///< Successor past the end of the program
+
+const char *typeName(Kind kind)
+{
+	switch (kind)
+	{
+	case Kind::Int:
+		return "i64";
+	case Kind::Float:
+		return "f64";
+	case Kind::Bool:
+		return "bool";
+	default:
+		return "Value";
+	}
+}
+
+// Conversions with the semantics of the Value accessors the interpreter uses
+
+std::string valueOf(const Operand &o)
+{
+	return o.kind == Kind::Value ? o.expr : "Value(" + o.expr + ")";
+}
+
+std::string intOf(const Operand &o)
+{
+	switch (o.kind)
+	{
+	case Kind::Int:
+		return o.expr;
+	case Kind::Float:
+		return "static_cast<i64>(" + o.expr + ")";
+	default:
+		return valueOf(o) + ".asInt()";
+	}
+}
+
+std::string floatOf(const Operand &o)
+{
+	switch (o.kind)
+	{
+	case Kind::Float:
+		return o.expr;
+	case Kind::Int:
+		return "static_cast<f64>(" + o.expr + ")";
+	default:
+		return valueOf(o) + ".asFloat()";
+	}
+}
+
+std::string truthOf(const Operand &o)
+{
+	switch (o.kind)
+	{
+	case Kind::Int:
+		return "(" + o.expr + " != 0)";
+	case Kind::Float:
+		return "(" + o.expr + " != 0.0)";
+	case Kind::Bool:
+		return o.expr;
+	default:
+		return o.truth.empty() ? o.expr + ".isTruthy()" : o.truth;
+	}
+}
+
+std::string isIntOf(const Operand &o)
+{
+	if (o.kind == Kind::Value)
+		return o.expr + ".isInt()";
+	return o.kind == Kind::Int ? "true" : "false";
+}
+
+std::string isNumberOf(const Operand &o)
+{
+	if (o.kind == Kind::Value)
+		return o.expr + ".isNumber()";
+	return o.kind == Kind::Int || o.kind == Kind::Float ? "true" : "false";
+}
+
+bool isRegisterOp(OpCode op)
+{
+	return (op >= OpCode::MOV && op <= OpCode::SYSTEM_ERR_R) || op == OpCode::LOAD_INT_IMM_R;
+}
+
+/// Register operands of a register instruction: rA, and rB / rC where the opcode reads them
+int registerOperands(OpCode op)
+{
+	switch (op)
+	{
+	case OpCode::LOAD_CONST_R:
+	case OpCode::LOAD_INT_IMM_R:
+	case OpCode::LOAD_VAR_R:
+	case OpCode::STORE_VAR_R:
+	case OpCode::PUSH_R:
+	case OpCode::POP_R:
+	case OpCode::PRINT_R:
+	case OpCode::PRINTERROR_R:
+	case OpCode::READLINE_R:
+	case OpCode::SYSTEM_R:
+	case OpCode::SYSTEM_OUT_R:
+	case OpCode::SYSTEM_ERR_R:
+		return 1;
+	case OpCode::MOV:
+	case OpCode::PUSH2_R:
+	case OpCode::POP2_R:
+	case OpCode::SQRT_R:
+	case OpCode::LOG_R:
+	case OpCode::EXP_R:
+	case OpCode::SIN_R:
+	case OpCode::COS_R:
+	case OpCode::TAN_R:
+	case OpCode::NEG_R:
+	case OpCode::NOT_R:
+		return 2;
+	default:
+		return 3;
+	}
+}
+
+class Translator
+{
+  public:
+	explicit Translator(const Bytecode &bytecode)
+	    : m_bytecode(bytecode), m_code(bytecode.instructions), m_size(static_cast<int>(m_code.size()))
+	{
+	}
+
+	std::string run(const std::string &entryName, NativeTranslator::Stats &stats)
+	{
+		Function &topLevel = m_functions.emplace_back();
+		topLevel.topLevel = true;
+		topLevel.symbol = entryName;
+
+		// Functions are keyed by entry, several names may share one
+		std::map<int, std::vector<std::string>> entries;
+		for (const auto &[name, entry] : m_bytecode.functionEntries)
+			if (entry >= 0 && entry < m_size)
+				entries[entry].push_back(name);
+		for (auto &[entry, names] : entries)
+		{
+			std::sort(names.begin(), names.end());
+			m_functionAt[entry] = m_functions.size();
+			Function &function = m_functions.emplace_back();
+			function.entry = entry;
+			function.symbol = "function_" + std::to_string(entry);
+			function.names = std::move(names);
+		}
+
+		for (Function &function : m_functions)
+			findBlocks(function);
+
+		// A call's uses are the callee's live registers at entry, so iterate to a fixpoint over all functions
+		for (bool changed = true; changed;)
+		{
+			changed = false;
+			for (Function &function : m_functions)
+				changed |= computeLiveness(function);
+		}
+
+		std::ostringstream body;
+		for (Function &function : m_functions)
+			emitFunction(function, body, stats);
+		stats.functions = m_functions.size();
+
+		std::ostringstream result;
+		result << "namespace\n{\nusing namespace Phasor;\n\n";
+		for (int index : m_stringConstants)
+			result << "const Value constant_" << index << "(std::string("
+			       << NativeTranslator::literal(m_bytecode.constants[index].asString().view()) << ", "
+			       << m_bytecode.constants[index].asString().view().size() << "));\n";
+		if (!m_stringConstants.empty())
+			result << "\n";
+		for (const Function &function : m_functions)
+		{
+			result << "void " << function.symbol << "(CompiledFrame &frame);";
+			if (!function.names.empty())
+			{
+				result << " //";
+				for (const std::string &name : function.names)
+					result << " " << name;
+			}
+			result << "\n";
+		}
+		result << "\n" << body.str() << "} // namespace\n";
+		return result.str();
+	}
+
+  private:
+	const Bytecode                 &m_bytecode;
+	const std::vector<Instruction> &m_code;
+	const int                       m_size;
+	std::vector<Function>           m_functions; ///< Top-level code first
+	std::map<int, size_t>           m_functionAt;
+	std::set<int>                   m_stringConstants;
+
+	// State of the block being emitted
+	std::ostream                                     *m_out = nullptr;
+	std::vector<Operand>                              m_stack;
+	std::array<std::optional<Operand>, MAX_REGISTERS> m_shadows;
+	RegisterSet                                       m_dirty = 0;
+	int                                               m_temps = 0;
+	bool                                              m_blockOpen = false;
+
+	// Analysis
+
+	int target(int pc) const
+	{
+		return pc >= 0 && pc < m_size ? pc : EXIT;
+	}
+
+	int calleeEntry(const Instruction &instr) const
+	{
+		int index = instr.operand1;
+		if (index < 0 || index >= static_cast<int>(m_bytecode.constants.size()) ||
+		    !m_bytecode.constants[index].isString())
+			return EXIT;
+		auto it = m_bytecode.functionEntries.find(std::string(m_bytecode.constants[index].asString().view()));
+		if (it == m_bytecode.functionEntries.end() || !m_functionAt.contains(it->second))
+			return EXIT;
+		return it->second;
+	}
+
+	std::optional<Operand> constantOperand(int index) const
+	{
+		if (index < 0 || index >= static_cast<int>(m_bytecode.constants.size()))
+			return std::nullopt;
+		const Value &value = m_bytecode.constants[index];
+		switch (value.getType())
+		{
+		case ValueType::Null:
+			return Operand{"Value()"};
+		case ValueType::Bool:
+			return Operand{value.asBool() ? "true" : "false", Kind::Bool};
+		case ValueType::Int:
+			return Operand{NativeTranslator::literal(value.asInt()), Kind::Int};
+		case ValueType::Float:
+			return Operand{NativeTranslator::literal(value.asFloat()), Kind::Float};
+		case ValueType::String:
+			return Operand{"constant_" + std::to_string(index)};
+		default:
+			return std::nullopt;
+		}
+	}
+
+	bool validVariable(int index) const
+	{
+		return index >= 0 && index < m_bytecode.nextVarIndex;
+	}
+
+	/// Whether the instruction is translated, rather than run through CompiledFrame::operation
+	bool translated(const Function &function, const Instruction &instr) const
+	{
+		if (isRegisterOp(instr.op))
+		{
+			int count = registerOperands(instr.op);
+			int operands[] = {instr.operand1, instr.operand2, instr.operand3};
+			for (int i = 0; i < count; i++)
+				if (operands[i] < 0 || operands[i] >= MAX_REGISTERS)
+					return false;
+		}
+
+		switch (instr.op)
+		{
+		case OpCode::PUSH_CONST:
+			return constantOperand(instr.operand1).has_value();
+		case OpCode::LOAD_CONST_R:
+			return constantOperand(instr.operand2).has_value();
+		case OpCode::STORE_VAR:
+		case OpCode::LOAD_VAR:
+			return validVariable(instr.operand1);
+		case OpCode::LOAD_VAR_R:
+		case OpCode::STORE_VAR_R:
+			return validVariable(instr.operand2);
+		case OpCode::SWITCH_TABLE:
+		case OpCode::SWITCH_HASH:
+			return instr.operand1 >= 0 && instr.operand1 < static_cast<int>(m_bytecode.switchTables.size());
+		case OpCode::CALL:
+			return calleeEntry(instr) != EXIT;
+		case OpCode::PUSH_INT_IMM:
+		case OpCode::LOAD_INT_IMM_R:
+			return true;
+		case OpCode::RETURN:
+			return !function.topLevel; // Returning from top-level code is an error the VM reports
+		case OpCode::PRINT:
+		case OpCode::PRINTERROR:
+		case OpCode::READLINE:
+		case OpCode::IMPORT:
+		case OpCode::HALT:
+		case OpCode::CALL_NATIVE:
+		case OpCode::SYSTEM:
+		case OpCode::SYSTEM_OUT:
+		case OpCode::SYSTEM_ERR:
+		case OpCode::LEN:
+		case OpCode::CHAR_AT:
+		case OpCode::SUBSTR:
+		case OpCode::NEW_STRUCT:
+		case OpCode::GET_FIELD:
+		case OpCode::SET_FIELD:
+		case OpCode::NEW_STRUCT_INSTANCE_STATIC:
+		case OpCode::GET_FIELD_STATIC:
+		case OpCode::SET_FIELD_STATIC:
+		case OpCode::PRINT_R:
+		case OpCode::PRINTERROR_R:
+		case OpCode::READLINE_R:
+		case OpCode::SYSTEM_R:
+		case OpCode::SYSTEM_OUT_R:
+		case OpCode::SYSTEM_ERR_R:
+			return false;
+		default:
+			return static_cast<unsigned>(instr.op) <= static_cast<unsigned>(OpCode::NOT_R);
+		}
+	}
+
+	std::vector<int> successors(const Function &function, int pc) const
+	{
+		const Instruction &instr = m_code[pc];
+		switch (instr.op)
+		{
+		case OpCode::JUMP:
+		case OpCode::JUMP_BACK:
+			return {target(instr.operand1)};
+		case OpCode::JUMP_IF_FALSE:
+		case OpCode::JUMP_IF_TRUE:
+			return {target(pc + 1), target(instr.operand1)};
+		case OpCode::SWITCH_TABLE:
+		case OpCode::SWITCH_HASH: {
+			if (!translated(function, instr))
+				break;
+			const SwitchTable &table = m_bytecode.switchTables[instr.operand1];
+			std::vector<int>   targets{target(table.defaultTarget)};
+			for (int denseTarget : table.denseTargets)
+				targets.push_back(target(denseTarget));
+			for (const auto &[value, caseTarget] : table.cases)
+				targets.push_back(target(caseTarget));
+			return targets;
+		}
+		case OpCode::RETURN:
+			if (translated(function, instr))
+				return {};
+			break;
+		case OpCode::HALT:
+			return {};
+		default:
+			break;
+		}
+		return {target(pc + 1)};
+	}
+
+	/// Whether execution may continue at pc + 1
+	bool fallsThrough(const Function &function, int pc) const
+	{
+		switch (m_code[pc].op)
+		{
+		case OpCode::JUMP:
+		case OpCode::JUMP_BACK:
+		case OpCode::HALT:
+			return false;
+		case OpCode::RETURN:
+		case OpCode::SWITCH_TABLE:
+		case OpCode::SWITCH_HASH:
+			return !translated(function, m_code[pc]);
+		default:
+			return true;
+		}
+	}
+
+	void findBlocks(Function &function)
+	{
+		function.reachable.assign(m_size, 0);
+		function.labelled.assign(m_size, 0);
+		function.liveIn.assign(m_size, 0);
+		if (function.entry >= m_size)
+			return; // No code at all
+
+		std::vector<int> work{function.entry};
+		function.reachable[function.entry] = 1;
+		while (!work.empty())
+		{
+			int pc = work.back();
+			work.pop_back();
+			for (int next : successors(function, pc))
+			{
+				if (next == EXIT)
+					continue;
+				// Anything entered other than by falling through needs a label
+				if (next != pc + 1 || !fallsThrough(function, pc))
+					function.labelled[next] = 1;
+				if (!function.reachable[next])
+				{
+					function.reachable[next] = 1;
+					work.push_back(next);
+				}
+			}
+		}
+		for (int pc = 0; pc < function.entry; pc++)
+			if (function.reachable[pc])
+				function.labelled[function.entry] = 1; // Emitted in order, so the body starts with a goto
+	}
+
+	RegisterSet uses(const Function &function, int pc) const
+	{
+		const Instruction &instr = m_code[pc];
+		if (!translated(function, instr))
+			return interpretedUses(instr);
+		switch (instr.op)
+		{
+		case OpCode::MOV:
+		case OpCode::SQRT_R:
+		case OpCode::LOG_R:
+		case OpCode::EXP_R:
+		case OpCode::SIN_R:
+		case OpCode::COS_R:
+		case OpCode::TAN_R:
+		case OpCode::NEG_R:
+		case OpCode::NOT_R:
+			return bit(instr.operand2);
+		case OpCode::STORE_VAR_R:
+		case OpCode::PUSH_R:
+			return bit(instr.operand1);
+		case OpCode::PUSH2_R:
+			return bit(instr.operand1) | bit(instr.operand2);
+		case OpCode::CALL:
+			return m_functions[m_functionAt.at(calleeEntry(instr))].liveIn[calleeEntry(instr)];
+		case OpCode::RETURN:
+			return function.liveOut;
+		default:
+			if (isRegisterOp(instr.op) && registerOperands(instr.op) == 3)
+				return bit(instr.operand2) | bit(instr.operand3);
+			return 0;
+		}
+	}
+
+	/// Registers an instruction left to the VM may read
+	static RegisterSet interpretedUses(const Instruction &instr)
+	{
+		if (isRegisterOp(instr.op))
+			return instr.operand1 >= 0 && instr.operand1 < MAX_REGISTERS ? bit(instr.operand1) : ALL_REGISTERS;
+		switch (instr.op)
+		{
+		case OpCode::PRINT:
+		case OpCode::PRINTERROR:
+		case OpCode::READLINE:
+		case OpCode::HALT:
+		case OpCode::SYSTEM:
+		case OpCode::SYSTEM_OUT:
+		case OpCode::SYSTEM_ERR:
+		case OpCode::LEN:
+		case OpCode::CHAR_AT:
+		case OpCode::SUBSTR:
+		case OpCode::NEW_STRUCT:
+		case OpCode::GET_FIELD:
+		case OpCode::SET_FIELD:
+		case OpCode::NEW_STRUCT_INSTANCE_STATIC:
+		case OpCode::GET_FIELD_STATIC:
+		case OpCode::SET_FIELD_STATIC:
+			return 0; // Stack only
+		default:
+			return ALL_REGISTERS; // Natives and imported code may read any register
+		}
+	}
+
+	RegisterSet defs(const Function &function, int pc) const
+	{
+		const Instruction &instr = m_code[pc];
+		if (!translated(function, instr) || !isRegisterOp(instr.op))
+			return 0;
+		switch (instr.op)
+		{
+		case OpCode::STORE_VAR_R:
+		case OpCode::PUSH_R:
+		case OpCode::PUSH2_R:
+			return 0;
+		case OpCode::POP2_R:
+			return bit(instr.operand1) | bit(instr.operand2);
+		default:
+			return bit(instr.operand1);
+		}
+	}
+
+	/// Updates function.liveIn, and the liveOut of the functions it calls; true if either grew
+	bool computeLiveness(Function &function)
+	{
+		bool entryChanged = false;
+		for (bool changed = true; changed;)
+		{
+			changed = false;
+			for (int pc = m_size - 1; pc >= 0; pc--)
+			{
+				if (!function.reachable[pc])
+					continue;
+				RegisterSet liveOut = 0;
+				for (int next : successors(function, pc))
+					if (next != EXIT)
+						liveOut |= function.liveIn[next];
+				RegisterSet liveIn = uses(function, pc) | (liveOut & ~defs(function, pc));
+				if (liveIn != function.liveIn[pc])
+				{
+					function.liveIn[pc] = liveIn;
+					changed = true;
+					entryChanged |= pc == function.entry;
+				}
+			}
+		}
+		for (int pc = 0; pc < m_size; pc++)
+		{
+			if (!function.reachable[pc] || m_code[pc].op != OpCode::CALL || !translated(function, m_code[pc]))
+				continue;
+			Function   &callee = m_functions[m_functionAt.at(calleeEntry(m_code[pc]))];
+			RegisterSet after = pc + 1 < m_size && function.reachable[pc + 1] ? function.liveIn[pc + 1] : 0;
+			if ((callee.liveOut | after) != callee.liveOut)
+			{
+				callee.liveOut |= after;
+				entryChanged = true;
+			}
+		}
+		return entryChanged;
+	}
+
+	// Emission
+
+	void line(const std::string &text)
+	{
+		*m_out << (m_blockOpen ? "\t\t" : "\t") << text << "\n";
+	}
+
+	Operand temp(Kind kind, const std::string &expr)
+	{
+		std::string name = "t" + std::to_string(m_temps++);
+		line(std::format("const {} {} = {};", typeName(kind), name, expr));
+		return {name, kind};
+	}
+
+	void push(Operand operand)
+	{
+		m_stack.push_back(std::move(operand));
+	}
+
+	Operand pop()
+	{
+		if (m_stack.empty())
+			return temp(Kind::Value, "frame.pop()");
+		Operand operand = std::move(m_stack.back());
+		m_stack.pop_back();
+		return operand;
+	}
+
+	Operand readRegister(int reg) const
+	{
+		if (m_shadows[reg])
+			return *m_shadows[reg];
+		return {std::format("r[{}]", reg), Kind::Value, -1, reg};
+	}
+
+	void writeRegister(int reg, Operand operand)
+	{
+		m_shadows[reg] = std::move(operand);
+		m_dirty |= bit(reg);
+	}
+
+	/// Copy reads of a variable or frame register into locals before it is overwritten
+	void materialize(int variable, int reg)
+	{
+		auto copy = [&](Operand &operand) {
+			if ((variable >= 0 && operand.variable == variable) || (reg >= 0 && operand.reg == reg))
+				operand = temp(operand.kind, operand.expr);
+		};
+		for (Operand &operand : m_stack)
+			copy(operand);
+		for (auto &shadow : m_shadows)
+			if (shadow)
+				copy(*shadow);
+	}
+
+	/// Write the virtual stack, and the registers in live, back to the VM
+	void flush(RegisterSet live)
+	{
+		for (const Operand &operand : m_stack)
+			line("s.push_back(" + valueOf(operand) + ");");
+		m_stack.clear();
+		for (int reg = 0; reg < MAX_REGISTERS; reg++)
+		{
+			if ((m_dirty & live & bit(reg)) == 0)
+				continue;
+			materialize(-1, reg);
+			line(std::format("r[{}] = {};", reg, valueOf(*m_shadows[reg])));
+		}
+		for (auto &shadow : m_shadows)
+			shadow.reset();
+		m_dirty = 0;
+	}
+
+	void openBlock()
+	{
+		if (!m_blockOpen)
+			*m_out << "\t{\n";
+		m_blockOpen = true;
+	}
+
+	void closeBlock()
+	{
+		if (m_blockOpen)
+			*m_out << "\t}\n";
+		m_blockOpen = false;
+	}
+
+	/// Past the end of the program: top-level code returns, a function stops the VM like the interpreter does
+	std::string exitStatement(const Function &function) const
+	{
+		if (function.topLevel)
+			return "return;";
+		return std::format("frame.operation(frame.vm, {}, 0, 0, 0); return; // HALT", static_cast<int>(OpCode::HALT));
+	}
+
+	std::string jumpStatement(const Function &function, int to) const
+	{
+		return to == EXIT ? exitStatement(function) : std::format("goto L{};", to);
+	}
+
+	Operand intArithmetic(OpCode op, const Operand &a, const Operand &b)
+	{
+		std::string x = intOf(a), y = intOf(b);
+		switch (op)
+		{
+		case OpCode::IADD:
+		case OpCode::IADD_R:
+			return temp(Kind::Int, std::format("static_cast<i64>(static_cast<u64>({}) + static_cast<u64>({}))", x, y));
+		case OpCode::ISUBTRACT:
+		case OpCode::ISUB_R:
+			return temp(Kind::Int, std::format("static_cast<i64>(static_cast<u64>({}) - static_cast<u64>({}))", x, y));
+		case OpCode::IMULTIPLY:
+		case OpCode::IMUL_R:
+			return temp(Kind::Int, std::format("static_cast<i64>(static_cast<u64>({}) * static_cast<u64>({}))", x, y));
+		case OpCode::IDIVIDE:
+		case OpCode::IDIV_R:
+			return temp(Kind::Int, std::format("{1} == 0 ? i64(0) : {0} / {1}", x, y));
+		default:
+			return temp(Kind::Int, std::format("{} % {}", x, y));
+		}
+	}
+
+	Operand floatArithmetic(OpCode op, const Operand &a, const Operand &b)
+	{
+		std::string x = floatOf(a), y = floatOf(b);
+		switch (op)
+		{
+		case OpCode::FLADD:
+		case OpCode::FLADD_R:
+			return temp(Kind::Float, x + " + " + y);
+		case OpCode::FLSUBTRACT:
+		case OpCode::FLSUB_R:
+			return temp(Kind::Float, x + " - " + y);
+		case OpCode::FLMULTIPLY:
+		case OpCode::FLMUL_R:
+			return temp(Kind::Float, x + " * " + y);
+		case OpCode::FLDIVIDE:
+		case OpCode::FLDIV_R:
+			return temp(Kind::Float, x + " / " + y);
+		case OpCode::FLMODULO:
+		case OpCode::FLMOD_R:
+			return temp(Kind::Float, std::format("std::fmod({}, {})", x, y));
+		default:
+			return temp(Kind::Float, std::format("std::pow({}, {})", x, y));
+		}
+	}
+
+	Operand mathFunction(const char *function, const Operand &a)
+	{
+		return temp(Kind::Float, std::format("std::{}({})", function, floatOf(a)));
+	}
+
+	/// IEQUAL and friends: integer comparison of two ints, Value comparison otherwise
+	Operand intComparison(const char *op, const Operand &a, const Operand &b)
+	{
+		if (a.kind == Kind::Int && b.kind == Kind::Int)
+			return temp(Kind::Int, std::format("i64({} {} {})", a.expr, op, b.expr));
+		std::string values = std::format("{} {} {}", valueOf(a), op, valueOf(b));
+		auto        maybeInt = [](const Operand &o) { return o.kind == Kind::Int || o.kind == Kind::Value; };
+		if (!maybeInt(a) || !maybeInt(b))
+			return temp(Kind::Bool, values);
+		return comparison(std::format("{} && {}", isIntOf(a), isIntOf(b)),
+		                  std::format("{} {} {}", intOf(a), op, intOf(b)), values);
+	}
+
+	/// A comparison typed at run time: i64 0 / 1 if typed holds, else the bool of the Value comparison
+	Operand comparison(const std::string &typed, const std::string &compare, const std::string &values)
+	{
+		Operand isTyped = temp(Kind::Bool, typed);
+		Operand result = temp(Kind::Bool, std::format("{} ? {} : {}", isTyped.expr, compare, values));
+		return {std::format("({} ? Value(i64({})) : Value({}))", isTyped.expr, result.expr, result.expr), Kind::Value,
+		        -1, -1, result.expr};
+	}
+
+	/// FLEQUAL and friends: float comparison of two numbers, Value comparison otherwise
+	Operand floatComparison(const char *op, const Operand &a, const Operand &b)
+	{
+		auto numeric = [](const Operand &o) { return o.kind == Kind::Int || o.kind == Kind::Float; };
+		if (numeric(a) && numeric(b))
+			return temp(Kind::Int, std::format("i64({} {} {})", floatOf(a), op, floatOf(b)));
+		std::string values = std::format("{} {} {}", valueOf(a), op, valueOf(b));
+		if (a.kind == Kind::Bool || b.kind == Kind::Bool)
+			return temp(Kind::Bool, values);
+		return comparison(std::format("{} && {}", isNumberOf(a), isNumberOf(b)),
+		                  std::format("{} {} {}", floatOf(a), op, floatOf(b)), values);
+	}
+
+	static const char *comparisonOperator(OpCode op)
+	{
+		switch (op)
+		{
+		case OpCode::IEQUAL:
+		case OpCode::FLEQUAL:
+		case OpCode::IEQ_R:
+		case OpCode::FLEQ_R:
+			return "==";
+		case OpCode::INOT_EQUAL:
+		case OpCode::FLNOT_EQUAL:
+		case OpCode::INE_R:
+		case OpCode::FLNE_R:
+			return "!=";
+		case OpCode::ILESS_THAN:
+		case OpCode::FLLESS_THAN:
+		case OpCode::ILT_R:
+		case OpCode::FLLT_R:
+			return "<";
+		case OpCode::IGREATER_THAN:
+		case OpCode::FLGREATER_THAN:
+		case OpCode::IGT_R:
+		case OpCode::FLGT_R:
+			return ">";
+		case OpCode::ILESS_EQUAL:
+		case OpCode::FLLESS_EQUAL:
+		case OpCode::ILE_R:
+		case OpCode::FLLE_R:
+			return "<=";
+		default:
+			return ">=";
+		}
+	}
+
+	/// Result of a binary operation, stack or register form
+	Operand binary(OpCode op, const Operand &a, const Operand &b)
+	{
+		switch (op)
+		{
+		case OpCode::IADD:
+		case OpCode::ISUBTRACT:
+		case OpCode::IMULTIPLY:
+		case OpCode::IDIVIDE:
+		case OpCode::IMODULO:
+		case OpCode::IADD_R:
+		case OpCode::ISUB_R:
+		case OpCode::IMUL_R:
+		case OpCode::IDIV_R:
+		case OpCode::IMOD_R:
+			return intArithmetic(op, a, b);
+		case OpCode::FLADD:
+		case OpCode::FLSUBTRACT:
+		case OpCode::FLMULTIPLY:
+		case OpCode::FLDIVIDE:
+		case OpCode::FLMODULO:
+		case OpCode::POW:
+		case OpCode::FLADD_R:
+		case OpCode::FLSUB_R:
+		case OpCode::FLMUL_R:
+		case OpCode::FLDIV_R:
+		case OpCode::FLMOD_R:
+		case OpCode::POW_R:
+			return floatArithmetic(op, a, b);
+		case OpCode::IAND:
+		case OpCode::FLAND:
+		case OpCode::IAND_R:
+		case OpCode::FLAND_R:
+			return temp(Kind::Int, std::format("i64({} && {})", truthOf(a), truthOf(b)));
+		case OpCode::IOR:
+		case OpCode::FLOR:
+		case OpCode::IOR_R:
+		case OpCode::FLOR_R:
+			return temp(Kind::Int, std::format("i64({} || {})", truthOf(a), truthOf(b)));
+		case OpCode::IEQUAL:
+		case OpCode::INOT_EQUAL:
+		case OpCode::ILESS_THAN:
+		case OpCode::IGREATER_THAN:
+		case OpCode::ILESS_EQUAL:
+		case OpCode::IGREATER_EQUAL:
+		case OpCode::IEQ_R:
+		case OpCode::INE_R:
+		case OpCode::ILT_R:
+		case OpCode::IGT_R:
+		case OpCode::ILE_R:
+		case OpCode::IGE_R:
+			return intComparison(comparisonOperator(op), a, b);
+		default:
+			return floatComparison(comparisonOperator(op), a, b);
+		}
+	}
+
+	/// Result of a unary operation, stack or register form
+	Operand unary(OpCode op, const Operand &a)
+	{
+		switch (op)
+		{
+		case OpCode::SQRT:
+		case OpCode::SQRT_R:
+			return mathFunction("sqrt", a);
+		case OpCode::LOG:
+		case OpCode::LOG_R:
+			return mathFunction("log", a);
+		case OpCode::EXP:
+		case OpCode::EXP_R:
+			return mathFunction("exp", a);
+		case OpCode::SIN:
+		case OpCode::SIN_R:
+			return mathFunction("sin", a);
+		case OpCode::COS:
+		case OpCode::COS_R:
+			return mathFunction("cos", a);
+		case OpCode::TAN:
+		case OpCode::TAN_R:
+			return mathFunction("tan", a);
+		case OpCode::NEGATE:
+		case OpCode::NEG_R:
+			return temp(Kind::Float, "-(" + floatOf(a) + ")");
+		default:
+			return temp(Kind::Int, "i64(!" + truthOf(a) + ")");
+		}
+	}
+
+	static bool isUnary(OpCode op)
+	{
+		switch (op)
+		{
+		case OpCode::SQRT:
+		case OpCode::LOG:
+		case OpCode::EXP:
+		case OpCode::SIN:
+		case OpCode::COS:
+		case OpCode::TAN:
+		case OpCode::NEGATE:
+		case OpCode::NOT:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	void emitInterpreted(const Function &function, int pc)
+	{
+		const Instruction &instr = m_code[pc];
+		flush(function.liveIn[pc]);
+		line(std::format("frame.operation(frame.vm, {}, {}, {}, {}); // {}", static_cast<int>(instr.op),
+		                 instr.operand1, instr.operand2, instr.operand3, opCodeToString(instr.op)));
+		if (instr.op == OpCode::HALT)
+			line("return;");
+	}
+
+	void emitInstruction(const Function &function, int pc)
+	{
+		const Instruction &instr = m_code[pc];
+		if (!translated(function, instr))
+		{
+			emitInterpreted(function, pc);
+			return;
+		}
+
+		const int a = instr.operand1, b = instr.operand2, c = instr.operand3;
+		switch (instr.op)
+		{
+		case OpCode::PUSH_CONST:
+			push(*constantOperand(a));
+			if (m_bytecode.constants[a].isString())
+				m_stringConstants.insert(a);
+			break;
+		case OpCode::PUSH_INT_IMM:
+			push({NativeTranslator::literal(static_cast<i64>(a)), Kind::Int});
+			break;
+		case OpCode::POP:
+			if (m_stack.empty())
+				line("frame.pop();");
+			else
+				m_stack.pop_back();
+			break;
+		case OpCode::TRUE_P:
+			push({"true", Kind::Bool});
+			break;
+		case OpCode::FALSE_P:
+			push({"false", Kind::Bool});
+			break;
+		case OpCode::NULL_VAL:
+			push({"Value()"});
+			break;
+		case OpCode::LOAD_VAR:
+			push({std::format("v[{}]", a), Kind::Value, a});
+			break;
+		case OpCode::STORE_VAR: {
+			Operand value = pop();
+			materialize(a, -1);
+			line(std::format("v[{}] = {};", a, valueOf(value)));
+			break;
+		}
+
+		case OpCode::MOV:
+			writeRegister(a, readRegister(b));
+			break;
+		case OpCode::LOAD_CONST_R:
+			writeRegister(a, *constantOperand(b));
+			if (m_bytecode.constants[b].isString())
+				m_stringConstants.insert(b);
+			break;
+		case OpCode::LOAD_INT_IMM_R:
+			writeRegister(a, {NativeTranslator::literal(static_cast<i64>(b)), Kind::Int});
+			break;
+		case OpCode::LOAD_VAR_R:
+			writeRegister(a, {std::format("v[{}]", b), Kind::Value, b});
+			break;
+		case OpCode::STORE_VAR_R:
+			materialize(b, -1);
+			line(std::format("v[{}] = {};", b, valueOf(readRegister(a))));
+			break;
+		case OpCode::PUSH_R:
+			push(readRegister(a));
+			break;
+		case OpCode::PUSH2_R:
+			push(readRegister(a));
+			push(readRegister(b));
+			break;
+		case OpCode::POP_R:
+			writeRegister(a, pop());
+			break;
+		case OpCode::POP2_R:
+			writeRegister(a, pop());
+			writeRegister(b, pop());
+			break;
+
+		case OpCode::JUMP:
+		case OpCode::JUMP_BACK:
+			flush(function.liveIn[pc]);
+			line(jumpStatement(function, target(a)));
+			break;
+		case OpCode::JUMP_IF_FALSE:
+		case OpCode::JUMP_IF_TRUE: {
+			Operand     condition = temp(Kind::Bool, truthOf(pop()));
+			const char *negate = instr.op == OpCode::JUMP_IF_FALSE ? "!" : "";
+			flush(function.liveIn[pc]);
+			if (target(a) == EXIT)
+				line(std::format("if ({}{}) {{ {} }}", negate, condition.expr, exitStatement(function)));
+			else
+				line(std::format("if ({}{}) goto L{};", negate, condition.expr, a));
+			break;
+		}
+		case OpCode::SWITCH_TABLE:
+		case OpCode::SWITCH_HASH: {
+			Operand scrutinee = pop();
+			if (scrutinee.kind != Kind::Value || scrutinee.dependent())
+				scrutinee = temp(Kind::Value, valueOf(scrutinee));
+			flush(function.liveIn[pc]);
+			line(std::format("switch (frame.resolveSwitch(frame.vm, {}, {}, {}))", a,
+			                 instr.op == OpCode::SWITCH_HASH ? "true" : "false", scrutinee.expr));
+			line("{");
+			std::set<int> targets;
+			for (int next : successors(function, pc))
+				if (next != EXIT && targets.insert(next).second)
+					line(std::format("case {}: goto L{};", next, next));
+			line("default: " + exitStatement(function));
+			line("}");
+			break;
+		}
+		case OpCode::CALL: {
+			int entry = calleeEntry(instr);
+			flush(function.liveIn[pc]);
+			line(m_functions[m_functionAt.at(entry)].symbol + "(frame);");
+			break;
+		}
+		case OpCode::RETURN:
+			flush(ALL_REGISTERS);
+			line("return;");
+			break;
+
+		default:
+			if (isRegisterOp(instr.op))
+			{
+				if (registerOperands(instr.op) == 2)
+					writeRegister(a, unary(instr.op, readRegister(b)));
+				else
+					writeRegister(a, binary(instr.op, readRegister(b), readRegister(c)));
+			}
+			else if (isUnary(instr.op))
+				push(unary(instr.op, pop()));
+			else
+			{
+				Operand right = pop();
+				Operand left = pop();
+				push(binary(instr.op, left, right));
+			}
+			break;
+		}
+	}
+
+	void emitFunction(Function &function, std::ostream &out, NativeTranslator::Stats &stats)
+	{
+		m_out = &out;
+		m_stack.clear();
+		for (auto &shadow : m_shadows)
+			shadow.reset();
+		m_dirty = 0;
+		m_temps = 0;
+		m_blockOpen = false;
+
+		out << "void " << function.symbol << "(CompiledFrame &frame)\n{\n";
+		out << "\t[[maybe_unused]] auto  &s = frame.stack;\n";
+		out << "\t[[maybe_unused]] auto  &v = frame.variables;\n";
+		out << "\t[[maybe_unused]] Value *r = frame.registers;\n";
+
+		bool entered = false;
+		for (int pc = 0; pc < m_size; pc++)
+		{
+			if (!function.reachable[pc])
+				continue;
+			if (!entered && pc != function.entry)
+				line(std::format("goto L{};", function.entry));
+			entered = true;
+
+			if (function.labelled[pc])
+			{
+				flush(function.liveIn[pc]);
+				closeBlock();
+				out << "L" << pc << ":\n";
+			}
+			openBlock();
+
+			// Registers nothing reads again needn't be written back
+			for (int reg = 0; reg < MAX_REGISTERS; reg++)
+				if ((function.liveIn[pc] & bit(reg)) == 0)
+					m_shadows[reg].reset();
+			m_dirty &= function.liveIn[pc];
+
+			stats.instructions++;
+			if (!translated(function, m_code[pc]))
+				stats.interpreted++;
+			emitInstruction(function, pc);
+
+			if (pc + 1 == m_size && fallsThrough(function, pc))
+			{
+				flush(0);
+				line(exitStatement(function)); // Ran off the end of the program
+			}
+		}
+		closeBlock();
+		out << "}\n\n";
+	}
+};
+
+} // namespace
+
+std::string NativeTranslator::literal(i64 value)
+{
+	if (value == std::numeric_limits<i64>::min())
+		return "std::numeric_limits<i64>::min()";
+	return std::format("i64({})", value);
+}
+
+std::string NativeTranslator::literal(f64 value)
+{
+	if (std::isnan(value))
+		return "std::numeric_limits<f64>::quiet_NaN()";
+	if (std::isinf(value))
+		return value > 0 ? "std::numeric_limits<f64>::infinity()" : "-std::numeric_limits<f64>::infinity()";
+	// Hex floats round-trip exactly
+	char buffer[64];
+	auto end = std::to_chars(buffer, buffer + sizeof(buffer), std::fabs(value), std::chars_format::hex).ptr;
+	return std::format("f64({}0x{})", std::signbit(value) ? "-" : "", std::string_view(buffer, end));
+}
+
+std::string NativeTranslator::literal(std::string_view text)
+{
+	std::string escaped = "\"";
+	for (char c : text)
+	{
+		auto byte = static_cast<unsigned char>(c);
+		if (c == '"' || c == '\\')
+			escaped += {'\\', c};
+		else if (byte >= 32 && byte <= 126)
+			escaped += c;
+		else
+			escaped += std::format("\\{:03o}", byte); // Octal escapes end after three digits, unlike \x
+	}
+	return escaped + "\"";
+}
+
+std::string NativeTranslator::translate(const Bytecode &bytecode, const std::string &entryName, Stats *stats)
+{
+	Stats      ignored;
+	Translator translator(bytecode);
+	return translator.run(entryName, stats != nullptr ? *stats : ignored);
+}
+
+} // namespace Phasor
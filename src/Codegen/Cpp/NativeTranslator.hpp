@@ -0,0 +1,57 @@
+#pragma once
+#include "../CodeGen.hpp"
+#include <string>
+#include <string_view>
+#include <phsint.hpp>
+
+/// @brief The Phasor Programming Language and Runtime
+namespace Phasor
+{
+
+/**
+ * @class NativeTranslator
+ * @brief Ahead-of-time translation of bytecode into C++
+ *
+ * Every function in the bytecode, and the top-level code, becomes a C++
+ * function taking a CompiledFrame (include/Phasor/PhasorAOT.hpp). Jumps become
+ * gotos between labelled blocks, CALLs of known functions direct C++ calls and
+ * RETURN a return, so no dispatch or call stack is left at run time.
+ *
+ * Within a block, stack slots and registers are C++ expressions rather than VM
+ * state: arithmetic and comparisons whose operand types are known become typed
+ * i64 / f64 locals, and a register is only written back to the VM when a
+ * liveness pass finds it may still be read, by a later block, a callee or an
+ * interpreted instruction. Instructions without a translation (I/O, natives,
+ * structs, imports, HALT) flush that state and run through
+ * CompiledFrame::operation, so the VM stays the reference for their semantics.
+ *
+ * The VM runs the result with VM::run(bytecode, program) on the same bytecode,
+ * which supplies constants, tables and the variable count.
+ */
+class NativeTranslator
+{
+  public:
+	/// @brief How much of the program was translated
+	struct Stats
+	{
+		size_t functions = 0;    ///< C++ functions emitted, top-level code included
+		size_t instructions = 0; ///< Reachable instructions
+		size_t interpreted = 0;  ///< Of those, left to CompiledFrame::operation
+	};
+
+	/**
+	 * @brief Translate a whole program
+	 * @param bytecode Program to translate, as it will be embedded
+	 * @param entryName Name of the top-level function, a CompiledProgram
+	 * @param stats Filled in if given
+	 * @return C++ definitions in an anonymous namespace, for the generated header
+	 */
+	static std::string translate(const Bytecode &bytecode, const std::string &entryName, Stats *stats = nullptr);
+
+	/// @brief C++ expressions for constants, exact for every value including inf, NaN and embedded NULs
+	static std::string literal(i64 value);
+	static std::string literal(f64 value);
+	static std::string literal(std::string_view text);
+};
+
+} // namespace Phasor
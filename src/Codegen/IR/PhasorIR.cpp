@@ -95,6 +95,9 @@ int PhasorIR::getOperandCount(OpCode op)
     case OpCode::GET_FIELD:
     case OpCode::SET_FIELD:
     case OpCode::NEW_STRUCT_INSTANCE_STATIC:
+    case OpCode::PUSH_INT_IMM:
+    case OpCode::SWITCH_TABLE:
+    case OpCode::SWITCH_HASH:
         return 1;
 
     // 2 operands
@@ -114,6 +117,7 @@ int PhasorIR::getOperandCount(OpCode op)
     case OpCode::POP2_R:
     case OpCode::GET_FIELD_STATIC:
     case OpCode::SET_FIELD_STATIC:
+    case OpCode::LOAD_INT_IMM_R:
         return 2;
 
     // 3 operands
@@ -186,6 +190,16 @@ PhasorIR::OperandType PhasorIR::getOperandType(OpCode op, int operandIndex)
         if (operandIndex == 1) return OperandType::VARIABLE_IDX;
     }
 
+    // Immediates are plain integers
+    if (op == OpCode::PUSH_INT_IMM)
+        return OperandType::INT;
+    if (op == OpCode::LOAD_INT_IMM_R)
+        return operandIndex == 0 ? OperandType::REGISTER : OperandType::INT;
+
+    // Switches index the switch section
+    if (op == OpCode::SWITCH_TABLE || op == OpCode::SWITCH_HASH)
+        return OperandType::INT;
+
     // JUMP instructions take an offset (INT)
     if (op == OpCode::JUMP || op == OpCode::JUMP_IF_FALSE ||
         op == OpCode::JUMP_IF_TRUE || op == OpCode::JUMP_BACK)
@@ -529,6 +543,26 @@ std::vector<u8> PhasorIR::serialize(const Bytecode &bytecode)
         ss << "\n";
     }
 
+    // Switch Tables Section (only when SWITCH_TABLE / SWITCH_HASH are used)
+    // Format per table: <default> <low> <denseCount> [<target>...] then <caseCount>
+    // followed by one "<target> <value>" line per case
+    if (!bytecode.switchTables.empty())
+    {
+        ss << ".SWITCHES " << bytecode.switchTables.size() << "\n";
+        for (const auto &table : bytecode.switchTables)
+        {
+            ss << table.defaultTarget << " " << table.low << " " << table.denseTargets.size();
+            for (int target : table.denseTargets)
+                ss << " " << target;
+            ss << "\n" << table.cases.size() << "\n";
+            for (const auto &[value, target] : table.cases)
+            {
+                ss << target << " ";
+                writeIRValue(ss, value, escapeString);
+            }
+        }
+    }
+
     // Instructions Section
     ss << ".INSTRUCTIONS " << bytecode.instructions.size() << "\n";
     for (const auto &instr : bytecode.instructions)
@@ -706,6 +740,33 @@ Bytecode PhasorIR::deserialize(const std::vector<u8> &data)
                 bytecode.structEntries[bytecode.structs.back().name] = index;
             }
         }
+        else if (section == ".SWITCHES")
+        {
+            int count;
+            ss >> count;
+            bytecode.switchTables.reserve(count);
+            for (int i = 0; i < count; ++i)
+            {
+                SwitchTable table;
+                size_t      denseCount;
+                ss >> table.defaultTarget >> table.low >> denseCount;
+                table.denseTargets.resize(denseCount);
+                for (auto &target : table.denseTargets)
+                    ss >> target;
+
+                size_t caseCount;
+                ss >> caseCount;
+                for (size_t c = 0; c < caseCount; ++c)
+                {
+                    int         target;
+                    std::string type;
+                    ss >> target >> type;
+                    table.cases.emplace_back(readIRValue(type, ss, unescapeString), target);
+                }
+                table.buildIndex();
+                bytecode.switchTables.push_back(std::move(table));
+            }
+        }
         else if (section == ".INSTRUCTIONS")
         {
             int count;
@@ -36,6 +36,9 @@ class PhasorIR
 	/// @brief Helper to unescape strings from text format
 	static std::string unescapeString(const std::string &str);
 
+	/// @brief Number of operands an opcode uses, the rest are always 0
+	static int getOperandCount(OpCode op);
+
   private:
 	/// @brief Operand types for instructions
 	enum class OperandType : u8
@@ -48,7 +51,6 @@ class PhasorIR
 		FUNCTION_IDX  ///< Index into function entries
 	};
 
-	static int         getOperandCount(OpCode op);
 	static OperandType getOperandType(OpCode op, int operandIndex);
 
 	static const std::unordered_map<OpCode, std::string> opCodeToStringMap;
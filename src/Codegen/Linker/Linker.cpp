@@ -0,0 +1,375 @@
+#include "Linker.hpp"
+#include "../Optimizer/TreeShaker.hpp"
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+
+namespace Phasor
+{
+
+namespace
+{
+
+/// Key modules are identified by, so two spellings of one file link once
+std::string moduleKey(const std::filesystem::path &module)
+{
+	std::error_code ec;
+	auto            canonical = std::filesystem::weakly_canonical(module, ec);
+	return (ec ? module.lexically_normal() : canonical).generic_string();
+}
+
+/// Which operand (1-3) holds a variable slot, or 0 for none
+int variableOperand(OpCode op)
+{
+	switch (op)
+	{
+	case OpCode::LOAD_VAR:
+	case OpCode::STORE_VAR:
+		return 1;
+	case OpCode::LOAD_VAR_R:
+	case OpCode::STORE_VAR_R:
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+} // namespace
+
+Linker::Linker(const ModuleLoader &load) : load(load)
+{
+}
+
+Bytecode Linker::link(const Bytecode &program, const std::filesystem::path &path, const ModuleLoader &load)
+{
+	Linker linker(load);
+	if (!path.empty())
+		linker.active.push_back(path);
+	linker.append(program, path, true);
+	linker.bindImportedCalls();
+	return std::move(linker.image);
+}
+
+void Linker::bindImportedCalls()
+{
+	// A module compiled on its own can't know what its imports define, so calls to
+	// those functions were emitted as CALL_NATIVE. The calling convention is the same.
+	const auto constCount = static_cast<int>(image.constants.size());
+	for (size_t i = 0; i < image.instructions.size(); ++i)
+	{
+		Instruction &instr = image.instructions[i];
+		if (instr.op != OpCode::CALL_NATIVE || instr.operand1 < 0 || instr.operand1 >= constCount ||
+		    !image.constants[instr.operand1].isString())
+			continue;
+		std::string name = image.constants[instr.operand1].asString();
+		if (!importedFunctions.contains(name))
+			continue;
+
+		// The argument count is pushed right before the call
+		auto params = image.functionParamCounts.find(name);
+		if (params != image.functionParamCounts.end() && i > 0)
+		{
+			const Instruction &count = image.instructions[i - 1];
+			if (count.op == OpCode::PUSH_INT_IMM && count.operand1 != params->second)
+				throw std::runtime_error(std::format("Calling function '{}' with {} arguments but it expects {}", name,
+				                                     count.operand1, params->second));
+		}
+		instr.op = OpCode::CALL;
+	}
+}
+
+std::filesystem::path Linker::resolve(const std::filesystem::path &importer, const std::string &module)
+{
+	std::filesystem::path spec(module);
+	if (spec.is_absolute())
+		return spec.lexically_normal();
+
+	// Next to the importing file first, then relative to the working directory as the runtime import did
+	auto            candidate = (importer.parent_path() / spec).lexically_normal();
+	std::error_code ec;
+	if (!std::filesystem::exists(candidate, ec) && std::filesystem::exists(spec, ec))
+		return spec.lexically_normal();
+	return candidate;
+}
+
+const std::string &Linker::initFunction(const std::filesystem::path &module, const std::string &spelling)
+{
+	auto key = moduleKey(module);
+	if (auto it = initFunctions.find(key); it != initFunctions.end())
+		return it->second;
+
+	// Two different files imported under the same spelling get numbered
+	auto taken = [&](const std::string &name) {
+		return std::ranges::any_of(initFunctions, [&](const auto &entry) { return entry.second == name; });
+	};
+	std::string name = "import:" + spelling;
+	for (int n = 2; taken(name); n++)
+		name = std::format("import:{}#{}", spelling, n);
+	return initFunctions.emplace(key, std::move(name)).first->second;
+}
+
+bool Linker::sameBody(const Bytecode &a, int entryA, const Bytecode &b, int entryB)
+{
+	auto bodyEnd = [](const Bytecode &bytecode, int entry) {
+		const auto size = static_cast<int>(bytecode.instructions.size());
+		if (entry < 1 || entry > size || bytecode.instructions[entry - 1].op != OpCode::JUMP)
+			return -1;
+		int end = bytecode.instructions[entry - 1].operand1;
+		return end >= entry && end <= size ? end : -1;
+	};
+
+	int endA = bodyEnd(a, entryA);
+	int endB = bodyEnd(b, entryB);
+	if (endA < 0 || endB < 0 || endA - entryA != endB - entryB)
+		return false;
+
+	// a has been relocated into the image and b not yet, so operands are compared by what they
+	// refer to: jump targets relative to the entry, constants by value, variables and structs by name
+	auto variableNames = [](const Bytecode &bytecode) {
+		std::unordered_map<int, std::string_view> names;
+		for (const auto &[name, index] : bytecode.variables)
+		{
+			std::string_view local = name;
+			if (auto qualifier = local.rfind("::"); qualifier != std::string_view::npos)
+				local.remove_prefix(qualifier + 2);
+			names.emplace(index, local);
+		}
+		return names;
+	};
+	auto sameConstant = [&](int x, int y) {
+		const auto sizeA = static_cast<int>(a.constants.size());
+		const auto sizeB = static_cast<int>(b.constants.size());
+		if (x < 0 || x >= sizeA || y < 0 || y >= sizeB)
+			return x == y;
+		return a.constants[x] == b.constants[y];
+	};
+	auto sameStruct = [&](int x, int y) {
+		const auto sizeA = static_cast<int>(a.structs.size());
+		const auto sizeB = static_cast<int>(b.structs.size());
+		if (x < 0 || x >= sizeA || y < 0 || y >= sizeB)
+			return x == y;
+		return a.structs[x].name == b.structs[y].name;
+	};
+	auto sameSwitch = [&](int x, int y) {
+		const auto sizeA = static_cast<int>(a.switchTables.size());
+		const auto sizeB = static_cast<int>(b.switchTables.size());
+		if (x < 0 || x >= sizeA || y < 0 || y >= sizeB)
+			return x == y;
+		const SwitchTable &ta = a.switchTables[x];
+		const SwitchTable &tb = b.switchTables[y];
+		auto sameTarget = [&](int targetA, int targetB) { return targetA - entryA == targetB - entryB; };
+		return ta.low == tb.low && sameTarget(ta.defaultTarget, tb.defaultTarget) &&
+		       std::ranges::equal(ta.denseTargets, tb.denseTargets, sameTarget) &&
+		       std::ranges::equal(ta.cases, tb.cases, [&](const auto &ca, const auto &cb) {
+			       return ca.first == cb.first && sameTarget(ca.second, cb.second);
+		       });
+	};
+	std::unordered_map<int, std::string_view> namesA;
+	std::unordered_map<int, std::string_view> namesB;
+
+	for (int offset = 0; offset < endA - entryA; ++offset)
+	{
+		Instruction x = a.instructions[entryA + offset];
+		Instruction y = b.instructions[entryB + offset];
+		if (x.op != y.op)
+			return false;
+		if (TreeShaker::isJump(x.op))
+		{
+			if (x.operand1 - entryA != y.operand1 - entryB)
+				return false;
+			x.operand1 = y.operand1 = 0;
+		}
+		if (int which = TreeShaker::constantOperand(x.op); which != 0)
+		{
+			i32 &ca = TreeShaker::operand(x, which);
+			i32 &cb = TreeShaker::operand(y, which);
+			if (!sameConstant(ca, cb))
+				return false;
+			ca = cb = 0;
+		}
+		if (TreeShaker::isStructOp(x.op))
+		{
+			if (!sameStruct(x.operand1, y.operand1))
+				return false;
+			x.operand1 = y.operand1 = 0;
+		}
+		if (int which = variableOperand(x.op); which != 0)
+		{
+			if (namesA.empty() && namesB.empty())
+			{
+				namesA = variableNames(a);
+				namesB = variableNames(b);
+			}
+			i32 &va = TreeShaker::operand(x, which);
+			i32 &vb = TreeShaker::operand(y, which);
+			auto na = namesA.find(va);
+			auto nb = namesB.find(vb);
+			if (na == namesA.end() || nb == namesB.end() || na->second != nb->second)
+				return false;
+			va = vb = 0;
+		}
+		if (x.op == OpCode::SWITCH_TABLE || x.op == OpCode::SWITCH_HASH)
+		{
+			if (!sameSwitch(x.operand1, y.operand1))
+				return false;
+			x.operand1 = y.operand1 = 0;
+		}
+		if (x.operand1 != y.operand1 || x.operand2 != y.operand2 || x.operand3 != y.operand3)
+			return false;
+	}
+	return true;
+}
+
+void Linker::append(const Bytecode &object, const std::filesystem::path &path, bool isProgram)
+{
+	const auto  count = static_cast<int>(object.instructions.size());
+	const auto  constCount = static_cast<int>(object.constants.size());
+	const auto  structCount = static_cast<int>(object.structs.size());
+	std::string module = path.empty() ? "<stdin>" : path.string();
+
+	// A module's code sits behind a JUMP like any function body
+	int jumpIndex = -1;
+	if (!isProgram)
+	{
+		jumpIndex = static_cast<int>(image.instructions.size());
+		image.emit(OpCode::JUMP);
+	}
+	const int base = static_cast<int>(image.instructions.size());
+	const int varBase = image.nextVarIndex;
+	const int switchBase = static_cast<int>(image.switchTables.size());
+
+	std::vector<int> constRemap(constCount);
+	for (int c = 0; c < constCount; ++c)
+		constRemap[c] = image.addConstant(object.constants[c]);
+
+	// Structs: one descriptor per name, defaults copied as a contiguous range
+	std::vector<int> structRemap(structCount);
+	for (int s = 0; s < structCount; ++s)
+	{
+		const StructInfo &info = object.structs[s];
+		if (auto it = image.structEntries.find(info.name); it != image.structEntries.end())
+		{
+			if (image.structs[it->second].fieldNames != info.fieldNames)
+				throw std::runtime_error(
+				    std::format("Struct '{}' in {} differs from an earlier definition", info.name, module));
+			structRemap[s] = it->second;
+			continue;
+		}
+		StructInfo linked = info;
+		linked.firstConstIndex = static_cast<int>(image.constants.size());
+		for (int c = info.firstConstIndex; c < info.firstConstIndex + info.fieldCount; ++c)
+			image.appendConstant(c >= 0 && c < constCount ? object.constants[c] : Value());
+		structRemap[s] = static_cast<int>(image.structs.size());
+		image.structEntries.emplace(linked.name, structRemap[s]);
+		image.structs.push_back(std::move(linked));
+	}
+
+	// Module variables get their own slot range; their names are qualified with the module's init
+	// function, which is unique per file, so the table stays unambiguous
+	std::string prefix = isProgram ? "" : initFunctions.at(moduleKey(path)) + "::";
+	for (const auto &[name, index] : object.variables)
+		image.variables[prefix + name] = index + varBase;
+	image.nextVarIndex += object.nextVarIndex;
+
+	for (const auto &[name, entry] : object.functionEntries)
+	{
+		if (auto it = image.functionEntries.find(name); it != image.functionEntries.end())
+		{
+			if (!sameBody(image, it->second, object, entry))
+				throw std::runtime_error(std::format("Function '{}' is defined in both {} and {}", name,
+				                                     functionOrigins[name].string(), module));
+			continue; // Same definition pulled in twice, the body is left in place but never called
+		}
+		image.functionEntries[name] = entry + base;
+		functionOrigins[name] = module;
+		if (!isProgram)
+			importedFunctions.insert(name);
+		auto copy = [&](auto &to, const auto &from) {
+			if (auto found = from.find(name); found != from.end())
+				to[name] = found->second;
+		};
+		copy(image.functionParamCounts, object.functionParamCounts);
+		copy(image.functionParamTypeNames, object.functionParamTypeNames);
+		copy(image.functionParamArrayDims, object.functionParamArrayDims);
+		copy(image.functionReturnTypeNames, object.functionReturnTypeNames);
+	}
+
+	for (SwitchTable table : object.switchTables)
+	{
+		table.defaultTarget += base;
+		for (int &target : table.denseTargets)
+			target += base;
+		for (auto &[value, target] : table.cases)
+			target += base;
+		table.buildIndex();
+		image.switchTables.push_back(std::move(table));
+	}
+
+	std::vector<std::filesystem::path> imports;
+	for (Instruction instr : object.instructions)
+	{
+		if (instr.op == OpCode::IMPORT)
+		{
+			if (instr.operand1 < 0 || instr.operand1 >= constCount || !object.constants[instr.operand1].isString())
+				throw std::runtime_error("Invalid import in " + module);
+			std::string spelling = object.constants[instr.operand1].asString();
+			auto        target = resolve(path, spelling);
+			image.emit(OpCode::CALL, image.addStringConstant(initFunction(target, spelling)));
+			imports.push_back(std::move(target));
+			continue;
+		}
+		if (instr.op == OpCode::HALT && !isProgram)
+		{
+			image.emit(OpCode::JUMP, base + count);
+			continue;
+		}
+
+		if (TreeShaker::isJump(instr.op))
+			instr.operand1 += base;
+		if (int which = TreeShaker::constantOperand(instr.op); which != 0)
+		{
+			i32 &index = TreeShaker::operand(instr, which);
+			if (index >= 0 && index < constCount)
+				index = constRemap[index];
+		}
+		if (TreeShaker::isStructOp(instr.op) && instr.operand1 >= 0 && instr.operand1 < structCount)
+			instr.operand1 = structRemap[instr.operand1];
+		if (int which = variableOperand(instr.op); which != 0)
+			TreeShaker::operand(instr, which) += varBase;
+		if (instr.op == OpCode::SWITCH_TABLE || instr.op == OpCode::SWITCH_HASH)
+			instr.operand1 += switchBase;
+		image.instructions.push_back(instr);
+	}
+
+	if (!isProgram)
+	{
+		image.emit(OpCode::RETURN);
+		image.instructions[jumpIndex].operand1 = static_cast<int>(image.instructions.size());
+		const std::string &init = initFunctions.at(moduleKey(path));
+		image.functionEntries[init] = base;
+		image.functionParamCounts[init] = 0;
+		image.functionParamTypeNames[init] = {};
+		functionOrigins[init] = module;
+	}
+
+	for (const auto &target : imports)
+	{
+		auto key = moduleKey(target);
+		if (std::ranges::any_of(active, [&](const auto &p) { return moduleKey(p) == key; }))
+		{
+			std::string chain;
+			for (const auto &p : active)
+				chain += p.string() + " -> ";
+			throw std::runtime_error("Import cycle: " + chain + target.string());
+		}
+		if (image.functionEntries.contains(initFunctions.at(key)))
+			continue;
+		active.push_back(target);
+		append(load(target), target, false);
+		active.pop_back();
+	}
+}
+
+} // namespace Phasor
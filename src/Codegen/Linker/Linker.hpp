@@ -0,0 +1,78 @@
+#pragma once
+#include "../CodeGen.hpp"
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <phsint.hpp>
+
+/// @brief The Phasor Programming Language and Runtime
+namespace Phasor
+{
+
+/**
+ * @class Linker
+ * @brief Static linker for separately compiled modules
+ *
+ * Every module is compiled on its own into object bytecode: a regular
+ * Bytecode whose variable, function and struct tables are its symbol tables
+ * and whose IMPORT instructions are its unresolved references. The linker
+ * follows those imports at compile time and merges all reachable modules
+ * into one image the VM runs without ever re-entering the compiler:
+ *  - the program comes first and keeps its layout
+ *  - each imported module becomes a parameterless init function, its
+ *    top-level code with HALT turned into a jump to a trailing RETURN,
+ *    and each IMPORT of it becomes a CALL of that function
+ *  - constants are merged into one pool, variables moved into their own
+ *    slot range, struct and switch table indices and jump targets relocated
+ *
+ * Modules keep private variables, as they had when run by the import
+ * handler. Functions and structs share one namespace, so the importer can
+ * call what its modules define; a name defined by two modules must be the
+ * same definition (usually a shared include), anything else is a link error.
+ */
+class Linker
+{
+  public:
+	/// @brief Compiles the module at a path into object bytecode
+	using ModuleLoader = std::function<Bytecode(const std::filesystem::path &path)>;
+
+	/**
+	 * @brief Resolve the imports of a program and link it with its modules
+	 * @param program Object bytecode of the program
+	 * @param path Source path of the program, imports are looked up next to it; empty for stdin
+	 * @param load Compiles each imported module
+	 */
+	static Bytecode link(const Bytecode &program, const std::filesystem::path &path, const ModuleLoader &load);
+
+	/// @brief Where an import statement in a module at importer refers to
+	static std::filesystem::path resolve(const std::filesystem::path &importer, const std::string &module);
+
+  private:
+	explicit Linker(const ModuleLoader &load);
+
+	const ModuleLoader                                    &load;
+	Bytecode                                               image;
+	std::unordered_map<std::string, std::string>           initFunctions;     ///< Canonical module path -> init function
+	std::unordered_map<std::string, std::filesystem::path> functionOrigins;   ///< Function name -> defining module
+	std::unordered_set<std::string>                        importedFunctions; ///< Functions defined by imported modules
+	std::vector<std::filesystem::path>                     active;            ///< Import chain being linked, for cycles
+
+	/// @brief Init function name for a module, assigned on first use
+	const std::string &initFunction(const std::filesystem::path &module, const std::string &spelling);
+
+	/// @brief Relocate an object into the image, then link the modules it imports
+	void append(const Bytecode &object, const std::filesystem::path &path, bool isProgram);
+
+	/// @brief Turn CALL_NATIVE of functions that imported modules define into CALL
+	void bindImportedCalls();
+
+	/// @brief Whether two function bodies are the same code, so a duplicate definition can be dropped
+	/// @param a The image, with the body already relocated
+	/// @param b An object not yet appended
+	static bool sameBody(const Bytecode &a, int entryA, const Bytecode &b, int entryB);
+};
+
+} // namespace Phasor
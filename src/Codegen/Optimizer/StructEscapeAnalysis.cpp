@@ -0,0 +1,247 @@
+#include "StructEscapeAnalysis.hpp"
+#include <algorithm>
+
+namespace Phasor
+{
+
+std::unordered_map<std::string, std::vector<std::string>> StructEscapeAnalysis::findReplaceable(
+    const AST::Program &program)
+{
+	StructEscapeAnalysis analysis;
+	for (const auto &stmt : program.statements)
+		analysis.visit(stmt.get());
+
+	std::unordered_map<std::string, std::vector<std::string>> result;
+	if (analysis.unsupported)
+		return result;
+
+	auto declares = [](const std::vector<std::string> &fields, const std::string &name) {
+		return std::find(fields.begin(), fields.end(), name) != fields.end();
+	};
+
+	for (const auto &[name, candidate] : analysis.candidates)
+	{
+		if (analysis.declarations[name] != 1 || analysis.escaped.contains(name))
+			continue;
+		auto structIt = analysis.structFields.find(candidate.structName);
+		if (structIt == analysis.structFields.end())
+			continue;
+		const auto &fields = structIt->second;
+
+		// Unknown fields keep the dynamic path so the runtime still reports them
+		bool known = std::ranges::all_of(candidate.literalFields, [&](const auto &f) { return declares(fields, f); });
+		if (auto uses = analysis.fieldUses.find(name); uses != analysis.fieldUses.end())
+			known = known && std::ranges::all_of(uses->second, [&](const auto &f) { return declares(fields, f); });
+		if (known)
+			result.emplace(name, fields);
+	}
+	return result;
+}
+
+void StructEscapeAnalysis::visit(const AST::Statement *stmt)
+{
+	if (stmt == nullptr || unsupported)
+		return;
+
+	switch (stmt->kind)
+	{
+	case AST::NodeKind::VarDecl:
+	{
+		const auto *varDecl = static_cast<const AST::VarDecl *>(stmt);
+		// The initializer runs before the variable exists, so field uses in it come before the declaration
+		visit(varDecl->initializer.get());
+		++declarations[varDecl->name];
+		const auto *literal = AST::as<AST::StructInstanceExpr>(varDecl->initializer.get());
+		bool        typeFits = varDecl->type == nullptr || varDecl->type->name == "any" ||
+		                (literal != nullptr && varDecl->type->name == literal->structName &&
+		                 varDecl->type->arrayDimensions.empty());
+		// A declaration that may not run would leave the fields null where the struct would be missing
+		if (literal != nullptr && typeFits && conditionalDepth == 0)
+		{
+			Candidate candidate{literal->structName, {}};
+			for (const auto &[fieldName, fieldValue] : literal->fieldValues)
+				candidate.literalFields.push_back(fieldName);
+			candidates[varDecl->name] = std::move(candidate);
+		}
+		break;
+	}
+	case AST::NodeKind::ExpressionStmt:
+		visit(static_cast<const AST::ExpressionStmt *>(stmt)->expression.get());
+		break;
+	case AST::NodeKind::PrintStmt:
+		visit(static_cast<const AST::PrintStmt *>(stmt)->expression.get());
+		break;
+	case AST::NodeKind::ExportStmt:
+	{
+		// Importers can see exported variables as a whole
+		const auto *exportStmt = static_cast<const AST::ExportStmt *>(stmt);
+		if (const auto *varDecl = AST::as<AST::VarDecl>(exportStmt->declaration.get()))
+			escaped.insert(varDecl->name);
+		visit(exportStmt->declaration.get());
+		break;
+	}
+	case AST::NodeKind::BlockStmt:
+		for (const auto &inner : static_cast<const AST::BlockStmt *>(stmt)->statements)
+			visit(inner.get());
+		break;
+	case AST::NodeKind::ReturnStmt:
+		visit(static_cast<const AST::ReturnStmt *>(stmt)->value.get());
+		break;
+	case AST::NodeKind::BreakStmt:
+	case AST::NodeKind::ContinueStmt:
+	case AST::NodeKind::IncludeStmt: // already spliced in by the parser
+		break;
+	case AST::NodeKind::IfStmt:
+	{
+		const auto *ifStmt = static_cast<const AST::IfStmt *>(stmt);
+		visit(ifStmt->condition.get());
+		++conditionalDepth;
+		visit(ifStmt->thenBranch.get());
+		visit(ifStmt->elseBranch.get());
+		--conditionalDepth;
+		break;
+	}
+	case AST::NodeKind::WhileStmt:
+	{
+		const auto *whileStmt = static_cast<const AST::WhileStmt *>(stmt);
+		visit(whileStmt->condition.get());
+		++conditionalDepth;
+		visit(whileStmt->body.get());
+		--conditionalDepth;
+		break;
+	}
+	case AST::NodeKind::ForStmt:
+	{
+		const auto *forStmt = static_cast<const AST::ForStmt *>(stmt);
+		visit(forStmt->initializer.get());
+		visit(forStmt->condition.get());
+		++conditionalDepth;
+		visit(forStmt->increment.get());
+		visit(forStmt->body.get());
+		--conditionalDepth;
+		break;
+	}
+	case AST::NodeKind::UnsafeBlockStmt:
+		visit(static_cast<const AST::UnsafeBlockStmt *>(stmt)->block.get());
+		break;
+	case AST::NodeKind::FunctionDecl:
+	{
+		// Parameters share the global variable namespace
+		const auto *funcDecl = static_cast<const AST::FunctionDecl *>(stmt);
+		for (const auto &param : funcDecl->params)
+			++declarations[param.name];
+		++conditionalDepth;
+		visit(funcDecl->body.get());
+		--conditionalDepth;
+		break;
+	}
+	case AST::NodeKind::StructDecl:
+	{
+		const auto *structDecl = static_cast<const AST::StructDecl *>(stmt);
+		auto       &fields = structFields[structDecl->name];
+		fields.clear();
+		for (const auto &field : structDecl->fields)
+			fields.push_back(field.name);
+		break;
+	}
+	case AST::NodeKind::SwitchStmt:
+	{
+		const auto *switchStmt = static_cast<const AST::SwitchStmt *>(stmt);
+		visit(switchStmt->expr.get());
+		++conditionalDepth;
+		for (const auto &caseClause : switchStmt->cases)
+		{
+			visit(caseClause.value.get());
+			for (const auto &inner : caseClause.statements)
+				visit(inner.get());
+		}
+		for (const auto &inner : switchStmt->defaultStmts)
+			visit(inner.get());
+		--conditionalDepth;
+		break;
+	}
+	default:
+		// Imported modules run against the same variables and can't be seen from here
+		unsupported = true;
+		break;
+	}
+}
+
+void StructEscapeAnalysis::visit(const AST::Expression *expr)
+{
+	if (expr == nullptr || unsupported)
+		return;
+
+	switch (expr->kind)
+	{
+	case AST::NodeKind::IdentifierExpr:
+		escaped.insert(static_cast<const AST::IdentifierExpr *>(expr)->name);
+		break;
+	case AST::NodeKind::FieldAccessExpr:
+	{
+		const auto *fieldAccess = static_cast<const AST::FieldAccessExpr *>(expr);
+		if (const auto *object = AST::as<AST::IdentifierExpr>(fieldAccess->object.get()))
+		{
+			// Before the declaration the struct doesn't exist yet, and the access has to fail as it would
+			if (!declarations.contains(object->name))
+				escaped.insert(object->name);
+			fieldUses[object->name].push_back(fieldAccess->fieldName);
+		}
+		else
+			visit(fieldAccess->object.get());
+		break;
+	}
+	case AST::NodeKind::PostfixExpr:
+		visit(static_cast<const AST::PostfixExpr *>(expr)->operand.get());
+		break;
+	case AST::NodeKind::UnaryExpr:
+		visit(static_cast<const AST::UnaryExpr *>(expr)->operand.get());
+		break;
+	case AST::NodeKind::BinaryExpr:
+	{
+		const auto *binary = static_cast<const AST::BinaryExpr *>(expr);
+		visit(binary->left.get());
+		visit(binary->right.get());
+		break;
+	}
+	case AST::NodeKind::ArrayAccessExpr:
+	{
+		const auto *arrayAccess = static_cast<const AST::ArrayAccessExpr *>(expr);
+		visit(arrayAccess->array.get());
+		visit(arrayAccess->index.get());
+		break;
+	}
+	case AST::NodeKind::ArrayLiteralExpr:
+		for (const auto &element : static_cast<const AST::ArrayLiteralExpr *>(expr)->elements)
+			visit(element.get());
+		break;
+	case AST::NodeKind::MemberAccessExpr:
+		visit(static_cast<const AST::MemberAccessExpr *>(expr)->object.get());
+		break;
+	case AST::NodeKind::CallExpr:
+		for (const auto &arg : static_cast<const AST::CallExpr *>(expr)->arguments)
+			visit(arg.get());
+		break;
+	case AST::NodeKind::AssignmentExpr:
+	{
+		const auto *assign = static_cast<const AST::AssignmentExpr *>(expr);
+		visit(assign->target.get());
+		visit(assign->value.get());
+		break;
+	}
+	case AST::NodeKind::StructInstanceExpr:
+		for (const auto &[fieldName, fieldValue] : static_cast<const AST::StructInstanceExpr *>(expr)->fieldValues)
+			visit(fieldValue.get());
+		break;
+	case AST::NodeKind::NumberExpr:
+	case AST::NodeKind::StringExpr:
+	case AST::NodeKind::BooleanExpr:
+	case AST::NodeKind::NullExpr:
+		break;
+	default:
+		unsupported = true;
+		break;
+	}
+}
+
+} // namespace Phasor
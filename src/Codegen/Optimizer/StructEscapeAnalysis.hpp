@@ -0,0 +1,53 @@
+#pragma once
+#include "../../AST/AST.hpp"
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/// @brief The Phasor Programming Language and Runtime
+namespace Phasor
+{
+
+/**
+ * @class StructEscapeAnalysis
+ * @brief Finds struct variables that never escape and can be scalar-replaced
+ *
+ * A variable qualifies when it is declared exactly once, outside any branch,
+ * loop or function body, initialized with a literal of a declared struct, and
+ * only ever used after its declaration as the object of a field read or field
+ * assignment (`p.x`, `p.x = v`). Anything else - passing it to a call,
+ * returning, printing, reassigning, exporting - counts as an escape. Field
+ * accesses before the struct exists must fail as they do without the
+ * optimization, rather than read null fields.
+ *
+ * CodeGenerator stores such a struct as one variable per field, so the
+ * struct instance is never allocated.
+ */
+class StructEscapeAnalysis
+{
+  public:
+	/// @brief Non-escaping struct variables, name -> field names in declaration order
+	static std::unordered_map<std::string, std::vector<std::string>> findReplaceable(const AST::Program &program);
+
+  private:
+	/// @brief A struct-literal declaration that may be replaced
+	struct Candidate
+	{
+		std::string              structName;
+		std::vector<std::string> literalFields;
+	};
+
+	std::unordered_map<std::string, std::vector<std::string>> structFields;
+	std::unordered_map<std::string, int>                      declarations;
+	std::unordered_map<std::string, Candidate>                candidates;
+	std::unordered_map<std::string, std::vector<std::string>> fieldUses;
+	std::unordered_set<std::string>                           escaped;
+	int                                                       conditionalDepth = 0; ///< Branches, loops and function bodies entered
+	bool                                                      unsupported = false; ///< Hit a node the walk doesn't know, give up
+
+	void visit(const AST::Statement *stmt);
+	void visit(const AST::Expression *expr);
+};
+
+} // namespace Phasor
@@ -0,0 +1,301 @@
+#include "TreeShaker.hpp"
+#include <algorithm>
+
+namespace Phasor
+{
+
+bool TreeShaker::isJump(OpCode op)
+{
+	switch (op)
+	{
+	case OpCode::JUMP:
+	case OpCode::JUMP_IF_FALSE:
+	case OpCode::JUMP_IF_TRUE:
+	case OpCode::JUMP_BACK:
+		return true;
+	default:
+		return false;
+	}
+}
+
+int TreeShaker::constantOperand(OpCode op)
+{
+	switch (op)
+	{
+	case OpCode::PUSH_CONST:
+	case OpCode::CALL:
+	case OpCode::CALL_NATIVE:
+	case OpCode::IMPORT:
+	case OpCode::NEW_STRUCT:
+	case OpCode::GET_FIELD:
+	case OpCode::SET_FIELD:
+		return 1;
+	case OpCode::LOAD_CONST_R:
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+bool TreeShaker::isStructOp(OpCode op)
+{
+	return op == OpCode::NEW_STRUCT_INSTANCE_STATIC || op == OpCode::GET_FIELD_STATIC ||
+	       op == OpCode::SET_FIELD_STATIC;
+}
+
+i32 &TreeShaker::operand(Instruction &instr, int which)
+{
+	switch (which)
+	{
+	case 1:
+		return instr.operand1;
+	case 2:
+		return instr.operand2;
+	default:
+		return instr.operand3;
+	}
+}
+
+TreeShaker::Stats TreeShaker::shake(Bytecode &bytecode, const Options &options)
+{
+	Stats      stats;
+	const auto instrCount = static_cast<int>(bytecode.instructions.size());
+	const auto constCount = static_cast<int>(bytecode.constants.size());
+
+	// Function ranges: [entry - 1, jumpOverTarget), i.e. the JUMP over the body plus the body itself
+	struct Range
+	{
+		std::string name;
+		int         begin;
+		int         end;
+	};
+	std::vector<Range>       ranges;
+	std::vector<std::string> pinned; // functions whose body can't be delimited are always live
+	for (const auto &[name, entry] : bytecode.functionEntries)
+	{
+		int jumpIndex = entry - 1;
+		if (jumpIndex >= 0 && jumpIndex < instrCount && bytecode.instructions[jumpIndex].op == OpCode::JUMP &&
+		    bytecode.instructions[jumpIndex].operand1 > entry && bytecode.instructions[jumpIndex].operand1 <= instrCount)
+			ranges.push_back({name, jumpIndex, bytecode.instructions[jumpIndex].operand1});
+		else
+			pinned.push_back(name);
+	}
+
+	// Outer ranges first so nested functions end up owning their own instructions
+	std::sort(ranges.begin(), ranges.end(), [](const Range &a, const Range &b) {
+		return a.begin != b.begin ? a.begin < b.begin : a.end > b.end;
+	});
+
+	std::vector<int> owner(instrCount, -1);
+	for (int r = 0; r < static_cast<int>(ranges.size()); ++r)
+		for (int i = ranges[r].begin; i < ranges[r].end; ++i)
+			owner[i] = r;
+
+	std::unordered_map<std::string, int> rangeOf;
+	for (int r = 0; r < static_cast<int>(ranges.size()); ++r)
+		rangeOf[ranges[r].name] = r;
+
+	std::vector<std::vector<int>> owned(ranges.size() + 1); // slot 0 is top-level code
+	for (int i = 0; i < instrCount; ++i)
+		owned[owner[i] + 1].push_back(i);
+
+	// Imported modules resolve CALLs by name against this bytecode at runtime, so keep everything
+	bool keepAll = options.keepAllFunctions;
+	for (const auto &instr : bytecode.instructions)
+		if (instr.op == OpCode::IMPORT)
+			keepAll = true;
+
+	std::vector<bool> live(ranges.size(), keepAll);
+	std::vector<int>  worklist;
+	auto              markLive = [&](const std::string &name) {
+		auto it = rangeOf.find(name);
+		if (it != rangeOf.end() && !live[it->second])
+		{
+			live[it->second] = true;
+			worklist.push_back(it->second);
+		}
+	};
+
+	for (const auto &name : options.keepFunctions)
+		markLive(name);
+
+	auto scan = [&](int slot) {
+		for (int i : owned[slot])
+		{
+			Instruction &instr = bytecode.instructions[i];
+			int          which = constantOperand(instr.op);
+			if (which == 0)
+				continue;
+			int index = operand(instr, which);
+			if (index < 0 || index >= constCount || !bytecode.constants[index].isString())
+				continue;
+			// String constants matching a function name are treated as references too,
+			// which keeps names handed to reflective natives alive
+			markLive(bytecode.constants[index].asString());
+		}
+	};
+
+	if (!keepAll)
+	{
+		scan(0);
+		while (!worklist.empty())
+		{
+			int r = worklist.back();
+			worklist.pop_back();
+			scan(r + 1);
+		}
+	}
+
+	std::vector<bool> keepInstr(instrCount);
+	for (int i = 0; i < instrCount; ++i)
+		keepInstr[i] = owner[i] == -1 || live[owner[i]];
+
+	// newIndex[i] = number of surviving instructions before i, so a jump to a
+	// removed instruction lands on the next survivor
+	std::vector<int> newIndex(instrCount + 1, 0);
+	for (int i = 0; i < instrCount; ++i)
+		newIndex[i + 1] = newIndex[i] + (keepInstr[i] ? 1 : 0);
+
+	// Structs referenced by live code
+	const auto        structCount = static_cast<int>(bytecode.structs.size());
+	std::vector<bool> keepStruct(structCount, false);
+	for (int i = 0; i < instrCount; ++i)
+	{
+		const Instruction &instr = bytecode.instructions[i];
+		if (keepInstr[i] && isStructOp(instr.op) && instr.operand1 >= 0 && instr.operand1 < structCount)
+			keepStruct[instr.operand1] = true;
+	}
+
+	// Constants referenced by live code or by a live struct's default values
+	std::vector<bool> keepConst(constCount, false);
+	for (int i = 0; i < instrCount; ++i)
+	{
+		if (!keepInstr[i])
+			continue;
+		int which = constantOperand(bytecode.instructions[i].op);
+		if (which == 0)
+			continue;
+		int index = operand(bytecode.instructions[i], which);
+		if (index >= 0 && index < constCount)
+			keepConst[index] = true;
+	}
+	for (int s = 0; s < structCount; ++s)
+	{
+		if (!keepStruct[s])
+			continue;
+		const StructInfo &info = bytecode.structs[s];
+		for (int c = info.firstConstIndex; c < info.firstConstIndex + info.fieldCount; ++c)
+			if (c >= 0 && c < constCount)
+				keepConst[c] = true;
+	}
+
+	std::vector<int>   constRemap(constCount, -1);
+	std::vector<Value> constants;
+	for (int c = 0; c < constCount; ++c)
+	{
+		if (!keepConst[c])
+			continue;
+		constRemap[c] = static_cast<int>(constants.size());
+		constants.push_back(std::move(bytecode.constants[c]));
+	}
+
+	std::vector<int>        structRemap(structCount, -1);
+	std::vector<StructInfo> structs;
+	for (int s = 0; s < structCount; ++s)
+	{
+		if (!keepStruct[s])
+			continue;
+		StructInfo info = std::move(bytecode.structs[s]);
+		if (info.fieldCount > 0 && info.firstConstIndex >= 0 && info.firstConstIndex < constCount)
+			info.firstConstIndex = constRemap[info.firstConstIndex];
+		else
+			info.firstConstIndex = static_cast<int>(constants.size());
+		structRemap[s] = static_cast<int>(structs.size());
+		structs.push_back(std::move(info));
+	}
+
+	std::vector<Instruction> instructions;
+	instructions.reserve(newIndex[instrCount]);
+	for (int i = 0; i < instrCount; ++i)
+	{
+		if (!keepInstr[i])
+			continue;
+		Instruction instr = bytecode.instructions[i];
+		if (isJump(instr.op) && instr.operand1 >= 0 && instr.operand1 <= instrCount)
+			instr.operand1 = newIndex[instr.operand1];
+		if (int which = constantOperand(instr.op); which != 0)
+		{
+			i32 &index = operand(instr, which);
+			if (index >= 0 && index < constCount)
+				index = constRemap[index];
+		}
+		if (isStructOp(instr.op) && instr.operand1 >= 0 && instr.operand1 < structCount)
+			instr.operand1 = structRemap[instr.operand1];
+		instructions.push_back(instr);
+	}
+
+	// Switch tables hold jump targets too
+	auto remapTarget = [&](int &target) {
+		if (target >= 0 && target <= instrCount)
+			target = newIndex[target];
+	};
+	for (auto &table : bytecode.switchTables)
+	{
+		remapTarget(table.defaultTarget);
+		for (int &target : table.denseTargets)
+			remapTarget(target);
+		for (auto &[value, target] : table.cases)
+			remapTarget(target);
+		table.buildIndex();
+	}
+
+	// Function tables
+	for (int r = 0; r < static_cast<int>(ranges.size()); ++r)
+	{
+		const std::string &name = ranges[r].name;
+		if (live[r])
+		{
+			bytecode.functionEntries[name] = newIndex[bytecode.functionEntries[name]];
+			continue;
+		}
+		bytecode.functionEntries.erase(name);
+		bytecode.functionParamCounts.erase(name);
+		bytecode.functionParamTypeNames.erase(name);
+		bytecode.functionParamArrayDims.erase(name);
+		bytecode.functionReturnTypeNames.erase(name);
+		++stats.functionsRemoved;
+	}
+	for (const auto &name : pinned)
+		bytecode.functionEntries[name] = newIndex[std::min(bytecode.functionEntries[name], instrCount)];
+
+	// Struct and string lookup tables
+	bytecode.structEntries.clear();
+	for (int s = 0; s < static_cast<int>(structs.size()); ++s)
+		bytecode.structEntries.emplace(structs[s].name, s);
+
+	auto remapCache = [&](auto &cache) {
+		for (auto it = cache.begin(); it != cache.end();)
+		{
+			if (it->second >= 0 && it->second < constCount && constRemap[it->second] != -1)
+			{
+				it->second = constRemap[it->second];
+				++it;
+			}
+			else
+				it = cache.erase(it);
+		}
+	};
+	remapCache(bytecode.stringConstantCache);
+	remapCache(bytecode.scalarConstantCache);
+
+	stats.instructionsRemoved = bytecode.instructions.size() - instructions.size();
+	stats.structsRemoved = bytecode.structs.size() - structs.size();
+	stats.constantsRemoved = bytecode.constants.size() - constants.size();
+
+	bytecode.instructions = std::move(instructions);
+	bytecode.constants = std::move(constants);
+	bytecode.structs = std::move(structs);
+	return stats;
+}
+
+} // namespace Phasor
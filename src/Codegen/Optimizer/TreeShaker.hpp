@@ -0,0 +1,61 @@
+#pragma once
+#include "../CodeGen.hpp"
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include <phsint.hpp>
+
+/// @brief The Phasor Programming Language and Runtime
+namespace Phasor
+{
+
+/**
+ * @class TreeShaker
+ * @brief Whole-program dead function, struct and constant elimination
+ *
+ * Runs over a fully generated Bytecode (after CodeGenerator::generate) and
+ * removes everything that cannot be reached from top-level code:
+ *  - function bodies that are never CALLed (including the JUMP over them)
+ *  - struct descriptors never referenced by the *_STATIC struct opcodes
+ *  - constants no live instruction or struct default range points at
+ *
+ * Surviving instructions, constants and structs keep their relative order,
+ * and every jump target, constant index and struct index is renumbered.
+ */
+class TreeShaker
+{
+  public:
+	/// @brief Tuning knobs for a shake
+	struct Options
+	{
+		std::unordered_set<std::string> keepFunctions;       ///< Extra roots, e.g. entry points called by a host via runFunction
+		bool                            keepAllFunctions = false; ///< Only compact structs and constants
+	};
+
+	/// @brief What a shake removed
+	struct Stats
+	{
+		size_t functionsRemoved = 0;
+		size_t instructionsRemoved = 0;
+		size_t structsRemoved = 0;
+		size_t constantsRemoved = 0;
+	};
+
+	/// @brief Shake bytecode in place
+	static Stats shake(Bytecode &bytecode, const Options &options);
+
+	// Operand classification, shared with Linker
+
+	/// @brief Whether operand1 of the instruction is a jump target
+	static bool isJump(OpCode op);
+
+	/// @brief Which operand (1-3) holds a constant pool index, or 0 for none
+	static int constantOperand(OpCode op);
+
+	/// @brief Whether operand1 of the instruction is a struct index
+	static bool isStructOp(OpCode op);
+
+	static i32 &operand(Instruction &instr, int which);
+};
+
+} // namespace Phasor
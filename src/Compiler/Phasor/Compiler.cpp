@@ -4,7 +4,12 @@
 #include "../../Codegen/Bytecode/BytecodeSerializer.hpp"
 #include "../../Codegen/CodeGen.hpp"
 #include "../../Codegen/IR/PhasorIR.hpp"
+#include "../../Codegen/Optimizer/TreeShaker.hpp"
+#include "../../Frontend/Phasor/Frontend.hpp"
+#include "../../Runtime/Stdlib/StdLib.hpp"
 #include <version.h>
+#include <algorithm>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <sstream>
@@ -21,126 +26,170 @@ Compiler::Compiler(int argc, char *argv[])
 
 int Compiler::run()
 {
-	if (m_args.inputFile.empty())
+	if (m_args.inputFiles.empty())
 	{
 		std::println(std::cerr, "Error: No input file provided\n");
 		return 1;
 	}
 
-	if (m_args.irMode)
+	if (Batch::isBatch(m_args.inputFiles))
 	{
-		return compileToIR();
+		return runBatch();
 	}
 
-	return compileToBytecode();
+	Batch::Job job;
+	job.input = m_args.inputFiles.front();
+	job.output = m_args.outputFile;
+	if (job.output.empty())
+	{
+		job.output = job.input;
+		job.output.replace_extension(m_args.irMode ? ".phir" : ".phsb");
+	}
+
+	compileFile(job);
+	std::cout << job.out.str();
+	std::cerr << job.err.str();
+	return job.ok ? 0 : 1;
 }
 
-int Compiler::compileToBytecode()
+int Compiler::runBatch()
 {
-	if (std::filesystem::path(m_args.inputFile).extension() == ".phsb")
+	std::vector<Batch::Source> sources;
+	try
 	{
-		std::println(std::cerr, "Error: Cannot compile a bytecode file (use phasordecomp)");
+		sources = Batch::collect(m_args.inputFiles, ".phs");
+	}
+	catch (const std::exception &e)
+	{
+		std::println(std::cerr, "Error: {}", e.what());
 		return 1;
 	}
 
-	std::ifstream file(m_args.inputFile);
-	if (!file.is_open())
+	if (sources.empty())
 	{
-		println(std::cerr, "Could not open file: {}", m_args.inputFile);
+		std::println(std::cerr, "Error: No .phs files found");
 		return 1;
 	}
 
-	std::stringstream buffer;
-	buffer << file.rdbuf();
-	std::string source = buffer.str();
-
-	try
+	std::vector<Batch::Job> jobs(sources.size());
+	for (size_t i = 0; i < sources.size(); ++i)
 	{
-		Lexer         lexer(source);
-		Parser        parser(lexer.tokenize(), m_args.inputFile);
-		auto          program = parser.parse();
-		CodeGenerator codegen;
-		auto          bytecode = codegen.generate(*program);
-
-		if (m_args.outputFile.empty())
-		{
-			m_args.outputFile = m_args.inputFile;
-			std::filesystem::path path(m_args.outputFile);
-			path.replace_extension(".phsb");
-			m_args.outputFile = path.string();
-		}
-
-		BytecodeSerializer serializer;
-		if (!serializer.saveToFile(bytecode, m_args.outputFile))
-		{
-			std::println(std::cerr, "Failed to save bytecode to: {}", m_args.outputFile);
-			return 1;
-		}
-
-		std::println("Compiled successfully: {} -> {}", m_args.inputFile, m_args.outputFile);
-		return 0;
+		jobs[i].input = sources[i].path;
+		jobs[i].output = sources[i].output(m_args.outputFile, m_args.irMode ? ".phir" : ".phsb");
 	}
-	catch (const std::exception &e)
+
+	if (!Batch::uniqueOutputs(jobs, std::cerr))
 	{
-		std::println(std::cerr, "Compilation Error: {}", e.what());
 		return 1;
 	}
+
+	unsigned threads = m_args.jobs != 0 ? m_args.jobs : Batch::defaultThreads();
+	auto     wall = Batch::run(jobs, threads, [this](Batch::Job &job) { compileFile(job); });
+	return Batch::report(jobs, threads, wall);
 }
 
-int Compiler::compileToIR()
+void Compiler::compileFile(Batch::Job &job) const
 {
-	if (std::filesystem::path(m_args.inputFile).extension() == ".phir")
+	if (!m_args.irMode && job.input.extension() == ".phsb")
 	{
-		std::println(std::cerr, "Error: Cannot compile a Phasor IR file (use phasorasm)");
-		return 1;
+		std::println(job.err, "Error: Cannot compile a bytecode file (use phasordecomp)");
+		return;
 	}
-
-	std::ifstream file(m_args.inputFile);
-	if (!file.is_open())
+	if (m_args.irMode && job.input.extension() == ".phir")
 	{
-		std::println(std::cerr, "Could not open file: {}\n", m_args.inputFile);
-		return 1;
+		std::println(job.err, "Error: Cannot compile a Phasor IR file (use phasorasm)");
+		return;
 	}
 
-	std::stringstream buffer;
-	buffer << file.rdbuf();
-	std::string source = buffer.str();
+	std::string source;
+	{
+		auto          timer = job.time("read");
+		std::ifstream file(job.input);
+		if (!file.is_open())
+		{
+			std::println(job.err, "Could not open file: {}", job.input.string());
+			return;
+		}
+
+		std::stringstream buffer;
+		buffer << file.rdbuf();
+		source = buffer.str();
+	}
 
 	try
 	{
-		Lexer         lexer(source);
-		Parser        parser(lexer.tokenize(), m_args.inputFile);
-		auto          program = parser.parse();
-		CodeGenerator codegen;
-		auto          bytecode = codegen.generate(*program);
+		std::vector<Token> tokens;
+		{
+			auto timer = job.time("lex");
+			tokens = Lexer(source).tokenize();
+		}
+
+		std::unique_ptr<AST::Program> program;
+		{
+			auto   timer = job.time("parse");
+			Parser parser(std::move(tokens), job.input);
+			parser.setDiagnostics(job.err);
+			program = parser.parse();
+		}
+
+		Bytecode bytecode;
+		{
+			auto          timer = job.time("codegen");
+			CodeGenerator codegen;
+			codegen.setPureCallEvaluator(StdLib::pureCallEvaluator());
+			bytecode = codegen.generate(*program);
+		}
+
+		{
+			auto timer = job.time("link");
+			bytecode = Frontend::linkModules(bytecode, job.input);
+		}
 
-		if (m_args.outputFile.empty())
+		if (m_args.strip && !m_args.irMode)
 		{
-			m_args.outputFile = m_args.inputFile;
-			std::filesystem::path path(m_args.outputFile);
-			path.replace_extension(".phir");
-			m_args.outputFile = path.string();
+			auto timer = job.time("strip");
+			auto stats = TreeShaker::shake(bytecode, {.keepFunctions = m_args.keepFunctions});
+			if (m_args.verbose)
+				std::println(job.out, "Stripped {} functions, {} structs, {} constants, {} instructions",
+				             stats.functionsRemoved, stats.structsRemoved, stats.constantsRemoved,
+				             stats.instructionsRemoved);
 		}
 
-		if (!PhasorIR::saveToFile(bytecode, m_args.outputFile))
+		auto timer = job.time("write");
+		if (job.output.has_parent_path())
 		{
-			std::println(std::cerr, "Failed to save Phasor IR to: {}", m_args.outputFile);
-			return 1;
+			std::filesystem::create_directories(job.output.parent_path());
 		}
 
-		std::println("Compiled successfully to IR: {} -> {}", m_args.inputFile, m_args.outputFile);
-		return 0;
+		if (m_args.irMode)
+		{
+			if (!PhasorIR::saveToFile(bytecode, job.output))
+			{
+				std::println(job.err, "Failed to save Phasor IR to: {}", job.output.string());
+				return;
+			}
+			std::println(job.out, "Compiled successfully to IR: {} -> {}", job.input.string(), job.output.string());
+		}
+		else
+		{
+			BytecodeSerializer serializer({.compactInstructions = m_args.compact});
+			if (!serializer.saveToFile(bytecode, job.output))
+			{
+				std::println(job.err, "Failed to save bytecode to: {}", job.output.string());
+				return;
+			}
+			std::println(job.out, "Compiled successfully: {} -> {}", job.input.string(), job.output.string());
+		}
+		job.ok = true;
 	}
 	catch (const std::exception &e)
 	{
-		std::println(std::cerr, "Compilation Error: {}", e.what());
-		return 1;
+		std::println(job.err, "Compilation Error: {}", e.what());
 	}
 }
 
 void Compiler::parseArguments(int argc, char *argv[])
 {
-	int defaultArgLocation = 1;
 	for (int i = 1; i < argc; i++)
 	{
 		std::string arg = argv[i];
@@ -165,6 +214,38 @@ void Compiler::parseArguments(int argc, char *argv[])
 		{
 			m_args.irMode = true;
 		}
+		else if (arg == "--strip")
+		{
+			m_args.strip = true;
+		}
+		else if (arg == "--compact")
+		{
+			m_args.compact = true;
+		}
+		else if (arg == "-k" || arg == "--keep")
+		{
+			if (i + 1 < argc)
+			{
+				m_args.keepFunctions.insert(argv[++i]);
+			}
+			else
+			{
+				std::print(std::cerr, "Error: {} requires an argument", arg);
+				exit(1);
+			}
+		}
+		else if (arg == "-j" || arg == "--jobs")
+		{
+			if (i + 1 < argc)
+			{
+				m_args.jobs = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+			}
+			else
+			{
+				std::print(std::cerr, "Error: {} requires an argument", arg);
+				exit(1);
+			}
+		}
 		else if (arg == "-h" || arg == "--help")
 		{
 			showHelp(argv[0]);
@@ -172,13 +253,9 @@ void Compiler::parseArguments(int argc, char *argv[])
 		}
 		else
 		{
-			defaultArgLocation = i;
-			m_args.inputFile = arg;
-			break; // Stop parsing after finding the input file
+			m_args.inputFiles.emplace_back(arg);
 		}
 	}
-	m_args.scriptArgv = argv + defaultArgLocation;
-	m_args.scriptArgc = argc - defaultArgLocation;
 }
 
 void Compiler::showHelp(const std::string &programName)
@@ -188,12 +265,17 @@ void Compiler::showHelp(const std::string &programName)
 	std::println("Phasor Compiler v{}\n"
 	             "(C) 2026 Daniel McGuire - Licensed under Apache 2.0\n\n"
 	             "Usage:\n"
-	             "  {} [options] <file.phs>\n\n"
-	             "Options:\n  -o, --output FILE   Specify output file\n"
+	             "  {} [options] <file.phs>\n"
+	             "  {} [options] <file.phs|dir>...\n\n"
+	             "Options:\n  -o, --output FILE   Specify output file (output directory for several inputs)\n"
 	             "  -i, --ir            Compile to IR format (.phir) instead of bytecode\n"
+	             "  -j, --jobs N        Compile several inputs on N threads (default: one per core)\n"
+	             "      --strip         Remove functions, structs and constants top-level code never reaches\n"
+	             "  -k, --keep FUNC     With --strip, keep FUNC even if unreferenced (e.g. called from a host)\n"
+	             "      --compact       Varint-encode instructions: smaller, but decoded on load instead of mapped\n"
 	             "  -v, --verbose       Enable verbose output\n"
 	             "  -h, --help          Show this help message",
-	             PHASOR_VERSION_STRING, filename);
+	             PHASOR_VERSION_STRING, filename, filename);
 }
 
 } // namespace Phasor
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "../Shared/Batch.hpp"
+#include <filesystem>
 #include <string>
+#include <unordered_set>
 #include <vector>
 /// @brief The Phasor Programming Language and Runtime
 namespace Phasor
@@ -11,6 +14,7 @@ namespace Phasor
  * @brief CLI wrapper for bytecode generation from Phasor source
  *
  * Compiles Phasor source files to bytecode using the methods provided.
+ * Several files, or a directory of them, are compiled in parallel as a batch.
  */
 class Compiler
 {
@@ -21,19 +25,24 @@ class Compiler
   private:
 	struct Args
 	{
-		std::string inputFile;
-		std::string outputFile;
-		bool        verbose = false;
-		bool        irMode = false;
-		int         scriptArgc = 0;
-		char      **scriptArgv = nullptr;
+		std::vector<std::filesystem::path> inputFiles;
+		std::string                        outputFile; ///< Output file, or output directory in batch mode
+		bool                               verbose = false;
+		bool                               irMode = false;
+		bool                               strip = false; ///< Tree-shake before writing; drops functions only hosts call
+		bool                               compact = false; ///< Varint-encoded instructions
+		unsigned                           jobs = 0; ///< Batch worker count, 0 for one per hardware thread
+		std::unordered_set<std::string>    keepFunctions;
 	} m_args;
 
 	void        parseArguments(int argc, char *argv[]);
 	static void showHelp(const std::string &programName);
 
-	int compileToBytecode();
-	int compileToIR();
+	/// @brief Compiles every file given and prints a timing summary
+	int runBatch();
+
+	/// @brief Compiles job.input to job.output, bytecode or IR depending on the mode
+	void compileFile(Batch::Job &job) const;
 };
 
 } // namespace Phasor
@@ -4,7 +4,12 @@
 #include "../../Codegen/CodeGen.hpp"
 #include "../../Codegen/Cpp/CppCodeGenerator.hpp"
 #include "../../Codegen/IR/PhasorIR.hpp"
+#include "../../Codegen/Optimizer/TreeShaker.hpp"
+#include "../../Frontend/Phasor/Frontend.hpp"
+#include "../../Runtime/Stdlib/StdLib.hpp"
 #include <version.h>
+#include <algorithm>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <print>
@@ -26,7 +31,7 @@ int CppCompiler::run()
 		return 0;
 	}
 
-	if (m_args.inputFile.empty() && !(m_args.headerOnly || m_args.generateOnly))
+	if (m_args.inputFiles.empty() && !(m_args.headerOnly || m_args.generateOnly))
 	{
 		std::println(std::cerr, "Error: No input file provided\nUse --help for usage information");
 		return 1;
@@ -39,89 +44,176 @@ int CppCompiler::run()
 		m_args.mainFile = "/usr/local/share/phasor/dev/nativestub.cpp";
 #endif
 
-	if (m_args.moduleName.empty())
-	{
-		std::filesystem::path inputPath(m_args.inputFile);
-		m_args.moduleName = inputPath.stem().string();
-	}
+	if (Batch::isBatch(m_args.inputFiles))
+		return runBatch();
+
+	Target target;
+	if (!m_args.inputFiles.empty())
+		target.inputFile = m_args.inputFiles.front();
+
+	target.moduleName = m_args.moduleName;
+	if (target.moduleName.empty())
+		target.moduleName = target.inputFile.stem().string();
+	target.intermediate = target.moduleName;
 
 	// Default output file if not specified
-	if (m_args.outputFile.empty())
+	target.outputFile = m_args.outputFile;
+	if (target.outputFile.empty())
 	{
 #ifdef _WIN32
-		m_args.outputFile = m_args.moduleName + ".exe";
+		target.outputFile = target.moduleName + ".exe";
 #else
-		m_args.outputFile = m_args.moduleName;
+		target.outputFile = target.moduleName;
 #endif
 	}
 
-	if (m_args.verbose)
+	// A single build reports as it goes, the native compiler can take a while
+	Batch::Job job;
+	return build(target, job, std::cout, std::cerr) ? 0 : 1;
+}
+
+int CppCompiler::runBatch()
+{
+	if (!m_args.moduleName.empty())
 	{
-		std::println("Input file: {}\nOutput file: {}", m_args.inputFile.string(), m_args.outputFile.string());
-		if (!m_args.moduleName.empty())
-			std::println("Module name: {}", m_args.moduleName);
+		std::println(std::cerr, "Error: --module cannot be used with several inputs");
+		return 1;
 	}
 
+	std::vector<Batch::Source> sources;
+	try
+	{
+		sources = Batch::collect(m_args.inputFiles, ".phs");
+	}
+	catch (const std::exception &e)
+	{
+		std::println(std::cerr, "Error: {}", e.what());
+		return 1;
+	}
+
+	if (sources.empty())
+	{
+		std::println(std::cerr, "Error: No .phs files found");
+		return 1;
+	}
+
+	std::string extension;
 	if (m_args.headerOnly)
+		extension = ".h";
+	else if (m_args.generateOnly)
+		extension = ".cpp";
+	else if (m_args.objectOnly)
+		extension = ".obj";
+#ifdef _WIN32
+	else
+		extension = ".exe";
+#endif
+
+	// Each target gets its own module name and intermediates next to its output,
+	// so files with the same name in different directories don't collide
+	std::vector<Target>     targets(sources.size());
+	std::vector<Batch::Job> jobs(sources.size());
+	for (size_t i = 0; i < sources.size(); ++i)
 	{
-		generateHeader(m_args.inputFile, m_args.outputFile);
-		return 0;
+		targets[i].inputFile = sources[i].path;
+		targets[i].outputFile = sources[i].output(m_args.outputFile, extension);
+		targets[i].moduleName = sources[i].path.stem().string();
+		targets[i].intermediate = targets[i].outputFile.parent_path() / targets[i].moduleName;
+		jobs[i].input = targets[i].inputFile;
+		jobs[i].output = targets[i].outputFile;
 	}
 
+	if (!Batch::uniqueOutputs(jobs, std::cerr))
+		return 1;
+
+	unsigned threads = m_args.jobs != 0 ? m_args.jobs : Batch::defaultThreads();
+	auto     wall = Batch::run(jobs, threads, [&](Batch::Job &job) {
+		job.ok = build(targets[static_cast<size_t>(&job - jobs.data())], job, job.out, job.err);
+	});
+	return Batch::report(jobs, threads, wall);
+}
+
+bool CppCompiler::build(const Target &target, Batch::Job &job, std::ostream &out, std::ostream &err) const
+{
+	auto intermediate = [&](const char *extension) {
+		std::filesystem::path path = target.intermediate;
+		path += extension;
+		return path;
+	};
+
+	if (m_args.verbose)
+	{
+		std::println(out, "Input file: {}\nOutput file: {}", target.inputFile.string(), target.outputFile.string());
+		if (!target.moduleName.empty())
+			std::println(out, "Module name: {}", target.moduleName);
+	}
+
+	if (target.outputFile.has_parent_path())
+		std::filesystem::create_directories(target.outputFile.parent_path());
+
+	if (m_args.headerOnly)
+		return generateHeader(target.inputFile, target.outputFile, target.moduleName, job, out, err);
+
 	if (m_args.generateOnly)
 	{
-		generateHeader(m_args.inputFile, m_args.moduleName + ".h");
-		generateSource(m_args.moduleName + ".h", m_args.outputFile);
-		return 0;
+		return generateHeader(target.inputFile, intermediate(".h"), target.moduleName, job, out, err) &&
+		       generateSource(intermediate(".h"), target.outputFile, err);
 	}
 
 	if (m_args.objectOnly)
 	{
-		generateHeader(m_args.inputFile, m_args.moduleName + ".h");
-		generateSource(m_args.moduleName + ".h", m_args.moduleName + ".cpp");
-		compileSource(m_args.moduleName + ".cpp", m_args.outputFile);
-		return 0;
+		if (!generateHeader(target.inputFile, intermediate(".h"), target.moduleName, job, out, err) ||
+		    !generateSource(intermediate(".h"), intermediate(".cpp"), err))
+			return false;
+		auto timer = job.time("compile");
+		return compileSource(intermediate(".cpp"), target.outputFile, err);
 	}
 
-	std::println("Generating wrapper...");
+	std::println(out, "Generating wrapper...");
 
-	if (generateHeader(m_args.inputFile, m_args.moduleName + ".h"))
-		std::println("{} -> {}.h", m_args.inputFile.string(), m_args.moduleName);
+	if (generateHeader(target.inputFile, intermediate(".h"), target.moduleName, job, out, err))
+		std::println(out, "{} -> {}", target.inputFile.string(), intermediate(".h").string());
 	else
 	{
-		std::println(std::cerr, "Error: Could not generate header file");
-		return 1;
+		std::println(err, "Error: Could not generate header file");
+		return false;
 	}
 
-	if (generateSource(m_args.mainFile, m_args.moduleName + ".cpp"))
-		std::println("{} -> {}.cpp\n", m_args.mainFile.filename().string(), m_args.moduleName);
+	if (generateSource(m_args.mainFile, intermediate(".cpp"), err))
+		std::println(out, "{} -> {}\n", m_args.mainFile.filename().string(), intermediate(".cpp").string());
 	else
 	{
-		std::println(std::cerr, "Could not generate source file");
-		return 1;
+		std::println(err, "Could not generate source file");
+		return false;
 	}
 
-	std::println("Compiling...");
-	std::print("[COMPILER] ");
-	if (compileSource(m_args.moduleName + ".cpp", m_args.moduleName + ".obj"))
-		std::println("{}.cpp -> {}.obj\n", m_args.moduleName, m_args.moduleName);
-	else
+	std::println(out, "Compiling...");
+	std::print(out, "[COMPILER] ");
+	out.flush();
 	{
-		std::println(std::cerr, "Could not compile program");
-		return 1;
+		auto timer = job.time("compile");
+		if (!compileSource(intermediate(".cpp"), intermediate(".obj"), err))
+		{
+			std::println(err, "Could not compile program");
+			return false;
+		}
 	}
+	std::println(out, "{} -> {}\n", intermediate(".cpp").string(), intermediate(".obj").string());
 
-	std::println("Linking...");
-	std::print("[LINKER] ");
-	if (linkObject(m_args.moduleName + ".obj", m_args.outputFile))
-		std::println("{}.obj -> {}", m_args.moduleName, m_args.outputFile.string());
-	else
+	std::println(out, "Linking...");
+	std::print(out, "[LINKER] ");
+	out.flush();
 	{
-		std::println(std::cerr, "Could not link program");
-		return 1;
+		auto timer = job.time("native link");
+		if (!linkObject(intermediate(".obj"), target.outputFile, err))
+		{
+			std::println(err, "Could not link program");
+			return false;
+		}
 	}
+	std::println(out, "{} -> {}", intermediate(".obj").string(), target.outputFile.string());
 
-	return 0;
+	return true;
 }
 
 bool CppCompiler::parseArguments(int argc, char *argv[])
@@ -215,6 +307,40 @@ bool CppCompiler::parseArguments(int argc, char *argv[])
 				return true;
 			}
 		}
+		else if (arg == "-k" || arg == "--keep")
+		{
+			if (i + 1 < argc)
+			{
+				m_args.keepFunctions.insert(argv[++i]);
+			}
+			else
+			{
+				std::println(std::cerr, "Error: {} requires an argument", arg);
+				m_args.showHelp = true;
+				return true;
+			}
+		}
+		else if (arg == "--strip")
+		{
+			m_args.strip = true;
+		}
+		else if (arg == "-a" || arg == "--aot")
+		{
+			m_args.aot = true;
+		}
+		else if (arg == "-j" || arg == "--jobs")
+		{
+			if (i + 1 < argc)
+			{
+				m_args.jobs = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+			}
+			else
+			{
+				std::println(std::cerr, "Error: {} requires an argument", arg);
+				m_args.showHelp = true;
+				return true;
+			}
+		}
 		else if (arg == "-s" || arg == "--source")
 		{
 			m_args.mainFile = argv[++i];
@@ -227,15 +353,8 @@ bool CppCompiler::parseArguments(int argc, char *argv[])
 		}
 		else
 		{
-			// First non-option argument is the input file
-			if (m_args.inputFile.empty())
-				m_args.inputFile = arg;
-			else
-			{
-				std::println(std::cerr, "Error: Multiple input files specified");
-				m_args.showHelp = true;
-				return true;
-			}
+			// Several inputs, or a directory, build as a batch
+			m_args.inputFiles.emplace_back(arg);
 		}
 	}
 	return false;
@@ -246,28 +365,38 @@ bool CppCompiler::showHelp(const std::string &programName)
 	std::println("Phasor C++ Bytecode Embedder v{}\n"
 	             "(C) 2026 Daniel McGuire - Licensed under Apache 2.0\n\n"
 	             "Usage:\n"
-	             "  {} [options] <input.phs>\n\n"
+	             "  {} [options] <input.phs>\n"
+	             "  {} [options] <input.phs|dir>...\n\n"
 	             "Options:\n"
 	             "  -c, --compiler <name>   Compiler to use (default: g++)\n"
 	             "  -l, --linker <name>     Linker to use (default: g++)\n"
 	             "  -s, --source <name>     The source file to compile with\n"
-	             "  -o, --output <file>   Output file\n"
+	             "  -o, --output <file>   Output file (output directory for several inputs)\n"
 	             "  -m, --module <name>   Module name for generated code (default: input filename)\n"
 	             "  -H, --header-only     Generate header file only\n"
 	             "  -g, --generate-only   Generate source file only\n"
 	             "  -O, --object-only     Generate and compile to object only\n"
+	             "      --strip           Remove functions, structs and constants top-level code never reaches\n"
+	             "  -k, --keep <func>     With --strip, keep an unreferenced function (e.g. one called via runFunction)\n"
+	             "  -a, --aot             Translate the program to C++ instead of embedding it for the interpreter\n"
+	             "  -j, --jobs <n>        Build several inputs on n threads (default: one per core)\n"
 	             "  -v, --verbose         Enable verbose output\n"
 	             "  -h, --help            Show this help message\n"
 	             "Example:\n"
 	             "  {} program.phs -o program.exe -c clang++ -l lld\n"
 	             "  {} -O program.phs -o program.obj -c clang++\n"
 	             "  {} -H program.phs -o program.hpp\n"
-	             "  {} -g program.phs -o program.cpp",
-	             PHASOR_VERSION_STRING, programName, programName, programName, programName, programName);
+	             "  {} -g program.phs -o program.cpp\n"
+	             "  {} -a program.phs -o program -c g++\n"
+	             "  {} -H -j 8 scripts/ -o include/",
+	             PHASOR_VERSION_STRING, programName, programName, programName, programName, programName, programName,
+	             programName, programName);
 	return true;
 }
 
-bool CppCompiler::generateHeader(const std::filesystem::path &sourcePath, const std::filesystem::path &outputPath)
+bool CppCompiler::generateHeader(const std::filesystem::path &sourcePath, const std::filesystem::path &outputPath,
+                                 const std::string &moduleName, Batch::Job &job, std::ostream &out,
+                                 std::ostream &err) const
 {
 	try
 	{
@@ -281,12 +410,12 @@ bool CppCompiler::generateHeader(const std::filesystem::path &sourcePath, const
 		{
 			// Read source file
 			if (m_args.verbose)
-				std::println("Reading source file...");
+				std::println(out, "Reading source file...");
 
 			std::ifstream file(sourcePath);
 			if (!file.is_open())
 			{
-				std::println(std::cerr, "Error: Could not open input file: {}", sourcePath.string());
+				std::println(err, "Error: Could not open input file: {}", sourcePath.string());
 				return false;
 			}
 
@@ -297,35 +426,68 @@ bool CppCompiler::generateHeader(const std::filesystem::path &sourcePath, const
 
 			// Lex
 			if (m_args.verbose)
-				std::println("Lexing...");
+				std::println(out, "Lexing...");
 
-			Lexer lexer(source);
-			auto  tokens = lexer.tokenize();
+			std::vector<Token> tokens;
+			{
+				auto timer = job.time("lex");
+				tokens = Lexer(source).tokenize();
+			}
 
 			// Parse
 			if (m_args.verbose)
-				std::println("Parsing...");
+				std::println(out, "Parsing...");
 
-			Parser parser(tokens, sourcePath);
-			auto   program = parser.parse();
+			std::unique_ptr<AST::Program> program;
+			{
+				auto   timer = job.time("parse");
+				Parser parser(std::move(tokens), sourcePath);
+				parser.setDiagnostics(err);
+				program = parser.parse();
+			}
 
 			// Generate bytecode
 			if (m_args.verbose)
-				std::println("Generating bytecode...");
+				std::println(out, "Generating bytecode...");
+
+			{
+				auto          timer = job.time("codegen");
+				CodeGenerator codegen;
+				codegen.setPureCallEvaluator(StdLib::pureCallEvaluator());
+				bytecode = codegen.generate(*program);
+			}
+
+			// Link imported modules into the image
+			if (m_args.verbose)
+				std::println(out, "Linking...");
 
-			CodeGenerator codegen;
-			bytecode = codegen.generate(*program);
+			auto timer = job.time("link");
+			bytecode = Frontend::linkModules(bytecode, sourcePath);
 		}
 
 		if (bytecode.instructions.empty())
 		{
-			std::println(std::cerr, "Error: No instructions generated");
+			std::println(err, "Error: No instructions generated");
 			return false;
 		}
 
+		if (m_args.strip)
+		{
+			if (m_args.verbose)
+				std::println(out, "Stripping unreferenced code...");
+
+			auto timer = job.time("strip");
+			auto stats = TreeShaker::shake(bytecode, {.keepFunctions = m_args.keepFunctions});
+			if (m_args.verbose)
+				std::println(out, "  Removed {} functions, {} structs, {} constants, {} instructions",
+				             stats.functionsRemoved, stats.structsRemoved, stats.constantsRemoved,
+				             stats.instructionsRemoved);
+		}
+
 		if (m_args.verbose)
 		{
-			std::println("Bytecode statistics:\n"
+			std::println(out,
+			             "Bytecode statistics:\n"
 			             "  Instructions: {}\n"
 			             "  Constants: {}\n"
 			             "  Variables: {}\n"
@@ -336,34 +498,43 @@ bool CppCompiler::generateHeader(const std::filesystem::path &sourcePath, const
 
 		// Generate C++ code
 		if (m_args.verbose)
-			std::println("Generating C++ code...");
+			std::println(out, "Generating C++ code...");
 
-		CppCodeGenerator cppGen;
-		bool             success = cppGen.generate(bytecode, outputPath, m_args.moduleName);
+		auto             timer = job.time("emit");
+		CppCodeGenerator cppGen({.aot = m_args.aot});
+		bool             success = cppGen.generate(bytecode, outputPath, moduleName);
 
 		if (!success)
 		{
-			std::println(std::cerr, "Error: Failed to generate C++ code");
+			std::println(err, "Error: Failed to generate C++ code");
 			return false;
 		}
 
+		if (m_args.aot && m_args.verbose)
+		{
+			const auto &stats = cppGen.translationStats();
+			std::println(out, "  Translated {} functions, {} of {} instructions left to the interpreter",
+			             stats.functions, stats.interpreted, stats.instructions);
+		}
+
 		if (m_args.verbose)
-			std::println("Successfully generated: {}", outputPath.string());
+			std::println(out, "Successfully generated: {}", outputPath.string());
 	}
 	catch (const std::exception &e)
 	{
-		std::println(std::cerr, "Compilation Error: {}", e.what());
+		std::println(err, "Compilation Error: {}", e.what());
 		return false;
 	}
 	return true;
 }
 
-bool CppCompiler::generateSource(const std::filesystem::path &sourcePath, const std::filesystem::path &outputPath)
+bool CppCompiler::generateSource(const std::filesystem::path &sourcePath, const std::filesystem::path &outputPath,
+                                 std::ostream &err) const
 {
 	std::ifstream file(sourcePath);
 	if (!file.is_open())
 	{
-		std::println(std::cerr, "Error: Could not open input file: {}", sourcePath.string());
+		std::println(err, "Error: Could not open input file: {}", sourcePath.string());
 		return false;
 	}
 
@@ -375,7 +546,7 @@ bool CppCompiler::generateSource(const std::filesystem::path &sourcePath, const
 	std::ofstream outputFile(outputPath);
 	if (!outputFile.is_open())
 	{
-		std::println(std::cerr, "Error: Could not open output file: {}", outputPath.string());
+		std::println(err, "Error: Could not open output file: {}", outputPath.string());
 		return false;
 	}
 
@@ -390,7 +561,8 @@ bool CppCompiler::generateSource(const std::filesystem::path &sourcePath, const
 	return true;
 }
 
-bool CppCompiler::compileSource(const std::filesystem::path &sourcePath, const std::filesystem::path &outputPath)
+bool CppCompiler::compileSource(const std::filesystem::path &sourcePath, const std::filesystem::path &outputPath,
+                                std::ostream &err) const
 {
 	std::vector<std::string> flags;
 	if (m_args.compiler == "cl")
@@ -412,7 +584,7 @@ bool CppCompiler::compileSource(const std::filesystem::path &sourcePath, const s
 
 	else
 	{
-		std::println(std::cerr, "Error: Unknown compiler: {}", m_args.compiler);
+		std::println(err, "Error: Unknown compiler: {}", m_args.compiler);
 		return false;
 	}
 
@@ -425,14 +597,15 @@ bool CppCompiler::compileSource(const std::filesystem::path &sourcePath, const s
 	command += " " + sourcePath.string();
 	if (std::system(command.c_str()) != 0)
 	{
-		std::println(std::cerr, "Error: Compilation failed");
+		std::println(err, "Error: Compilation failed");
 		return false;
 	}
 
 	return true;
 }
 
-bool CppCompiler::linkObject(const std::filesystem::path &objectPath, const std::filesystem::path &outputPath)
+bool CppCompiler::linkObject(const std::filesystem::path &objectPath, const std::filesystem::path &outputPath,
+                             std::ostream &err) const
 {
 	std::string command = m_args.linker;
 	command += " " + objectPath.string();
@@ -442,7 +615,7 @@ bool CppCompiler::linkObject(const std::filesystem::path &objectPath, const std:
 		command += "-flto -pthread -Wl,--gc-sections -o " + outputPath.string();
 	else
 	{
-		std::println(std::cerr, "Error: Unknown linker: {}", m_args.linker);
+		std::println(err, "Error: Unknown linker: {}", m_args.linker);
 		return false;
 	}
 	return (std::system(command.c_str()) == 0);
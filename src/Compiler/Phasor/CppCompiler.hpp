@@ -1,7 +1,10 @@
 #pragma once
 
+#include "../Shared/Batch.hpp"
 #include <string>
 #include <filesystem>
+#include <unordered_set>
+#include <vector>
 /// @brief The Phasor Programming Language and Runtime
 namespace Phasor
 {
@@ -11,7 +14,8 @@ namespace Phasor
  * @brief CLI wrapper for C++ code generation from Phasor source
  *
  * Compiles Phasor source files to C++ source files that embed bytecode
- * and link against the phasor-runtime DLL.
+ * and link against the phasor-runtime DLL. Several files, or a directory of
+ * them, are built in parallel as a batch.
  */
 class CppCompiler
 {
@@ -21,27 +25,51 @@ class CppCompiler
 
   private:
 	struct Args
+	{
+		std::vector<std::filesystem::path> inputFiles;
+		std::filesystem::path              outputFile; ///< Output file, or output directory in batch mode
+		std::filesystem::path              mainFile;
+		std::string                        moduleName;
+		bool                               verbose = false;
+		bool                               showHelp = false;
+		std::string                        compiler;
+		std::string                        linker;
+		bool                               run = false;
+		bool                               headerOnly = false;
+		bool                               objectOnly = false;
+		bool                               generateOnly = false;
+		bool                               strip = false; ///< Tree-shake before writing; drops functions only hosts call
+		bool                               aot = false; ///< Translate to native C++ instead of interpreting
+		unsigned                           jobs = 0; ///< Batch worker count, 0 for one per hardware thread
+		std::unordered_set<std::string>    keepFunctions;
+	} m_args;
+
+	/// @brief One program to build and where its files go
+	struct Target
 	{
 		std::filesystem::path inputFile;
 		std::filesystem::path outputFile;
-		std::filesystem::path mainFile;
 		std::string           moduleName;
-		bool                  verbose = false;
-		bool                  showHelp = false;
-		std::string           compiler;
-		std::string           linker;
-		bool                  run = false;
-		bool                  headerOnly = false;
-		bool                  objectOnly = false;
-		bool                  generateOnly = false;
-	} m_args;
+		std::filesystem::path intermediate; ///< Generated .h/.cpp/.obj files, without extension
+	};
 
 	bool parseArguments(int argc, char *argv[]);
 	bool showHelp(const std::string &programName);
-	bool generateHeader(const std::filesystem::path &sourcePath, const std::filesystem::path &outputPath);
-	bool generateSource(const std::filesystem::path &sourcePath, const std::filesystem::path &outputPath);
-	bool compileSource(const std::filesystem::path &sourcePath, const std::filesystem::path &outputPath);
-	bool linkObject(const std::filesystem::path &objectPath, const std::filesystem::path &outputPath);
+
+	/// @brief Builds every file given on a thread pool and prints a timing summary
+	int runBatch();
+
+	/// @brief Runs the steps selected by the mode flags for one target, timing them in job
+	bool build(const Target &target, Batch::Job &job, std::ostream &out, std::ostream &err) const;
+
+	bool generateHeader(const std::filesystem::path &sourcePath, const std::filesystem::path &outputPath,
+	                    const std::string &moduleName, Batch::Job &job, std::ostream &out, std::ostream &err) const;
+	bool generateSource(const std::filesystem::path &sourcePath, const std::filesystem::path &outputPath,
+	                    std::ostream &err) const;
+	bool compileSource(const std::filesystem::path &sourcePath, const std::filesystem::path &outputPath,
+	                   std::ostream &err) const;
+	bool linkObject(const std::filesystem::path &objectPath, const std::filesystem::path &outputPath,
+	                std::ostream &err) const;
 };
 
 } // namespace Phasor
@@ -4,6 +4,7 @@
 #include "../../Codegen/Bytecode/BytecodeSerializer.hpp"
 #include "../../Codegen/CodeGen.hpp"
 #include "../../Codegen/IR/PhasorIR.hpp"
+#include "../../Runtime/Stdlib/StdLib.hpp"
 #include <version.h>
 #include <filesystem>
 #include <fstream>
@@ -57,6 +58,7 @@ int Compiler::compileToBytecode()
 		Parser        parser(lexer.tokenize());
 		auto          program = parser.parse();
 		CodeGenerator codegen;
+		codegen.setPureCallEvaluator(StdLib::pureCallEvaluator());
 		auto          bytecode = codegen.generate(*program);
 
 		if (m_args.outputFile.empty())
@@ -110,6 +112,7 @@ int Compiler::compileToIR()
 		Parser        parser(lexer.tokenize());
 		auto          program = parser.parse();
 		CodeGenerator codegen;
+		codegen.setPureCallEvaluator(StdLib::pureCallEvaluator());
 		auto          bytecode = codegen.generate(*program);
 
 		if (m_args.outputFile.empty())
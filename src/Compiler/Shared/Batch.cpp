@@ -0,0 +1,182 @@
+#include "Batch.hpp"
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <print>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace Phasor
+{
+
+std::filesystem::path Batch::Source::output(const std::filesystem::path &directory, std::string_view extension) const
+{
+	std::filesystem::path result = directory.empty() ? path : directory / relative;
+	result.replace_extension(extension);
+	return result;
+}
+
+void Batch::Job::addTime(const std::string &stage, Clock::duration elapsed)
+{
+	auto it = std::ranges::find(stages, stage, &std::pair<std::string, Clock::duration>::first);
+	if (it == stages.end())
+		stages.emplace_back(stage, elapsed);
+	else
+		it->second += elapsed;
+}
+
+std::vector<Batch::Source> Batch::collect(const std::vector<std::filesystem::path> &inputs, std::string_view extension)
+{
+	std::vector<Source> sources;
+	for (const auto &input : inputs)
+	{
+		if (std::filesystem::is_directory(input))
+		{
+			for (const auto &entry : std::filesystem::recursive_directory_iterator(input))
+				if (entry.is_regular_file() && entry.path().extension() == extension)
+					sources.push_back({entry.path(), entry.path().lexically_relative(input)});
+		}
+		else if (std::filesystem::exists(input))
+			sources.push_back({input, input.filename()});
+		else
+			throw std::runtime_error("No such file or directory: " + input.string());
+	}
+
+	// Directory iteration order is unspecified, sort so the job list is the same on every run
+	std::ranges::sort(sources, {}, [](const Source &source) { return source.path.lexically_normal(); });
+	auto duplicates = std::ranges::unique(sources, [](const Source &a, const Source &b) {
+		return a.path.lexically_normal() == b.path.lexically_normal();
+	});
+	sources.erase(duplicates.begin(), duplicates.end());
+	return sources;
+}
+
+bool Batch::isBatch(const std::vector<std::filesystem::path> &inputs)
+{
+	return inputs.size() > 1 ||
+	       std::ranges::any_of(inputs, [](const auto &input) { return std::filesystem::is_directory(input); });
+}
+
+unsigned Batch::defaultThreads()
+{
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+bool Batch::uniqueOutputs(const std::vector<Job> &jobs, std::ostream &err)
+{
+	std::unordered_map<std::string, const Job *> claimed;
+	bool                                         unique = true;
+	for (const auto &job : jobs)
+	{
+		auto [it, inserted] = claimed.emplace(job.output.lexically_normal().string(), &job);
+		if (!inserted)
+		{
+			std::println(err, "Error: {} and {} both write {}", it->second->input.string(), job.input.string(),
+			             job.output.string());
+			unique = false;
+		}
+	}
+	return unique;
+}
+
+Batch::Clock::duration Batch::run(std::vector<Job> &jobs, unsigned threads, const std::function<void(Job &)> &compile)
+{
+	auto start = Clock::now();
+	auto execute = [&](Job &job) {
+		try
+		{
+			compile(job);
+		}
+		catch (const std::exception &e)
+		{
+			std::println(job.err, "Compilation Error: {}", e.what());
+			job.ok = false;
+		}
+	};
+
+	threads = std::clamp<unsigned>(threads, 1, std::max<size_t>(jobs.size(), 1));
+	if (threads == 1)
+	{
+		for (auto &job : jobs)
+			execute(job);
+		return Clock::now() - start;
+	}
+
+	struct Queue
+	{
+		std::mutex         mutex;
+		std::deque<size_t> jobs;
+	};
+	std::vector<Queue> queues(threads);
+	for (size_t i = 0; i < jobs.size(); ++i)
+		queues[i * threads / jobs.size()].jobs.push_back(i);
+
+	// No job is ever added, so a worker that finds every queue empty is done
+	auto take = [&](unsigned self) -> std::optional<size_t> {
+		{
+			std::lock_guard lock(queues[self].mutex);
+			if (!queues[self].jobs.empty())
+			{
+				size_t index = queues[self].jobs.front();
+				queues[self].jobs.pop_front();
+				return index;
+			}
+		}
+		for (unsigned offset = 1; offset < threads; ++offset)
+		{
+			Queue          &victim = queues[(self + offset) % threads];
+			std::lock_guard lock(victim.mutex);
+			if (!victim.jobs.empty())
+			{
+				size_t index = victim.jobs.back();
+				victim.jobs.pop_back();
+				return index;
+			}
+		}
+		return std::nullopt;
+	};
+
+	{
+		std::vector<std::jthread> workers;
+		workers.reserve(threads);
+		for (unsigned self = 0; self < threads; ++self)
+			workers.emplace_back([&, self] {
+				while (auto index = take(self))
+					execute(jobs[*index]);
+			});
+	}
+	return Clock::now() - start;
+}
+
+int Batch::report(const std::vector<Job> &jobs, unsigned threads, Clock::duration wall)
+{
+	auto            ms = [](Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+	size_t          failed = 0;
+	Job             totals;
+	Clock::duration busy{};
+	for (const auto &job : jobs)
+	{
+		std::cout << job.out.str();
+		std::cerr << job.err.str();
+		if (!job.ok)
+			++failed;
+		for (const auto &[stage, elapsed] : job.stages)
+		{
+			totals.addTime(stage, elapsed);
+			busy += elapsed;
+		}
+	}
+
+	threads = std::clamp<unsigned>(threads, 1, std::max<size_t>(jobs.size(), 1));
+	std::println("\nCompiled {} files ({} ok, {} failed) in {:.1f} ms on {} thread{}", jobs.size(),
+	             jobs.size() - failed, failed, ms(wall), threads, threads == 1 ? "" : "s");
+	for (const auto &[stage, elapsed] : totals.stages)
+		std::println("  {:<10}{:>10.1f} ms", stage, ms(elapsed));
+	if (wall.count() > 0)
+		std::println("  {:<10}{:>10.1f} ms ({:.1f}x parallel)", "total", ms(busy), ms(busy) / ms(wall));
+	return failed == 0 ? 0 : 1;
+}
+
+} // namespace Phasor
@@ -0,0 +1,117 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/// @brief The Phasor Programming Language and Runtime
+namespace Phasor
+{
+
+/**
+ * @class Batch
+ * @brief Many-file mode shared by the compiler drivers
+ *
+ * Inputs are expanded into a sorted file list and every file becomes an
+ * independent job: lexing, parsing and code generation share no state, so
+ * the jobs run on a work-stealing pool. Each worker starts with a contiguous
+ * slice of the list, takes jobs from the front of its own slice and, once
+ * that is empty, steals from the back of the others.
+ *
+ * Jobs never print. Their messages are buffered and written in input order
+ * after the pool is done, followed by a timing summary, so the console output
+ * and the files written don't depend on the thread count or scheduling.
+ */
+class Batch
+{
+  public:
+	using Clock = std::chrono::steady_clock;
+
+	/// @brief A file found by collect()
+	struct Source
+	{
+		std::filesystem::path path;
+		std::filesystem::path relative; ///< Relative to the directory argument it was found in, or its file name
+
+		/// @brief Output path: next to the source, or mirrored under directory when one is given
+		std::filesystem::path output(const std::filesystem::path &directory, std::string_view extension) const;
+	};
+
+	/// @brief One input file, what it produced and how long each phase took
+	struct Job
+	{
+		std::filesystem::path                                input;
+		std::filesystem::path                                output;
+		bool                                                 ok = false;
+		std::ostringstream                                   out; ///< Buffered standard output messages
+		std::ostringstream                                   err; ///< Buffered error messages
+		std::vector<std::pair<std::string, Clock::duration>> stages;
+
+		/// @brief Adds the lifetime of the returned object to a phase
+		class Timer
+		{
+		  public:
+			Timer(Job &job, std::string stage) : job(job), stage(std::move(stage)), start(Clock::now())
+			{
+			}
+			Timer(const Timer &) = delete;
+			Timer &operator=(const Timer &) = delete;
+			~Timer()
+			{
+				job.addTime(stage, Clock::now() - start);
+			}
+
+		  private:
+			Job              &job;
+			std::string       stage;
+			Clock::time_point start;
+		};
+
+		[[nodiscard]] Timer time(std::string stage)
+		{
+			return {*this, std::move(stage)};
+		}
+
+		void addTime(const std::string &stage, Clock::duration elapsed);
+	};
+
+	/**
+	 * @brief Expands inputs into the files to compile
+	 *
+	 * Directories are searched recursively for files with the extension,
+	 * plain files are taken as given. The result is sorted by path with
+	 * duplicates removed.
+	 * @throws std::runtime_error if an input does not exist
+	 */
+	static std::vector<Source> collect(const std::vector<std::filesystem::path> &inputs, std::string_view extension);
+
+	/// @brief Whether the inputs need batch mode: more than one, or a directory
+	static bool isBatch(const std::vector<std::filesystem::path> &inputs);
+
+	/// @brief Worker count used when none is given, one per hardware thread
+	static unsigned defaultThreads();
+
+	/// @brief Reports outputs claimed by more than one job to err
+	static bool uniqueOutputs(const std::vector<Job> &jobs, std::ostream &err);
+
+	/**
+	 * @brief Runs compile on every job using up to threads workers
+	 *
+	 * An exception escaping compile fails that job only.
+	 * @return Wall time of the whole batch
+	 */
+	static Clock::duration run(std::vector<Job> &jobs, unsigned threads, const std::function<void(Job &)> &compile);
+
+	/**
+	 * @brief Prints every job's messages in input order, then the timing summary
+	 * @return Process exit code, 0 when every job succeeded
+	 */
+	static int report(const std::vector<Job> &jobs, unsigned threads, Clock::duration wall);
+};
+
+} // namespace Phasor
@@ -1,4 +1,5 @@
 #include "../../../Runtime/Phasor/ScriptingRuntime.hpp"
+#include "../../../Runtime/Phasor/ServeRuntime.hpp"
 #include "../../../Runtime/Shared/BinaryRuntime.hpp"
 #include "../../../Frontend/Phasor/Frontend.hpp"
 #include <print>
@@ -61,13 +62,22 @@ void showHelp(const fs::path &program = "phasor")
 Options:
     -h, --help     Show this help message and exit
     -v, --version  Show the version number and exit
-    -c, --command  Run a raw script string)");
+    -c, --command  Run a raw script string
+    --snapshot <out> <file>  Run file up to its snapshot() call and save the VM to out
+    --from-snapshot <file>   Resume a saved VM
+    --serve [options]        Run scripts sent over stdin or a socket (see --serve --help))");
 }
 
 int main(int argc, char *argv[])
 {
 	try
 	{
+		// Reads its own request frames from stdin
+		if (argc > 1 && std::string_view(argv[1]) == "--serve")
+		{
+			Phasor::ServeRuntime ServeRT(argc, argv);
+			return ServeRT.run();
+		}
 		if (!IS_TERMINAL)
 		{
 			const std::string source = readStdin();
@@ -107,6 +117,22 @@ int main(int argc, char *argv[])
 					auto                     vm = ScriptRT.createVm();
 					return ScriptRT.runSourceString(argv[2], *vm);
 				}
+				else if (m_path == "snapshot" && argc > 3)
+				{
+					// phasor --snapshot <out> <file> [args]
+					if (fs::path(argv[3]).extension() == ".phsb")
+					{
+						Phasor::BinaryRuntime BinRT(argc, argv);
+						return BinRT.run();
+					}
+					Phasor::ScriptingRuntime ScriptRT(argc, argv);
+					return ScriptRT.run();
+				}
+				else if (m_path == "from-snapshot" && argc > 2)
+				{
+					Phasor::BinaryRuntime BinRT(argc, argv);
+					return BinRT.run();
+				}
 				else
 				{
 					std::println(std::cerr, "Invalid argument: {}", m_path);
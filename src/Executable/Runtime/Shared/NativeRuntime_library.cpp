@@ -1,5 +1,6 @@
 #include "../../../Runtime/Stdlib/StdLib.hpp"
 #include "../../../Runtime/Shared/NativeRuntime.hpp"
+#include "../../../Runtime/FFI/ffi.hpp"
 #include "../../../Frontend/Pulsar/Frontend.hpp"
 #include "../../../Frontend/Phasor/Frontend.hpp"
 #include "../../../Language/Phasor/Lexer/Lexer.hpp"
@@ -52,6 +53,62 @@ std::string getCommandLine(LPSTR &lpszCmdLine) {
 
 #define msg error
 
+/// @brief What a PhasorProgram handle from PhasorRT.h points to
+struct PhasorProgram
+{
+	Phasor::Bytecode bytecode;
+	std::string      moduleName;
+};
+
+namespace
+{
+/// @brief The state to run a program on, or a temporary one held by owned when vmPtr is null
+Phasor::VM &programState(void *vmPtr, std::unique_ptr<Phasor::VM> &owned)
+{
+	if (vmPtr)
+		return *static_cast<Phasor::VM *>(vmPtr);
+	owned = std::make_unique<Phasor::VM>();
+	return *owned;
+}
+
+/// @brief Set a state up for a program; the plugin folder is only scanned for a state's first
+void prepareState(Phasor::VM &vm, int argc, const char **argv)
+{
+	Phasor::StdLib::setArguments(vm, argc, const_cast<char **>(argv));
+	Phasor::StdLib::registerFunctions(vm);
+	if (!vm.hasFFI())
+	{
+#if defined(_WIN32)
+		vm.initFFI("plugins");
+#elif defined(__APPLE__)
+		vm.initFFI("/Library/Application Support/org.Phasor.Phasor/plugins");
+#elif defined(__linux__)
+		vm.initFFI("/usr/lib/phasor/plugins/");
+#endif
+	}
+	vm.setImportHandler([vm = &vm](const std::filesystem::path &path) { Phasor::Frontend::runModule(path, vm); });
+}
+
+/// @brief Convert a result, keeping a string's text in text
+PhasorValue fromValue(const Phasor::Value &value, std::string &text)
+{
+	switch (value.getType())
+	{
+	case Phasor::ValueType::Null:
+		return phasor_make_null();
+	case Phasor::ValueType::Bool:
+		return phasor_make_bool(value.asBool());
+	case Phasor::ValueType::Int:
+		return phasor_make_int(value.asInt());
+	case Phasor::ValueType::Float:
+		return phasor_make_float(value.asFloat());
+	default:
+		text = value.asString();
+		return phasor_make_string(text.c_str());
+	}
+}
+} // namespace
+
 extern "C"
 {
 	PHASOR_API const char *getVersion()
@@ -77,6 +134,24 @@ extern "C"
 		return -1;
 	}
 
+	PHASOR_API int execImage(void *vmPtr, const unsigned char *bytecode, size_t bytecodeSize, const void *image,
+	                         const char *moduleName, int argc, const char **argv, void *program)
+	{
+		set_terminal_title(moduleName);
+		try
+		{
+			Phasor::NativeRuntime NativeRT(static_cast<Phasor::VM *>(vmPtr), std::span(bytecode, bytecodeSize),
+			                               *static_cast<const Phasor::EmbeddedImage *>(image), argc, argv);
+
+			return NativeRT.run(reinterpret_cast<Phasor::CompiledProgram>(program));
+		}
+		catch (const std::exception &e)
+		{
+			msg(std::string(moduleName) + ": " + e.what());
+		}
+		return -1;
+	}
+
 	PHASOR_API int execFuncInt(void *vmPtr, const unsigned char *bytecode, size_t bytecodeSize, const char *moduleName,
 	                           int argc, const char **argv, const char *functionName)
 	{
@@ -156,7 +231,7 @@ extern "C"
 		{
 			Phasor::CodeGenerator      codegen;
 			Phasor::BytecodeSerializer serializer;
-			Phasor::Lexer              lexer(script);
+			Phasor::Lexer              lexer{std::string_view(script)};
 			Phasor::Parser             parser(lexer.tokenize());
 
 			if (modulePath && std::filesystem::exists(modulePath))
@@ -165,6 +240,7 @@ extern "C"
 			}
 
 			auto                 ast = parser.parse();
+			codegen.setPureCallEvaluator(Phasor::StdLib::pureCallEvaluator());
 			auto                 bc = codegen.generate(*ast);
 			std::vector<Phasor::u8> data = serializer.serialize(bc);
 
@@ -196,10 +272,11 @@ extern "C"
 		{
 			Phasor::CodeGenerator      codegen;
 			Phasor::BytecodeSerializer serializer;
-			pulsar::Lexer              lexer(script);
+			pulsar::Lexer              lexer{std::string_view(script)};
 			pulsar::Parser             parser(lexer.tokenize());
 
 			auto                 ast = parser.parse();
+			codegen.setPureCallEvaluator(Phasor::StdLib::pureCallEvaluator());
 			auto                 bc = codegen.generate(*ast);
 			std::vector<Phasor::u8> data = serializer.serialize(bc);
 
@@ -262,6 +339,181 @@ extern "C"
 		return vm->isErrorStatus();
 	}
 
+	PHASOR_API PhasorProgram *compileProgramPHS(const char *script, const char *moduleName, const char *modulePath)
+	{
+		set_terminal_title((std::string("Compiling ") + moduleName).c_str());
+		try
+		{
+			Phasor::CodeGenerator codegen;
+			Phasor::Lexer         lexer{std::string_view(script)};
+			Phasor::Parser        parser(lexer.tokenize());
+
+			std::filesystem::path path;
+			if (modulePath && std::filesystem::exists(modulePath))
+			{
+				path = modulePath;
+				parser.setSourcePath(path);
+			}
+
+			auto ast = parser.parse();
+			codegen.setPureCallEvaluator(Phasor::StdLib::pureCallEvaluator());
+			return new PhasorProgram{Phasor::Frontend::linkModules(codegen.generate(*ast), path), moduleName};
+		}
+		catch (const std::exception &e)
+		{
+			msg(std::string(moduleName) + ": " + e.what());
+		}
+		return nullptr;
+	}
+
+	PHASOR_API PhasorProgram *compileProgramPUL(const char *script, const char *moduleName)
+	{
+		set_terminal_title((std::string("Compiling ") + moduleName).c_str());
+		try
+		{
+			Phasor::CodeGenerator codegen;
+			pulsar::Lexer         lexer{std::string_view(script)};
+			pulsar::Parser        parser(lexer.tokenize());
+
+			auto ast = parser.parse();
+			codegen.setPureCallEvaluator(Phasor::StdLib::pureCallEvaluator());
+			return new PhasorProgram{codegen.generate(*ast), moduleName};
+		}
+		catch (const std::exception &e)
+		{
+			msg(std::string(moduleName) + ": " + e.what());
+		}
+		return nullptr;
+	}
+
+	PHASOR_API PhasorProgram *loadProgram(const unsigned char *bytecode, size_t bytecodeSize, const char *moduleName)
+	{
+		try
+		{
+			Phasor::BytecodeDeserializer deserializer;
+			return new PhasorProgram{deserializer.deserialize(std::vector<Phasor::u8>(bytecode, bytecode + bytecodeSize)),
+			                         moduleName};
+		}
+		catch (const std::exception &e)
+		{
+			msg(std::string(moduleName) + ": " + e.what());
+		}
+		return nullptr;
+	}
+
+	// No terminal title here, these are meant to be called many times a second
+	PHASOR_API int execProgram(void *vmPtr, const PhasorProgram *program, int argc, const char **argv)
+	{
+		if (!program)
+			return -1;
+		try
+		{
+			std::unique_ptr<Phasor::VM> owned;
+			Phasor::VM                 &vm = programState(vmPtr, owned);
+			prepareState(vm, argc, argv);
+
+			int status = vm.run(program->bytecode);
+			if (status != 0)
+			{
+				vm.reset(true, false, false);
+				vm.resetStatus();
+			}
+			return status;
+		}
+		catch (const std::exception &e)
+		{
+			msg(program->moduleName + ": " + e.what());
+		}
+		return -1;
+	}
+
+	PHASOR_API int execProgramFuncInt(void *vmPtr, const PhasorProgram *program, int argc, const char **argv,
+	                                  const char *functionName)
+	{
+		if (!program)
+			return -1;
+		try
+		{
+			std::unique_ptr<Phasor::VM> owned;
+			Phasor::VM                 &vm = programState(vmPtr, owned);
+			prepareState(vm, argc, argv);
+
+			return static_cast<int>(vm.runFunction(functionName, program->bytecode).asInt());
+		}
+		catch (const std::exception &e)
+		{
+			msg(program->moduleName + ": " + e.what());
+		}
+		return -1;
+	}
+
+	PHASOR_API const char *execProgramFuncString(void *vmPtr, const PhasorProgram *program, int argc,
+	                                             const char **argv, const char *functionName)
+	{
+		static std::string ret;
+		if (!program)
+			return nullptr;
+		try
+		{
+			std::unique_ptr<Phasor::VM> owned;
+			Phasor::VM                 &vm = programState(vmPtr, owned);
+			prepareState(vm, argc, argv);
+
+			ret = vm.runFunction(functionName, program->bytecode).asString();
+			return ret.c_str();
+		}
+		catch (const std::exception &e)
+		{
+			msg(program->moduleName + ": " + e.what());
+		}
+		return nullptr;
+	}
+
+	PHASOR_API long long findProgramFunction(const PhasorProgram *program, const char *functionName)
+	{
+		if (!program || !functionName)
+			return -1;
+		auto it = program->bytecode.functionEntries.find(functionName);
+		return it != program->bytecode.functionEntries.end() ? it->second : -1;
+	}
+
+	PHASOR_API bool callProgramFunction(void *vmPtr, const PhasorProgram *program, long long function,
+	                                    const PhasorValue *args, size_t argCount, PhasorValue *result)
+	{
+		// Reused across calls so a warm call allocates nothing
+		thread_local std::vector<Phasor::Value> values;
+		thread_local std::string                text;
+		if (!vmPtr || !program || function < 0)
+			return false;
+		try
+		{
+			Phasor::VM &vm = *static_cast<Phasor::VM *>(vmPtr);
+			if (!vm.isLoaded(program->bytecode))
+			{
+				prepareState(vm, 0, nullptr);
+				vm.load(program->bytecode);
+			}
+
+			values.clear();
+			for (size_t i = 0; i < argCount; ++i)
+				values.push_back(Phasor::from_c_value(args[i]));
+			Phasor::Value ret = vm.call(static_cast<size_t>(function), values);
+			if (result)
+				*result = fromValue(ret, text);
+			return true;
+		}
+		catch (const std::exception &e)
+		{
+			msg(program->moduleName + ": " + e.what());
+		}
+		return false;
+	}
+
+	PHASOR_API void freeProgram(PhasorProgram *program)
+	{
+		delete program;
+	}
+
 #if defined(_SHARED) && defined(_WIN32)
 	PHASOR_API void CALLBACK PhasorSourceStringEvaluateA(HWND hwnd, HINSTANCE, LPSTR lpszCmdLine, int)
 	{
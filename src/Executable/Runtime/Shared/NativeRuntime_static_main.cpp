@@ -11,14 +11,29 @@
 #include <Value.hpp>
 #endif
 
+#ifdef PHASOR_EMBEDDED_IMAGE
+extern "C" int execImage(void *state, const unsigned char embeddedBytecode[], size_t embeddedBytecodeSize,
+                         const void *image, const char *moduleName, int argc, const char *argv[], void *program);
+#ifdef PHASOR_COMPILED_PROGRAM
+#define PHASOR_PROGRAM reinterpret_cast<void *>(PHASOR_COMPILED_PROGRAM)
+#else
+#define PHASOR_PROGRAM nullptr
+#endif
+#else
 extern "C" int exec(void *state, const unsigned char embeddedBytecode[], size_t embeddedBytecodeSize,
                     const char *moduleName, int argc, const char *argv[]);
+#endif
 
 int main(int argc, char *argv[])
 {
 	try
 	{
+#ifdef PHASOR_EMBEDDED_IMAGE
+		return execImage(nullptr, embeddedBytecode, embeddedBytecodeSize, &PHASOR_EMBEDDED_IMAGE, moduleName.c_str(),
+		                 argc, (const char **)argv, PHASOR_PROGRAM);
+#else
 		return exec(nullptr, embeddedBytecode, embeddedBytecodeSize, moduleName.c_str(), argc, (const char **)argv);
+#endif
 	}
 	catch (const std::exception &e)
 	{
@@ -9,7 +9,7 @@ from __future__ import annotations
 
 from dataclasses import dataclass, field
 from pathlib import Path
-from typing import Dict, List, Optional
+from typing import Dict, List, Optional, Tuple
 
 from .Instruction import Instruction
 from .OpCode import OpCode
@@ -26,6 +26,23 @@ class StructInfo:
     field_names: List[str]
 
 
+@dataclass
+class SwitchTable:
+    """Jump table used by :attr:`~phasor.OpCode.OpCode.SWITCH_TABLE` / :attr:`~phasor.OpCode.OpCode.SWITCH_HASH`.
+
+    Attributes:
+        default_target: Instruction index taken when no case matches.
+        low: ``SWITCH_TABLE`` only; case value mapped to ``dense_targets[0]``.
+        dense_targets: ``SWITCH_TABLE`` only; targets for ``low``, ``low + 1``, ...
+        cases: ``SWITCH_HASH`` only; ``(value, target)`` pairs, first match wins.
+    """
+
+    default_target: int = 0
+    low: int = 0
+    dense_targets: List[int] = field(default_factory=list)
+    cases: List[Tuple[Value, int]] = field(default_factory=list)
+
+
 @dataclass
 class Bytecode:
     """In-memory representation of a compiled Phasor program.
@@ -45,6 +62,7 @@ class Bytecode:
         next_var_index: Next available variable slot; serialised as part of the variables section.
         structs: List of struct descriptors.
         struct_entries: Maps each struct name to its index in the structs list.
+        switch_tables: Jump tables indexed by the operand of ``SWITCH_TABLE`` / ``SWITCH_HASH``.
     """
 
     instructions:              List[Instruction]       = field(default_factory=list)
@@ -57,6 +75,7 @@ class Bytecode:
     next_var_index:            int                     = 0
     structs:                   List[StructInfo]        = field(default_factory=list)
     struct_entries:            Dict[str, int]          = field(default_factory=dict)
+    switch_tables:             List[SwitchTable]       = field(default_factory=list)
 
     # Mirrors C++ stringConstantCache: dedup cache for string constants.
     # Not a dataclass field — excluded from __init__, __repr__, serialisation, etc.
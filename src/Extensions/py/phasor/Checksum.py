@@ -0,0 +1,34 @@
+# Checksum.py
+"""
+phasor.Checksum
+===============
+CRC-32C (Castagnoli) checksums of ``.phsb`` sections, matching ``Checksum::crc32c`` in the C++ runtime.
+
+:mod:`zlib` only provides the IEEE CRC-32, which versions 3.0 and 4.1 use.
+"""
+
+from __future__ import annotations
+
+from typing import List
+
+
+def _make_table(polynomial: int) -> List[int]:
+    table = []
+    for i in range(256):
+        crc = i
+        for _ in range(8):
+            crc = (crc >> 1) ^ polynomial if crc & 1 else crc >> 1
+        table.append(crc)
+    return table
+
+
+_CRC32C_TABLE: List[int] = _make_table(0x82F63B78)
+
+
+def crc32c(data: bytes, crc: int = 0) -> int:
+    """Return the CRC-32C of *data*; pass a previous result as *crc* to continue it."""
+    table = _CRC32C_TABLE
+    crc ^= 0xFFFFFFFF
+    for byte in data:
+        crc = (crc >> 8) ^ table[(crc ^ byte) & 0xFF]
+    return crc ^ 0xFFFFFFFF
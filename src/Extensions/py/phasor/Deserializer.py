@@ -11,23 +11,42 @@ import struct
 import zlib
 from pathlib import Path
 
-from .Bytecode import Bytecode, StructInfo
+from .Bytecode import Bytecode, StructInfo, SwitchTable
+from .Checksum import crc32c
 from .Instruction import Instruction
 from .Metadata import (
-    HEADER_SIZE, MAGIC, SEC_CONSTANTS, SEC_FUNCTIONS,
-    SEC_FUNC_TYPES, SEC_INSTRUCTIONS, SEC_STRUCTS, SEC_VARIABLES, VERSION,
+    FLAG_COMPACT_INSTRUCTIONS, FLAG_SECTION_INDEX, HEADER_SIZE,
+    INSTRUCTION_ALIGNMENT, MAGIC, SEC_CONSTANTS, SEC_FUNCTIONS, SEC_FUNC_TYPES,
+    SEC_INDEX, SEC_INSTRUCTIONS, SEC_STRUCTS, SEC_SWITCHES, SEC_VARIABLES,
+    VERSION, VERSION_3, VERSION_4_1,
 )
-from .OpCode import OpCode
+from .OpCode import OpCode, operand_count
 from .Value import Value, ValueType
 
 
 class BytecodeDeserializer:
     """Deserialises ``.phsb`` into :class:`~phasor.Bytecode.Bytecode`."""
 
-    def __init__(self) -> None:
-        """Initialise the deserializer with an empty data buffer and zero read position."""
-        self._data: bytes = b""
-        self._pos:  int   = 0
+    _SECTION_NAMES = {
+        SEC_CONSTANTS: "constant pool", SEC_VARIABLES: "variables", SEC_INSTRUCTIONS: "instructions",
+        SEC_FUNCTIONS: "functions", SEC_STRUCTS: "structs", SEC_FUNC_TYPES: "function types",
+        SEC_SWITCHES: "switch tables",
+    }
+
+    def __init__(self, verify_checksums: bool = True) -> None:
+        """Initialise the deserializer with an empty data buffer and zero read position.
+
+        Args:
+            verify_checksums: Check the header and section checksums. Turn off only for
+                trusted images; structural checks still apply.
+        """
+        self._verify_checksums = verify_checksums
+        self._data:    bytes = b""
+        self._pos:     int   = 0
+        self._version: int   = VERSION
+        self._flags:   int   = 0
+        self._sections: dict = {}
+        self._index_end: int = 0
 
     def deserialize(self, data: bytes) -> Bytecode:
         """Parse a raw ``.phsb`` byte buffer into a :class:`~phasor.Bytecode.Bytecode` object.
@@ -39,7 +58,7 @@ class BytecodeDeserializer:
             A fully populated :class:`~phasor.Bytecode.Bytecode` instance.
 
         Raises:
-            ValueError: If the magic number, version, or CRC-32 checksum is invalid,
+            ValueError: If the magic number, version, or a checksum is invalid,
                 or if any section tag is unexpected.
         """
         self._data = data
@@ -48,18 +67,29 @@ class BytecodeDeserializer:
         checksum = self._read_header()
 
         data_start = self._pos
-        actual_crc = zlib.crc32(self._data[data_start:]) & 0xFFFFFFFF
-        if actual_crc != checksum:
-            raise ValueError(
-                f"Bytecode checksum mismatch: "
-                f"expected {checksum:#010x}, got {actual_crc:#010x}"
-            )
-
+        self._sections = {}
+        if self._flags & FLAG_SECTION_INDEX:
+            self._read_section_index()
+        self._index_end = self._pos
+        if self._verify_checksums:
+            self._verify(data_start, checksum)
+        for sid, (offset, size, _) in self._sections.items():
+            if offset < self._index_end or offset + size > len(self._data):
+                raise ValueError(f"Section 0x{sid:02x} is out of range")
+
+        self._seek_section(SEC_CONSTANTS)
         self._read_constant_pool(bytecode)
+        self._seek_section(SEC_VARIABLES)
         self._read_variable_mapping(bytecode)
+        self._seek_section(SEC_FUNCTIONS)
         self._read_function_entries(bytecode)
+        self._seek_section(SEC_FUNC_TYPES)
         self._read_function_types(bytecode)
+        self._seek_section(SEC_STRUCTS)
         self._read_struct_section(bytecode)
+        if self._seek_section(SEC_SWITCHES):
+            self._read_switch_section(bytecode)
+        self._seek_section(SEC_INSTRUCTIONS)
         self._read_instructions(bytecode)
 
         return bytecode
@@ -85,7 +115,8 @@ class BytecodeDeserializer:
 
         Raises:
             ValueError: If the magic number does not equal :data:`~phasor.Metadata.MAGIC`
-                or the version does not equal :data:`~phasor.Metadata.VERSION`.
+                or the version is neither :data:`~phasor.Metadata.VERSION` nor
+                :data:`~phasor.Metadata.VERSION_3`.
         """
         magic = self._read_uint32()
         if magic != MAGIC:
@@ -94,15 +125,77 @@ class BytecodeDeserializer:
             )
 
         version = self._read_uint32()
-        if version != VERSION:
+        if version not in (VERSION, VERSION_4_1, VERSION_3):
             raise ValueError(
                 f"Unsupported version: {version:#010x} (expected {VERSION:#010x})"
             )
 
-        _flags = self._read_uint32()
+        self._version = version
+        flags = self._read_uint32()
+        if version == VERSION_3:
+            flags = 0  # reserved in version 3
+        elif flags & ~(FLAG_SECTION_INDEX | FLAG_COMPACT_INSTRUCTIONS):
+            raise ValueError(f"Unsupported bytecode flags: {flags:#010x}")
+        self._flags = flags
         checksum = self._read_uint32()
         return checksum
 
+    def _read_section_index(self) -> None:
+        """Read the optional :data:`~phasor.Metadata.SEC_INDEX` table of section offsets and sizes."""
+        section_id = self._read_uint8()
+        if section_id != SEC_INDEX:
+            raise ValueError(
+                f"Expected section index (0x{SEC_INDEX:02x}), got 0x{section_id:02x}"
+            )
+        count = self._read_uint8()
+        for _ in range(count):
+            sid      = self._read_uint8()
+            offset   = self._read_uint32()
+            size     = self._read_uint32()
+            checksum = self._read_uint32() if self._version == VERSION else 0
+            self._sections[sid] = (offset, size, checksum)
+
+    def _verify(self, data_start: int, checksum: int) -> None:
+        """Check the header checksum, and with a section index every section's.
+
+        Versions 3.0 and 4.1 have one CRC-32 over everything after the header. Since
+        then it is a CRC-32C, and with an index it covers only the index.
+
+        Raises:
+            ValueError: Naming the damaged section, if any.
+        """
+        if self._version != VERSION:
+            actual = zlib.crc32(self._data[data_start:]) & 0xFFFFFFFF
+            if actual != checksum:
+                raise ValueError(
+                    f"Bytecode checksum mismatch: expected {checksum:#010x}, got {actual:#010x}"
+                )
+            return
+        end = self._index_end if self._sections else len(self._data)
+        actual = crc32c(self._data[data_start:end])
+        if actual != checksum:
+            where = " in section index" if self._sections else ""
+            raise ValueError(
+                f"Bytecode checksum mismatch{where}: expected {checksum:#010x}, got {actual:#010x}"
+            )
+        for sid, (offset, size, expected) in self._sections.items():
+            if offset + size <= len(self._data) and crc32c(self._data[offset:offset + size]) != expected:
+                name = self._SECTION_NAMES.get(sid, "unknown")
+                raise ValueError(f"Bytecode checksum mismatch in {name} section")
+
+    def _seek_section(self, section_id: int) -> bool:
+        """Move to *section_id* and report whether the file has it.
+
+        With a section index the offset is looked up, otherwise sections are
+        read in file order and the next tag is peeked at.
+        """
+        if self._flags & FLAG_SECTION_INDEX:
+            if section_id not in self._sections:
+                return False
+            self._pos = self._sections[section_id][0]
+            return True
+        return self._pos < len(self._data) and self._data[self._pos] == section_id
+
     def _read_constant_pool(self, bytecode: Bytecode) -> None:
         """Read the :data:`~phasor.Metadata.SEC_CONSTANTS` section and append entries to :attr:`bytecode.constants <phasor.Bytecode.Bytecode.constants>`."""
         section_id = self._read_uint8()
@@ -111,7 +204,12 @@ class BytecodeDeserializer:
                 f"Expected constants section (0x{SEC_CONSTANTS:02x}), "
                 f"got 0x{section_id:02x}"
             )
-        count = self._read_uint32()
+        count = self._read_count()
+        if self._version != VERSION_3:
+            # The offset table is only needed for random access, values are stored in index order
+            _size = self._read_count()
+            self._require(4 * count)
+            self._pos += 4 * count
         for _ in range(count):
             bytecode.constants.append(self._read_value())
 
@@ -123,11 +221,11 @@ class BytecodeDeserializer:
                 f"Expected variables section (0x{SEC_VARIABLES:02x}), "
                 f"got 0x{section_id:02x}"
             )
-        count = self._read_uint32()
-        bytecode.next_var_index = self._read_int32()
+        count = self._read_count()
+        bytecode.next_var_index = self._read_index()
         for _ in range(count):
             name  = self._read_string()
-            index = self._read_int32()
+            index = self._read_index()
             bytecode.variables[name] = index
 
     def _read_function_entries(self, bytecode: Bytecode) -> None:
@@ -138,10 +236,10 @@ class BytecodeDeserializer:
                 f"Expected functions section (0x{SEC_FUNCTIONS:02x}), "
                 f"got 0x{section_id:02x}"
             )
-        count = self._read_uint32()
+        count = self._read_count()
         for _ in range(count):
             name    = self._read_string()
-            address = self._read_int32()
+            address = self._read_index()
             bytecode.function_entries[name] = address
 
     def _read_function_types(self, bytecode: Bytecode) -> None:
@@ -156,11 +254,11 @@ class BytecodeDeserializer:
                 f"Expected function-types section (0x{SEC_FUNC_TYPES:02x}), "
                 f"got 0x{section_id:02x}"
             )
-        count = self._read_uint32()
+        count = self._read_count()
         for _ in range(count):
             name        = self._read_string()
             return_type = self._read_string()
-            param_count = self._read_uint32()
+            param_count = self._read_count()
             param_types = [self._read_string() for _ in range(param_count)]
             bytecode.function_return_type_names[name] = return_type
             bytecode.function_param_type_names[name]  = param_types
@@ -177,11 +275,11 @@ class BytecodeDeserializer:
                 f"Expected structs section (0x{SEC_STRUCTS:02x}), "
                 f"got 0x{section_id:02x}"
             )
-        count = self._read_uint32()
+        count = self._read_count()
         for i in range(count):
             name              = self._read_string()
-            first_const_index = self._read_int32()
-            field_count       = self._read_int32()
+            first_const_index = self._read_index()
+            field_count       = self._read_index()
             field_names       = [self._read_string() for _ in range(field_count)]
             info = StructInfo(
                 name=name,
@@ -192,6 +290,27 @@ class BytecodeDeserializer:
             bytecode.structs.append(info)
             bytecode.struct_entries[name] = i
 
+    def _read_switch_section(self, bytecode: Bytecode) -> None:
+        """Read the optional :data:`~phasor.Metadata.SEC_SWITCHES` section (0x07) and populate
+        :attr:`~phasor.Bytecode.Bytecode.switch_tables`.
+        """
+        section_id = self._read_uint8()
+        if section_id != SEC_SWITCHES:
+            raise ValueError(
+                f"Expected switch tables section (0x{SEC_SWITCHES:02x}), "
+                f"got 0x{section_id:02x}"
+            )
+        count = self._read_count()
+        for _ in range(count):
+            table = SwitchTable(default_target=self._read_index(), low=self._read_integer())
+            dense_count = self._read_count()
+            table.dense_targets = [self._read_index() for _ in range(dense_count)]
+            case_count = self._read_count()
+            for _ in range(case_count):
+                value = self._read_value()
+                table.cases.append((value, self._read_index()))
+            bytecode.switch_tables.append(table)
+
     def _read_instructions(self, bytecode: Bytecode) -> None:
         """Read the :data:`~phasor.Metadata.SEC_INSTRUCTIONS` section and populate :attr:`bytecode.instructions <phasor.Bytecode.Bytecode.instructions>`."""
         section_id = self._read_uint8()
@@ -200,9 +319,20 @@ class BytecodeDeserializer:
                 f"Expected instructions section (0x{SEC_INSTRUCTIONS:02x}), "
                 f"got 0x{section_id:02x}"
             )
-        count = self._read_uint32()
+        count = self._read_count()
+        if self._flags & FLAG_COMPACT_INSTRUCTIONS:
+            for _ in range(count):
+                opcode   = OpCode(self._read_uint8())
+                operands = [self._read_index() for _ in range(operand_count(opcode))]
+                bytecode.instructions.append(Instruction(opcode, *operands))
+            return
+        padded = self._version != VERSION_3
+        if padded:
+            self._pos += -self._pos % INSTRUCTION_ALIGNMENT
         for _ in range(count):
             opcode = OpCode(self._read_uint8())
+            if padded:
+                self._pos += 3
             op1    = self._read_int32()
             op2    = self._read_int32()
             op3    = self._read_int32()
@@ -215,11 +345,13 @@ class BytecodeDeserializer:
 
             0  Null
             1  Bool   : uint8(0|1)
-            2  Int    : int64
+            2  Int    : varint
             3  Float  : float64
-            4  String : uint16(len) + bytes
-            5  Struct : string(structName) uint32(fieldCount) [string(name) value]...
-            6  Array  : uint32(elementCount) [value]...
+            4  String : uvarint(len) + bytes
+            5  Struct : string(structName) uvarint(fieldCount) [string(name) value]...
+            6  Array  : uvarint(elementCount) [value]...
+
+        Version 3 files use ``int64`` ints, ``uint16`` string lengths and ``uint32`` counts.
         """
         tag = self._read_uint8()
         if tag == 0:
@@ -227,21 +359,21 @@ class BytecodeDeserializer:
         if tag == 1:
             return Value.from_bool(self._read_uint8() != 0)
         if tag == 2:
-            return Value.from_int(self._read_int64())
+            return Value.from_int(self._read_integer())
         if tag == 3:
             return Value.from_float(self._read_double())
         if tag == 4:
             return Value.from_string(self._read_string())
         if tag == 5:
             struct_name = self._read_string()
-            field_count = self._read_uint32()
+            field_count = self._read_count()
             fields: dict = {}
             for _ in range(field_count):
                 field_name = self._read_string()
                 fields[field_name] = self._read_value()
             return Value.from_struct(struct_name, fields)
         if tag == 6:
-            elem_count = self._read_uint32()
+            elem_count = self._read_count()
             elems = [self._read_value() for _ in range(elem_count)]
             return Value.from_array(elems)
         raise ValueError(f"Unknown value type tag: {tag}")
@@ -289,6 +421,48 @@ class BytecodeDeserializer:
         self._pos += 8
         return v
 
+    def _read_varuint(self) -> int:
+        """Read and return an unsigned LEB128 varint of at most 64 bits."""
+        result = 0
+        shift  = 0
+        while True:
+            byte = self._read_uint8()
+            if shift == 63 and byte > 1:
+                raise ValueError(f"Bytecode file corrupted: varint too long at offset {self._pos - 1}")
+            result |= (byte & 0x7F) << shift
+            if byte < 0x80:
+                return result
+            shift += 7
+
+    def _read_varint(self) -> int:
+        """Read and return a zigzag-encoded signed 64-bit varint."""
+        v = self._read_varuint()
+        return (v >> 1) ^ -(v & 1)
+
+    def _read_count(self) -> int:
+        """Read a table or element count: ``uint32`` in version 3, a ``uint32``-range uvarint otherwise."""
+        if self._version == VERSION_3:
+            return self._read_uint32()
+        v = self._read_varuint()
+        if v > 0xFFFFFFFF:
+            raise ValueError("Bytecode file corrupted: count out of range")
+        return v
+
+    def _read_index(self) -> int:
+        """Read an index, address or operand: ``int32`` in version 3, an ``int32``-range varint otherwise."""
+        if self._version == VERSION_3:
+            return self._read_int32()
+        v = self._read_varint()
+        if not -0x80000000 <= v <= 0x7FFFFFFF:
+            raise ValueError("Bytecode file corrupted: index out of range")
+        return v
+
+    def _read_integer(self) -> int:
+        """Read an integer value: ``int64`` in version 3, a varint otherwise."""
+        if self._version == VERSION_3:
+            return self._read_int64()
+        return self._read_varint()
+
     def _read_double(self) -> float:
         """Read and return the next little-endian IEEE 754 double from the buffer."""
         self._require(8)
@@ -297,8 +471,8 @@ class BytecodeDeserializer:
         return v
 
     def _read_string(self) -> str:
-        """Read a length-prefixed UTF-8 string (uint16 length + bytes) and return it."""
-        length = self._read_uint16()
+        """Read a length-prefixed UTF-8 string (uvarint length, uint16 in version 3, + bytes) and return it."""
+        length = self._read_uint16() if self._version == VERSION_3 else self._read_count()
         self._require(length)
         s = self._data[self._pos : self._pos + length].decode("utf-8")
         self._pos += length
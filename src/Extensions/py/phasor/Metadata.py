@@ -10,7 +10,15 @@ def _ascii_to_u32_le(s: str) -> int:
     return b[0] | (b[1] << 8) | (b[2] << 16) | (b[3] << 24)
 
 MAGIC: int = _ascii_to_u32_le("PHSB")
-VERSION: int = 0x03000000
+VERSION: int = 0x04020000   # varint tables and values, indexed constant pool, aligned instruction records, CRC-32C per section
+VERSION_4_1: int = 0x04010000   # still readable: 9-byte index entries, one CRC-32 over the whole file
+VERSION_3: int = 0x03000000 # still readable
+INSTRUCTION_RECORD_SIZE: int = 16
+INSTRUCTION_ALIGNMENT:   int = 16   # file offset of the first instruction record
+
+FLAG_SECTION_INDEX:        int = 0x1   # a section index follows the header
+FLAG_COMPACT_INSTRUCTIONS: int = 0x2   # varint operands, as many as OpCode.operand_count
+SECTION_INDEX_ENTRY_SIZE:  int = 13    # id, offset, size, CRC-32C of the section
 HEADER_SIZE: int = 16       # bytes: MAGIC(4) + VERSION(4) + FLAGS(4) + CHECKSUM(4)
 
 SEC_CONSTANTS:    int = 0x01
@@ -18,4 +26,6 @@ SEC_VARIABLES:    int = 0x02
 SEC_INSTRUCTIONS: int = 0x03
 SEC_FUNCTIONS:    int = 0x04
 SEC_STRUCTS:      int = 0x05
-SEC_FUNC_TYPES:   int = 0x06
\ No newline at end of file
+SEC_FUNC_TYPES:   int = 0x06
+SEC_SWITCHES:     int = 0x07   # optional, present only when SWITCH_TABLE / SWITCH_HASH are used
+SEC_INDEX:        int = 0x08   # optional, offsets of the other sections
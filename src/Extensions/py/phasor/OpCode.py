@@ -147,3 +147,94 @@ class OpCode(IntEnum):
     SYSTEM_R     = 0x70
     SYSTEM_OUT_R = 0x71
     SYSTEM_ERR_R = 0x72
+
+    PUSH_INT_IMM   = 0x73   # push(operand1)
+    LOAD_INT_IMM_R = 0x74   # R[rA] = operand2
+
+    SWITCH_TABLE = 0x75   # pop v, jump via dense switch_tables[operand1]
+    SWITCH_HASH  = 0x76   # pop v, jump via hashed switch_tables[operand1]
+
+# Operands each opcode uses, mirrors PhasorIR::getOperandCount. Opcodes not
+# listed take none; compact instruction encoding writes only these.
+_OPERAND_COUNTS = {
+    # 1 operand
+    OpCode.PUSH_CONST: 1,
+    OpCode.JUMP: 1,
+    OpCode.JUMP_IF_FALSE: 1,
+    OpCode.JUMP_IF_TRUE: 1,
+    OpCode.JUMP_BACK: 1,
+    OpCode.STORE_VAR: 1,
+    OpCode.LOAD_VAR: 1,
+    OpCode.IMPORT: 1,
+    OpCode.CALL_NATIVE: 1,
+    OpCode.CALL: 1,
+    OpCode.SYSTEM: 1,
+    OpCode.SYSTEM_OUT: 1,
+    OpCode.SYSTEM_ERR: 1,
+    OpCode.PUSH_R: 1,
+    OpCode.POP_R: 1,
+    OpCode.PRINT_R: 1,
+    OpCode.PRINTERROR_R: 1,
+    OpCode.READLINE_R: 1,
+    OpCode.SYSTEM_R: 1,
+    OpCode.SYSTEM_OUT_R: 1,
+    OpCode.SYSTEM_ERR_R: 1,
+    OpCode.NEW_STRUCT: 1,
+    OpCode.GET_FIELD: 1,
+    OpCode.SET_FIELD: 1,
+    OpCode.NEW_STRUCT_INSTANCE_STATIC: 1,
+    OpCode.PUSH_INT_IMM: 1,
+    OpCode.SWITCH_TABLE: 1,
+    OpCode.SWITCH_HASH: 1,
+    # 2 operands
+    OpCode.MOV: 2,
+    OpCode.LOAD_CONST_R: 2,
+    OpCode.LOAD_VAR_R: 2,
+    OpCode.STORE_VAR_R: 2,
+    OpCode.SQRT_R: 2,
+    OpCode.LOG_R: 2,
+    OpCode.EXP_R: 2,
+    OpCode.SIN_R: 2,
+    OpCode.COS_R: 2,
+    OpCode.TAN_R: 2,
+    OpCode.NEG_R: 2,
+    OpCode.NOT_R: 2,
+    OpCode.PUSH2_R: 2,
+    OpCode.POP2_R: 2,
+    OpCode.GET_FIELD_STATIC: 2,
+    OpCode.SET_FIELD_STATIC: 2,
+    OpCode.LOAD_INT_IMM_R: 2,
+    # 3 operands
+    OpCode.IADD_R: 3,
+    OpCode.ISUB_R: 3,
+    OpCode.IMUL_R: 3,
+    OpCode.IDIV_R: 3,
+    OpCode.IMOD_R: 3,
+    OpCode.FLADD_R: 3,
+    OpCode.FLSUB_R: 3,
+    OpCode.FLMUL_R: 3,
+    OpCode.FLDIV_R: 3,
+    OpCode.FLMOD_R: 3,
+    OpCode.POW_R: 3,
+    OpCode.IAND_R: 3,
+    OpCode.IOR_R: 3,
+    OpCode.IEQ_R: 3,
+    OpCode.INE_R: 3,
+    OpCode.ILT_R: 3,
+    OpCode.IGT_R: 3,
+    OpCode.ILE_R: 3,
+    OpCode.IGE_R: 3,
+    OpCode.FLAND_R: 3,
+    OpCode.FLOR_R: 3,
+    OpCode.FLEQ_R: 3,
+    OpCode.FLNE_R: 3,
+    OpCode.FLLT_R: 3,
+    OpCode.FLGT_R: 3,
+    OpCode.FLLE_R: 3,
+    OpCode.FLGE_R: 3,
+}
+
+
+def operand_count(op: OpCode) -> int:
+    """Number of operands *op* uses; the rest are always ``0``."""
+    return _OPERAND_COUNTS.get(op, 0)
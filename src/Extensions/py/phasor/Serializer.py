@@ -8,32 +8,43 @@ Serialises a :class:`~phasor.Bytecode.Bytecode` object to the binary ``.phsb`` f
 from __future__ import annotations
 
 import struct
-import zlib
 from pathlib import Path
 from typing import Dict, List
 
-from .Bytecode import Bytecode, StructInfo
+from .Bytecode import Bytecode, StructInfo, SwitchTable
+from .Checksum import crc32c
 from .Instruction import Instruction
 from .Metadata import (
-    HEADER_SIZE, MAGIC, SEC_CONSTANTS, SEC_FUNCTIONS,
-    SEC_FUNC_TYPES, SEC_INSTRUCTIONS, SEC_STRUCTS, SEC_VARIABLES, VERSION,
+    FLAG_COMPACT_INSTRUCTIONS, FLAG_SECTION_INDEX, HEADER_SIZE,
+    INSTRUCTION_ALIGNMENT, MAGIC, SEC_CONSTANTS, SEC_FUNCTIONS, SEC_FUNC_TYPES,
+    SEC_INDEX, SEC_INSTRUCTIONS, SEC_STRUCTS, SEC_SWITCHES, SEC_VARIABLES,
+    SECTION_INDEX_ENTRY_SIZE, VERSION,
 )
+from .OpCode import operand_count
 from .Value import Value, ValueType
 
 
 class BytecodeSerializer:
     """Converts a :class:`~phasor.Bytecode.Bytecode` object into its binary ``.phsb`` representation."""
 
-    def __init__(self) -> None:
-        """Initialise the serializer with an empty write buffer."""
+    def __init__(self, compact_instructions: bool = False, section_index: bool = True) -> None:
+        """Initialise the serializer with an empty write buffer.
+
+        Args:
+            compact_instructions: Write only the operands each opcode uses, as varints. Smaller,
+                but ``phasorvm`` decodes such files on load instead of running them in place.
+            section_index: Write a table of section offsets and checksums after the header.
+        """
         self._buf: bytearray = bytearray()
+        self._compact_instructions = compact_instructions
+        self._section_index = section_index
 
     def serialize(self, bytecode: Bytecode) -> bytes:
         """Serialise *bytecode* to the ``.phsb`` wire format.
 
-        Writes a 16-byte header (magic, version, flags, CRC-32 checksum) followed
-        by the constants, variables, functions, function-types, structs, and
-        instructions sections in order.
+        Writes a 16-byte header (magic, version, flags, CRC-32C checksum), the
+        optional section index, then the constants, variables, functions,
+        function-types, structs, switch tables and instructions sections in order.
 
         Args:
             bytecode: The :class:`~phasor.Bytecode.Bytecode` object to serialise.
@@ -46,16 +57,49 @@ class BytecodeSerializer:
         self._buf.extend(bytes(HEADER_SIZE))
         data_start = len(self._buf)
 
-        self._write_constant_pool(bytecode.constants)
-        self._write_variable_mapping(bytecode.variables, bytecode.next_var_index)
-        self._write_function_entries(bytecode.function_entries)
-        self._write_function_types(bytecode)
-        self._write_struct_section(bytecode.structs)
-        self._write_instructions(bytecode.instructions)
-
-        checksum = zlib.crc32(self._buf[data_start:]) & 0xFFFFFFFF
-
-        header = struct.pack("<IIII", MAGIC, VERSION, 0, checksum)
+        # Instructions whose unused operands aren't zero can only be stored as full records
+        compact = self._compact_instructions and all(
+            all(v == 0 for v in (instr.operand1, instr.operand2, instr.operand3)[operand_count(instr.op):])
+            for instr in bytecode.instructions
+        )
+        flags = (FLAG_SECTION_INDEX if self._section_index else 0) | (FLAG_COMPACT_INSTRUCTIONS if compact else 0)
+
+        writers = [
+            lambda: self._write_constant_pool(bytecode.constants),
+            lambda: self._write_variable_mapping(bytecode.variables, bytecode.next_var_index),
+            lambda: self._write_function_entries(bytecode.function_entries),
+            lambda: self._write_function_types(bytecode),
+            lambda: self._write_struct_section(bytecode.structs),
+        ]
+        if bytecode.switch_tables:
+            writers.append(lambda: self._write_switch_section(bytecode.switch_tables))
+        writers.append(lambda: self._write_instructions(bytecode.instructions, compact))
+
+        index_pos = len(self._buf)
+        if self._section_index:
+            self._write_uint8(SEC_INDEX)
+            self._write_uint8(len(writers))
+            self._buf.extend(bytes(SECTION_INDEX_ENTRY_SIZE * len(writers)))
+
+        starts = []
+        for write in writers:
+            starts.append(len(self._buf))
+            write()
+
+        # With an index the header checksum covers just the index, each section has its own
+        checked_end = len(self._buf)
+        if self._section_index:
+            ends = starts[1:] + [len(self._buf)]
+            for i, (start, end) in enumerate(zip(starts, ends)):
+                struct.pack_into(
+                    "<BIII", self._buf, index_pos + 2 + SECTION_INDEX_ENTRY_SIZE * i,
+                    self._buf[start], start, end - start, crc32c(self._buf[start:end]),
+                )
+            checked_end = starts[0]
+
+        checksum = crc32c(self._buf[data_start:checked_end])
+
+        header = struct.pack("<IIII", MAGIC, VERSION, flags, checksum)
         self._buf[:HEADER_SIZE] = header
 
         return bytes(self._buf)
@@ -74,30 +118,41 @@ class BytecodeSerializer:
         path.write_bytes(self.serialize(bytecode))
 
     def _write_constant_pool(self, constants: List[Value]) -> None:
-        """Write the :data:`~phasor.Metadata.SEC_CONSTANTS` section: count followed by each :class:`~phasor.Value.Value`."""
-        self._write_uint8(SEC_CONSTANTS)
-        self._write_uint32(len(constants))
+        """Write the :data:`~phasor.Metadata.SEC_CONSTANTS` section: count and payload size as varints, a ``uint32``
+        offset per constant relative to the payload, then each :class:`~phasor.Value.Value`."""
+        section_start = len(self._buf)
+        offsets = []
         for value in constants:
+            offsets.append(len(self._buf) - section_start)
             self._write_value(value)
+        payload = bytes(self._buf[section_start:])
+        del self._buf[section_start:]
+
+        self._write_uint8(SEC_CONSTANTS)
+        self._write_varuint(len(constants))
+        self._write_varuint(len(payload))
+        for offset in offsets:
+            self._write_uint32(offset)
+        self._buf.extend(payload)
 
     def _write_variable_mapping(
         self, variables: Dict[str, int], next_var_index: int
     ) -> None:
         """Write the :data:`~phasor.Metadata.SEC_VARIABLES` section: count, :attr:`~phasor.Bytecode.Bytecode.next_var_index`, then each name→slot pair."""
         self._write_uint8(SEC_VARIABLES)
-        self._write_uint32(len(variables))
-        self._write_int32(next_var_index)
+        self._write_varuint(len(variables))
+        self._write_varint(next_var_index)
         for name, index in variables.items():
             self._write_string(name)
-            self._write_int32(index)
+            self._write_varint(index)
 
     def _write_function_entries(self, function_entries: Dict[str, int]) -> None:
         """Write the :data:`~phasor.Metadata.SEC_FUNCTIONS` section: count then each name→instruction-index entry point."""
         self._write_uint8(SEC_FUNCTIONS)
-        self._write_uint32(len(function_entries))
+        self._write_varuint(len(function_entries))
         for name, address in function_entries.items():
             self._write_string(name)
-            self._write_int32(address)
+            self._write_varint(address)
 
     def _write_function_types(self, bytecode: Bytecode) -> None:
         """Write the :data:`~phasor.Metadata.SEC_FUNC_TYPES` section (0x06).
@@ -106,7 +161,7 @@ class BytecodeSerializer:
 
             string  name
             string  returnTypeName   ("any" when absent)
-            uint32  paramCount
+            uvarint paramCount
             string  paramTypeName[0..paramCount-1]
 
         Only functions present in
@@ -114,11 +169,11 @@ class BytecodeSerializer:
         untyped functions are omitted from this section.
         """
         self._write_uint8(SEC_FUNC_TYPES)
-        self._write_uint32(len(bytecode.function_param_type_names))
+        self._write_varuint(len(bytecode.function_param_type_names))
         for name, param_types in bytecode.function_param_type_names.items():
             self._write_string(name)
             self._write_string(bytecode.function_return_type_names.get(name, "any"))
-            self._write_uint32(len(param_types))
+            self._write_varuint(len(param_types))
             for type_name in param_types:
                 self._write_string(type_name)
 
@@ -128,25 +183,63 @@ class BytecodeSerializer:
         Binary layout per entry::
 
             string  name
-            int32   firstConstIndex
-            int32   fieldCount
+            varint  firstConstIndex
+            varint  fieldCount
             string  fieldName[0..fieldCount-1]
         """
         self._write_uint8(SEC_STRUCTS)
-        self._write_uint32(len(structs))
+        self._write_varuint(len(structs))
         for info in structs:
             self._write_string(info.name)
-            self._write_int32(info.first_const_index)
-            self._write_int32(info.field_count)
+            self._write_varint(info.first_const_index)
+            self._write_varint(info.field_count)
             for field_name in info.field_names:
                 self._write_string(field_name)
 
-    def _write_instructions(self, instructions: List[Instruction]) -> None:
-        """Write the :data:`~phasor.Metadata.SEC_INSTRUCTIONS` section: count then each :class:`~phasor.Instruction.Instruction` as ``uint8`` opcode + three ``int32`` operands."""
+    def _write_switch_section(self, tables: List[SwitchTable]) -> None:
+        """Write the :data:`~phasor.Metadata.SEC_SWITCHES` section (0x07).
+
+        Binary layout per table::
+
+            varint  defaultTarget
+            varint  low
+            uvarint denseCount
+            varint  denseTarget[0..denseCount-1]
+            uvarint caseCount
+            [value  varint(target)]...
+        """
+        self._write_uint8(SEC_SWITCHES)
+        self._write_varuint(len(tables))
+        for table in tables:
+            self._write_varint(table.default_target)
+            self._write_varint(table.low)
+            self._write_varuint(len(table.dense_targets))
+            for target in table.dense_targets:
+                self._write_varint(target)
+            self._write_varuint(len(table.cases))
+            for value, target in table.cases:
+                self._write_value(value)
+                self._write_varint(target)
+
+    def _write_instructions(self, instructions: List[Instruction], compact: bool) -> None:
+        """Write the :data:`~phasor.Metadata.SEC_INSTRUCTIONS` section: count, zero padding up to a
+        :data:`~phasor.Metadata.INSTRUCTION_ALIGNMENT` file offset, then each :class:`~phasor.Instruction.Instruction`
+        as a 16-byte record: ``uint8`` opcode, three zero bytes, three ``int32`` operands.
+
+        When *compact*, there is no padding and each instruction is its opcode followed by
+        :func:`~phasor.OpCode.operand_count` varint operands."""
         self._write_uint8(SEC_INSTRUCTIONS)
-        self._write_uint32(len(instructions))
+        self._write_varuint(len(instructions))
+        if compact:
+            for instr in instructions:
+                self._write_uint8(int(instr.op))
+                for v in (instr.operand1, instr.operand2, instr.operand3)[:operand_count(instr.op)]:
+                    self._write_varint(v)
+            return
+        self._buf.extend(bytes(-len(self._buf) % INSTRUCTION_ALIGNMENT))
         for instr in instructions:
             self._write_uint8(int(instr.op))
+            self._buf.extend(bytes(3))
             self._write_int32(instr.operand1)
             self._write_int32(instr.operand2)
             self._write_int32(instr.operand3)
@@ -158,11 +251,11 @@ class BytecodeSerializer:
 
             0  Null
             1  Bool   : uint8(0|1)
-            2  Int    : int64
+            2  Int    : varint
             3  Float  : float64
-            4  String : uint16(len) + bytes
-            5  Struct : string(structName) uint32(fieldCount) [string(name) value]...
-            6  Array  : uint32(elementCount) [value]...
+            4  String : uvarint(len) + bytes
+            5  Struct : string(structName) uvarint(fieldCount) [string(name) value]...
+            6  Array  : uvarint(elementCount) [value]...
 
         Raises:
             NotImplementedError: If :attr:`value.type <phasor.Value.Value.type>` is not a
@@ -176,7 +269,7 @@ class BytecodeSerializer:
             self._write_uint8(1 if value.as_bool() else 0)
         elif t == ValueType.Int:
             self._write_uint8(2)
-            self._write_int64(value.as_int())
+            self._write_varint(value.as_int())
         elif t == ValueType.Float:
             self._write_uint8(3)
             self._write_double(value.as_float())
@@ -187,14 +280,14 @@ class BytecodeSerializer:
             s = value.as_struct()
             self._write_uint8(5)
             self._write_string(s.struct_name)
-            self._write_uint32(len(s.fields))
+            self._write_varuint(len(s.fields))
             for field_name, field_val in s.fields.items():
                 self._write_string(field_name)
                 self._write_value(field_val)
         elif t == ValueType.Array:
             elems = value.as_array()
             self._write_uint8(6)
-            self._write_uint32(len(elems))
+            self._write_varuint(len(elems))
             for elem in elems:
                 self._write_value(elem)
         else:
@@ -204,10 +297,6 @@ class BytecodeSerializer:
         """Append a single unsigned byte to the buffer."""
         self._buf.append(v & 0xFF)
 
-    def _write_uint16(self, v: int) -> None:
-        """Append a little-endian unsigned 16-bit integer to the buffer."""
-        self._buf.extend(struct.pack("<H", v & 0xFFFF))
-
     def _write_uint32(self, v: int) -> None:
         """Append a little-endian unsigned 32-bit integer to the buffer."""
         self._buf.extend(struct.pack("<I", v & 0xFFFFFFFF))
@@ -216,16 +305,23 @@ class BytecodeSerializer:
         """Append a little-endian signed 32-bit integer to the buffer."""
         self._buf.extend(struct.pack("<i", v))
 
-    def _write_int64(self, v: int) -> None:
-        """Append a little-endian signed 64-bit integer to the buffer."""
-        self._buf.extend(struct.pack("<q", v))
+    def _write_varuint(self, v: int) -> None:
+        """Append an unsigned LEB128 varint: seven bits per byte, low group first."""
+        while v >= 0x80:
+            self._buf.append((v & 0x7F) | 0x80)
+            v >>= 7
+        self._buf.append(v)
+
+    def _write_varint(self, v: int) -> None:
+        """Append a signed 64-bit integer as a zigzag LEB128 varint."""
+        self._write_varuint(((v << 1) ^ (v >> 63)) & 0xFFFFFFFFFFFFFFFF)
 
     def _write_double(self, v: float) -> None:
         """Append a little-endian IEEE 754 double to the buffer."""
         self._buf.extend(struct.pack("<d", v))
 
     def _write_string(self, s: str) -> None:
-        """Append a length-prefixed UTF-8 string (uint16 length + bytes) to the buffer."""
+        """Append a length-prefixed UTF-8 string (uvarint length + bytes) to the buffer."""
         encoded = s.encode("utf-8")
-        self._write_uint16(len(encoded))
+        self._write_varuint(len(encoded))
         self._buf.extend(encoded)
\ No newline at end of file
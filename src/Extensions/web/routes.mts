@@ -1,14 +1,19 @@
 import { spawn } from 'node:child_process';
+import type { ChildProcessWithoutNullStreams } from 'node:child_process';
 import { resolve } from 'node:path';
 import type { IncomingMessage } from 'node:http';
 import type { AddressInfo } from 'node:net';
 import type { ServerInstance } from 'zorvix';
 import { createBodyParser } from 'zorvix';
 
+type RunResult = { stdout: string; stderr: string; exitCode: number };
+
+const INTERNAL_ERROR = 'An internal server error occured. If you are a server administrator, please see the server logs for more information.';
+
 async function runViaPipe(
     executablePath: string,
     code: string
-): Promise<{ stdout: string; stderr: string; exitCode: number }> {
+): Promise<RunResult> {
     return new Promise((resolve) => {
         const proc = spawn(executablePath, [], { stdio: ['pipe', 'pipe', 'pipe'] });
 
@@ -28,7 +33,7 @@ async function runViaPipe(
             console.error(err);
             resolve({
                 stdout,
-                stderr: 'An internal server error occured. If you are a server administrator, please see the server logs for more information.',
+                stderr: INTERNAL_ERROR,
                 exitCode: -1
             });
         });
@@ -38,7 +43,86 @@ async function runViaPipe(
     });
 }
 
+/**
+ * One long-lived `phasor --serve`, which runs each script on a warm worker
+ * instead of starting a process for it. Requests and responses are framed on
+ * its stdin/stdout as described in `phasor --serve --help`; the server is
+ * started again if it exits.
+ */
+class ScriptServer {
+    private proc: ChildProcessWithoutNullStreams | null = null;
+    private buffer = Buffer.alloc(0);
+    private nextId = 0;
+    private pending = new Map<number, (result: RunResult) => void>();
+
+    constructor(private executablePath: string, private args: string[] = []) {}
+
+    run(code: string): Promise<RunResult> {
+        const proc = this.proc ?? this.start();
+        const id = this.nextId;
+        this.nextId = (this.nextId + 1) >>> 0;
+
+        const source = Buffer.from(code, 'utf8');
+        const header = Buffer.alloc(8);
+        header.writeUInt32LE(id, 0);
+        header.writeUInt32LE(source.length, 4);
+
+        return new Promise((resolve) => {
+            this.pending.set(id, resolve);
+            proc.stdin.write(Buffer.concat([header, source]));
+        });
+    }
+
+    private start(): ChildProcessWithoutNullStreams {
+        const proc = spawn(this.executablePath, ['--serve', ...this.args], { stdio: ['pipe', 'pipe', 'pipe'] });
+        this.proc = proc;
+        this.buffer = Buffer.alloc(0);
+
+        proc.stdout.on('data', (chunk: Buffer) => this.receive(chunk));
+        proc.stderr.on('data', (chunk: Buffer) => console.error(chunk.toString('utf8')));
+        proc.stdin.on('error', (err) => console.error(err));
+        const fail = (err?: Error) => {
+            if (err) console.error(err);
+            if (this.proc !== proc) return;
+            this.proc = null;
+            for (const resolve of this.pending.values()) resolve({ stdout: '', stderr: INTERNAL_ERROR, exitCode: -1 });
+            this.pending.clear();
+        };
+        proc.on('error', fail);
+        proc.on('close', () => fail());
+        return proc;
+    }
+
+    private receive(chunk: Buffer) {
+        this.buffer = Buffer.concat([this.buffer, chunk]);
+        for (;;) {
+            if (this.buffer.length < 12) return;
+            const outSize = this.buffer.readUInt32LE(8);
+            if (this.buffer.length < 16 + outSize) return;
+            const errSize = this.buffer.readUInt32LE(12 + outSize);
+            const end = 16 + outSize + errSize;
+            if (this.buffer.length < end) return;
+
+            const id = this.buffer.readUInt32LE(0);
+            const exitCode = this.buffer.readInt32LE(4);
+            const stdout = this.buffer.toString('utf8', 12, 12 + outSize);
+            const stderr = this.buffer.toString('utf8', 16 + outSize, end);
+            this.buffer = this.buffer.subarray(end);
+
+            this.pending.get(id)?.({ stdout, stderr, exitCode });
+            this.pending.delete(id);
+        }
+    }
+}
+
 export default async function (server: ServerInstance) {
+    const exeName = process.platform === 'win32' ? 'phasor.exe' : 'phasor';
+    const exePath = resolve(process.cwd(), 'phasor', 'bin', exeName);
+
+    // --serve needs fork(), so Windows keeps starting a process per script
+    const scripts = process.platform === 'win32' ? null : new ScriptServer(exePath, ['--timeout', '10000']);
+    const runScript = (code: string) => scripts ? scripts.run(code) : runViaPipe(exePath, code);
+
     server.use('/run', createBodyParser({ limit: 2 * 1048576 }));
     server.use("/run",  (req, res, next) => {
         const APIKEY =
@@ -62,17 +146,11 @@ export default async function (server: ServerInstance) {
         const code = await req.body as string;
         if (!code.trim()) { res.json({ error: 'Request body must contain source code.' }, 400); return; }
 
-        const exeName = process.platform === 'win32' ? 'phasor.exe' : 'phasor';
-        const exePath = resolve(process.cwd(), 'phasor', 'bin', exeName);
-
-        res.json(await runViaPipe(exePath, code));
+        res.json(await runScript(code));
     });
 
     server.get('/version', async (req, res) => {
-        const exeName = process.platform === 'win32' ? 'phasor.exe' : 'phasor';
-        const exePath = resolve(process.cwd(), 'phasor', 'bin', exeName);
-
-        res.json({ version: `${(await runViaPipe(exePath, 'using("stdmeta");print(phs_version());')).stdout.trim()}` });
+        res.json({ version: `${(await runScript( 'using("stdmeta");print(phs_version());')).stdout.trim()}` });
     });
 
     await server.start();
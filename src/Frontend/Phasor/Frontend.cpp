@@ -1,6 +1,8 @@
 #include "../../Language/Phasor/Lexer/Lexer.hpp"
 #include "../../Language/Phasor/Parser/Parser.hpp"
 #include "../../Codegen/IR/PhasorIR.hpp"
+#include "../../Codegen/Cache/ModuleCache.hpp"
+#include "../../Codegen/Linker/Linker.hpp"
 #include "../../Runtime/Stdlib/StdLib.hpp"
 #include "../../Runtime/VM/VM.hpp"
 
@@ -39,7 +41,8 @@ int Phasor::Frontend::runScript(const std::string &source, VM *vm, const std::fi
 #ifndef TRACING
 	}
 #endif
-	auto bytecode = codegen.generate(*program);
+	codegen.setPureCallEvaluator(StdLib::pureCallEvaluator());
+	auto bytecode = linkModules(codegen.generate(*program), path);
 
 	if (vm == nullptr)
 	{
@@ -56,16 +59,7 @@ int Phasor::Frontend::runScript(const std::string &source, VM *vm, const std::fi
 	vm->initFFI("/usr/lib/phasor/plugins/");
 #endif
 
-	vm->setImportHandler([vm](const std::filesystem::path &path) {
-		std::ifstream file(path);
-		if (!file.is_open())
-		{
-			throw std::runtime_error("Could not open imported file: " + path.string());
-		}
-		std::stringstream buffer;
-		buffer << file.rdbuf();
-		runScript(buffer.str(), vm, path);
-	});
+	vm->setImportHandler([vm](const std::filesystem::path &path) { runModule(path, vm); });
 
 	try
 	{
@@ -93,11 +87,39 @@ int Phasor::Frontend::runScript(const std::string &source, VM *vm, const std::fi
 	return status;
 }
 
+/// @brief Compile one module to object bytecode, through the on-disk cache
+static Phasor::Bytecode compileObject(const std::filesystem::path &path)
+{
+	Phasor::ModuleCache cache("phasor");
+	return cache.load(path, [&](const std::string &source, std::vector<std::filesystem::path> &dependencies) {
+		Phasor::Lexer  lexer(source);
+		Phasor::Parser parser(lexer.tokenize(), path);
+		auto           program = parser.parse();
+		dependencies = parser.includedFiles();
+
+		Phasor::CodeGenerator codegen;
+		codegen.setPureCallEvaluator(Phasor::StdLib::pureCallEvaluator());
+		return codegen.generate(*program);
+	});
+}
+
+Phasor::Bytecode Phasor::Frontend::linkModules(const Bytecode &program, const std::filesystem::path &path)
+{
+	return Linker::link(program, path, compileObject);
+}
+
+int Phasor::Frontend::runModule(const std::filesystem::path &path, VM *vm)
+{
+	Bytecode bytecode = linkModules(compileObject(path), path);
+	return vm->run(bytecode);
+}
+
 int Phasor::Frontend::runRepl(VM *vm, bool verbose)
 {
 	int           status = 0;
 	bool          ownVM = false;
 	CodeGenerator codegen;
+	codegen.setPureCallEvaluator(StdLib::pureCallEvaluator());
 
 	if (vm == nullptr)
 	{
@@ -114,16 +136,7 @@ int Phasor::Frontend::runRepl(VM *vm, bool verbose)
 	vm->initFFI("/usr/lib/phasor/plugins/");
 #endif
 
-	vm->setImportHandler([vm](const std::filesystem::path &path) {
-		std::ifstream file(path);
-		if (!file.is_open())
-		{
-			throw std::runtime_error("Could not open imported file: " + path.string());
-		}
-		std::stringstream buffer;
-		buffer << file.rdbuf();
-		runScript(buffer.str(), vm, path);
-	});
+	vm->setImportHandler([vm](const std::filesystem::path &path) { runModule(path, vm); });
 
 	if (status != 0)
 	{
@@ -1,3 +1,4 @@
+#include "../../Codegen/CodeGen.hpp"
 #include "../../Runtime/VM/VM.hpp"
 #include <string>
 /// @brief The Phasor Programming Language and Runtime
@@ -16,6 +17,20 @@ namespace Frontend
  * @return The result of the script
  */
 int runScript(const std::string &source, VM *vm, const std::filesystem::path &path = "", bool verbose = false);
+/**
+ * @brief Resolve a program's imports at compile time and link it with its modules
+ * @param program Bytecode generated for the program
+ * @param path The optional path of the program source, imports are looked up next to it
+ * @return One image with no IMPORT left, see Linker
+ */
+Bytecode linkModules(const Bytecode &program, const std::filesystem::path &path);
+/**
+ * @brief Run a module imported at runtime (REPL), compiled through the on-disk ModuleCache
+ * @param path The module file
+ * @param vm The virtual machine of the importing program
+ * @return The result of the module
+ */
+int runModule(const std::filesystem::path &path, VM *vm);
 /**
  * @brief Run an REPL
  * @param vm The virtual machine to run the REPL on
@@ -1,6 +1,7 @@
 #include "../../Language/Pulsar/Lexer/Lexer.hpp"
 #include "../../Language/Pulsar/Parser/Parser.hpp"
 #include "../../Codegen/IR/PhasorIR.hpp"
+#include "../../Codegen/Cache/ModuleCache.hpp"
 #include "../../Runtime/Stdlib/StdLib.hpp"
 #include "../../Runtime/VM/VM.hpp"
 
@@ -32,6 +33,7 @@ int pulsar::Frontend::runScript(const std::string &source, Phasor::VM *vm)
 	Parser        parser(lexer.tokenize());
 
 	auto program = parser.parse();
+	codegen.setPureCallEvaluator(StdLib::pureCallEvaluator());
 	auto bytecode = codegen.generate(*program);
 
 	if (vm == nullptr)
@@ -49,16 +51,7 @@ int pulsar::Frontend::runScript(const std::string &source, Phasor::VM *vm)
 	vm->initFFI("/usr/lib/phasor/plugins/");
 #endif
 
-	vm->setImportHandler([vm](const std::filesystem::path &path) {
-		std::ifstream file(path);
-		if (!file.is_open())
-		{
-			throw std::runtime_error("Could not open imported file: " + path.string());
-		}
-		std::stringstream buffer;
-		buffer << file.rdbuf();
-		runScript(buffer.str(), vm);
-	});
+	vm->setImportHandler([vm](const std::filesystem::path &path) { runModule(path, vm); });
 
 	try
 	{
@@ -86,11 +79,27 @@ int pulsar::Frontend::runScript(const std::string &source, Phasor::VM *vm)
 	return status;
 }
 
+int pulsar::Frontend::runModule(const std::filesystem::path &path, Phasor::VM *vm)
+{
+	Phasor::ModuleCache cache("pulsar");
+	Phasor::Bytecode    bytecode = cache.load(path, [](const std::string &source, std::vector<std::filesystem::path> &) {
+		Lexer  lexer(source);
+		Parser parser(lexer.tokenize());
+		auto   program = parser.parse();
+
+		Phasor::CodeGenerator codegen;
+		codegen.setPureCallEvaluator(Phasor::StdLib::pureCallEvaluator());
+		return codegen.generate(*program);
+	});
+	return vm->run(bytecode);
+}
+
 int pulsar::Frontend::runRepl(Phasor::VM *vm)
 {
 	int           status = 0;
 	bool          ownVM = false;
 	CodeGenerator codegen;
+	codegen.setPureCallEvaluator(StdLib::pureCallEvaluator());
 
 	if (vm == nullptr)
 	{
@@ -107,16 +116,7 @@ int pulsar::Frontend::runRepl(Phasor::VM *vm)
 	vm->initFFI("/usr/lib/phasor/plugins/");
 #endif
 
-	vm->setImportHandler([](const std::filesystem::path &path) {
-		std::ifstream file(path);
-		if (!file.is_open())
-		{
-			throw std::runtime_error("Could not open imported file: " + path.string());
-		}
-		std::stringstream buffer;
-		buffer << file.rdbuf();
-		runScript(buffer.str());
-	});
+	vm->setImportHandler([vm](const std::filesystem::path &path) { runModule(path, vm); });
 
 	if (status != 0)
 	{
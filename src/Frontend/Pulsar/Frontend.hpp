@@ -15,6 +15,14 @@ namespace Frontend
  */
 int runScript(const std::string &source, Phasor::VM *vm = nullptr);
 
+/**
+ * @brief Run an imported module, compiled through the on-disk ModuleCache
+ * @param path The module file
+ * @param vm The virtual machine of the importing program
+ * @return The result of the module
+ */
+int runModule(const std::filesystem::path &path, Phasor::VM *vm);
+
 /**
  * @brief Run an REPL
  * @param vm The virtual machine to run the REPL on
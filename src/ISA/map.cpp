@@ -117,7 +117,11 @@ const std::unordered_map<OpCode, std::string> opCodeToStringMap = {{OpCode::PUSH
                                                                    {OpCode::SET_FIELD, "SET_FIELD"},
                                                                    {OpCode::NEW_STRUCT_INSTANCE_STATIC, "NEW_STRUCT_INSTANCE_STATIC"},
                                                                    {OpCode::GET_FIELD_STATIC, "GET_FIELD_STATIC"},
-                                                                   {OpCode::SET_FIELD_STATIC, "SET_FIELD_STATIC"}
+                                                                   {OpCode::SET_FIELD_STATIC, "SET_FIELD_STATIC"},
+                                                                   {OpCode::PUSH_INT_IMM, "PUSH_INT_IMM"},
+                                                                   {OpCode::LOAD_INT_IMM_R, "LOAD_INT_IMM_R"},
+                                                                   {OpCode::SWITCH_TABLE, "SWITCH_TABLE"},
+                                                                   {OpCode::SWITCH_HASH, "SWITCH_HASH"}
                                                                 };
 
 const std::unordered_map<std::string, OpCode> stringToOpCodeMap = [] {
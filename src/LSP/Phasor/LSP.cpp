@@ -16,7 +16,7 @@ static inline size_t toLexerCol(size_t lspCol)
 
 static std::string buildSignature(AST::Node *node)
 {
-	if (auto *fn = dynamic_cast<AST::FunctionDecl *>(node))
+	if (auto *fn = AST::as<AST::FunctionDecl>(node))
 	{
 		std::ostringstream ss;
 		ss << "fn " << fn->name << "(";
@@ -43,7 +43,7 @@ static std::string buildSignature(AST::Node *node)
 		}
 		return ss.str();
 	}
-	if (auto *st = dynamic_cast<AST::StructDecl *>(node))
+	if (auto *st = AST::as<AST::StructDecl>(node))
 	{
 		std::ostringstream ss;
 		ss << "struct " << st->name << " {";
@@ -62,7 +62,7 @@ static std::string buildSignature(AST::Node *node)
 		ss << " }";
 		return ss.str();
 	}
-	if (auto *vd = dynamic_cast<AST::VarDecl *>(node))
+	if (auto *vd = AST::as<AST::VarDecl>(node))
 		return "var " + vd->name;
 
 	return "";
@@ -191,60 +191,60 @@ AST::Node *walkExpr(AST::Expression *expr, size_t line, size_t col)
 	if (!expr)
 		return nullptr;
 
-	if (auto *e = dynamic_cast<AST::BinaryExpr *>(expr))
+	if (auto *e = AST::as<AST::BinaryExpr>(expr))
 	{
 		if (auto *n = walkExpr(e->left.get(), line, col))
 			return n;
 		if (auto *n = walkExpr(e->right.get(), line, col))
 			return n;
 	}
-	else if (auto *e = dynamic_cast<AST::UnaryExpr *>(expr))
+	else if (auto *e = AST::as<AST::UnaryExpr>(expr))
 	{
 		if (auto *n = walkExpr(e->operand.get(), line, col))
 			return n;
 	}
-	else if (auto *e = dynamic_cast<AST::PostfixExpr *>(expr))
+	else if (auto *e = AST::as<AST::PostfixExpr>(expr))
 	{
 		if (auto *n = walkExpr(e->operand.get(), line, col))
 			return n;
 	}
-	else if (auto *e = dynamic_cast<AST::AssignmentExpr *>(expr))
+	else if (auto *e = AST::as<AST::AssignmentExpr>(expr))
 	{
 		if (auto *n = walkExpr(e->target.get(), line, col))
 			return n;
 		if (auto *n = walkExpr(e->value.get(), line, col))
 			return n;
 	}
-	else if (auto *e = dynamic_cast<AST::CallExpr *>(expr))
+	else if (auto *e = AST::as<AST::CallExpr>(expr))
 	{
 		for (const auto &arg : e->arguments)
 			if (auto *n = walkExpr(arg.get(), line, col))
 				return n;
 	}
-	else if (auto *e = dynamic_cast<AST::ArrayAccessExpr *>(expr))
+	else if (auto *e = AST::as<AST::ArrayAccessExpr>(expr))
 	{
 		if (auto *n = walkExpr(e->array.get(), line, col))
 			return n;
 		if (auto *n = walkExpr(e->index.get(), line, col))
 			return n;
 	}
-	else if (auto *e = dynamic_cast<AST::ArrayLiteralExpr *>(expr))
+	else if (auto *e = AST::as<AST::ArrayLiteralExpr>(expr))
 	{
 		for (const auto &elem : e->elements)
 			if (auto *n = walkExpr(elem.get(), line, col))
 				return n;
 	}
-	else if (auto *e = dynamic_cast<AST::MemberAccessExpr *>(expr))
+	else if (auto *e = AST::as<AST::MemberAccessExpr>(expr))
 	{
 		if (auto *n = walkExpr(e->object.get(), line, col))
 			return n;
 	}
-	else if (auto *e = dynamic_cast<AST::FieldAccessExpr *>(expr))
+	else if (auto *e = AST::as<AST::FieldAccessExpr>(expr))
 	{
 		if (auto *n = walkExpr(e->object.get(), line, col))
 			return n;
 	}
-	else if (auto *e = dynamic_cast<AST::StructInstanceExpr *>(expr))
+	else if (auto *e = AST::as<AST::StructInstanceExpr>(expr))
 	{
 		for (const auto &fv : e->fieldValues)
 			if (auto *n = walkExpr(fv.second.get(), line, col))
@@ -259,34 +259,34 @@ AST::Node *walkStmt(AST::Statement *stmt, size_t line, size_t col)
 	if (!stmt)
 		return nullptr;
 
-	if (auto *s = dynamic_cast<AST::BlockStmt *>(stmt))
+	if (auto *s = AST::as<AST::BlockStmt>(stmt))
 	{
 		for (const auto &child : s->statements)
 			if (auto *n = walkStmt(child.get(), line, col))
 				return n;
 	}
-	else if (auto *s = dynamic_cast<AST::ExpressionStmt *>(stmt))
+	else if (auto *s = AST::as<AST::ExpressionStmt>(stmt))
 	{
 		if (auto *n = walkExpr(s->expression.get(), line, col))
 			return n;
 	}
-	else if (auto *s = dynamic_cast<AST::PrintStmt *>(stmt))
+	else if (auto *s = AST::as<AST::PrintStmt>(stmt))
 	{
 		if (auto *n = walkExpr(s->expression.get(), line, col))
 			return n;
 	}
-	else if (auto *s = dynamic_cast<AST::VarDecl *>(stmt))
+	else if (auto *s = AST::as<AST::VarDecl>(stmt))
 	{
 		if (auto *n = walkExpr(s->initializer.get(), line, col))
 			return n;
 		return candidate(s, line, col);
 	}
-	else if (auto *s = dynamic_cast<AST::ReturnStmt *>(stmt))
+	else if (auto *s = AST::as<AST::ReturnStmt>(stmt))
 	{
 		if (auto *n = walkExpr(s->value.get(), line, col))
 			return n;
 	}
-	else if (auto *s = dynamic_cast<AST::IfStmt *>(stmt))
+	else if (auto *s = AST::as<AST::IfStmt>(stmt))
 	{
 		if (auto *n = walkExpr(s->condition.get(), line, col))
 			return n;
@@ -295,14 +295,14 @@ AST::Node *walkStmt(AST::Statement *stmt, size_t line, size_t col)
 		if (auto *n = walkStmt(s->elseBranch.get(), line, col))
 			return n;
 	}
-	else if (auto *s = dynamic_cast<AST::WhileStmt *>(stmt))
+	else if (auto *s = AST::as<AST::WhileStmt>(stmt))
 	{
 		if (auto *n = walkExpr(s->condition.get(), line, col))
 			return n;
 		if (auto *n = walkStmt(s->body.get(), line, col))
 			return n;
 	}
-	else if (auto *s = dynamic_cast<AST::ForStmt *>(stmt))
+	else if (auto *s = AST::as<AST::ForStmt>(stmt))
 	{
 		if (auto *n = walkStmt(s->initializer.get(), line, col))
 			return n;
@@ -313,7 +313,7 @@ AST::Node *walkStmt(AST::Statement *stmt, size_t line, size_t col)
 		if (auto *n = walkStmt(s->body.get(), line, col))
 			return n;
 	}
-	else if (auto *s = dynamic_cast<AST::SwitchStmt *>(stmt))
+	else if (auto *s = AST::as<AST::SwitchStmt>(stmt))
 	{
 		if (auto *n = walkExpr(s->expr.get(), line, col))
 			return n;
@@ -329,23 +329,23 @@ AST::Node *walkStmt(AST::Statement *stmt, size_t line, size_t col)
 			if (auto *n = walkStmt(ds.get(), line, col))
 				return n;
 	}
-	else if (auto *s = dynamic_cast<AST::FunctionDecl *>(stmt))
+	else if (auto *s = AST::as<AST::FunctionDecl>(stmt))
 	{
 		if (s->body)
 			if (auto *n = walkStmt(s->body.get(), line, col))
 				return n;
 		return candidate(s, line, col);
 	}
-	else if (auto *s = dynamic_cast<AST::StructDecl *>(stmt))
+	else if (auto *s = AST::as<AST::StructDecl>(stmt))
 	{
 		return candidate(s, line, col);
 	}
-	else if (auto *s = dynamic_cast<AST::ExportStmt *>(stmt))
+	else if (auto *s = AST::as<AST::ExportStmt>(stmt))
 	{
 		if (auto *n = walkStmt(s->declaration.get(), line, col))
 			return n;
 	}
-	else if (auto *s = dynamic_cast<AST::UnsafeBlockStmt *>(stmt))
+	else if (auto *s = AST::as<AST::UnsafeBlockStmt>(stmt))
 	{
 		if (auto *n = walkStmt(s->block.get(), line, col))
 			return n;
@@ -369,15 +369,15 @@ std::string LSP::symbolNameAt(AST::Node *node) const
 {
 	if (!node)
 		return "";
-	if (auto *e = dynamic_cast<AST::IdentifierExpr *>(node))
+	if (auto *e = AST::as<AST::IdentifierExpr>(node))
 		return e->name;
-	if (auto *e = dynamic_cast<AST::CallExpr *>(node))
+	if (auto *e = AST::as<AST::CallExpr>(node))
 		return e->callee;
-	if (auto *e = dynamic_cast<AST::StructInstanceExpr *>(node))
+	if (auto *e = AST::as<AST::StructInstanceExpr>(node))
 		return e->structName;
-	if (auto *e = dynamic_cast<AST::FieldAccessExpr *>(node))
+	if (auto *e = AST::as<AST::FieldAccessExpr>(node))
 		return e->fieldName;
-	if (auto *e = dynamic_cast<AST::MemberAccessExpr *>(node))
+	if (auto *e = AST::as<AST::MemberAccessExpr>(node))
 		return e->member;
 	return "";
 }
@@ -406,19 +406,19 @@ void LSP::buildGlobalSymbols(DocumentState &doc)
 
 	for (const auto &stmt : doc.program->statements)
 	{
-		if (auto *fn = dynamic_cast<AST::FunctionDecl *>(stmt.get()))
+		if (auto *fn = AST::as<AST::FunctionDecl>(stmt.get()))
 			tryRegister(fn->name, fn);
-		else if (auto *st = dynamic_cast<AST::StructDecl *>(stmt.get()))
+		else if (auto *st = AST::as<AST::StructDecl>(stmt.get()))
 			tryRegister(st->name, st);
-		else if (auto *vd = dynamic_cast<AST::VarDecl *>(stmt.get()))
+		else if (auto *vd = AST::as<AST::VarDecl>(stmt.get()))
 			tryRegister(vd->name, vd);
-		else if (auto *ex = dynamic_cast<AST::ExportStmt *>(stmt.get()))
+		else if (auto *ex = AST::as<AST::ExportStmt>(stmt.get()))
 		{
-			if (auto *fn = dynamic_cast<AST::FunctionDecl *>(ex->declaration.get()))
+			if (auto *fn = AST::as<AST::FunctionDecl>(ex->declaration.get()))
 				tryRegister(fn->name, fn);
-			else if (auto *st = dynamic_cast<AST::StructDecl *>(ex->declaration.get()))
+			else if (auto *st = AST::as<AST::StructDecl>(ex->declaration.get()))
 				tryRegister(st->name, st);
-			else if (auto *vd = dynamic_cast<AST::VarDecl *>(ex->declaration.get()))
+			else if (auto *vd = AST::as<AST::VarDecl>(ex->declaration.get()))
 				tryRegister(vd->name, vd);
 		}
 	}
@@ -431,7 +431,7 @@ void LSP::compile(DocumentState &doc)
 	{
 		Lexer  lexer(doc.source);
 		auto   tokens = lexer.tokenize();
-		Parser parser(tokens);
+		Parser parser(std::move(tokens));
 		doc.program = parser.parse();
 
 		if (auto err = lexer.getError())
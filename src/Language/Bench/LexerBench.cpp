@@ -0,0 +1,77 @@
+// Lexer throughput benchmark, built with -DBENCHMARKS=ON
+//
+//   phasor_lexer_bench [megabytes] [iterations] [file.phs]
+//
+// Without a file, lexes a generated multi-megabyte script shaped like real
+// code: functions, indentation, comments, identifiers and escaped strings.
+#include "../Phasor/Lexer/Lexer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <print>
+#include <string>
+
+static std::string generateSource(size_t bytes)
+{
+	std::string source;
+	source.reserve(bytes + 512);
+	for (size_t i = 0; source.size() < bytes; ++i)
+	{
+		std::string n = std::to_string(i);
+		source += "// helper number " + n + ", generated for the lexer benchmark\n";
+		source += "fn compute_value_" + n + "(input_value: int, scale_factor: float) -> int {\n";
+		source += "    var accumulator_total: int = input_value * " + n + " + 42;\n";
+		source += "    var message_text: string = \"iteration\\t" + n + " of the \\\"benchmark\\\" run\\n\";\n";
+		source += "    while (accumulator_total > 1000) {\n";
+		source += "        accumulator_total = accumulator_total / 2 - 3.25;\n";
+		source += "    }\n";
+		source += "    if (accumulator_total >= 10 && scale_factor != 0.5) { print(message_text); }\n";
+		source += "    return accumulator_total;\n";
+		source += "}\n\n";
+	}
+	return source;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 8;
+	int    iterations = argc > 2 ? std::atoi(argv[2]) : 5;
+	iterations = std::max(iterations, 1);
+
+	std::string source;
+	if (argc > 3)
+	{
+		std::ifstream file(argv[3], std::ios::binary);
+		if (!file.is_open())
+		{
+			std::println(stderr, "Could not open file {}", argv[3]);
+			return 1;
+		}
+		source.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+	else
+	{
+		source = generateSource(megabytes * 1024 * 1024);
+	}
+
+	using Clock = std::chrono::steady_clock;
+	double best = 0;
+	size_t tokenCount = 0;
+	for (int i = 0; i < iterations; ++i)
+	{
+		auto          start = Clock::now();
+		Phasor::Lexer lexer(source);
+		auto          tokens = lexer.tokenize();
+		double        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		tokenCount = tokens.size();
+		best = i == 0 ? seconds : std::min(best, seconds);
+	}
+
+	double mb = static_cast<double>(source.size()) / (1024.0 * 1024.0);
+	std::println("{:.2f} MiB, {} tokens, best of {}: {:.2f} ms ({:.1f} MiB/s, {:.1f} Mtok/s)", mb, tokenCount,
+	             iterations, best * 1000.0, mb / best, static_cast<double>(tokenCount) / best / 1e6);
+	return 0;
+}
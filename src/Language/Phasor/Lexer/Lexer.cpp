@@ -1,6 +1,6 @@
 #include "Lexer.hpp"
-#include <cctype>
-#include <sstream>
+#include "../../Scan.hpp"
+#include <array>
 #include <algorithm>
 #include <stdexcept>
 #include <utility>
@@ -9,9 +9,8 @@
 namespace Phasor
 {
 
-Lexer::Lexer(std::string source) : source(std::move(source))
+Lexer::Lexer(std::string_view source) : source(source)
 {
-	std::erase(this->source, '\r');
 }
 
 void Lexer::skipShebang()
@@ -28,6 +27,7 @@ void Lexer::skipShebang()
 std::vector<Token> Lexer::tokenize()
 {
 	std::vector<Token> tokens;
+	tokens.reserve(source.size() / 6 + 1); // code averages 6+ bytes per token, so large inputs never regrow
 	skipShebang();
 	while (!isAtEnd())
 	{
@@ -38,7 +38,7 @@ std::vector<Token> Lexer::tokenize()
 		}
 		tokens.push_back(scanToken());
 	}
-	tokens.push_back({Phasor::TokenType::EndOfFile, "", line, column});
+	tokens.push_back({Phasor::TokenType::EndOfFile, {}, line, column});
 	return tokens;
 }
 
@@ -68,22 +68,37 @@ bool Lexer::isAtEnd()
 	return position >= source.length();
 }
 
+void Lexer::advanceTo(const char *stop)
+{
+	const char *begin = source.data() + position;
+	Scan::Lines lines = Scan::countLines(begin, stop);
+	if (lines.count == 0)
+	{
+		column += static_cast<size_t>(stop - begin);
+	}
+	else
+	{
+		line += lines.count;
+		column = static_cast<size_t>(stop - lines.last);
+	}
+	position = static_cast<size_t>(stop - source.data());
+}
+
 void Lexer::skipWhitespace()
 {
+	const char *end = source.data() + source.length();
 	while (!isAtEnd())
 	{
-		char c = peek();
-		if (std::isspace(static_cast<unsigned char>(c)) != 0)
+		const char *p = source.data() + position;
+		if (const char *stop = Scan::spaceEnd(p, end); stop != p)
 		{
-			advance();
+			// '\r' is plain whitespace here, so CRLF sources need no copy
+			advanceTo(stop);
 		}
-		else if (c == '/' && position + 1 < source.length() && source[position + 1] == '/')
+		else if (*p == '/' && position + 1 < source.length() && p[1] == '/')
 		{
 			// Skip single-line comment
-			while (!isAtEnd() && peek() != '\n')
-			{
-				advance();
-			}
+			advanceTo(Scan::find(p, end, '\n'));
 		}
 		else
 		{
@@ -95,11 +110,11 @@ void Lexer::skipWhitespace()
 Token Lexer::scanToken()
 {
 	char c = peek();
-	if (std::isalpha(static_cast<unsigned char>(c)) != 0)
+	if (Scan::isAlpha(c))
 	{
 		return identifier();
 	}
-	if (std::isdigit(static_cast<unsigned char>(c)) != 0)
+	if (Scan::isDigit(c))
 	{
 		return number();
 	}
@@ -169,36 +184,33 @@ Token Lexer::scanToken()
 	}
 
 	// Single-character symbols (parentheses, operators, punctuation, etc.)
-	if (std::string("()+-*/%<>=!&|.{}:;,[]").find(c) != std::string::npos)
+	std::string_view text = source.substr(position, 1);
+	if (std::string_view("()+-*/%<>=!&|.{}:;,[]").find(c) != std::string_view::npos)
 	{
 		advance();
-		return {Phasor::TokenType::Symbol, std::string(1, c), line, column};
+		return {Phasor::TokenType::Symbol, text, line, column};
 	}
 
 	advance();
-	return {Phasor::TokenType::Unknown, std::string(1, c), line, column};
+	return {Phasor::TokenType::Unknown, text, line, column};
 }
 
 Token Lexer::identifier()
 {
-	size_t start = position;
-	while ((std::isalnum(static_cast<unsigned char>(peek())) != 0) || peek() == '_')
+	const char *begin = source.data() + position;
+	const char *stop = Scan::identifierEnd(begin, source.data() + source.length());
+	std::string_view text = source.substr(position, static_cast<size_t>(stop - begin));
+	position += text.length();
+	column += text.length();
+
+	static constexpr std::array<std::string_view, 22> keywords = {
+	    "var",   "fn",    "if",     "else",     "while",  "for",    "return", "true",    "false",
+	    "null",  "throw", "print",  "break",    "continue", "switch", "case", "default", "include",
+	    "import", "export", "struct", "any"};
+
+	if (std::ranges::find(keywords, text) != keywords.end())
 	{
-		advance();
-	}
-	std::string text = source.substr(start, position - start);
-
-	static const std::vector<std::string> keywords = {"var",    "fn",       "if",     "else",    "while",   "for",
-	                                                  "return", "true",     "false",  "null",    "throw",   "print",
-	                                                  "break",  "continue", "switch", "case",    "default", "include",
-	                                                  "struct", "any"};
-
-	for (const auto &kw : keywords)
-	{
-		if (text == kw)
-		{
-			return {Phasor::TokenType::Keyword, text, line, column};
-		}
+		return {Phasor::TokenType::Keyword, text, line, column};
 	}
 
 	return {Phasor::TokenType::Identifier, text, line, column};
@@ -206,19 +218,13 @@ Token Lexer::identifier()
 
 Token Lexer::number()
 {
-	size_t start = position;
-	while (std::isdigit(static_cast<unsigned char>(peek())) != 0)
-	{
-		advance();
-	}
-	if (peek() == '.' && position + 1 < source.length() &&
-	    (std::isdigit(static_cast<unsigned char>(source[position + 1])) != 0))
+	size_t      start = position;
+	const char *end = source.data() + source.length();
+	advanceTo(Scan::digitsEnd(source.data() + position, end));
+	if (peek() == '.' && position + 1 < source.length() && Scan::isDigit(source[position + 1]))
 	{
 		advance();
-		while (std::isdigit(static_cast<unsigned char>(peek())) != 0)
-		{
-			advance();
-		}
+		advanceTo(Scan::digitsEnd(source.data() + position, end));
 	}
 	return {Phasor::TokenType::Number, source.substr(start, position - start), line, column};
 }
@@ -242,137 +248,201 @@ static int hexValue(char c)
 
 Token Lexer::string()
 {
-	size_t             tokenLine = line;
-	size_t             tokenColumn = column;
-	std::ostringstream out;
+	size_t      tokenLine = line;
+	size_t      tokenColumn = column;
+	const char *end = source.data() + source.length();
 	advance(); // Skip opening quote
 
+	// Only validate escapes here, the parser decodes them through stringValue()
+	size_t     bodyStart = position;
+	StringForm form = StringForm::Verbatim;
 	while (!isAtEnd())
 	{
-		char c = advance();
+		advanceTo(Scan::quotedStop(source.data() + position, end));
+		if (isAtEnd())
+			break;
+
+		size_t bodyEnd = position;
+		char   c = advance();
 
 		if (c == '\n')
-			return {Phasor::TokenType::Unknown, std::string(), tokenLine, tokenColumn};
+			return {Phasor::TokenType::Unknown, {}, tokenLine, tokenColumn};
 
-		if (c == '\\')
-		{
-			if (isAtEnd())
-				return {Phasor::TokenType::Unknown, std::string(), tokenLine, tokenColumn};
+		if (c == '"')
+			return {Phasor::TokenType::String, source.substr(bodyStart, bodyEnd - bodyStart), tokenLine, tokenColumn, form};
 
-			char esc = advance();
-			switch (esc)
-			{
-			case 'a':  out << '\a'; break;
-			case 'b':  out << '\b'; break;
-			case 'f':  out << '\f'; break;
-			case 'n':  out << '\n'; break;
-			case 'r':  out << '\r'; break;
-			case 't':  out << '\t'; break;
-			case 'v':  out << '\v'; break;
-			case '\\': out << '\\'; break;
-			case '\'': out << '\''; break;
-			case '"':  out << '"';  break;
-
-			case 'e':
-			case 'E':
-				out << '\x1b';
-				break;
-
-			case '0': case '1': case '2': case '3':
-			case '4': case '5': case '6': case '7':
-			{
-				u32 val = static_cast<u32>(esc - '0');
-				for (int i = 1; i < 3 && !isAtEnd(); ++i)
-				{
-					char d = peek();
-					if (d < '0' || d > '7') break;
-					advance();
-					val = val * 8 + static_cast<u32>(d - '0');
-				}
-				if (val > 0xFF)
-					return {Phasor::TokenType::Unknown, std::string(), tokenLine, tokenColumn};
-				out << static_cast<char>(val);
-				break;
-			}
+		form = StringForm::Escaped;
+		if (c == '\r')
+		{
+			--column; // dropped from the value, and never counted as a column
+			continue;
+		}
 
-			case 'x':
-			{
-				if (isAtEnd() || hexValue(peek()) < 0)
-					return {Phasor::TokenType::Unknown, std::string(), tokenLine, tokenColumn};
-				int val = hexValue(advance());
-				if (!isAtEnd() && hexValue(peek()) >= 0)
-					val = (val << 4) | hexValue(advance());
-				out << static_cast<char>(val);
-				break;
-			}
+		if (isAtEnd())
+			return {Phasor::TokenType::Unknown, {}, tokenLine, tokenColumn};
 
-			case 'u':
-			case 'U':
+		char esc = advance();
+		switch (esc)
+		{
+		case '0': case '1': case '2': case '3':
+		case '4': case '5': case '6': case '7':
+		{
+			u32 val = static_cast<u32>(esc - '0');
+			for (int i = 1; i < 3 && !isAtEnd(); ++i)
 			{
-				int      ndigits = (esc == 'u') ? 4 : 8;
-				u32 cp      = 0;
-				for (int i = 0; i < ndigits; ++i)
-				{
-					if (isAtEnd() || hexValue(peek()) < 0)
-						return {Phasor::TokenType::Unknown, std::string(), tokenLine, tokenColumn};
-					cp = (cp << 4) | static_cast<u32>(hexValue(advance()));
-				}
-				if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
-					return {Phasor::TokenType::Unknown, std::string(), tokenLine, tokenColumn};
-				if      (cp <= 0x7F)   { out << static_cast<char>(cp); }
-				else if (cp <= 0x7FF)  { out << static_cast<char>(0xC0 | (cp >> 6))
-				                            << static_cast<char>(0x80 | (cp & 0x3F)); }
-				else if (cp <= 0xFFFF) { out << static_cast<char>(0xE0 | (cp >> 12))
-				                            << static_cast<char>(0x80 | ((cp >> 6) & 0x3F))
-				                            << static_cast<char>(0x80 | (cp & 0x3F)); }
-				else                   { out << static_cast<char>(0xF0 | (cp >> 18))
-				                            << static_cast<char>(0x80 | ((cp >> 12) & 0x3F))
-				                            << static_cast<char>(0x80 | ((cp >> 6) & 0x3F))
-				                            << static_cast<char>(0x80 | (cp & 0x3F)); }
-				break;
-			}
-
-			default:
-				out << esc;
-				break;
+				char d = peek();
+				if (d < '0' || d > '7') break;
+				advance();
+				val = val * 8 + static_cast<u32>(d - '0');
 			}
+			if (val > 0xFF)
+				return {Phasor::TokenType::Unknown, {}, tokenLine, tokenColumn};
+			break;
 		}
-		else if (c == '"')
+
+		case 'x':
 		{
-			return {Phasor::TokenType::String, out.str(), tokenLine, tokenColumn};
+			if (isAtEnd() || hexValue(peek()) < 0)
+				return {Phasor::TokenType::Unknown, {}, tokenLine, tokenColumn};
+			advance();
+			if (!isAtEnd() && hexValue(peek()) >= 0)
+				advance();
+			break;
 		}
-		else
+
+		case 'u':
+		case 'U':
 		{
-			out << c;
+			int ndigits = (esc == 'u') ? 4 : 8;
+			u32 cp      = 0;
+			for (int i = 0; i < ndigits; ++i)
+			{
+				if (isAtEnd() || hexValue(peek()) < 0)
+					return {Phasor::TokenType::Unknown, {}, tokenLine, tokenColumn};
+				cp = (cp << 4) | static_cast<u32>(hexValue(advance()));
+			}
+			if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+				return {Phasor::TokenType::Unknown, {}, tokenLine, tokenColumn};
+			break;
+		}
+
+		default:
+			break;
 		}
 	}
 
-	return {Phasor::TokenType::Unknown, std::string(), tokenLine, tokenColumn};
+	return {Phasor::TokenType::Unknown, {}, tokenLine, tokenColumn};
 }
 
 Token Lexer::complexString()
 {
-	size_t             tokenLine = line;
-	size_t             tokenColumn = column;
-	std::ostringstream out;
+	size_t tokenLine = line;
+	size_t tokenColumn = column;
 	advance(); // Skip opening backtick
 
 	// Not even attempting ${} syntax for now. Just read as a raw string.
 
-	while (!isAtEnd())
+	const char *begin = source.data() + position;
+	const char *end = source.data() + source.length();
+	const char *close = Scan::find(begin, end, '`');
+	advanceTo(close);
+
+	if (close == end)
+	{
+		// If we get here, string was unterminated
+		return {Phasor::TokenType::Unknown, {}, tokenLine, tokenColumn};
+	}
+
+	std::string_view body(begin, static_cast<size_t>(close - begin));
+	advance(); // Closing backtick
+	StringForm form = body.find('\r') != std::string_view::npos ? StringForm::Raw : StringForm::Verbatim;
+	return {Phasor::TokenType::String, body, tokenLine, tokenColumn, form};
+}
+
+std::string Lexer::stringValue(const Token &token)
+{
+	std::string_view body = token.lexeme;
+	if (token.form == StringForm::Verbatim)
 	{
-		char c = advance();
+		return std::string(body);
+	}
 
-		if (c == '`')
+	std::string out;
+	out.reserve(body.length());
+	for (size_t i = 0; i < body.length(); ++i)
+	{
+		char c = body[i];
+		if (c == '\r')
+			continue;
+		if (c != '\\' || token.form == StringForm::Raw || i + 1 >= body.length())
 		{
-			// Closing backtick
-			return {Phasor::TokenType::String, out.str(), tokenLine, tokenColumn};
+			out += c;
+			continue;
 		}
 
-		out << c;
-	}
+		char esc = body[++i];
+		switch (esc)
+		{
+		case 'a':  out += '\a'; break;
+		case 'b':  out += '\b'; break;
+		case 'f':  out += '\f'; break;
+		case 'n':  out += '\n'; break;
+		case 'r':  out += '\r'; break;
+		case 't':  out += '\t'; break;
+		case 'v':  out += '\v'; break;
+		case '\\': out += '\\'; break;
+		case '\'': out += '\''; break;
+		case '"':  out += '"';  break;
+
+		case 'e':
+		case 'E':
+			out += '\x1b';
+			break;
 
-	// If we get here, string was unterminated
-	return {Phasor::TokenType::Unknown, std::string(), tokenLine, tokenColumn};
+		case '0': case '1': case '2': case '3':
+		case '4': case '5': case '6': case '7':
+		{
+			u32 val = static_cast<u32>(esc - '0');
+			for (int n = 1; n < 3 && i + 1 < body.length() && body[i + 1] >= '0' && body[i + 1] <= '7'; ++n)
+				val = val * 8 + static_cast<u32>(body[++i] - '0');
+			out += static_cast<char>(val);
+			break;
+		}
+
+		case 'x':
+		{
+			int val = 0;
+			for (int n = 0; n < 2 && i + 1 < body.length() && hexValue(body[i + 1]) >= 0; ++n)
+				val = (val << 4) | hexValue(body[++i]);
+			out += static_cast<char>(val);
+			break;
+		}
+
+		case 'u':
+		case 'U':
+		{
+			int ndigits = (esc == 'u') ? 4 : 8;
+			u32 cp      = 0;
+			for (int n = 0; n < ndigits && i + 1 < body.length(); ++n)
+				cp = (cp << 4) | static_cast<u32>(hexValue(body[++i]));
+			if      (cp <= 0x7F)   { out += static_cast<char>(cp); }
+			else if (cp <= 0x7FF)  { out += static_cast<char>(0xC0 | (cp >> 6));
+			                         out += static_cast<char>(0x80 | (cp & 0x3F)); }
+			else if (cp <= 0xFFFF) { out += static_cast<char>(0xE0 | (cp >> 12));
+			                         out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+			                         out += static_cast<char>(0x80 | (cp & 0x3F)); }
+			else                   { out += static_cast<char>(0xF0 | (cp >> 18));
+			                         out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+			                         out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+			                         out += static_cast<char>(0x80 | (cp & 0x3F)); }
+			break;
+		}
+
+		default:
+			out += esc;
+			break;
+		}
+	}
+	return out;
 }
-} // namespace Phasor
\ No newline at end of file
+} // namespace Phasor
@@ -8,42 +8,50 @@
 namespace Phasor
 {
 
-static std::vector<Token> tokenizeFile(const std::filesystem::path &path)
+static std::string readFile(const std::filesystem::path &path)
 {
-	std::ifstream file(path);
+	std::ifstream file(path, std::ios::binary);
 	if (!file.is_open())
 	{
 		throw std::runtime_error("Could not open file " + path.string());
 	}
-	std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-	file.close();
-
-	Lexer lexer(source);
-	return lexer.tokenize();
+	return {(std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()};
 }
 
-static std::vector<std::unique_ptr<AST::Statement>> resolveIncludes(std::vector<std::unique_ptr<AST::Statement>> &stmts,
-                                                                    const std::filesystem::path &baseDir);
+static std::vector<AST::Ptr<AST::Statement>> resolveIncludes(std::vector<AST::Ptr<AST::Statement>> &stmts,
+                                                             const std::filesystem::path &baseDir, AST::Arena &arena,
+                                                             std::vector<std::filesystem::path> &included,
+                                                             std::ostream                       &diagnostics);
 
-static std::vector<std::unique_ptr<AST::Statement>> resolveIncludesInternal(
-    std::vector<std::unique_ptr<AST::Statement>> &stmts, const std::filesystem::path &baseDir)
+static std::vector<AST::Ptr<AST::Statement>> resolveIncludesInternal(std::vector<AST::Ptr<AST::Statement>> &stmts,
+                                                                     const std::filesystem::path        &baseDir,
+                                                                     AST::Arena                         &arena,
+                                                                     std::vector<std::filesystem::path> &included,
+                                                                     std::ostream                       &diagnostics)
 {
-	std::vector<std::unique_ptr<AST::Statement>> result;
+	std::vector<AST::Ptr<AST::Statement>> result;
 
 	for (auto &i : stmts)
 	{
-		if (auto *includeStmt = dynamic_cast<AST::IncludeStmt *>(i.get()))
+		if (auto *includeStmt = AST::as<AST::IncludeStmt>(i.get()))
 		{
-			auto   includePath = (baseDir / includeStmt->modulePath).lexically_normal();
-			auto   tokens = tokenizeFile(includePath);
-			Parser parser(tokens, includePath);
-			auto   program = parser.parse();
-
-			auto resolved = resolveIncludes(program->statements, includePath.parent_path());
+			// Tokens borrow from source, so it has to live until the included file is parsed
+			auto        includePath = (baseDir / includeStmt->modulePath).lexically_normal();
+			std::string source = readFile(includePath);
+			Lexer       lexer(source);
+			Parser      parser(lexer.tokenize(), includePath);
+			parser.setDiagnostics(diagnostics);
+			auto program = parser.parse();
+			included.push_back(includePath);
+			included.insert(included.end(), parser.includedFiles().begin(), parser.includedFiles().end());
+
+			auto resolved = resolveIncludes(program->statements, includePath.parent_path(), arena, included, diagnostics);
 			for (auto &stmt : resolved)
 			{
 				result.push_back(std::move(stmt));
 			}
+			// The spliced statements still live in the included program's arena
+			arena.absorb(std::move(*program->arena));
 		}
 		else
 		{
@@ -54,37 +62,41 @@ static std::vector<std::unique_ptr<AST::Statement>> resolveIncludesInternal(
 	return result;
 }
 
-static std::vector<std::unique_ptr<AST::Statement>> resolveIncludes(std::vector<std::unique_ptr<AST::Statement>> &stmts,
-                                                                    const std::filesystem::path &baseDir)
+static std::vector<AST::Ptr<AST::Statement>> resolveIncludes(std::vector<AST::Ptr<AST::Statement>> &stmts,
+                                                             const std::filesystem::path &baseDir, AST::Arena &arena,
+                                                             std::vector<std::filesystem::path> &included,
+                                                             std::ostream                       &diagnostics)
 {
-	return resolveIncludesInternal(stmts, baseDir);
+	return resolveIncludesInternal(stmts, baseDir, arena, included, diagnostics);
 }
 
 using namespace AST;
 
-Parser::Parser(const std::vector<Token> &tokens) : tokens(tokens)
+Parser::Parser(std::vector<Token> tokens) : tokens(std::move(tokens))
 {
 }
 
-Parser::Parser(const std::vector<Token> &tokens, std::filesystem::path sourcePath)
-    : tokens(tokens), sourcePath(std::move(sourcePath))
+Parser::Parser(std::vector<Token> tokens, std::filesystem::path sourcePath)
+    : tokens(std::move(tokens)), sourcePath(std::move(sourcePath))
 {
 }
 
 std::unique_ptr<Program> Parser::parse()
 {
 	auto program = std::make_unique<Program>();
+	arena = program->arena.get();
 	while (!isAtEnd())
 	{
 		program->statements.push_back(declaration());
 	}
 
-	program->statements = Phasor::resolveIncludes(program->statements, sourcePath.parent_path());
+	program->statements = Phasor::resolveIncludes(program->statements, sourcePath.parent_path(), *arena, includes,
+	                                              *diagnostics);
 
 	return program;
 }
 
-std::unique_ptr<Statement> Parser::declaration()
+Ptr<Statement> Parser::declaration()
 {
 	if (check(Phasor::TokenType::Keyword) && peek().lexeme == "fn")
 	{
@@ -129,7 +141,7 @@ std::unique_ptr<Statement> Parser::declaration()
 	return statement();
 }
 
-std::unique_ptr<Statement> Parser::functionDeclaration()
+Ptr<Statement> Parser::functionDeclaration()
 {
 	Token name = consume(Phasor::TokenType::Identifier, "Expect function name.");
 	consume(Phasor::TokenType::Symbol, "(", "Expect '(' after function name.");
@@ -141,12 +153,12 @@ std::unique_ptr<Statement> Parser::functionDeclaration()
 			Token paramName = consume(Phasor::TokenType::Identifier, "Expect parameter name.");
 			consume(Phasor::TokenType::Symbol, ":", "Expect ':' after parameter name.");
 			auto type = parseType();
-			params.push_back({paramName.lexeme, std::move(type)});
+			params.push_back({std::string(paramName.lexeme), std::move(type)});
 		} while (match(Phasor::TokenType::Symbol, ","));
 	}
 	consume(Phasor::TokenType::Symbol, ")", "Expect ')' after parameters.");
 
-	std::unique_ptr<TypeNode> returnType = nullptr;
+	Ptr<TypeNode> returnType = nullptr;
 	if (match(Phasor::TokenType::Symbol, "->"))
 	{
 		returnType = parseType();
@@ -156,20 +168,20 @@ std::unique_ptr<Statement> Parser::functionDeclaration()
 
 	// Track function context for better error messages
 	std::string previousFunction = currentFunction;
-	currentFunction = name.lexeme;
+	currentFunction = std::string(name.lexeme);
 
 	auto body = block();
 
 	// Restore previous function context
 	currentFunction = previousFunction;
 
-	auto node = std::make_unique<FunctionDecl>(name.lexeme, std::move(params), std::move(returnType), std::move(body));
+	auto node = make<FunctionDecl>(std::string(name.lexeme), std::move(params), std::move(returnType), std::move(body));
 	node->line = name.line;
 	node->column = name.column;
 	return node;
 }
 
-std::unique_ptr<TypeNode> Parser::parseType()
+Ptr<TypeNode> Parser::parseType()
 {
     Token start = peek();
     bool  isPointer = false;
@@ -199,7 +211,7 @@ std::unique_ptr<TypeNode> Parser::parseType()
         if (check(Phasor::TokenType::Number))
         {
             Token size = consume(Phasor::TokenType::Number, "Expect array size in type declaration.");
-            dims.push_back(std::stoi(size.lexeme));
+            dims.push_back(std::stoi(std::string(size.lexeme)));
         }
         else
         {
@@ -207,13 +219,13 @@ std::unique_ptr<TypeNode> Parser::parseType()
         }
         consume(Phasor::TokenType::Symbol, "]", "Expect ']' after array size.");
     }
-    auto node = std::make_unique<TypeNode>(typeName.lexeme, isPointer, dims);
+    auto node = make<TypeNode>(std::string(typeName.lexeme), isPointer, dims);
     node->line = start.line;
     node->column = start.column;
     return node;
 }
 
-std::unique_ptr<Statement> Parser::varDeclaration()
+Ptr<Statement> Parser::varDeclaration()
 {
     Token name = consume(Phasor::TokenType::Identifier, "Expect variable name.");
 
@@ -225,7 +237,7 @@ std::unique_ptr<Statement> Parser::varDeclaration()
     consume(Phasor::TokenType::Symbol, ":", "Expect ':' after variable name.");
     auto type = parseType();
 
-    std::unique_ptr<Expression> initializer = nullptr;
+    Ptr<Expression> initializer = nullptr;
     if (match(Phasor::TokenType::Symbol, "="))
     {
         initializer = expression();
@@ -233,13 +245,13 @@ std::unique_ptr<Statement> Parser::varDeclaration()
     
     consume(Phasor::TokenType::Symbol, ";", "Expect ';' after variable declaration.");
     
-    auto node = std::make_unique<VarDecl>(name.lexeme, std::move(type), std::move(initializer));
+    auto node = make<VarDecl>(std::string(name.lexeme), std::move(type), std::move(initializer));
     node->line = name.line;
     node->column = name.column;
     return node;
 }
 
-std::unique_ptr<Statement> Parser::statement()
+Ptr<Statement> Parser::statement()
 {
 	if (check(Phasor::TokenType::Keyword) && peek().lexeme == "print")
 	{
@@ -300,7 +312,7 @@ std::unique_ptr<Statement> Parser::statement()
 		Token start = peek();
 		advance();
 		consume(Phasor::TokenType::Symbol, ";", "Expect ';' after 'break'.");
-		auto node = std::make_unique<BreakStmt>();
+		auto node = make<BreakStmt>();
 		node->line = start.line;
 		node->column = start.column;
 		return node;
@@ -310,7 +322,7 @@ std::unique_ptr<Statement> Parser::statement()
 		Token start = peek();
 		advance();
 		consume(Phasor::TokenType::Symbol, ";", "Expect ';' after 'continue'.");
-		auto node = std::make_unique<ContinueStmt>();
+		auto node = make<ContinueStmt>();
 		node->line = start.line;
 		node->column = start.column;
 		return node;
@@ -324,7 +336,7 @@ std::unique_ptr<Statement> Parser::statement()
 
 		consume(Phasor::TokenType::Symbol, ";", "Expect ';' after include.");
 
-		auto node = std::make_unique<IncludeStmt>(pathToken.lexeme);
+		auto node = make<IncludeStmt>(Lexer::stringValue(pathToken));
 		node->line = start.line;
 		node->column = start.column;
 		return node;
@@ -350,35 +362,35 @@ std::unique_ptr<Statement> Parser::statement()
 	return expressionStatement();
 }
 
-std::unique_ptr<Statement> Parser::ifStatement()
+Ptr<Statement> Parser::ifStatement()
 {
 	consume(Phasor::TokenType::Symbol, "(", "Expect '(' after 'if'.");
 	auto condition = expression();
 	consume(Phasor::TokenType::Symbol, ")", "Expect ')' after if condition.");
 	auto                       thenBranch = statement();
-	std::unique_ptr<Statement> elseBranch = nullptr;
+	Ptr<Statement> elseBranch = nullptr;
 	if (match(Phasor::TokenType::Keyword, "else"))
 	{
 		elseBranch = statement();
 	}
-	return std::make_unique<IfStmt>(std::move(condition), std::move(thenBranch), std::move(elseBranch));
+	return make<IfStmt>(std::move(condition), std::move(thenBranch), std::move(elseBranch));
 	// Note: line/column is set by the caller (statement()) from the 'if' keyword token.
 }
 
-std::unique_ptr<Statement> Parser::whileStatement()
+Ptr<Statement> Parser::whileStatement()
 {
 	consume(Phasor::TokenType::Symbol, "(", "Expect '(' after 'while'.");
 	auto condition = expression();
 	consume(Phasor::TokenType::Symbol, ")", "Expect ')' after while condition.");
 	auto body = statement();
-	return std::make_unique<WhileStmt>(std::move(condition), std::move(body));
+	return make<WhileStmt>(std::move(condition), std::move(body));
 }
 
-std::unique_ptr<Statement> Parser::forStatement()
+Ptr<Statement> Parser::forStatement()
 {
 	consume(Phasor::TokenType::Symbol, "(", "Expect '(' after 'for'.");
 
-	std::unique_ptr<Statement> initializer = nullptr;
+	Ptr<Statement> initializer = nullptr;
 	if (!check(Phasor::TokenType::Symbol) || peek().lexeme != ";")
 	{
 		if (check(Phasor::TokenType::Keyword) && peek().lexeme == "var")
@@ -396,14 +408,14 @@ std::unique_ptr<Statement> Parser::forStatement()
 		consume(Phasor::TokenType::Symbol, ";", "Expect ';'.");
 	}
 
-	std::unique_ptr<Expression> condition = nullptr;
+	Ptr<Expression> condition = nullptr;
 	if (!check(Phasor::TokenType::Symbol) || peek().lexeme != ";")
 	{
 		condition = expression();
 	}
 	consume(Phasor::TokenType::Symbol, ";", "Expect ';' after loop condition.");
 
-	std::unique_ptr<Expression> increment = nullptr;
+	Ptr<Expression> increment = nullptr;
 	if (!check(Phasor::TokenType::Symbol) || peek().lexeme != ")")
 	{
 		increment = expression();
@@ -411,11 +423,11 @@ std::unique_ptr<Statement> Parser::forStatement()
 	consume(Phasor::TokenType::Symbol, ")", "Expect ')' after for clauses.");
 
 	auto body = statement();
-	return std::make_unique<ForStmt>(std::move(initializer), std::move(condition), std::move(increment),
+	return make<ForStmt>(std::move(initializer), std::move(condition), std::move(increment),
 	                                 std::move(body));
 }
 
-std::unique_ptr<Statement> Parser::switchStatement()
+Ptr<Statement> Parser::switchStatement()
 {
 	consume(Phasor::TokenType::Symbol, "(", "Expect '(' after 'switch'.");
 	auto expr = expression();
@@ -423,7 +435,7 @@ std::unique_ptr<Statement> Parser::switchStatement()
 	consume(Phasor::TokenType::Symbol, "{", "Expect '{' after switch.");
 
 	std::vector<CaseClause>                 cases;
-	std::vector<std::unique_ptr<Statement>> defaultStmts;
+	std::vector<Ptr<Statement>> defaultStmts;
 
 	while (!check(Phasor::TokenType::Symbol) || peek().lexeme != "}")
 	{
@@ -439,7 +451,7 @@ std::unique_ptr<Statement> Parser::switchStatement()
 			auto caseValue = expression();
 			consume(Phasor::TokenType::Symbol, ":", "Expect ':' after case value.");
 
-			std::vector<std::unique_ptr<Statement>> stmts;
+			std::vector<Ptr<Statement>> stmts;
 			while ((!check(Phasor::TokenType::Keyword) || (peek().lexeme != "case" && peek().lexeme != "default")) &&
 			       (!check(Phasor::TokenType::Symbol) || peek().lexeme != "}"))
 			{
@@ -476,30 +488,30 @@ std::unique_ptr<Statement> Parser::switchStatement()
 	}
 
 	consume(Phasor::TokenType::Symbol, "}", "Expect '}' after switch body.");
-	return std::make_unique<SwitchStmt>(std::move(expr), std::move(cases), std::move(defaultStmts));
+	return make<SwitchStmt>(std::move(expr), std::move(cases), std::move(defaultStmts));
 }
 
-std::unique_ptr<Statement> Parser::returnStatement()
+Ptr<Statement> Parser::returnStatement()
 {
-	std::unique_ptr<Expression> value = nullptr;
+	Ptr<Expression> value = nullptr;
 	if (!check(Phasor::TokenType::Symbol) || peek().lexeme != ";")
 	{
 		value = expression();
 	}
 	consume(Phasor::TokenType::Symbol, ";", "Expect ';' after return value.");
-	return std::make_unique<ReturnStmt>(std::move(value));
+	return make<ReturnStmt>(std::move(value));
 	// Note: line/column is set by the caller (statement()) from the 'return' keyword token.
 }
 
-std::unique_ptr<Statement> Parser::unsafeStatement()
+Ptr<Statement> Parser::unsafeStatement()
 {
 	consume(Phasor::TokenType::Symbol, "{", "Expect '{' after 'unsafe'.");
-	return std::make_unique<UnsafeBlockStmt>(block());
+	return make<UnsafeBlockStmt>(block());
 }
 
-std::unique_ptr<BlockStmt> Parser::block()
+Ptr<BlockStmt> Parser::block()
 {
-	std::vector<std::unique_ptr<Statement>> statements;
+	std::vector<Ptr<Statement>> statements;
 	while (!check(Phasor::TokenType::Symbol) || peek().lexeme != "}")
 	{
 		if (isAtEnd())
@@ -510,51 +522,51 @@ std::unique_ptr<BlockStmt> Parser::block()
 		statements.push_back(declaration());
 	}
 	consume(Phasor::TokenType::Symbol, "}", "Expect '}' after block.");
-	return std::make_unique<BlockStmt>(std::move(statements));
+	return make<BlockStmt>(std::move(statements));
 }
 
-std::unique_ptr<Statement> Parser::printStatement()
+Ptr<Statement> Parser::printStatement()
 {
 	auto expr = expression();
 	consume(Phasor::TokenType::Symbol, ";", "Expect ';' after print statement.");
-	return std::make_unique<PrintStmt>(std::move(expr));
+	return make<PrintStmt>(std::move(expr));
 	// Note: line/column set by caller (statement()) from the 'print' keyword token.
 }
 
-std::unique_ptr<Statement> Parser::importStatement()
+Ptr<Statement> Parser::importStatement()
 {
 	Token path = consume(Phasor::TokenType::String, "Expect string after 'import'.");
 	consume(Phasor::TokenType::Symbol, ";", "Expect ';' after import statement.");
-	auto node = std::make_unique<ImportStmt>(path.lexeme);
+	auto node = make<ImportStmt>(Lexer::stringValue(path));
 	node->line = path.line;
 	node->column = path.column;
 	return node;
 }
 
-std::unique_ptr<Statement> Parser::exportStatement()
+Ptr<Statement> Parser::exportStatement()
 {
-	auto node = std::make_unique<ExportStmt>(declaration());
+	auto node = make<ExportStmt>(declaration());
 	// line/column set by caller (declaration()) from the 'export' keyword token.
 	return node;
 }
 
-std::unique_ptr<Statement> Parser::expressionStatement()
+Ptr<Statement> Parser::expressionStatement()
 {
 	Token start = peek();
 	auto  expr = expression();
 	consume(Phasor::TokenType::Symbol, ";", "Expect ';' after expression.");
-	auto node = std::make_unique<ExpressionStmt>(std::move(expr));
+	auto node = make<ExpressionStmt>(std::move(expr));
 	node->line = start.line;
 	node->column = start.column;
 	return node;
 }
 
-std::unique_ptr<Expression> Parser::expression()
+Ptr<Expression> Parser::expression()
 {
 	return assignment();
 }
 
-std::unique_ptr<Expression> Parser::assignment()
+Ptr<Expression> Parser::assignment()
 {
 	auto expr = logicalOr();
 
@@ -562,7 +574,7 @@ std::unique_ptr<Expression> Parser::assignment()
 	{
 		Token op = previous();
 		auto  value = assignment(); // Right-associative
-		auto  node = std::make_unique<AssignmentExpr>(std::move(expr), std::move(value));
+		auto  node = make<AssignmentExpr>(std::move(expr), std::move(value));
 		node->line = op.line;
 		node->column = op.column;
 		return node;
@@ -571,7 +583,7 @@ std::unique_ptr<Expression> Parser::assignment()
 	return expr;
 }
 
-std::unique_ptr<Expression> Parser::logicalOr()
+Ptr<Expression> Parser::logicalOr()
 {
 	auto expr = logicalAnd();
 
@@ -579,7 +591,7 @@ std::unique_ptr<Expression> Parser::logicalOr()
 	{
 		Token op = advance();
 		auto  right = logicalAnd();
-		auto  node = std::make_unique<BinaryExpr>(std::move(expr), BinaryOp::Or, std::move(right));
+		auto  node = make<BinaryExpr>(std::move(expr), BinaryOp::Or, std::move(right));
 		node->line = op.line;
 		node->column = op.column;
 		expr = std::move(node);
@@ -588,7 +600,7 @@ std::unique_ptr<Expression> Parser::logicalOr()
 	return expr;
 }
 
-std::unique_ptr<Expression> Parser::logicalAnd()
+Ptr<Expression> Parser::logicalAnd()
 {
 	auto expr = equality();
 
@@ -596,7 +608,7 @@ std::unique_ptr<Expression> Parser::logicalAnd()
 	{
 		Token op = advance();
 		auto  right = equality();
-		auto  node = std::make_unique<BinaryExpr>(std::move(expr), BinaryOp::And, std::move(right));
+		auto  node = make<BinaryExpr>(std::move(expr), BinaryOp::And, std::move(right));
 		node->line = op.line;
 		node->column = op.column;
 		expr = std::move(node);
@@ -605,7 +617,7 @@ std::unique_ptr<Expression> Parser::logicalAnd()
 	return expr;
 }
 
-std::unique_ptr<Expression> Parser::equality()
+Ptr<Expression> Parser::equality()
 {
 	auto expr = comparison();
 
@@ -614,7 +626,7 @@ std::unique_ptr<Expression> Parser::equality()
 		Token    op = advance();
 		auto     right = comparison();
 		BinaryOp binOp = (op.lexeme == "==") ? BinaryOp::Equal : BinaryOp::NotEqual;
-		auto     node = std::make_unique<BinaryExpr>(std::move(expr), binOp, std::move(right));
+		auto     node = make<BinaryExpr>(std::move(expr), binOp, std::move(right));
 		node->line = op.line;
 		node->column = op.column;
 		expr = std::move(node);
@@ -623,7 +635,7 @@ std::unique_ptr<Expression> Parser::equality()
 	return expr;
 }
 
-std::unique_ptr<Expression> Parser::comparison()
+Ptr<Expression> Parser::comparison()
 {
 	auto expr = term();
 
@@ -650,7 +662,7 @@ std::unique_ptr<Expression> Parser::comparison()
 			binOp = BinaryOp::GreaterEqual;
 		}
 
-		auto node = std::make_unique<BinaryExpr>(std::move(expr), binOp, std::move(right));
+		auto node = make<BinaryExpr>(std::move(expr), binOp, std::move(right));
 		node->line = op.line;
 		node->column = op.column;
 		expr = std::move(node);
@@ -659,7 +671,7 @@ std::unique_ptr<Expression> Parser::comparison()
 	return expr;
 }
 
-std::unique_ptr<Expression> Parser::term()
+Ptr<Expression> Parser::term()
 {
 	auto expr = factor();
 
@@ -668,7 +680,7 @@ std::unique_ptr<Expression> Parser::term()
 		Token    op = advance();
 		auto     right = factor();
 		BinaryOp binOp = (op.lexeme == "+") ? BinaryOp::Add : BinaryOp::Subtract;
-		auto     node = std::make_unique<BinaryExpr>(std::move(expr), binOp, std::move(right));
+		auto     node = make<BinaryExpr>(std::move(expr), binOp, std::move(right));
 		node->line = op.line;
 		node->column = op.column;
 		expr = std::move(node);
@@ -677,7 +689,7 @@ std::unique_ptr<Expression> Parser::term()
 	return expr;
 }
 
-std::unique_ptr<Expression> Parser::factor()
+Ptr<Expression> Parser::factor()
 {
 	auto expr = unary();
 
@@ -699,7 +711,7 @@ std::unique_ptr<Expression> Parser::factor()
 			binOp = BinaryOp::Modulo;
 		}
 
-		auto node = std::make_unique<BinaryExpr>(std::move(expr), binOp, std::move(right));
+		auto node = make<BinaryExpr>(std::move(expr), binOp, std::move(right));
 		node->line = op.line;
 		node->column = op.column;
 		expr = std::move(node);
@@ -708,14 +720,14 @@ std::unique_ptr<Expression> Parser::factor()
 	return expr;
 }
 
-std::unique_ptr<Expression> Parser::unary()
+Ptr<Expression> Parser::unary()
 {
 	if (check(Phasor::TokenType::Symbol) && (peek().lexeme == "!" || peek().lexeme == "-"))
 	{
 		Token   op = advance();
 		auto    right = unary();
 		UnaryOp uOp = (op.lexeme == "!") ? UnaryOp::Not : UnaryOp::Negate;
-		auto    node = std::make_unique<UnaryExpr>(uOp, std::move(right));
+		auto    node = make<UnaryExpr>(uOp, std::move(right));
 		node->line = op.line;
 		node->column = op.column;
 		return node;
@@ -724,7 +736,7 @@ std::unique_ptr<Expression> Parser::unary()
 	{
 		Token op = advance();
 		auto  right = unary();
-		auto  node = std::make_unique<UnaryExpr>(UnaryOp::AddressOf, std::move(right));
+		auto  node = make<UnaryExpr>(UnaryOp::AddressOf, std::move(right));
 		node->line = op.line;
 		node->column = op.column;
 		return node;
@@ -733,7 +745,7 @@ std::unique_ptr<Expression> Parser::unary()
 	{
 		Token op = advance();
 		auto  right = unary();
-		auto  node = std::make_unique<UnaryExpr>(UnaryOp::Dereference, std::move(right));
+		auto  node = make<UnaryExpr>(UnaryOp::Dereference, std::move(right));
 		node->line = op.line;
 		node->column = op.column;
 		return node;
@@ -741,7 +753,7 @@ std::unique_ptr<Expression> Parser::unary()
 	return call();
 }
 
-std::unique_ptr<Expression> Parser::call()
+Ptr<Expression> Parser::call()
 {
 	auto expr = primary();
 
@@ -764,7 +776,7 @@ std::unique_ptr<Expression> Parser::call()
 		else if (match(Phasor::TokenType::Symbol, "++"))
 		{
 			Token op = previous();
-			auto  node = std::make_unique<PostfixExpr>(PostfixOp::Increment, std::move(expr));
+			auto  node = make<PostfixExpr>(PostfixOp::Increment, std::move(expr));
 			node->line = op.line;
 			node->column = op.column;
 			expr = std::move(node);
@@ -772,7 +784,7 @@ std::unique_ptr<Expression> Parser::call()
 		else if (match(Phasor::TokenType::Symbol, "--"))
 		{
 			Token op = previous();
-			auto  node = std::make_unique<PostfixExpr>(PostfixOp::Decrement, std::move(expr));
+			auto  node = make<PostfixExpr>(PostfixOp::Decrement, std::move(expr));
 			node->line = op.line;
 			node->column = op.column;
 			expr = std::move(node);
@@ -783,16 +795,16 @@ std::unique_ptr<Expression> Parser::call()
 			auto  index = expression();
 			consume(Phasor::TokenType::Symbol, "]", "Expect ']' after index.");
 
-			if (auto* strLit = dynamic_cast<StringExpr*>(index.get()))
+			if (auto* strLit = as<StringExpr>(index.get()))
 			{
-				auto node = std::make_unique<FieldAccessExpr>(std::move(expr), strLit->value);
+				auto node = make<FieldAccessExpr>(std::move(expr), strLit->value);
 				node->line = op.line;
 				node->column = op.column;
 				expr = std::move(node);
 			}
 			else
 			{
-				auto node = std::make_unique<ArrayAccessExpr>(std::move(expr), std::move(index));
+				auto node = make<ArrayAccessExpr>(std::move(expr), std::move(index));
 				node->line = op.line;
 				node->column = op.column;
 				expr = std::move(node);
@@ -807,9 +819,9 @@ std::unique_ptr<Expression> Parser::call()
 	return expr;
 }
 
-std::unique_ptr<Expression> Parser::finishCall(std::unique_ptr<Expression> callee)
+Ptr<Expression> Parser::finishCall(Ptr<Expression> callee)
 {
-	std::vector<std::unique_ptr<Expression>> arguments;
+	std::vector<Ptr<Expression>> arguments;
 	if (!check(Phasor::TokenType::Symbol) || peek().lexeme != ")")
 	{
 		do
@@ -821,20 +833,20 @@ std::unique_ptr<Expression> Parser::finishCall(std::unique_ptr<Expression> calle
 
 	// For now, we only support direct function calls by name, or calls on field access which are
 	// rewritten to pass the object as the first argument.
-	if (auto *ident = dynamic_cast<IdentifierExpr *>(callee.get()))
+	if (auto *ident = as<IdentifierExpr>(callee.get()))
 	{
-		auto node = std::make_unique<CallExpr>(ident->name, std::move(arguments));
+		auto node = make<CallExpr>(ident->name, std::move(arguments));
 		node->line = ident->line;
 		node->column = ident->column;
 		return node;
 	}
-	if (auto field = dynamic_cast<FieldAccessExpr *>(callee.get()))
+	if (auto field = as<FieldAccessExpr>(callee.get()))
 	{
 		// Transform obj.method(args) -> method(obj, args)
 		std::string methodName = field->fieldName;
 		size_t      fline = field->line, fcol = field->column;
 		arguments.insert(arguments.begin(), std::move(field->object));
-		auto node = std::make_unique<CallExpr>(methodName, std::move(arguments));
+		auto node = make<CallExpr>(methodName, std::move(arguments));
 		node->line = fline;
 		node->column = fcol;
 		return node;
@@ -843,12 +855,12 @@ std::unique_ptr<Expression> Parser::finishCall(std::unique_ptr<Expression> calle
 	throw std::runtime_error("Can only call named functions.");
 }
 
-std::unique_ptr<Expression> Parser::primary()
+Ptr<Expression> Parser::primary()
 {
 	if (match(Phasor::TokenType::Number))
 	{
 		Token t = previous();
-		auto  node = std::make_unique<NumberExpr>(t.lexeme);
+		auto  node = make<NumberExpr>(std::string(t.lexeme));
 		node->line = t.line;
 		node->column = t.column;
 		return node;
@@ -856,7 +868,7 @@ std::unique_ptr<Expression> Parser::primary()
 	if (match(Phasor::TokenType::String))
 	{
 		Token t = previous();
-		auto  node = std::make_unique<StringExpr>(t.lexeme);
+		auto  node = make<StringExpr>(Lexer::stringValue(t));
 		node->line = t.line;
 		node->column = t.column;
 		return node;
@@ -870,7 +882,7 @@ std::unique_ptr<Expression> Parser::primary()
 			return structInstance();
 		}
 		advance();
-		auto node = std::make_unique<IdentifierExpr>(identTok.lexeme);
+		auto node = make<IdentifierExpr>(std::string(identTok.lexeme));
 		node->line = identTok.line;
 		node->column = identTok.column;
 		return node;
@@ -878,7 +890,7 @@ std::unique_ptr<Expression> Parser::primary()
 	if (match(Phasor::TokenType::Symbol, "["))
 	{
 		Token                                    start = previous();
-		std::vector<std::unique_ptr<Expression>> elements;
+		std::vector<Ptr<Expression>> elements;
 		if (!check(Phasor::TokenType::Symbol) || peek().lexeme != "]")
 		{
 			do
@@ -887,7 +899,7 @@ std::unique_ptr<Expression> Parser::primary()
 			} while (match(Phasor::TokenType::Symbol, ","));
 		}
 		consume(Phasor::TokenType::Symbol, "]", "Expect ']' after array elements.");
-		auto node = std::make_unique<ArrayLiteralExpr>(std::move(elements));
+		auto node = make<ArrayLiteralExpr>(std::move(elements));
 		node->line = start.line;
 		node->column = start.column;
 		return node;
@@ -895,7 +907,7 @@ std::unique_ptr<Expression> Parser::primary()
 	if (match(Phasor::TokenType::Keyword, "true"))
 	{
 		Token t = previous();
-		auto  node = std::make_unique<BooleanExpr>(true);
+		auto  node = make<BooleanExpr>(true);
 		node->line = t.line;
 		node->column = t.column;
 		return node;
@@ -903,7 +915,7 @@ std::unique_ptr<Expression> Parser::primary()
 	if (match(Phasor::TokenType::Keyword, "false"))
 	{
 		Token t = previous();
-		auto  node = std::make_unique<BooleanExpr>(false);
+		auto  node = make<BooleanExpr>(false);
 		node->line = t.line;
 		node->column = t.column;
 		return node;
@@ -911,7 +923,7 @@ std::unique_ptr<Expression> Parser::primary()
 	if (match(Phasor::TokenType::Keyword, "null"))
 	{
 		Token t = previous();
-		auto  node = std::make_unique<NullExpr>();
+		auto  node = make<NullExpr>();
 		node->line = t.line;
 		node->column = t.column;
 		return node;
@@ -940,15 +952,15 @@ std::unique_ptr<Expression> Parser::primary()
 			return anonymousStructInstance();
 		}
 	}
-	std::cerr << "Error: Expect expression at '" << peek().lexeme << "'";
-	std::cerr << " (line " << peek().line << ", column " << peek().column << ")\n";
+	*diagnostics << "Error: Expect expression at '" << peek().lexeme << "'";
+	*diagnostics << " (line " << peek().line << ", column " << peek().column << ")\n";
 	lastError = {"Expect expression", peek().line, peek().column};
 	throw std::runtime_error("Expect expression.");
 }
 
 // Struct declaration
 // struct Point { x: int, y: int }
-std::unique_ptr<StructDecl> Parser::structDecl()
+Ptr<StructDecl> Parser::structDecl()
 {
 	// 'struct' keyword
 	Token start = peek();
@@ -973,7 +985,7 @@ std::unique_ptr<StructDecl> Parser::structDecl()
 		}
 		consume(Phasor::TokenType::Symbol, ":", "Expected ':' after field name");
 		auto type = parseType();
-		fields.emplace_back(fieldNameTok.lexeme, std::move(type));
+		fields.emplace_back(std::string(fieldNameTok.lexeme), std::move(type));
 
 		if (!match(Phasor::TokenType::Symbol, ","))
 		{
@@ -982,7 +994,7 @@ std::unique_ptr<StructDecl> Parser::structDecl()
 	}
 
 	consume(Phasor::TokenType::Symbol, "}", "Expected '}' after struct fields");
-	auto node = std::make_unique<StructDecl>(nameTok.lexeme, std::move(fields));
+	auto node = make<StructDecl>(std::string(nameTok.lexeme), std::move(fields));
 	node->line = start.line;
 	node->column = start.column;
 	return node;
@@ -990,12 +1002,12 @@ std::unique_ptr<StructDecl> Parser::structDecl()
 
 // Struct instantiation
 // Point{ x: 10, y: 20 }
-std::unique_ptr<AST::StructInstanceExpr> Parser::structInstance()
+AST::Ptr<AST::StructInstanceExpr> Parser::structInstance()
 {
 	Token nameTok = consume(Phasor::TokenType::Identifier, "Expected struct name");
 	consume(Phasor::TokenType::Symbol, "{", "Expected '{' in struct instance");
 
-	std::vector<std::pair<std::string, std::unique_ptr<Expression>>> fields;
+	std::vector<std::pair<std::string, Ptr<Expression>>> fields;
 	while (!check(Phasor::TokenType::Symbol) || peek().lexeme != "}")
 	{
 		if (isAtEnd())
@@ -1006,7 +1018,7 @@ std::unique_ptr<AST::StructInstanceExpr> Parser::structInstance()
 		Token fieldNameTok = consume(Phasor::TokenType::Identifier, "Expected field name");
 		consume(Phasor::TokenType::Symbol, ":", "Expected ':' after field name");
 		auto value = expression();
-		fields.emplace_back(fieldNameTok.lexeme, std::move(value));
+		fields.emplace_back(std::string(fieldNameTok.lexeme), std::move(value));
 
 		if (!match(Phasor::TokenType::Symbol, ","))
 		{
@@ -1015,7 +1027,7 @@ std::unique_ptr<AST::StructInstanceExpr> Parser::structInstance()
 	}
 
 	consume(Phasor::TokenType::Symbol, "}", "Expected '}' after struct fields");
-	auto node = std::make_unique<AST::StructInstanceExpr>(nameTok.lexeme, std::move(fields));
+	auto node = make<AST::StructInstanceExpr>(std::string(nameTok.lexeme), std::move(fields));
 	node->line = nameTok.line;
 	node->column = nameTok.column;
 	return node;
@@ -1023,12 +1035,12 @@ std::unique_ptr<AST::StructInstanceExpr> Parser::structInstance()
 
 // Anonymous struct literal
 // { x: 10, y: 20 }
-std::unique_ptr<AST::StructInstanceExpr> Parser::anonymousStructInstance()
+AST::Ptr<AST::StructInstanceExpr> Parser::anonymousStructInstance()
 {
     Token start = peek();
     consume(Phasor::TokenType::Symbol, "{", "Expected '{' in anonymous struct literal.");
 
-    std::vector<std::pair<std::string, std::unique_ptr<Expression>>> fields;
+    std::vector<std::pair<std::string, Ptr<Expression>>> fields;
     while (!check(Phasor::TokenType::Symbol) || peek().lexeme != "}")
     {
         if (isAtEnd())
@@ -1039,7 +1051,7 @@ std::unique_ptr<AST::StructInstanceExpr> Parser::anonymousStructInstance()
         Token fieldNameTok = consume(Phasor::TokenType::Identifier, "Expected field name in anonymous struct.");
         consume(Phasor::TokenType::Symbol, ":", "Expected ':' after field name.");
         auto value = expression();
-        fields.emplace_back(fieldNameTok.lexeme, std::move(value));
+        fields.emplace_back(std::string(fieldNameTok.lexeme), std::move(value));
 
         if (!match(Phasor::TokenType::Symbol, ","))
             break;
@@ -1047,7 +1059,7 @@ std::unique_ptr<AST::StructInstanceExpr> Parser::anonymousStructInstance()
     consume(Phasor::TokenType::Symbol, "}", "Expected '}' after anonymous struct fields.");
 
     // Empty name signals anonymous — falls through to the dynamic NEW_STRUCT path in CodeGen
-    auto node = std::make_unique<AST::StructInstanceExpr>("__anon", std::move(fields));
+    auto node = make<AST::StructInstanceExpr>("__anon", std::move(fields));
     node->line = start.line;
     node->column = start.column;
     return node;
@@ -1055,10 +1067,10 @@ std::unique_ptr<AST::StructInstanceExpr> Parser::anonymousStructInstance()
 
 // Field access
 // point.x
-std::unique_ptr<Expression> Parser::fieldAccess(std::unique_ptr<Expression> object)
+Ptr<Expression> Parser::fieldAccess(Ptr<Expression> object)
 {
 	Token nameTok = consume(Phasor::TokenType::Identifier, "Expected field name after '.'");
-	auto  node = std::make_unique<FieldAccessExpr>(std::move(object), nameTok.lexeme);
+	auto  node = make<FieldAccessExpr>(std::move(object), std::string(nameTok.lexeme));
 	node->line = nameTok.line;
 	node->column = nameTok.column;
 	return node;
@@ -1123,18 +1135,18 @@ Token Parser::consume(Phasor::TokenType type, const std::string &message)
 		return advance();
 	}
 
-	std::cerr << "Error: " << message << " at '" << peek().lexeme << "'";
-	std::cerr << " (line " << peek().line << ", column " << peek().column << ")";
+	*diagnostics << "Error: " << message << " at '" << peek().lexeme << "'";
+	*diagnostics << " (line " << peek().line << ", column " << peek().column << ")";
 	if (!currentFunction.empty())
 	{
-		std::cerr << " [in function '" << currentFunction << "']";
+		*diagnostics << " [in function '" << currentFunction << "']";
 	}
-	std::cerr << "\n";
+	*diagnostics << "\n";
 	lastError = {message, peek().line, peek().column};
 	throw std::runtime_error(message);
 }
 
-bool Parser::match(Phasor::TokenType type, const std::string &lexeme)
+bool Parser::match(Phasor::TokenType type, std::string_view lexeme)
 {
 	if (check(type) && peek().lexeme == lexeme)
 	{
@@ -1144,20 +1156,20 @@ bool Parser::match(Phasor::TokenType type, const std::string &lexeme)
 	return false;
 }
 
-Token Parser::consume(Phasor::TokenType type, const std::string &lexeme, const std::string &message)
+Token Parser::consume(Phasor::TokenType type, std::string_view lexeme, const std::string &message)
 {
 	if (check(type) && peek().lexeme == lexeme)
 	{
 		return advance();
 	}
 
-	std::cerr << "Error: " << message << " at '" << peek().lexeme << "'";
-	std::cerr << " (line " << peek().line << ", column " << peek().column << ")";
+	*diagnostics << "Error: " << message << " at '" << peek().lexeme << "'";
+	*diagnostics << " (line " << peek().line << ", column " << peek().column << ")";
 	if (!currentFunction.empty())
 	{
-		std::cerr << " [in function '" << currentFunction << "']";
+		*diagnostics << " [in function '" << currentFunction << "']";
 	}
-	std::cerr << "\n";
+	*diagnostics << "\n";
 
 	lastError = {message, peek().line, peek().column};
 	throw std::runtime_error(message);
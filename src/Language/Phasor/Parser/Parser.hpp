@@ -1,9 +1,12 @@
 #pragma once
 #include "../../../AST/AST.hpp"
+#include <iostream>
 #include <memory>
+#include <string_view>
 #include <optional>
 #include <vector>
 #include <filesystem>
+#include <utility>
 /// @brief The Phasor Programming Language and Runtime
 namespace Phasor
 {
@@ -12,16 +15,28 @@ namespace Phasor
 class Parser
 {
   public:
-	Parser(const std::vector<Token> &tokens);
-	Parser(const std::vector<Token> &tokens, std::filesystem::path sourcePath);
+	Parser(std::vector<Token> tokens);
+	Parser(std::vector<Token> tokens, std::filesystem::path sourcePath);
 
 	void setSourcePath(const std::filesystem::path &path)
 	{
 		sourcePath = path;
 	}
 
+	/// @brief Where syntax errors are reported, std::cerr by default
+	void setDiagnostics(std::ostream &stream)
+	{
+		diagnostics = &stream;
+	}
+
 	std::unique_ptr<AST::Program> parse();
 
+	/// @brief Files spliced in by `include` during the last parse(), nested ones included
+	[[nodiscard]] const std::vector<std::filesystem::path> &includedFiles() const
+	{
+		return includes;
+	}
+
 	struct Error
 	{
 		std::string message;
@@ -34,11 +49,20 @@ class Parser
 	}
 
   private:
-	std::vector<Token>    tokens;
-	int                   current = 0;
-	std::string           currentFunction;
-	std::optional<Error>  lastError;
-	std::filesystem::path sourcePath;
+	std::vector<Token>                 tokens;
+	int                                current = 0;
+	std::string                        currentFunction;
+	std::optional<Error>               lastError;
+	std::filesystem::path              sourcePath;
+	std::vector<std::filesystem::path> includes;
+	AST::Arena                        *arena = nullptr; ///< Arena of the program being parsed
+	std::ostream                      *diagnostics = &std::cerr;
+
+	/// @brief Allocate a node in the arena of the program being parsed
+	template <typename T, typename... Args> AST::Ptr<T> make(Args &&...args)
+	{
+		return arena->make<T>(std::forward<Args>(args)...);
+	}
 
 	Token peek();
 	Token previous();
@@ -47,42 +71,42 @@ class Parser
 	bool  check(Phasor::TokenType type);
 	Token peekNext();
 	bool  match(Phasor::TokenType type);
-	bool  match(Phasor::TokenType type, const std::string &lexeme);
+	bool  match(Phasor::TokenType type, std::string_view lexeme);
 	Token consume(Phasor::TokenType type, const std::string &message);
-	Token consume(Phasor::TokenType type, const std::string &lexeme, const std::string &message);
+	Token consume(Phasor::TokenType type, std::string_view lexeme, const std::string &message);
 	Token expect(Phasor::TokenType type, const std::string &message);
 
-	std::unique_ptr<AST::Statement>          declaration();
-	std::unique_ptr<AST::Statement>          varDeclaration();
-	std::unique_ptr<AST::Statement>          functionDeclaration();
-	std::unique_ptr<AST::Statement>          statement();
-	std::unique_ptr<AST::Statement>          printStatement();
-	std::unique_ptr<AST::Statement>          ifStatement();
-	std::unique_ptr<AST::Statement>          whileStatement();
-	std::unique_ptr<AST::Statement>          forStatement();
-	std::unique_ptr<AST::Statement>          switchStatement();
-	std::unique_ptr<AST::Statement>          returnStatement();
-	std::unique_ptr<AST::Statement>          unsafeStatement();
-	std::unique_ptr<AST::BlockStmt>          block();
-	std::unique_ptr<AST::Statement>          importStatement();
-	std::unique_ptr<AST::Statement>          exportStatement();
-	std::unique_ptr<AST::Statement>          expressionStatement();
-	std::unique_ptr<AST::TypeNode>           parseType();
-	std::unique_ptr<AST::Expression>         expression();
-	std::unique_ptr<AST::Expression>         assignment();
-	std::unique_ptr<AST::Expression>         logicalOr();
-	std::unique_ptr<AST::Expression>         logicalAnd();
-	std::unique_ptr<AST::Expression>         equality();
-	std::unique_ptr<AST::Expression>         comparison();
-	std::unique_ptr<AST::Expression>         term();
-	std::unique_ptr<AST::Expression>         factor();
-	std::unique_ptr<AST::Expression>         unary();
-	std::unique_ptr<AST::Expression>         call();
-	std::unique_ptr<AST::Expression>         finishCall(std::unique_ptr<AST::Expression> callee);
-	std::unique_ptr<AST::Expression>         primary();
-	std::unique_ptr<AST::StructDecl>         structDecl();
-	std::unique_ptr<AST::StructInstanceExpr> structInstance();
-	std::unique_ptr<AST::StructInstanceExpr> anonymousStructInstance();
-	std::unique_ptr<AST::Expression>         fieldAccess(std::unique_ptr<AST::Expression> object);
+	AST::Ptr<AST::Statement>          declaration();
+	AST::Ptr<AST::Statement>          varDeclaration();
+	AST::Ptr<AST::Statement>          functionDeclaration();
+	AST::Ptr<AST::Statement>          statement();
+	AST::Ptr<AST::Statement>          printStatement();
+	AST::Ptr<AST::Statement>          ifStatement();
+	AST::Ptr<AST::Statement>          whileStatement();
+	AST::Ptr<AST::Statement>          forStatement();
+	AST::Ptr<AST::Statement>          switchStatement();
+	AST::Ptr<AST::Statement>          returnStatement();
+	AST::Ptr<AST::Statement>          unsafeStatement();
+	AST::Ptr<AST::BlockStmt>          block();
+	AST::Ptr<AST::Statement>          importStatement();
+	AST::Ptr<AST::Statement>          exportStatement();
+	AST::Ptr<AST::Statement>          expressionStatement();
+	AST::Ptr<AST::TypeNode>           parseType();
+	AST::Ptr<AST::Expression>         expression();
+	AST::Ptr<AST::Expression>         assignment();
+	AST::Ptr<AST::Expression>         logicalOr();
+	AST::Ptr<AST::Expression>         logicalAnd();
+	AST::Ptr<AST::Expression>         equality();
+	AST::Ptr<AST::Expression>         comparison();
+	AST::Ptr<AST::Expression>         term();
+	AST::Ptr<AST::Expression>         factor();
+	AST::Ptr<AST::Expression>         unary();
+	AST::Ptr<AST::Expression>         call();
+	AST::Ptr<AST::Expression>         finishCall(AST::Ptr<AST::Expression> callee);
+	AST::Ptr<AST::Expression>         primary();
+	AST::Ptr<AST::StructDecl>         structDecl();
+	AST::Ptr<AST::StructInstanceExpr> structInstance();
+	AST::Ptr<AST::StructInstanceExpr> anonymousStructInstance();
+	AST::Ptr<AST::Expression>         fieldAccess(AST::Ptr<AST::Expression> object);
 };
 } // namespace Phasor
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "../../../AST/AST.hpp"
 #include <string>
+#include <string_view>
 #include <vector>
 #include <iostream>
 /// @brief The Pulsar Scripting Language
@@ -10,18 +11,24 @@ namespace pulsar
 class Lexer
 {
   public:
-	Lexer(std::string source);
+	/// @param source Buffer to tokenize, borrowed: it must outlive the returned tokens
+	Lexer(std::string_view source);
+	Lexer(std::string &&source) = delete; ///< Tokens would point into a destroyed temporary
 	std::vector<Phasor::Token> tokenize();
 
+	/// @brief Value of a String token, decoding escapes the lexer has already validated
+	static std::string stringValue(const Phasor::Token &token);
+
   private:
-	std::string source;
-	size_t      position = 0;
-	size_t      line = 1;
-	size_t      column = 1;
+	std::string_view source;
+	size_t           position = 0;
+	size_t           line = 1;
+	size_t           column = 1;
 
 	char          peek();
 	char          advance();
 	bool          isAtEnd();
+	void          advanceTo(const char *stop);
 	void          skipWhitespace();
 	void          skipShebang();
 	Phasor::Token scanToken();
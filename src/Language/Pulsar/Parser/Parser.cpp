@@ -1,16 +1,19 @@
 #include "Parser.hpp"
+#include "../Lexer/Lexer.hpp"
 #include <iostream>
+#include <utility>
 
 namespace pulsar
 {
 
-Parser::Parser(const std::vector<Token> &tokens) : tokens(tokens)
+Parser::Parser(std::vector<Token> tokens) : tokens(std::move(tokens))
 {
 }
 
 std::unique_ptr<Program> Parser::parse()
 {
 	auto program = std::make_unique<Program>();
+	arena = program->arena.get();
 	while (!isAtEnd())
 	{
 		program->statements.push_back(declaration());
@@ -18,7 +21,7 @@ std::unique_ptr<Program> Parser::parse()
 	return program;
 }
 
-std::unique_ptr<Statement> Parser::declaration()
+Ptr<Statement> Parser::declaration()
 {
 	if (check(Phasor::TokenType::Keyword) && peek().lexeme == "func")
 	{
@@ -33,7 +36,7 @@ std::unique_ptr<Statement> Parser::declaration()
 	return statement();
 }
 
-std::unique_ptr<Statement> Parser::functionDeclaration()
+Ptr<Statement> Parser::functionDeclaration()
 {
 	Token name = consume(Phasor::TokenType::Identifier, "Expect function name.");
 	consume(Phasor::TokenType::Symbol, "(", "Expect '(' after function name.");
@@ -45,12 +48,12 @@ std::unique_ptr<Statement> Parser::functionDeclaration()
 			Token paramName = consume(Phasor::TokenType::Identifier, "Expect parameter name.");
 			consume(Phasor::TokenType::Symbol, ":", "Expect ':' after parameter name.");
 			auto type = parseType();
-			params.push_back({paramName.lexeme, std::move(type)});
+			params.push_back({std::string(paramName.lexeme), std::move(type)});
 		} while (match(Phasor::TokenType::Symbol, ","));
 	}
 	consume(Phasor::TokenType::Symbol, ")", "Expect ')' after parameters.");
 
-	std::unique_ptr<TypeNode> returnType = nullptr;
+	Ptr<TypeNode> returnType = nullptr;
 	if (match(Phasor::TokenType::Symbol, "->"))
 	{
 		returnType = parseType();
@@ -60,17 +63,17 @@ std::unique_ptr<Statement> Parser::functionDeclaration()
 
 	// Track function context for better error messages
 	std::string previousFunction = currentFunction;
-	currentFunction = name.lexeme;
+	currentFunction = std::string(name.lexeme);
 
 	auto body = block();
 
 	// Restore previous function context
 	currentFunction = previousFunction;
 
-	return std::make_unique<FunctionDecl>(name.lexeme, std::move(params), std::move(returnType), std::move(body));
+	return make<FunctionDecl>(std::string(name.lexeme), std::move(params), std::move(returnType), std::move(body));
 }
 
-std::unique_ptr<TypeNode> Parser::parseType()
+Ptr<TypeNode> Parser::parseType()
 {
 	bool isPointer = false;
 	if (match(Phasor::TokenType::Symbol, "*"))
@@ -83,22 +86,22 @@ std::unique_ptr<TypeNode> Parser::parseType()
 	while (match(Phasor::TokenType::Symbol, "["))
 	{
 		Token size = consume(Phasor::TokenType::Number, "Expect array size in type declaration.");
-		dims.push_back(std::stoi(size.lexeme));
+		dims.push_back(std::stoi(std::string(size.lexeme)));
 		consume(Phasor::TokenType::Symbol, "]", "Expect ']' after array size.");
 	}
-	return std::make_unique<TypeNode>(typeName.lexeme, isPointer, dims);
+	return make<TypeNode>(std::string(typeName.lexeme), isPointer, dims);
 }
 
-std::unique_ptr<Statement> Parser::varDeclaration()
+Ptr<Statement> Parser::varDeclaration()
 {
 	Token name = consume(Phasor::TokenType::Identifier, "Expect variable name.");
 	consume(Phasor::TokenType::Symbol, "=", "Expect '=' after variable name.");
-	std::unique_ptr<Expression> initializer = nullptr;
+	Ptr<Expression> initializer = nullptr;
 	initializer = expression();
-	return std::make_unique<VarDecl>(name.lexeme, std::move(initializer));
+	return make<VarDecl>(std::string(name.lexeme), std::move(initializer));
 }
 
-std::unique_ptr<Statement> Parser::statement()
+Ptr<Statement> Parser::statement()
 {
 	if (check(Phasor::TokenType::Keyword) && peek().lexeme == "print")
 	{
@@ -123,12 +126,12 @@ std::unique_ptr<Statement> Parser::statement()
 	if (check(Phasor::TokenType::Keyword) && peek().lexeme == "break")
 	{
 		advance();
-		return std::make_unique<BreakStmt>();
+		return make<BreakStmt>();
 	}
 	if (check(Phasor::TokenType::Keyword) && peek().lexeme == "continue")
 	{
 		advance();
-		return std::make_unique<ContinueStmt>();
+		return make<ContinueStmt>();
 	}
 	if (check(Phasor::TokenType::Symbol) && peek().lexeme == "{")
 	{
@@ -139,34 +142,34 @@ std::unique_ptr<Statement> Parser::statement()
 	return expressionStatement();
 }
 
-std::unique_ptr<Statement> Parser::ifStatement()
+Ptr<Statement> Parser::ifStatement()
 {
 	consume(Phasor::TokenType::Symbol, "(", "Expect '(' after 'if'.");
 	auto condition = expression();
 	consume(Phasor::TokenType::Symbol, ")", "Expect ')' after if condition.");
 	auto                       thenBranch = statement();
-	std::unique_ptr<Statement> elseBranch = nullptr;
+	Ptr<Statement> elseBranch = nullptr;
 	if (match(Phasor::TokenType::Keyword, "else"))
 	{
 		elseBranch = statement();
 	}
-	return std::make_unique<IfStmt>(std::move(condition), std::move(thenBranch), std::move(elseBranch));
+	return make<IfStmt>(std::move(condition), std::move(thenBranch), std::move(elseBranch));
 }
 
-std::unique_ptr<Statement> Parser::whileStatement()
+Ptr<Statement> Parser::whileStatement()
 {
 	consume(Phasor::TokenType::Symbol, "(", "Expect '(' after 'while'.");
 	auto condition = expression();
 	consume(Phasor::TokenType::Symbol, ")", "Expect ')' after while condition.");
 	auto body = statement();
-	return std::make_unique<WhileStmt>(std::move(condition), std::move(body));
+	return make<WhileStmt>(std::move(condition), std::move(body));
 }
 
-std::unique_ptr<Statement> Parser::forStatement()
+Ptr<Statement> Parser::forStatement()
 {
 	consume(Phasor::TokenType::Symbol, "(", "Expect '(' after 'for'.");
 
-	std::unique_ptr<Statement> initializer = nullptr;
+	Ptr<Statement> initializer = nullptr;
 	if (check(Phasor::TokenType::Keyword) && peek().lexeme == "let")
 	{
 		advance();
@@ -177,10 +180,10 @@ std::unique_ptr<Statement> Parser::forStatement()
 		initializer = expressionStatement();
 	}
 
-	std::unique_ptr<Expression> condition = nullptr;
+	Ptr<Expression> condition = nullptr;
 	condition = expression();
 
-	std::unique_ptr<Expression> increment = nullptr;
+	Ptr<Expression> increment = nullptr;
 	if (!check(Phasor::TokenType::Symbol) || peek().lexeme != ")")
 	{
 		increment = expression();
@@ -188,11 +191,11 @@ std::unique_ptr<Statement> Parser::forStatement()
 	consume(Phasor::TokenType::Symbol, ")", "Expect ')' after for clauses.");
 
 	auto body = statement();
-	return std::make_unique<ForStmt>(std::move(initializer), std::move(condition), std::move(increment),
+	return make<ForStmt>(std::move(initializer), std::move(condition), std::move(increment),
 	                                 std::move(body));
 }
 
-std::unique_ptr<Statement> Parser::switchStatement()
+Ptr<Statement> Parser::switchStatement()
 {
 	consume(Phasor::TokenType::Symbol, "(", "Expect '(' after 'switch'.");
 	auto expr = expression();
@@ -200,7 +203,7 @@ std::unique_ptr<Statement> Parser::switchStatement()
 	consume(Phasor::TokenType::Symbol, "{", "Expect '{' after switch.");
 
 	std::vector<CaseClause>                 cases;
-	std::vector<std::unique_ptr<Statement>> defaultStmts;
+	std::vector<Ptr<Statement>> defaultStmts;
 
 	while (!check(Phasor::TokenType::Symbol) || peek().lexeme != "}")
 	{
@@ -215,7 +218,7 @@ std::unique_ptr<Statement> Parser::switchStatement()
 			auto caseValue = expression();
 			consume(Phasor::TokenType::Symbol, ":", "Expect ':' after case value.");
 
-			std::vector<std::unique_ptr<Statement>> stmts;
+			std::vector<Ptr<Statement>> stmts;
 			while ((!check(Phasor::TokenType::Keyword) || (peek().lexeme != "case" && peek().lexeme != "default")) &&
 			       (!check(Phasor::TokenType::Symbol) || peek().lexeme != "}"))
 			{
@@ -249,19 +252,19 @@ std::unique_ptr<Statement> Parser::switchStatement()
 	}
 
 	consume(Phasor::TokenType::Symbol, "}", "Expect '}' after switch body.");
-	return std::make_unique<SwitchStmt>(std::move(expr), std::move(cases), std::move(defaultStmts));
+	return make<SwitchStmt>(std::move(expr), std::move(cases), std::move(defaultStmts));
 }
 
-std::unique_ptr<Statement> Parser::returnStatement()
+Ptr<Statement> Parser::returnStatement()
 {
-	std::unique_ptr<Expression> value = nullptr;
+	Ptr<Expression> value = nullptr;
 	value = expression();
-	return std::make_unique<ReturnStmt>(std::move(value));
+	return make<ReturnStmt>(std::move(value));
 }
 
-std::unique_ptr<BlockStmt> Parser::block()
+Ptr<BlockStmt> Parser::block()
 {
-	std::vector<std::unique_ptr<Statement>> statements;
+	std::vector<Ptr<Statement>> statements;
 	while (!check(Phasor::TokenType::Symbol) || peek().lexeme != "}")
 	{
 		if (isAtEnd())
@@ -271,40 +274,40 @@ std::unique_ptr<BlockStmt> Parser::block()
 		statements.push_back(declaration());
 	}
 	consume(Phasor::TokenType::Symbol, "}", "Expect '}' after block.");
-	return std::make_unique<BlockStmt>(std::move(statements));
+	return make<BlockStmt>(std::move(statements));
 }
 
-std::unique_ptr<Statement> Parser::printStatement()
+Ptr<Statement> Parser::printStatement()
 {
 	auto expr = expression();
-	return std::make_unique<PrintStmt>(std::move(expr));
+	return make<PrintStmt>(std::move(expr));
 }
 
-std::unique_ptr<Statement> Parser::expressionStatement()
+Ptr<Statement> Parser::expressionStatement()
 {
 	auto expr = expression();
-	return std::make_unique<ExpressionStmt>(std::move(expr));
+	return make<ExpressionStmt>(std::move(expr));
 }
 
-std::unique_ptr<Expression> Parser::expression()
+Ptr<Expression> Parser::expression()
 {
 	return assignment();
 }
 
-std::unique_ptr<Expression> Parser::assignment()
+Ptr<Expression> Parser::assignment()
 {
 	auto expr = logicalOr();
 
 	if (match(Phasor::TokenType::Symbol, "="))
 	{
 		auto value = assignment();
-		return std::make_unique<AssignmentExpr>(std::move(expr), std::move(value));
+		return make<AssignmentExpr>(std::move(expr), std::move(value));
 	}
 
 	return expr;
 }
 
-std::unique_ptr<Expression> Parser::logicalOr()
+Ptr<Expression> Parser::logicalOr()
 {
 	auto expr = logicalAnd();
 
@@ -312,13 +315,13 @@ std::unique_ptr<Expression> Parser::logicalOr()
 	{
 		advance();
 		auto right = logicalAnd();
-		expr = std::make_unique<BinaryExpr>(std::move(expr), BinaryOp::Or, std::move(right));
+		expr = make<BinaryExpr>(std::move(expr), BinaryOp::Or, std::move(right));
 	}
 
 	return expr;
 }
 
-std::unique_ptr<Expression> Parser::logicalAnd()
+Ptr<Expression> Parser::logicalAnd()
 {
 	auto expr = equality();
 
@@ -326,13 +329,13 @@ std::unique_ptr<Expression> Parser::logicalAnd()
 	{
 		advance();
 		auto right = equality();
-		expr = std::make_unique<BinaryExpr>(std::move(expr), BinaryOp::And, std::move(right));
+		expr = make<BinaryExpr>(std::move(expr), BinaryOp::And, std::move(right));
 	}
 
 	return expr;
 }
 
-std::unique_ptr<Expression> Parser::equality()
+Ptr<Expression> Parser::equality()
 {
 	auto expr = comparison();
 
@@ -341,13 +344,13 @@ std::unique_ptr<Expression> Parser::equality()
 		Token    op = advance();
 		auto     right = comparison();
 		BinaryOp binOp = (op.lexeme == "==") ? BinaryOp::Equal : BinaryOp::NotEqual;
-		expr = std::make_unique<BinaryExpr>(std::move(expr), binOp, std::move(right));
+		expr = make<BinaryExpr>(std::move(expr), binOp, std::move(right));
 	}
 
 	return expr;
 }
 
-std::unique_ptr<Expression> Parser::comparison()
+Ptr<Expression> Parser::comparison()
 {
 	auto expr = term();
 
@@ -374,13 +377,13 @@ std::unique_ptr<Expression> Parser::comparison()
 			binOp = BinaryOp::GreaterEqual;
 		}
 
-		expr = std::make_unique<BinaryExpr>(std::move(expr), binOp, std::move(right));
+		expr = make<BinaryExpr>(std::move(expr), binOp, std::move(right));
 	}
 
 	return expr;
 }
 
-std::unique_ptr<Expression> Parser::term()
+Ptr<Expression> Parser::term()
 {
 	auto expr = factor();
 
@@ -389,13 +392,13 @@ std::unique_ptr<Expression> Parser::term()
 		Token    op = advance();
 		auto     right = factor();
 		BinaryOp binOp = (op.lexeme == "+") ? BinaryOp::Add : BinaryOp::Subtract;
-		expr = std::make_unique<BinaryExpr>(std::move(expr), binOp, std::move(right));
+		expr = make<BinaryExpr>(std::move(expr), binOp, std::move(right));
 	}
 
 	return expr;
 }
 
-std::unique_ptr<Expression> Parser::factor()
+Ptr<Expression> Parser::factor()
 {
 	auto expr = unary();
 
@@ -417,37 +420,37 @@ std::unique_ptr<Expression> Parser::factor()
 			binOp = BinaryOp::Modulo;
 		}
 
-		expr = std::make_unique<BinaryExpr>(std::move(expr), binOp, std::move(right));
+		expr = make<BinaryExpr>(std::move(expr), binOp, std::move(right));
 	}
 
 	return expr;
 }
 
-std::unique_ptr<Expression> Parser::unary()
+Ptr<Expression> Parser::unary()
 {
 	if (check(Phasor::TokenType::Symbol) && (peek().lexeme == "!" || peek().lexeme == "-"))
 	{
 		Token   op = advance();
 		auto    right = unary();
 		UnaryOp uOp = (op.lexeme == "!") ? UnaryOp::Not : UnaryOp::Negate;
-		return std::make_unique<UnaryExpr>(uOp, std::move(right));
+		return make<UnaryExpr>(uOp, std::move(right));
 	}
 	if (check(Phasor::TokenType::Symbol) && peek().lexeme == "&")
 	{
 		advance();
 		auto right = unary();
-		return std::make_unique<UnaryExpr>(UnaryOp::AddressOf, std::move(right));
+		return make<UnaryExpr>(UnaryOp::AddressOf, std::move(right));
 	}
 	if (check(Phasor::TokenType::Symbol) && peek().lexeme == "*")
 	{
 		advance();
 		auto right = unary();
-		return std::make_unique<UnaryExpr>(UnaryOp::Dereference, std::move(right));
+		return make<UnaryExpr>(UnaryOp::Dereference, std::move(right));
 	}
 	return call();
 }
 
-std::unique_ptr<Expression> Parser::call()
+Ptr<Expression> Parser::call()
 {
 	auto expr = primary();
 
@@ -459,11 +462,11 @@ std::unique_ptr<Expression> Parser::call()
 		}
 		else if (match(Phasor::TokenType::Symbol, "++"))
 		{
-			expr = std::make_unique<PostfixExpr>(PostfixOp::Increment, std::move(expr));
+			expr = make<PostfixExpr>(PostfixOp::Increment, std::move(expr));
 		}
 		else if (match(Phasor::TokenType::Symbol, "--"))
 		{
-			expr = std::make_unique<PostfixExpr>(PostfixOp::Decrement, std::move(expr));
+			expr = make<PostfixExpr>(PostfixOp::Decrement, std::move(expr));
 		}
 		else
 		{
@@ -474,9 +477,9 @@ std::unique_ptr<Expression> Parser::call()
 	return expr;
 }
 
-std::unique_ptr<Expression> Parser::finishCall(std::unique_ptr<Expression> callee)
+Ptr<Expression> Parser::finishCall(Ptr<Expression> callee)
 {
-	std::vector<std::unique_ptr<Expression>> arguments;
+	std::vector<Ptr<Expression>> arguments;
 	if (!check(Phasor::TokenType::Symbol) || peek().lexeme != ")")
 	{
 		do
@@ -488,48 +491,48 @@ std::unique_ptr<Expression> Parser::finishCall(std::unique_ptr<Expression> calle
 
 	// For now, we only support direct function calls by name, or calls on field access which are
 	// rewritten to pass the object as the first argument.
-	if (auto *ident = dynamic_cast<IdentifierExpr *>(callee.get()))
+	if (auto *ident = as<IdentifierExpr>(callee.get()))
 	{
-		return std::make_unique<CallExpr>(ident->name, std::move(arguments));
+		return make<CallExpr>(ident->name, std::move(arguments));
 	}
-	if (auto field = dynamic_cast<FieldAccessExpr *>(callee.get()))
+	if (auto field = as<FieldAccessExpr>(callee.get()))
 	{
 		// Transform obj.method(args) -> method(obj, args)
 		std::string methodName = field->fieldName;
 		arguments.insert(arguments.begin(), std::move(field->object));
-		return std::make_unique<CallExpr>(methodName, std::move(arguments));
+		return make<CallExpr>(methodName, std::move(arguments));
 	}
 
 	throw std::runtime_error("Can only call named functions.");
 }
 
-std::unique_ptr<Expression> Parser::primary()
+Ptr<Expression> Parser::primary()
 {
 	if (match(Phasor::TokenType::Number))
 	{
-		return std::make_unique<NumberExpr>(previous().lexeme);
+		return make<NumberExpr>(std::string(previous().lexeme));
 	}
 	if (match(Phasor::TokenType::String))
 	{
-		return std::make_unique<StringExpr>(previous().lexeme);
+		return make<StringExpr>(Lexer::stringValue(previous()));
 	}
 	if (check(Phasor::TokenType::Identifier))
 	{
 		Token identTok = peek();
 		advance();
-		return std::make_unique<IdentifierExpr>(identTok.lexeme);
+		return make<IdentifierExpr>(std::string(identTok.lexeme));
 	}
 	if (match(Phasor::TokenType::Keyword, "true"))
 	{
-		return std::make_unique<BooleanExpr>(true);
+		return make<BooleanExpr>(true);
 	}
 	if (match(Phasor::TokenType::Keyword, "false"))
 	{
-		return std::make_unique<BooleanExpr>(false);
+		return make<BooleanExpr>(false);
 	}
 	if (match(Phasor::TokenType::Keyword, "null"))
 	{
-		return std::make_unique<NullExpr>();
+		return make<NullExpr>();
 	}
 	if (match(Phasor::TokenType::Symbol, "("))
 	{
@@ -612,7 +615,7 @@ Token Parser::consume(TokenType type, const std::string &message)
 	throw std::runtime_error(message);
 }
 
-bool Parser::match(TokenType type, const std::string &lexeme)
+bool Parser::match(TokenType type, std::string_view lexeme)
 {
 	if (check(type) && peek().lexeme == lexeme)
 	{
@@ -622,7 +625,7 @@ bool Parser::match(TokenType type, const std::string &lexeme)
 	return false;
 }
 
-Token Parser::consume(TokenType type, const std::string &lexeme, const std::string &message)
+Token Parser::consume(TokenType type, std::string_view lexeme, const std::string &message)
 {
 	if (check(type) && peek().lexeme == lexeme)
 	{
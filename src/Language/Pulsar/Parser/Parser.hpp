@@ -1,6 +1,8 @@
 #pragma once
 #include "../../../AST/AST.hpp"
 #include <memory>
+#include <string_view>
+#include <utility>
 #include <vector>
 /// @brief The Pulsar Scripting Language
 namespace pulsar
@@ -13,13 +15,20 @@ using namespace Phasor;
 class Parser
 {
   public:
-	Parser(const std::vector<Token> &tokens);
+	Parser(std::vector<Token> tokens);
 	std::unique_ptr<Program> parse();
 
   private:
 	std::vector<Token> tokens;
 	int                current = 0;
 	std::string        currentFunction;
+	Arena             *arena = nullptr; ///< Arena of the program being parsed
+
+	/// @brief Allocate a node in the arena of the program being parsed
+	template <typename T, typename... Args> Ptr<T> make(Args &&...args)
+	{
+		return arena->make<T>(std::forward<Args>(args)...);
+	}
 
 	Token peek();
 	Token previous();
@@ -28,35 +37,35 @@ class Parser
 	bool  check(Phasor::TokenType type);
 	Token peekNext();
 	bool  match(Phasor::TokenType type);
-	bool  match(Phasor::TokenType type, const std::string &lexeme);
+	bool  match(Phasor::TokenType type, std::string_view lexeme);
 	Token consume(Phasor::TokenType type, const std::string &message);
-	Token consume(Phasor::TokenType type, const std::string &lexeme, const std::string &message);
+	Token consume(Phasor::TokenType type, std::string_view lexeme, const std::string &message);
 	Token expect(Phasor::TokenType type, const std::string &message);
 
-	std::unique_ptr<Statement>  declaration();
-	std::unique_ptr<Statement>  varDeclaration();
-	std::unique_ptr<Statement>  functionDeclaration();
-	std::unique_ptr<Statement>  statement();
-	std::unique_ptr<Statement>  printStatement();
-	std::unique_ptr<Statement>  ifStatement();
-	std::unique_ptr<Statement>  whileStatement();
-	std::unique_ptr<Statement>  forStatement();
-	std::unique_ptr<Statement>  switchStatement();
-	std::unique_ptr<Statement>  returnStatement();
-	std::unique_ptr<BlockStmt>  block();
-	std::unique_ptr<Statement>  expressionStatement();
-	std::unique_ptr<TypeNode>   parseType();
-	std::unique_ptr<Expression> expression();
-	std::unique_ptr<Expression> assignment();
-	std::unique_ptr<Expression> logicalOr();
-	std::unique_ptr<Expression> logicalAnd();
-	std::unique_ptr<Expression> equality();
-	std::unique_ptr<Expression> comparison();
-	std::unique_ptr<Expression> term();
-	std::unique_ptr<Expression> factor();
-	std::unique_ptr<Expression> unary();
-	std::unique_ptr<Expression> call();
-	std::unique_ptr<Expression> finishCall(std::unique_ptr<Expression> callee);
-	std::unique_ptr<Expression> primary();
+	Ptr<Statement>  declaration();
+	Ptr<Statement>  varDeclaration();
+	Ptr<Statement>  functionDeclaration();
+	Ptr<Statement>  statement();
+	Ptr<Statement>  printStatement();
+	Ptr<Statement>  ifStatement();
+	Ptr<Statement>  whileStatement();
+	Ptr<Statement>  forStatement();
+	Ptr<Statement>  switchStatement();
+	Ptr<Statement>  returnStatement();
+	Ptr<BlockStmt>  block();
+	Ptr<Statement>  expressionStatement();
+	Ptr<TypeNode>   parseType();
+	Ptr<Expression> expression();
+	Ptr<Expression> assignment();
+	Ptr<Expression> logicalOr();
+	Ptr<Expression> logicalAnd();
+	Ptr<Expression> equality();
+	Ptr<Expression> comparison();
+	Ptr<Expression> term();
+	Ptr<Expression> factor();
+	Ptr<Expression> unary();
+	Ptr<Expression> call();
+	Ptr<Expression> finishCall(Ptr<Expression> callee);
+	Ptr<Expression> primary();
 };
 } // namespace pulsar
\ No newline at end of file
@@ -0,0 +1,225 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <phsint.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PHASOR_SCAN_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define PHASOR_SCAN_NEON
+#endif
+
+/// @brief The Phasor Programming Language and Runtime
+namespace Phasor
+{
+/**
+ * @brief Character-class scanning shared by the Phasor and Pulsar lexers
+ *
+ * Every scanner takes a run [p, end) of the source buffer and returns where the
+ * run stops, or end. Whole 16-byte blocks are classified at once with SSE2 or
+ * NEON when the target has them, the remaining tail byte by byte. Classes are
+ * ASCII-only, matching the <cctype> functions the lexers used in the "C" locale.
+ */
+namespace Scan
+{
+
+inline bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+inline bool isAlpha(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+inline bool isIdentifierChar(char c)
+{
+	return isAlpha(c) || isDigit(c) || c == '_';
+}
+
+inline bool isSpace(char c)
+{
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/// @brief Stops a "..." literal body: closing quote, escape, or a line break
+inline bool isQuotedStop(char c)
+{
+	return c == '"' || c == '\\' || c == '\n' || c == '\r';
+}
+
+#if defined(PHASOR_SCAN_SSE2)
+using Block = __m128i;
+/// One mask bit per byte
+inline constexpr int bitsPerByte = 1;
+inline constexpr u64 fullMask = 0xFFFF;
+
+inline Block load(const char *p)
+{
+	return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+inline Block eq(Block v, char c)
+{
+	return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+}
+inline Block inRange(Block v, char lo, char hi)
+{
+	// Unsigned (v - lo) <= (hi - lo)
+	Block shifted = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+	return _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(static_cast<char>(hi - lo))), shifted);
+}
+inline Block either(Block a, Block b)
+{
+	return _mm_or_si128(a, b);
+}
+inline u64 bits(Block m)
+{
+	return static_cast<u32>(_mm_movemask_epi8(m));
+}
+#elif defined(PHASOR_SCAN_NEON)
+using Block = uint8x16_t;
+/// Four mask bits per byte, NEON has no movemask
+inline constexpr int bitsPerByte = 4;
+inline constexpr u64 fullMask = ~u64{0};
+
+inline Block load(const char *p)
+{
+	return vld1q_u8(reinterpret_cast<const uint8_t *>(p));
+}
+inline Block eq(Block v, char c)
+{
+	return vceqq_u8(v, vdupq_n_u8(static_cast<uint8_t>(c)));
+}
+inline Block inRange(Block v, char lo, char hi)
+{
+	return vcleq_u8(vsubq_u8(v, vdupq_n_u8(static_cast<uint8_t>(lo))), vdupq_n_u8(static_cast<uint8_t>(hi - lo)));
+}
+inline Block either(Block a, Block b)
+{
+	return vorrq_u8(a, b);
+}
+inline u64 bits(Block m)
+{
+	return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+}
+#endif
+
+/// @brief First byte in [p, end) outside the class
+template <typename BlockClass, typename ByteClass>
+inline const char *skipWhile(const char *p, const char *end, BlockClass blockClass, ByteClass byteClass)
+{
+#if defined(PHASOR_SCAN_SSE2) || defined(PHASOR_SCAN_NEON)
+	for (; end - p >= 16; p += 16)
+	{
+		u64 outside = ~bits(blockClass(load(p))) & fullMask;
+		if (outside != 0)
+		{
+			return p + std::countr_zero(outside) / bitsPerByte;
+		}
+	}
+#else
+	(void)blockClass;
+#endif
+	while (p != end && byteClass(*p))
+	{
+		++p;
+	}
+	return p;
+}
+
+/// @brief First byte in [p, end) inside the class
+template <typename BlockClass, typename ByteClass>
+inline const char *findFirst(const char *p, const char *end, BlockClass blockClass, ByteClass byteClass)
+{
+#if defined(PHASOR_SCAN_SSE2) || defined(PHASOR_SCAN_NEON)
+	for (; end - p >= 16; p += 16)
+	{
+		u64 inside = bits(blockClass(load(p)));
+		if (inside != 0)
+		{
+			return p + std::countr_zero(inside) / bitsPerByte;
+		}
+	}
+#else
+	(void)blockClass;
+#endif
+	while (p != end && !byteClass(*p))
+	{
+		++p;
+	}
+	return p;
+}
+
+inline const char *identifierEnd(const char *p, const char *end)
+{
+	return skipWhile(
+	    p, end,
+	    [](auto v) {
+		    return either(either(inRange(v, 'a', 'z'), inRange(v, 'A', 'Z')), either(inRange(v, '0', '9'), eq(v, '_')));
+	    },
+	    isIdentifierChar);
+}
+
+inline const char *digitsEnd(const char *p, const char *end)
+{
+	return skipWhile(p, end, [](auto v) { return inRange(v, '0', '9'); }, isDigit);
+}
+
+inline const char *spaceEnd(const char *p, const char *end)
+{
+	return skipWhile(p, end, [](auto v) { return either(eq(v, ' '), inRange(v, '\t', '\r')); }, isSpace);
+}
+
+inline const char *quotedStop(const char *p, const char *end)
+{
+	return findFirst(
+	    p, end, [](auto v) { return either(either(eq(v, '"'), eq(v, '\\')), either(eq(v, '\n'), eq(v, '\r'))); },
+	    isQuotedStop);
+}
+
+/// @brief First occurrence of c in [p, end), or end
+inline const char *find(const char *p, const char *end, char c)
+{
+	// libc memchr is already vectorized on every platform we ship
+	const void *hit = std::memchr(p, c, static_cast<size_t>(end - p));
+	return hit != nullptr ? static_cast<const char *>(hit) : end;
+}
+
+/// @brief Line breaks in a run, for bulk line/column updates
+struct Lines
+{
+	size_t      count = 0;
+	const char *last = nullptr; ///< Last '\n', nullptr when count is 0
+};
+
+inline Lines countLines(const char *p, const char *end)
+{
+	Lines lines;
+#if defined(PHASOR_SCAN_SSE2) || defined(PHASOR_SCAN_NEON)
+	for (; end - p >= 16; p += 16)
+	{
+		u64 newlines = bits(eq(load(p), '\n'));
+		if (newlines != 0)
+		{
+			lines.count += static_cast<size_t>(std::popcount(newlines)) / bitsPerByte;
+			lines.last = p + (63 - std::countl_zero(newlines)) / bitsPerByte;
+		}
+	}
+#endif
+	for (; p != end; ++p)
+	{
+		if (*p == '\n')
+		{
+			++lines.count;
+			lines.last = p;
+		}
+	}
+	return lines;
+}
+
+} // namespace Scan
+} // namespace Phasor
@@ -0,0 +1,133 @@
+// Channel pipeline benchmark, built with -DBENCHMARKS=ON
+//
+//   phasor_channel_bench [messages]
+//
+// Times scripts passing messages between tasks through channels:
+//
+//   ints     one producer task sending integers to the script, which receives them
+//   moved    a producer task sends 256-element arrays to a forwarding task, which
+//            passes each on to the script as chan_send(out, chan_recv(in)); the
+//            array is referenced by nothing else, so it is moved, not copied
+//   copied   the same, but the forwarding task keeps each array in a variable
+//            before sending it, so chan_send() has to clone it
+//
+// and prints messages per second for each. It then checks that a task which first uses a
+// channel after the script closed it still receives the values left in it.
+#include "../../Codegen/CodeGen.hpp"
+#include "../../Language/Phasor/Lexer/Lexer.hpp"
+#include "../../Language/Phasor/Parser/Parser.hpp"
+#include "../Stdlib/StdLib.hpp"
+#include "../VM/VM.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <print>
+#include <string>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+static Phasor::Bytecode compile(const std::string &source)
+{
+	Phasor::Lexer         lexer(source);
+	Phasor::Parser        parser(lexer.tokenize());
+	Phasor::CodeGenerator codegen;
+	auto                  program = parser.parse();
+	return codegen.generate(*program);
+}
+
+// Locals of different functions get distinct names, as they share a variable slot per name
+static const char *source = "fn produce(ch: int, n: int) -> int {\n"
+                            "    var i: int = 0;\n"
+                            "    while (i < n) { chan_send(ch, i); i++; }\n"
+                            "    return n;\n"
+                            "}\n"
+                            "fn produceRows(ch: int, n: int) -> int {\n"
+                            "    var row: int[] = [];\n"
+                            "    var j: int = 0;\n"
+                            "    while (j < 256) { row = row.arr_push(j); j++; }\n"
+                            "    var r: int = 0;\n"
+                            "    while (r < n) { chan_send(ch, row); r++; }\n"
+                            "    return n;\n"
+                            "}\n"
+                            "fn moved(src: int, dst: int, n: int) -> int {\n"
+                            "    var f: int = 0;\n"
+                            "    while (f < n) { chan_send(dst, chan_recv(src)); f++; }\n"
+                            "    return n;\n"
+                            "}\n"
+                            "fn copied(src: int, dst: int, n: int) -> int {\n"
+                            "    var g: int = 0;\n"
+                            "    while (g < n) { var item: int[] = chan_recv(src); chan_send(dst, item); g++; }\n"
+                            "    return n;\n"
+                            "}\n"
+                            "fn drain(ch: int, n: int) -> int {\n"
+                            "    var d: int = 0;\n"
+                            "    while (d < n) { chan_recv(ch); d++; }\n"
+                            "    return n;\n"
+                            "}\n"
+                            "fn ints(n: int) -> int {\n"
+                            "    var a: int = chan_new(1024);\n"
+                            "    var p: int = spawn(\"produce\", [a, n]);\n"
+                            "    drain(a, n);\n"
+                            "    join(p);\n"
+                            "    chan_close(a);\n"
+                            "    return n;\n"
+                            "}\n"
+                            "fn sum(ch: int, n: int) -> int {\n"
+                            "    var total: int = 0;\n"
+                            "    var k: int = 0;\n"
+                            "    while (k < n) { total = total + chan_recv(ch); k++; }\n"
+                            "    return total;\n"
+                            "}\n"
+                            "fn late(n: int) -> int {\n"
+                            "    var c: int = chan_new(n);\n"
+                            "    var m: int = 0;\n"
+                            "    while (m < n) { chan_send(c, m); m++; }\n"
+                            "    chan_close(c);\n"
+                            "    return join(spawn(\"sum\", [c, n]));\n"
+                            "}\n"
+                            "fn rows(n: int, stage: string) -> int {\n"
+                            "    var a: int = chan_new(64);\n"
+                            "    var b: int = chan_new(64);\n"
+                            "    var p: int = spawn(\"produceRows\", [a, n]);\n"
+                            "    var s: int = spawn(stage, [a, b, n]);\n"
+                            "    drain(b, n);\n"
+                            "    join(p);\n"
+                            "    join(s);\n"
+                            "    chan_close(a);\n"
+                            "    chan_close(b);\n"
+                            "    return n;\n"
+                            "}\n";
+
+int main(int argc, char *argv[])
+{
+	int messages = std::max(argc > 1 ? std::atoi(argv[1]) : 100000, 1);
+
+	Phasor::Bytecode bytecode = compile(source);
+	Phasor::VM       vm;
+	Phasor::StdLib::registerFunctions(vm);
+	Phasor::StdLib::registerAllFunctions(vm);
+	vm.load(bytecode);
+
+	std::println("{} threads, {} messages", std::thread::hardware_concurrency(), messages);
+	auto report = [&](const char *name, const char *function, std::vector<Phasor::Value> args) {
+		vm.call(function, args);
+		auto   start = Clock::now();
+		vm.call(function, args);
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		std::println("{:<8} {:>12.0f} messages/s", name, messages / seconds);
+	};
+	const Phasor::Value count(static_cast<Phasor::i64>(messages));
+	report("ints", "ints", {count});
+	report("moved", "rows", {count, Phasor::Value("moved")});
+	report("copied", "rows", {count, Phasor::Value("copied")});
+
+	const Phasor::i64 sent = 1000;
+	Phasor::Value     total = vm.call("late", std::vector<Phasor::Value>{Phasor::Value(sent)});
+	if (total.asInt() != sent * (sent - 1) / 2)
+	{
+		std::println(stderr, "late: received a total of {}, expected {}", total.asInt(), sent * (sent - 1) / 2);
+		return 1;
+	}
+	std::println("late     ok");
+	return 0;
+}
@@ -0,0 +1,105 @@
+// Fiber switch benchmark, built with -DBENCHMARKS=ON
+//
+//   phasor_fiber_bench [switches]
+//
+// Times a script loop that resumes a generator fiber, which yields straight
+// back, against the same loop calling a function, so the difference is what
+// a resume and a yield cost over a call and a return. Then times the same
+// generator driven by resumeFiber() from C++, and fiber_run() switching
+// between a hundred fibers that take turns counting down a shared counter.
+#include "../../Codegen/CodeGen.hpp"
+#include "../../Language/Phasor/Lexer/Lexer.hpp"
+#include "../../Language/Phasor/Parser/Parser.hpp"
+#include "../Stdlib/StdLib.hpp"
+#include "../VM/VM.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <print>
+#include <string>
+
+using Clock = std::chrono::steady_clock;
+
+static Phasor::Bytecode compile(const std::string &source)
+{
+	Phasor::Lexer         lexer(source);
+	Phasor::Parser        parser(lexer.tokenize());
+	Phasor::CodeGenerator codegen;
+	auto                  program = parser.parse();
+	return codegen.generate(*program);
+}
+
+// Locals of different functions get distinct names, as they share a variable slot per name
+static const char *source = "var ticks: int = 0;\n"
+                            "fn counter(n: int) -> int {\n"
+                            "    var i: int = 0;\n"
+                            "    while (i < n) { yield(i); i++; }\n"
+                            "    return n;\n"
+                            "}\n"
+                            "fn identity(x: int) -> int {\n"
+                            "    return x;\n"
+                            "}\n"
+                            "fn calls(n: int) -> int {\n"
+                            "    var c: int = 0;\n"
+                            "    while (c < n) { identity(c); c++; }\n"
+                            "    return n;\n"
+                            "}\n"
+                            "fn resumes(n: int) -> int {\n"
+                            "    var f: int = fiber_new(\"counter\", [n]);\n"
+                            "    var r: int = 0;\n"
+                            "    while (r < n) { resume(f); r++; }\n"
+                            "    resume(f);\n"
+                            "    return n;\n"
+                            "}\n"
+                            "fn ticker() -> int {\n"
+                            "    while (ticks > 0) { ticks = ticks - 1; yield(); }\n"
+                            "    return 0;\n"
+                            "}\n"
+                            "fn scheduled(fibers: int, n: int) -> int {\n"
+                            "    ticks = n;\n"
+                            "    var s: int = 0;\n"
+                            "    while (s < fibers) { fiber_spawn(\"ticker\"); s++; }\n"
+                            "    fiber_run();\n"
+                            "    return n;\n"
+                            "}\n";
+
+static double nanosecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+	int switches = std::max(argc > 1 ? std::atoi(argv[1]) : 1000000, 100);
+
+	Phasor::Bytecode bytecode = compile(source);
+	Phasor::VM       vm;
+	Phasor::StdLib::registerFunctions(vm);
+	Phasor::StdLib::registerAllFunctions(vm);
+	vm.load(bytecode);
+
+	const Phasor::Value count[] = {Phasor::Value(static_cast<Phasor::i64>(switches))};
+	auto time = [&](const char *function) {
+		vm.call(function, count);
+		auto start = Clock::now();
+		vm.call(function, count);
+		return nanosecondsSince(start) / switches;
+	};
+	double callNs = time("calls");
+	double resumeNs = time("resumes");
+	std::println("call          {:>8.1f} ns", callNs);
+	std::println("resume/yield  {:>8.1f} ns   {:+.1f} ns over a call", resumeNs, resumeNs - callNs);
+
+	Phasor::i64 fiber = vm.newFiber(vm.findFunction("counter"), count);
+	auto        start = Clock::now();
+	while (!vm.fiberDone(fiber))
+		vm.resumeFiber(fiber);
+	std::println("from C++      {:>8.1f} ns", nanosecondsSince(start) / switches);
+
+	const int           fibers = 100;
+	const Phasor::Value scheduled[] = {Phasor::Value(fibers), count[0]};
+	start = Clock::now();
+	vm.call("scheduled", scheduled);
+	// Every tick is a switch, and so is each fiber's last resume, which finds none left
+	std::println("fiber_run()   {:>8.1f} ns per switch, {} fibers", nanosecondsSince(start) / (switches + fibers), fibers);
+	return 0;
+}
@@ -0,0 +1,130 @@
+// Multi-isolate stress benchmark, built with -DBENCHMARKS=ON
+//
+//   phasor_isolate_bench [threads] [calls]
+//
+// Compiles one program once and calls a function in it calls times on each of
+// 1, 2, ... threads at once, every thread with its own VM over the shared
+// Bytecode. The function seeds and draws from the random generator, builds a
+// string with a string builder and reads the script arguments, so VMs that
+// still shared any of that state would get each other's results. Every call's
+// result is checked against one made up front on a single VM, then the calls
+// per second at each thread count are printed with the speedup over one thread.
+#include "../../Codegen/CodeGen.hpp"
+#include "../../Language/Phasor/Lexer/Lexer.hpp"
+#include "../../Language/Phasor/Parser/Parser.hpp"
+#include "../Stdlib/StdLib.hpp"
+#include "../VM/VM.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <print>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static Phasor::Bytecode compile(const std::string &source)
+{
+	Phasor::Lexer         lexer(source);
+	Phasor::Parser        parser(lexer.tokenize());
+	Phasor::CodeGenerator codegen;
+	auto                  program = parser.parse();
+	return codegen.generate(*program);
+}
+
+static const char *source = "fn work(seed: int) -> int {\n"
+                            "    var next: int = seed + 1;\n"
+                            "    rand_seed(seed, next);\n"
+                            "    var sb: int = sb_new();\n"
+                            "    var total: int = 0;\n"
+                            "    var i: int = 0;\n"
+                            "    while (i < 64) {\n"
+                            "        total = total + rand_next_range(0, 9);\n"
+                            "        sb_append(sb, \"ab\");\n"
+                            "        i++;\n"
+                            "    }\n"
+                            "    var text: string = sb_to_string(sb);\n"
+                            "    sb_free(sb);\n"
+                            "    var size: int = len(text);\n"
+                            "    var argc: int = sys_argc();\n"
+                            "    total = total * 1000 + size;\n"
+                            "    return total * 10 + argc;\n"
+                            "}\n";
+
+/// @brief A VM with the standard library and its own arguments, ready to call into bytecode
+static std::unique_ptr<Phasor::VM> isolate(const Phasor::Bytecode &bytecode, char **argv)
+{
+	auto vm = std::make_unique<Phasor::VM>();
+	Phasor::StdLib::registerFunctions(*vm);
+	Phasor::StdLib::registerAllFunctions(*vm);
+	Phasor::StdLib::setArguments(*vm, 3, argv);
+	vm->load(bytecode);
+	return vm;
+}
+
+int main(int argc, char *argv[])
+{
+	int threads = std::max(argc > 1 ? std::atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency()), 1);
+	int calls = std::max(argc > 2 ? std::atoi(argv[2]) : 20000, 1);
+
+	const Phasor::Bytecode bytecode = compile(source);
+	char                   arg0[] = "bench", arg1[] = "a", arg2[] = "b";
+	char                  *arguments[] = {arg0, arg1, arg2};
+
+	// Results to expect, one per seed
+	constexpr int            SEEDS = 16;
+	std::vector<Phasor::i64> expected(SEEDS);
+	{
+		auto   vm = isolate(bytecode, arguments);
+		size_t entry = vm->findFunction("work");
+		for (int seed = 0; seed < SEEDS; ++seed)
+		{
+			const Phasor::Value args[] = {Phasor::Value(static_cast<Phasor::i64>(seed + 1))};
+			expected[seed] = vm->call(entry, args).asInt();
+		}
+	}
+
+	double single = 0;
+	for (int count = 1; count <= threads; ++count)
+	{
+		std::atomic<int>         mismatches = 0;
+		std::atomic<int>         ready = 0;
+		std::atomic<bool>        go = false;
+		std::vector<std::thread> workers;
+		for (int t = 0; t < count; ++t)
+		{
+			workers.emplace_back([&, t] {
+				auto   vm = isolate(bytecode, arguments);
+				size_t entry = vm->findFunction("work");
+				++ready;
+				while (!go.load(std::memory_order_acquire))
+					std::this_thread::yield();
+				for (int i = 0; i < calls; ++i)
+				{
+					int                 seed = (i + t) % SEEDS;
+					const Phasor::Value args[] = {Phasor::Value(static_cast<Phasor::i64>(seed + 1))};
+					if (vm->call(entry, args).asInt() != expected[seed])
+						++mismatches;
+				}
+			});
+		}
+		while (ready.load() < count)
+			std::this_thread::yield();
+		auto start = Clock::now();
+		go.store(true, std::memory_order_release);
+		for (std::thread &worker : workers)
+			worker.join();
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		double rate = static_cast<double>(calls) * count / seconds;
+		if (count == 1)
+			single = rate;
+		std::println("{:>3} threads {:>12.0f} calls/s   x{:<5.2f} {}", count, rate, rate / single,
+		             mismatches ? std::to_string(mismatches.load()) + " MISMATCHED" : "ok");
+		if (mismatches)
+			return 1;
+	}
+	return 0;
+}
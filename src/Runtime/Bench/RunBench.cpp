@@ -0,0 +1,70 @@
+// Short script latency benchmark, built with -DBENCHMARKS=ON
+//
+//   phasor_run_bench [iterations]
+//
+// Times VM::run() on tiny scripts that end in each way a run can: at their
+// HALT, through shutdown(), and with an error the VM raises itself. Then times
+// VM::call() on a function that recurses a few times before it returns. Each
+// script is compiled once and run on the same VM, as an embedder that runs many
+// short scripts would; run() sets the VM up afresh each time.
+#include "../../Codegen/CodeGen.hpp"
+#include "../../Language/Phasor/Lexer/Lexer.hpp"
+#include "../../Language/Phasor/Parser/Parser.hpp"
+#include "../Stdlib/StdLib.hpp"
+#include "../VM/VM.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <print>
+#include <string>
+
+using Clock = std::chrono::steady_clock;
+
+static Phasor::Bytecode compile(const std::string &source)
+{
+	Phasor::Lexer         lexer(source);
+	Phasor::Parser        parser(lexer.tokenize());
+	Phasor::CodeGenerator codegen;
+	auto                  program = parser.parse();
+	return codegen.generate(*program);
+}
+
+template <typename F> static void report(const char *name, int iterations, F &&run)
+{
+	run();
+	auto start = Clock::now();
+	for (int i = 0; i < iterations; ++i)
+		run();
+	double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / iterations;
+	std::println("{:<10} {:>8.3f} us", name, us);
+}
+
+int main(int argc, char *argv[])
+{
+	int iterations = std::max(argc > 1 ? std::atoi(argv[1]) : 200000, 1);
+
+	Phasor::Bytecode halt = compile("var x: int = 1;\nx = x + 2;\n");
+	Phasor::Bytecode shutdown = compile("using(\"stdsys\");\nvar x: int = 1;\nshutdown(x - 1);\n");
+	Phasor::Bytecode error = compile("var x: int = 1;\nvar s: string = substr(x, 2, 3);\n");
+	Phasor::Bytecode function = compile("fn f(n: int) -> int { if (n < 2) { return n; } return f(n - 1); }\n");
+
+	Phasor::VM vm;
+	Phasor::StdLib::registerFunctions(vm);
+
+	report("halt", iterations, [&] { vm.run(halt); });
+	report("shutdown", iterations, [&] { vm.run(shutdown); });
+	report("error", iterations, [&] {
+		try
+		{
+			vm.run(error);
+		}
+		catch (const std::exception &)
+		{
+		}
+	});
+
+	vm.load(function);
+	size_t                 entry = vm.findFunction("f");
+	const Phasor::Value    args[] = {Phasor::Value(5)};
+	report("call", iterations, [&] { vm.call(entry, args); });
+	return 0;
+}
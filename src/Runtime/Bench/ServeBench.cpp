@@ -0,0 +1,206 @@
+// Script server benchmark, built with -DBENCHMARKS=ON (POSIX only)
+//
+//   phasor_serve_bench <phasor> [requests] [concurrency] [script.phs]
+//
+// Runs the same script requests times, concurrency at a time, two ways: as the
+// web extension used to, spawning `phasor` with the source on stdin for each
+// one, and through a single `phasor --serve --workers <concurrency>` on
+// stdin/stdout. Prints throughput and median and 99th percentile latency of
+// each. Without a script, runs a small loop that prints its result.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <print>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static bool writeAll(int fd, const char *data, size_t size)
+{
+	while (size > 0)
+	{
+		ssize_t n = write(fd, data, size);
+		if (n <= 0)
+			return false;
+		data += n;
+		size -= static_cast<size_t>(n);
+	}
+	return true;
+}
+
+static bool readAll(int fd, char *data, size_t size)
+{
+	while (size > 0)
+	{
+		ssize_t n = read(fd, data, size);
+		if (n <= 0)
+			return false;
+		data += n;
+		size -= static_cast<size_t>(n);
+	}
+	return true;
+}
+
+static uint32_t getU32(const char *data)
+{
+	uint32_t value;
+	std::memcpy(&value, data, 4);
+	return value;
+}
+
+/// @brief Start argv with pipes on its stdin and stdout
+static pid_t spawn(std::vector<std::string> args, int &input, int &output)
+{
+	int toChild[2], fromChild[2];
+	if (pipe(toChild) != 0 || pipe(fromChild) != 0)
+		return -1;
+
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, toChild[0], STDIN_FILENO);
+	posix_spawn_file_actions_adddup2(&actions, fromChild[1], STDOUT_FILENO);
+	posix_spawn_file_actions_addclose(&actions, toChild[1]);
+	posix_spawn_file_actions_addclose(&actions, fromChild[0]);
+
+	std::vector<char *> argv;
+	for (std::string &arg : args)
+		argv.push_back(arg.data());
+	argv.push_back(nullptr);
+
+	pid_t pid = -1;
+	if (posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), environ) != 0)
+		pid = -1;
+	posix_spawn_file_actions_destroy(&actions);
+	close(toChild[0]);
+	close(fromChild[1]);
+	input = toChild[1];
+	output = fromChild[0];
+	return pid;
+}
+
+static void report(const char *name, std::vector<double> latencies, double seconds)
+{
+	std::sort(latencies.begin(), latencies.end());
+	auto percentile = [&](double p) {
+		return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))];
+	};
+	std::println("{:<8} {:>9.1f} req/s   p50 {:>8.3f} ms   p99 {:>8.3f} ms", name, latencies.size() / seconds,
+	             percentile(0.50), percentile(0.99));
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		std::println(stderr, "Usage: {} <phasor> [requests] [concurrency] [script.phs]", argv[0]);
+		return 1;
+	}
+	std::string phasor = argv[1];
+	int         requests = std::max(argc > 2 ? std::atoi(argv[2]) : 500, 1);
+	int         concurrency = std::max(argc > 3 ? std::atoi(argv[3]) : 4, 1);
+	std::string source = "var total: int = 0;\n"
+	                     "var i: int = 0;\n"
+	                     "while (i < 1000) { total = total + i; i++; }\n"
+	                     "print(total);\n";
+	if (argc > 4)
+	{
+		std::ifstream     file(argv[4]);
+		std::stringstream buffer;
+		buffer << file.rdbuf();
+		source = buffer.str();
+	}
+
+	// A process per request, source on stdin
+	{
+		std::vector<double>      latencies(requests);
+		std::atomic<int>         next = 0;
+		std::vector<std::thread> threads;
+		auto                     start = Clock::now();
+		for (int t = 0; t < concurrency; ++t)
+		{
+			threads.emplace_back([&] {
+				for (int i = next++; i < requests; i = next++)
+				{
+					auto  sent = Clock::now();
+					int   input, output;
+					pid_t pid = spawn({phasor}, input, output);
+					writeAll(input, source.data(), source.size());
+					close(input);
+					char chunk[4096];
+					while (read(output, chunk, sizeof(chunk)) > 0)
+					{
+					}
+					close(output);
+					waitpid(pid, nullptr, 0);
+					latencies[i] = millisecondsSince(sent);
+				}
+			});
+		}
+		for (std::thread &thread : threads)
+			thread.join();
+		report("spawn", latencies, millisecondsSince(start) / 1000);
+	}
+
+	// One server, concurrency requests in flight
+	{
+		int   input, output;
+		pid_t pid = spawn({phasor, "--serve", "--workers", std::to_string(concurrency)}, input, output);
+
+		std::vector<Clock::time_point> sent(requests);
+		std::vector<double>            latencies(requests);
+		auto                           send = [&](uint32_t id) {
+			std::string frame(8, '\0');
+			uint32_t    size = static_cast<uint32_t>(source.size());
+			std::memcpy(frame.data(), &id, 4);
+			std::memcpy(frame.data() + 4, &size, 4);
+			frame += source;
+			sent[id] = Clock::now();
+			writeAll(input, frame.data(), frame.size());
+		};
+
+		auto start = Clock::now();
+		int  issued = 0;
+		for (; issued < std::min(concurrency, requests); ++issued)
+			send(issued);
+		for (int done = 0; done < requests; ++done)
+		{
+			char header[12];
+			if (!readAll(output, header, sizeof(header)))
+			{
+				std::println(stderr, "Server closed the connection");
+				return 1;
+			}
+			std::string body(getU32(header + 8) + 4, '\0');
+			readAll(output, body.data(), body.size());
+			std::string err(getU32(body.data() + body.size() - 4), '\0');
+			readAll(output, err.data(), err.size());
+
+			uint32_t id = getU32(header);
+			latencies[id] = millisecondsSince(sent[id]);
+			if (issued < requests)
+				send(issued++);
+		}
+		double seconds = millisecondsSince(start) / 1000;
+		close(input);
+		close(output);
+		waitpid(pid, nullptr, 0);
+		report("serve", latencies, seconds);
+	}
+	return 0;
+}
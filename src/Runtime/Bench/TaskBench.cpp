@@ -0,0 +1,127 @@
+// stdtask benchmark, built with -DBENCHMARKS=ON
+//
+//   phasor_task_bench [items] [iterations]
+//
+// Runs a CPU-bound script function on items array elements, first one after
+// another in a script loop and then through par_map(), and prints both times
+// with the speedup, which should approach the number of cores. Then times
+// par_map() over functions that do nothing, which is what the pool costs per
+// element and per call. Last it times par_map() over lookups in a large global
+// table, which each task gets a copy of unless the table is frozen.
+#include "../../Codegen/CodeGen.hpp"
+#include "../../Language/Phasor/Lexer/Lexer.hpp"
+#include "../../Language/Phasor/Parser/Parser.hpp"
+#include "../Stdlib/StdLib.hpp"
+#include "../VM/VM.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <print>
+#include <string>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+static Phasor::Bytecode compile(const std::string &source)
+{
+	Phasor::Lexer         lexer(source);
+	Phasor::Parser        parser(lexer.tokenize());
+	Phasor::CodeGenerator codegen;
+	auto                  program = parser.parse();
+	return codegen.generate(*program);
+}
+
+static const char *source = "var table: int[] = [];\n"
+                            "fn work(n: int) -> int {\n"
+                            "    var total: int = 0;\n"
+                            "    var i: int = 0;\n"
+                            "    while (i < n) { total = total + i % 7; i++; }\n"
+                            "    return total;\n"
+                            "}\n"
+                            "fn serial(items: int[]) -> int[] {\n"
+                            "    var results: int[] = [];\n"
+                            "    var k: int = 0;\n"
+                            "    var count: int = arr_length(items);\n"
+                            "    while (k < count) { results = results.arr_push(work(items[k])); k++; }\n"
+                            "    return results;\n"
+                            "}\n"
+                            "fn parallel(items: int[]) -> int[] {\n"
+                            "    return par_map(items, \"work\");\n"
+                            "}\n"
+                            "fn setTable(rows: int[], frozen: bool) -> int {\n"
+                            "    if (frozen) { table = freeze(rows); } else { table = rows; }\n"
+                            "    return 0;\n"
+                            "}\n"
+                            "fn lookup(key: int) -> int {\n"
+                            "    return table[key];\n"
+                            "}\n"
+                            "fn lookups(keys: int[]) -> int[] {\n"
+                            "    return par_map(keys, \"lookup\");\n"
+                            "}\n";
+
+static double millisecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+	int items = std::max(argc > 1 ? std::atoi(argv[1]) : 256, 1);
+	int iterations = std::max(argc > 2 ? std::atoi(argv[2]) : 20000, 0);
+
+	Phasor::Bytecode bytecode = compile(source);
+	Phasor::VM       vm;
+	Phasor::StdLib::registerFunctions(vm);
+	Phasor::StdLib::registerAllFunctions(vm);
+	vm.load(bytecode);
+
+	auto work = [&](Phasor::i64 n) {
+		std::vector<Phasor::Value> elements(items, Phasor::Value(n));
+		return Phasor::Value::createArray(std::move(elements));
+	};
+
+	const Phasor::Value heavy[] = {work(iterations)};
+	vm.call("parallel", heavy);
+
+	auto          start = Clock::now();
+	Phasor::Value serial = vm.call("serial", heavy);
+	double        serialMs = millisecondsSince(start);
+	start = Clock::now();
+	Phasor::Value parallel = vm.call("parallel", heavy);
+	double        parallelMs = millisecondsSince(start);
+	if (serial != parallel)
+	{
+		std::println(stderr, "par_map() results differ from the serial loop's");
+		return 1;
+	}
+	std::println("{} threads, {} items of {} iterations", std::thread::hardware_concurrency(), items, iterations);
+	std::println("serial   {:>10.3f} ms", serialMs);
+	std::println("par_map  {:>10.3f} ms   x{:.2f}", parallelMs, serialMs / parallelMs);
+
+	const Phasor::Value empty[] = {work(0)};
+	const int           calls = 200;
+	start = Clock::now();
+	for (int i = 0; i < calls; ++i)
+		vm.call("parallel", empty);
+	double overheadUs = millisecondsSince(start) * 1000 / calls;
+	std::println("overhead {:>10.3f} us per par_map(), {:.3f} us per element", overheadUs, overheadUs / items);
+
+	const Phasor::i64 rows = 100000;
+	for (bool frozen : {false, true})
+	{
+		std::vector<Phasor::Value> table, keys;
+		for (Phasor::i64 i = 0; i < rows; ++i)
+			table.push_back(Phasor::Value(i));
+		for (int i = 0; i < items; ++i)
+			keys.push_back(Phasor::Value(static_cast<Phasor::i64>(i) * 7919 % rows));
+		const Phasor::Value setArgs[] = {Phasor::Value::createArray(std::move(table)), Phasor::Value(frozen)};
+		const Phasor::Value lookupArgs[] = {Phasor::Value::createArray(std::move(keys))};
+		vm.call("setTable", setArgs);
+
+		start = Clock::now();
+		for (int i = 0; i < 10; ++i)
+			vm.call("lookups", lookupArgs);
+		std::println("{:<8} {:>10.3f} ms per par_map() over a {}-row table", frozen ? "frozen" : "copied",
+		             millisecondsSince(start) / 10, rows);
+	}
+	return 0;
+}
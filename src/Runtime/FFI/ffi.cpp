@@ -188,12 +188,26 @@ FFI::FFI(const std::filesystem::path &pluginFolder, VM *vm) : pluginFolder_(plug
 	vm_->flush();
 #endif
 	vm_->registerNativeFunction("load_plugin", INSTANCED_FFI(FFI::native_add_plugin));
-	auto plugins = scanPlugins(pluginFolder_);
+	loadPlugins(scanPlugins(pluginFolder_));
+}
+
+FFI::FFI(const std::vector<std::string> &plugins, VM *vm) : vm_(vm)
+{
+#ifdef TRACING
+	vm_->log(std::format("Phasor::FFI::{}(): created {:#x}\n", __func__, (uintptr_t)this));
+	vm_->flush();
+#endif
+	vm_->registerNativeFunction("load_plugin", INSTANCED_FFI(FFI::native_add_plugin));
+	loadPlugins(plugins);
+}
+
+void FFI::loadPlugins(const std::vector<std::string> &plugins)
+{
 	for (const auto &pluginPath : plugins)
 	{
 		try
 		{
-			loadPlugin(pluginPath, vm);
+			loadPlugin(pluginPath, vm_);
 		}
 		catch (const std::runtime_error &e)
 		{
@@ -202,6 +216,15 @@ FFI::FFI(const std::filesystem::path &pluginFolder, VM *vm) : pluginFolder_(plug
 	}
 }
 
+std::vector<std::string> FFI::pluginPaths() const
+{
+	std::vector<std::string> paths;
+	paths.reserve(plugins_.size());
+	for (const auto &plugin : plugins_)
+		paths.push_back(std::filesystem::absolute(plugin.path).string());
+	return paths;
+}
+
 FFI::~FFI()
 {
 	unloadAll();
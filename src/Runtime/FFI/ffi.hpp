@@ -45,6 +45,11 @@ struct Plugin
 	std::function<void()> shutdown; ///< Optional shutdown callback
 };
 
+/**
+ * @brief Converts a C value from a plugin or host to a VM value, copying strings.
+ */
+Phasor::Value from_c_value(const PhasorValue &c_value);
+
 /**
  * @brief The "trampoline" that wraps a C function from a plugin.
  */
@@ -76,6 +81,13 @@ class FFI
 	 */
 	explicit FFI(const std::filesystem::path &pluginFolder, VM *vm);
 
+	/**
+	 * @brief Constructs the FFI manager and loads exactly these plugins, without scanning.
+	 * @param plugins Plugin files, as returned by pluginPaths().
+	 * @param vm Pointer to the Phasor VM instance to register plugin functions with.
+	 */
+	FFI(const std::vector<std::string> &plugins, VM *vm);
+
 	/**
 	 * @brief Destructor. Unloads all loaded plugins.
 	 */
@@ -88,6 +100,11 @@ class FFI
 	 */
 	bool addPlugin(const std::filesystem::path &pluginPath);
 
+	/**
+	 * @brief Absolute paths of the plugins loaded so far, from the folder or load_plugin().
+	 */
+	std::vector<std::string> pluginPaths() const;
+
   private:
 	/**
 	 * @brief Native function to load a plugin at runtime.
@@ -109,6 +126,11 @@ class FFI
 	 */
 	std::vector<std::string> scanPlugins(const std::filesystem::path &folder);
 
+	/**
+	 * @brief Loads each plugin, reporting the ones that fail on stderr.
+	 */
+	void loadPlugins(const std::vector<std::string> &plugins);
+
 	/**
 	 * @brief Unloads all currently loaded plugins and clears internal state.
 	 */
@@ -61,7 +61,7 @@ int ScriptingRuntime::runSourceString(const std::string &source, VM &vm)
 {
 	Lexer  lexer(source);
 	auto   tokens = lexer.tokenize();
-	Parser parser(tokens, m_args.inputFile);
+	Parser parser(std::move(tokens), m_args.inputFile);
 	auto   program = parser.parse();
 
 	if (m_args.verbose)
@@ -72,17 +72,26 @@ int ScriptingRuntime::runSourceString(const std::string &source, VM &vm)
 	}
 
 	CodeGenerator codegen;
-	auto          bytecode = codegen.generate(*program);
-
-	return vm.run(bytecode);
+	codegen.setPureCallEvaluator(StdLib::pureCallEvaluator());
+	auto          bytecode = Frontend::linkModules(codegen.generate(*program), m_args.inputFile);
+
+	if (m_args.snapshotFile.empty())
+		return vm.run(bytecode);
+
+	vm.setSnapshotPath(m_args.snapshotFile);
+	int status = vm.run(bytecode);
+	if (!vm.snapshotTaken())
+		throw std::runtime_error("Script finished without calling snapshot(), no snapshot written");
+	std::println(std::cerr, "Snapshot written to {}, {:.3f} ms after start", m_args.snapshotFile,
+	             std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count());
+	return status;
 }
 
 std::unique_ptr<VM> ScriptingRuntime::createVm()
 {
 	auto vm = std::make_unique<VM>();
 	StdLib::registerFunctions(*vm);
-	StdLib::argv = m_args.scriptArgv;
-	StdLib::argc = m_args.scriptArgc;
+	StdLib::setArguments(*vm, m_args.scriptArgc, m_args.scriptArgv);
 
 #if defined(_WIN32)
 	vm->initFFI("plugins");
@@ -92,14 +101,8 @@ std::unique_ptr<VM> ScriptingRuntime::createVm()
 	vm->initFFI("/usr/lib/phasor/plugins/");
 #endif
 
-	vm->setImportHandler([this, vm_ptr = vm.get()](const std::filesystem::path &path) {
-		std::ifstream file(path);
-		if (!file.is_open())
-			throw std::runtime_error("Could not open imported file: " + path.string());
-		std::stringstream buffer;
-		buffer << file.rdbuf();
-		runSourceString(buffer.str(), *vm_ptr);
-	});
+	vm->setImportHandler(
+	    [vm_ptr = vm.get()](const std::filesystem::path &path) { Frontend::runModule(path, vm_ptr); });
 
 	return vm;
 }
@@ -127,6 +130,10 @@ void ScriptingRuntime::parseArguments(int argc, char *argv[])
 			showHelp(argv[0]);
 			exit(0);
 		}
+		else if (arg == "--snapshot" && i + 1 < argc)
+		{
+			m_args.snapshotFile = argv[++i];
+		}
 		else
 		{
 			defaultArgLocation = i;
@@ -148,7 +155,8 @@ void ScriptingRuntime::showHelp(const std::string &programName)
 	             "Options:\n"
 	             "  -v, --verbose       Enable verbose output (print AST)\n"
 	             "  -h, --help          Show this help message\n"
-	             "  -c, --command       Run a source string from argv",
+	             "  -c, --command       Run a source string from argv\n"
+	             "  --snapshot <file>   Stop at the script's snapshot() call and save the VM to file",
 	             PHASOR_VERSION_STRING, filename);
 }
 
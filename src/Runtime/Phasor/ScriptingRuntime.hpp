@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <memory>
 #include <string>
 #include <vector>
@@ -34,10 +35,13 @@ class ScriptingRuntime
 	{
 		std::string inputFile;
 		bool        verbose = false;
+		std::string snapshotFile; ///< Write a snapshot here when the script calls snapshot()
 		int         scriptArgc = 0;
 		char      **scriptArgv = nullptr;
 	} m_args;
 
+	std::chrono::steady_clock::time_point m_start = std::chrono::steady_clock::now();
+
 	void parseArguments(int argc, char *argv[]);
 	void showHelp(const std::string &programName);
 };
@@ -0,0 +1,675 @@
+#include "ServeRuntime.hpp"
+#include "../../Codegen/CodeGen.hpp"
+#include "../../Frontend/Phasor/Frontend.hpp"
+#include "../../Language/Phasor/Lexer/Lexer.hpp"
+#include "../../Language/Phasor/Parser/Parser.hpp"
+#include "../../Runtime/Stdlib/StdLib.hpp"
+#include "../../Runtime/VM/VM.hpp"
+#include <version.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <print>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nativeerror.h>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace Phasor
+{
+
+ServeRuntime::ServeRuntime(int argc, char *argv[])
+{
+	parseArguments(argc, argv);
+}
+
+#ifndef _WIN32
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+constexpr u32    MAX_SOURCE_SIZE = 16u << 20; ///< Larger requests close the connection
+constexpr size_t CACHE_ENTRIES = 256;         ///< Compiled scripts a worker keeps, dropped all at once when full
+
+volatile std::sig_atomic_t stopRequested = 0;
+
+void putU32(std::string &out, u32 value)
+{
+	for (int i = 0; i < 4; i++)
+		out.push_back(static_cast<char>(value >> (i * 8)));
+}
+
+u32 getU32(const char *data)
+{
+	const auto *bytes = reinterpret_cast<const unsigned char *>(data);
+	return static_cast<u32>(bytes[0]) | static_cast<u32>(bytes[1]) << 8 | static_cast<u32>(bytes[2]) << 16 |
+	       static_cast<u32>(bytes[3]) << 24;
+}
+
+/// @return false at end of file or on an error
+bool readAll(int fd, char *data, size_t size)
+{
+	while (size > 0)
+	{
+		ssize_t n = ::read(fd, data, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		data += n;
+		size -= static_cast<size_t>(n);
+	}
+	return true;
+}
+
+bool writeAll(int fd, const char *data, size_t size)
+{
+	while (size > 0)
+	{
+		ssize_t n = ::write(fd, data, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		data += n;
+		size -= static_cast<size_t>(n);
+	}
+	return true;
+}
+
+std::string encodeResponse(u32 id, i32 exitCode, std::string_view out, std::string_view err)
+{
+	std::string frame;
+	frame.reserve(16 + out.size() + err.size());
+	putU32(frame, id);
+	putU32(frame, static_cast<u32>(exitCode));
+	putU32(frame, static_cast<u32>(out.size()));
+	frame.append(out);
+	putU32(frame, static_cast<u32>(err.size()));
+	frame.append(err);
+	return frame;
+}
+
+/// @brief An unlinked temporary file for a worker's stdout or stderr
+int scratchFile()
+{
+	char path[] = "/tmp/phasor-serve-XXXXXX";
+	int  fd = mkstemp(path);
+	if (fd < 0)
+		throw std::runtime_error(std::string("Failed to create scratch file: ") + std::strerror(errno));
+	::unlink(path);
+	return fd;
+}
+
+/// @brief What a script wrote to a scratch file, up to limit bytes; the file is emptied for the next one
+std::string drain(int fd, size_t limit)
+{
+	off_t       size = ::lseek(fd, 0, SEEK_END);
+	std::string text(static_cast<size_t>(std::clamp<off_t>(size, 0, static_cast<off_t>(limit))), '\0');
+	ssize_t     got = text.empty() ? 0 : ::pread(fd, text.data(), text.size(), 0);
+	text.resize(got > 0 ? static_cast<size_t>(got) : 0);
+	if (size > static_cast<off_t>(limit))
+		text += "\n[output truncated]\n";
+	if (::ftruncate(fd, 0) != 0 || ::lseek(fd, 0, SEEK_SET) != 0)
+		throw std::runtime_error("Failed to reset scratch file");
+	return text;
+}
+
+/// @brief Compiled bytecode by source, so a script sent again isn't compiled again
+class BytecodeCache
+{
+  public:
+	/// @throws std::runtime_error on compile errors, which aren't cached
+	const Bytecode &get(const std::string &source)
+	{
+		auto it = m_entries.find(source);
+		if (it != m_entries.end())
+			return it->second;
+
+		Lexer  lexer(source);
+		Parser parser(lexer.tokenize());
+		auto   program = parser.parse();
+
+		CodeGenerator codegen;
+		codegen.setPureCallEvaluator(StdLib::pureCallEvaluator());
+		Bytecode bytecode = Frontend::linkModules(codegen.generate(*program), "");
+
+		if (m_entries.size() >= CACHE_ENTRIES)
+			m_entries.clear();
+		return m_entries.emplace(source, std::move(bytecode)).first->second;
+	}
+
+  private:
+	std::unordered_map<std::string, Bytecode> m_entries;
+};
+
+/// @brief Run requests from the parent until it closes the channel
+[[noreturn]] void workerMain(int channel, VM &vm, const ServeRuntime::Args &args)
+{
+	// Writes past the output limit fail instead of filling the disk
+	std::signal(SIGXFSZ, SIG_IGN);
+	rlimit output{static_cast<rlim_t>(args.maxOutput + 1), static_cast<rlim_t>(args.maxOutput + 1)};
+	setrlimit(RLIMIT_FSIZE, &output);
+	if (args.memoryLimit > 0)
+	{
+		rlimit memory{static_cast<rlim_t>(args.memoryLimit), static_cast<rlim_t>(args.memoryLimit)};
+		setrlimit(RLIMIT_AS, &memory);
+	}
+
+	BytecodeCache cache;
+	char          header[8];
+	while (readAll(channel, header, sizeof(header)))
+	{
+		u32         id = getU32(header);
+		std::string source(getU32(header + 4), '\0');
+		if (!readAll(channel, source.data(), source.size()))
+			break;
+
+		int exitCode;
+		try
+		{
+			exitCode = vm.run(cache.get(source));
+		}
+		catch (const std::exception &e)
+		{
+			std::println(std::cerr, "Error: {}", e.what());
+			exitCode = 1;
+		}
+		std::cout.flush();
+		std::cerr.flush();
+		std::fflush(stdout);
+		std::fflush(stderr);
+
+		std::string out = drain(STDOUT_FILENO, args.maxOutput);
+		std::string err = drain(STDERR_FILENO, args.maxOutput);
+		vm.resetToBaseline();
+
+		std::string response = encodeResponse(id, exitCode, out, err);
+		if (!writeAll(channel, response.data(), response.size()))
+			break;
+	}
+	_exit(0);
+}
+
+class Server
+{
+  public:
+	Server(const ServeRuntime::Args &args, VM &vm) : m_args(args), m_vm(vm), m_workers(std::max(args.workers, 1))
+	{
+	}
+
+	~Server()
+	{
+		for (Worker &worker : m_workers)
+			stop(worker);
+		for (auto &[id, client] : m_clients)
+			closeFds(client);
+		if (m_listen >= 0)
+		{
+			::close(m_listen);
+			::unlink(m_args.socketPath.c_str());
+		}
+	}
+
+	int run()
+	{
+		if (m_args.socketPath.empty())
+			m_clients.emplace(m_nextClient++, Client{STDIN_FILENO, STDOUT_FILENO});
+		else
+			listenOn(m_args.socketPath);
+
+		for (Worker &worker : m_workers)
+			spawn(worker);
+		if (m_args.verbose)
+			std::println(std::cerr, "phasor --serve: {} workers, {}", m_workers.size(),
+			             m_args.socketPath.empty() ? "stdin/stdout" : "listening on " + m_args.socketPath);
+
+		// On stdin/stdout, done once stdin is closed and every response is out
+		while (!stopRequested && (m_listen >= 0 || !m_clients.empty()))
+		{
+			dispatch();
+
+			std::vector<pollfd>   fds;
+			std::vector<Watched>  watched;
+			if (m_listen >= 0)
+			{
+				fds.push_back({m_listen, POLLIN, 0});
+				watched.push_back({Watched::Listen, 0});
+			}
+			for (auto &[id, client] : m_clients)
+			{
+				if (!client.reading)
+					continue;
+				fds.push_back({client.in, POLLIN, 0});
+				watched.push_back({Watched::Client, id});
+			}
+			std::optional<Clock::time_point> deadline;
+			for (size_t i = 0; i < m_workers.size(); i++)
+			{
+				if (!m_workers[i].job)
+					continue;
+				fds.push_back({m_workers[i].channel, POLLIN, 0});
+				watched.push_back({Watched::Worker, i});
+				deadline = deadline ? std::min(*deadline, m_workers[i].deadline) : m_workers[i].deadline;
+			}
+
+			int timeout = -1;
+			if (deadline)
+				timeout = static_cast<int>(std::max<i64>(
+				    0, std::chrono::ceil<std::chrono::milliseconds>(*deadline - Clock::now()).count()));
+			if (::poll(fds.data(), fds.size(), timeout) < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				throw std::runtime_error(std::string("poll failed: ") + std::strerror(errno));
+			}
+
+			for (size_t i = 0; i < fds.size(); i++)
+			{
+				if (fds[i].revents == 0)
+					continue;
+				switch (watched[i].kind)
+				{
+				case Watched::Listen:
+					accept();
+					break;
+				case Watched::Client:
+					readClient(watched[i].id);
+					break;
+				case Watched::Worker:
+					readWorker(m_workers[watched[i].id]);
+					break;
+				}
+			}
+
+			auto now = Clock::now();
+			for (Worker &worker : m_workers)
+			{
+				if (worker.job && now >= worker.deadline)
+					replace(worker, std::format("Error: Time limit of {} ms exceeded\n", m_args.timeoutMs));
+			}
+		}
+		return 0;
+	}
+
+  private:
+	struct Job
+	{
+		u64         client;
+		std::string frame; ///< The request as received, forwarded to the worker unchanged
+	};
+
+	struct Worker
+	{
+		pid_t              pid = -1;
+		int                channel = -1;
+		int                out = -1; ///< Scratch files behind the worker's stdout and stderr
+		int                err = -1;
+		std::optional<Job> job;
+		Clock::time_point  deadline;
+	};
+
+	struct Client
+	{
+		int         in;
+		int         out;
+		std::string buffer;
+		bool        reading = true;
+		size_t      inFlight = 0;
+	};
+
+	struct Watched
+	{
+		enum Kind
+		{
+			Listen,
+			Client,
+			Worker
+		} kind;
+		u64 id;
+	};
+
+	const ServeRuntime::Args          &m_args;
+	VM                                &m_vm;
+	std::vector<Worker>                m_workers;
+	std::unordered_map<u64, Client>    m_clients;
+	std::deque<Job>                    m_queue;
+	u64                                m_nextClient = 0;
+	int                                m_listen = -1;
+
+	void listenOn(const std::string &path)
+	{
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(address.sun_path))
+			throw std::runtime_error("Socket path too long: " + path);
+		std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+		// A socket left behind by an earlier server, but never anything else
+		struct stat info{};
+		if (::lstat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode))
+			::unlink(path.c_str());
+
+		m_listen = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		if (m_listen < 0 || ::bind(m_listen, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+		    ::listen(m_listen, 64) != 0)
+			throw std::runtime_error("Failed to listen on " + path + ": " + std::strerror(errno));
+	}
+
+	void accept()
+	{
+		int fd = ::accept(m_listen, nullptr, nullptr);
+		if (fd >= 0)
+			m_clients.emplace(m_nextClient++, Client{fd, fd});
+	}
+
+	void spawn(Worker &worker)
+	{
+		if (worker.out < 0)
+		{
+			worker.out = scratchFile();
+			worker.err = scratchFile();
+		}
+		int channel[2];
+		if (::socketpair(AF_UNIX, SOCK_STREAM, 0, channel) != 0)
+			throw std::runtime_error(std::string("socketpair failed: ") + std::strerror(errno));
+
+		pid_t pid = ::fork();
+		if (pid < 0)
+			throw std::runtime_error(std::string("fork failed: ") + std::strerror(errno));
+		if (pid == 0)
+		{
+			std::signal(SIGINT, SIG_DFL);
+			std::signal(SIGTERM, SIG_DFL);
+			::close(channel[0]);
+			if (m_listen >= 0)
+				::close(m_listen);
+			for (auto &[id, client] : m_clients)
+				closeFds(client);
+			for (Worker &other : m_workers)
+			{
+				if (other.channel >= 0)
+					::close(other.channel);
+			}
+			int null = ::open("/dev/null", O_RDONLY);
+			::dup2(null, STDIN_FILENO);
+			::dup2(worker.out, STDOUT_FILENO);
+			::dup2(worker.err, STDERR_FILENO);
+			::close(null);
+			workerMain(channel[1], m_vm, m_args);
+		}
+		::close(channel[1]);
+		worker.pid = pid;
+		worker.channel = channel[0];
+	}
+
+	/// @brief Kill a worker, answer its request with what it had written and message, and start another
+	void replace(Worker &worker, const std::string &message)
+	{
+		stop(worker);
+		if (worker.job)
+		{
+			Job job = std::move(*worker.job);
+			worker.job.reset();
+			std::string out = drain(worker.out, m_args.maxOutput);
+			std::string err = drain(worker.err, m_args.maxOutput) + message;
+			respond(job.client, encodeResponse(getU32(job.frame.data()), -1, out, err));
+		}
+		spawn(worker);
+	}
+
+	void stop(Worker &worker)
+	{
+		if (worker.pid > 0)
+		{
+			::kill(worker.pid, SIGKILL);
+			::waitpid(worker.pid, nullptr, 0);
+			worker.pid = -1;
+		}
+		if (worker.channel >= 0)
+		{
+			::close(worker.channel);
+			worker.channel = -1;
+		}
+	}
+
+	void dispatch()
+	{
+		for (Worker &worker : m_workers)
+		{
+			if (m_queue.empty())
+				return;
+			if (worker.job)
+				continue;
+			worker.job = std::move(m_queue.front());
+			m_queue.pop_front();
+			worker.deadline = Clock::now() + std::chrono::milliseconds(m_args.timeoutMs);
+			if (!writeAll(worker.channel, worker.job->frame.data(), worker.job->frame.size()))
+				replace(worker, "Error: Worker exited unexpectedly\n");
+		}
+	}
+
+	void readClient(u64 id)
+	{
+		Client &client = m_clients.at(id);
+		char    chunk[64 * 1024];
+		ssize_t n = ::read(client.in, chunk, sizeof(chunk));
+		if (n < 0 && errno == EINTR)
+			return;
+		if (n <= 0)
+		{
+			finishReading(id);
+			return;
+		}
+
+		client.buffer.append(chunk, static_cast<size_t>(n));
+		size_t used = 0;
+		while (client.buffer.size() - used >= 8)
+		{
+			u32 size = getU32(client.buffer.data() + used + 4);
+			if (size > MAX_SOURCE_SIZE)
+			{
+				finishReading(id);
+				return;
+			}
+			if (client.buffer.size() - used < 8 + size)
+				break;
+			m_queue.push_back(Job{id, client.buffer.substr(used, 8 + size)});
+			client.inFlight++;
+			used += 8 + size;
+		}
+		client.buffer.erase(0, used);
+	}
+
+	/// @brief Take no more requests from a client, and drop it once its responses are out
+	void finishReading(u64 id)
+	{
+		Client &client = m_clients.at(id);
+		client.reading = false;
+		client.buffer.clear();
+		if (client.inFlight == 0)
+			dropClient(id);
+	}
+
+	void readWorker(Worker &worker)
+	{
+		std::string response(12, '\0');
+		bool        ok = readAll(worker.channel, response.data(), 12);
+		if (ok)
+		{
+			size_t outSize = getU32(response.data() + 8);
+			response.resize(12 + outSize + 4);
+			ok = readAll(worker.channel, response.data() + 12, outSize + 4);
+			if (ok)
+			{
+				size_t errSize = getU32(response.data() + 12 + outSize);
+				response.resize(16 + outSize + errSize);
+				ok = readAll(worker.channel, response.data() + 16 + outSize, errSize);
+			}
+		}
+		if (!ok)
+		{
+			replace(worker, "Error: Worker exited unexpectedly\n");
+			return;
+		}
+		u64 client = worker.job->client;
+		worker.job.reset();
+		respond(client, response);
+	}
+
+	void respond(u64 id, const std::string &response)
+	{
+		auto it = m_clients.find(id);
+		if (it == m_clients.end())
+			return;
+		Client &client = it->second;
+		client.inFlight--;
+		if (!writeAll(client.out, response.data(), response.size()))
+		{
+			dropClient(id);
+			return;
+		}
+		if (!client.reading && client.inFlight == 0)
+			dropClient(id);
+	}
+
+	void dropClient(u64 id)
+	{
+		closeFds(m_clients.at(id));
+		m_clients.erase(id);
+		// Queued requests of a client that's gone aren't run
+		std::erase_if(m_queue, [id](const Job &job) { return job.client == id; });
+	}
+
+	static void closeFds(Client &client)
+	{
+		// stdin/stdout stay open for the process
+		if (client.in > STDERR_FILENO)
+			::close(client.in);
+		if (client.out > STDERR_FILENO && client.out != client.in)
+			::close(client.out);
+	}
+};
+
+} // namespace
+
+int ServeRuntime::run()
+{
+	try
+	{
+		// Everything a request shouldn't pay for again happens here, before the workers fork
+		auto vm = std::make_unique<VM>();
+		StdLib::registerFunctions(*vm);
+		StdLib::setArguments(*vm, 0, nullptr);
+#if defined(__APPLE__)
+		vm->initFFI("/Library/Application Support/org.Phasor.Phasor/plugins");
+#elif defined(__linux__)
+		vm->initFFI("/usr/lib/phasor/plugins/");
+#endif
+		vm->setImportHandler([vm_ptr = vm.get()](const std::filesystem::path &path) {
+			Frontend::runModule(path, vm_ptr);
+		});
+		vm->saveBaseline();
+
+		struct sigaction stop{};
+		stop.sa_handler = [](int) { stopRequested = 1; };
+		sigaction(SIGINT, &stop, nullptr);
+		sigaction(SIGTERM, &stop, nullptr);
+		std::signal(SIGPIPE, SIG_IGN);
+
+		Server server(m_args, *vm);
+		return server.run();
+	}
+	catch (const std::exception &e)
+	{
+		error(e.what());
+		return 1;
+	}
+}
+
+#else
+
+int ServeRuntime::run()
+{
+	error("--serve needs fork() and Unix domain sockets and isn't available on Windows yet");
+	return 1;
+}
+
+#endif
+
+void ServeRuntime::parseArguments(int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		auto        value = [&]() -> std::string {
+			if (i + 1 >= argc)
+				throw std::runtime_error("Missing value for " + arg);
+			return argv[++i];
+		};
+
+		if (arg == "--serve")
+			continue;
+		else if (arg == "-v" || arg == "--verbose")
+			m_args.verbose = true;
+		else if (arg == "--socket")
+			m_args.socketPath = value();
+		else if (arg == "--workers")
+			m_args.workers = std::stoi(value());
+		else if (arg == "--timeout")
+			m_args.timeoutMs = std::stoi(value());
+		else if (arg == "--max-output")
+			m_args.maxOutput = std::stoull(value());
+		else if (arg == "--memory")
+			m_args.memoryLimit = std::stoull(value()) << 20;
+		else if (arg == "-h" || arg == "--help")
+		{
+			showHelp(argv[0]);
+			exit(0);
+		}
+		else
+			throw std::runtime_error("Unknown --serve option: " + arg);
+	}
+	if (m_args.workers < 1 || m_args.timeoutMs < 1)
+		throw std::runtime_error("--workers and --timeout must be positive");
+}
+
+void ServeRuntime::showHelp(const std::string &programName)
+{
+	std::string filename = std::filesystem::path(programName).filename().string();
+	std::println("Phasor Script Server v{}\n"
+	             "(C) 2026 Daniel McGuire - Licensed under Apache 2.0\n\n"
+	             "Usage:\n"
+	             "  {} --serve [options]\n\n"
+	             "Options:\n"
+	             "  --socket <path>     Listen on a Unix domain socket instead of stdin/stdout\n"
+	             "  --workers <n>       Worker processes (default 4)\n"
+	             "  --timeout <ms>      Time limit per script (default 5000)\n"
+	             "  --max-output <n>    Bytes of stdout and of stderr kept per script (default 1048576)\n"
+	             "  --memory <MiB>      Address space limit per worker (default none)\n"
+	             "  -v, --verbose       Report the configuration on stderr\n"
+	             "  -h, --help          Show this help message",
+	             PHASOR_VERSION_STRING, filename);
+}
+
+} // namespace Phasor
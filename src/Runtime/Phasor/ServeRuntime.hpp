@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+/// @brief The Phasor Programming Language and Runtime
+namespace Phasor
+{
+
+/**
+ * @class ServeRuntime
+ * @brief `phasor --serve`: runs submitted scripts on a pool of warm worker processes
+ *
+ * The standard library is registered and the FFI plugins are loaded once, then
+ * the process forks its workers, each keeping one VM that is reset between
+ * scripts and a cache of compiled bytecode keyed by source. The parent only
+ * moves frames between clients and idle workers, and enforces the time limit
+ * by replacing a worker that overruns it.
+ *
+ * Clients talk either over stdin/stdout or over connections to a Unix domain
+ * socket, in frames of little-endian integers:
+ *
+ *   request:  u32 id, u32 size, source
+ *   response: u32 id, i32 exit code, u32 size, stdout, u32 size, stderr
+ *
+ * Responses carry the id of their request and may arrive out of order when
+ * several are in flight. POSIX only.
+ */
+class ServeRuntime
+{
+  public:
+	struct Args
+	{
+		std::string socketPath;            ///< Listen here instead of on stdin/stdout
+		int         workers = 4;           ///< Worker processes, each running one script at a time
+		int         timeoutMs = 5000;      ///< Per script; the worker is killed and replaced after it
+		size_t      maxOutput = 1 << 20;   ///< Bytes of stdout and of stderr kept per script
+		size_t      memoryLimit = 0;       ///< Address space per worker in bytes, 0 for no limit
+		bool        verbose = false;
+	};
+
+	ServeRuntime(int argc, char *argv[]);
+	int run();
+
+  private:
+	Args m_args;
+
+	void parseArguments(int argc, char *argv[]);
+	void showHelp(const std::string &programName);
+};
+
+} // namespace Phasor
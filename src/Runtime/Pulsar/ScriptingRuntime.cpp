@@ -63,6 +63,7 @@ int Interpreter::runSourceString(const std::string &source, Phasor::VM &vm)
 	Parser                parser(lexer.tokenize());
 	Phasor::CodeGenerator codegen;
 	auto                  program = parser.parse();
+	codegen.setPureCallEvaluator(Phasor::StdLib::pureCallEvaluator());
 
 	if (m_args.verbose)
 	{
@@ -79,8 +80,7 @@ std::unique_ptr<Phasor::VM> Interpreter::createVm()
 {
 	auto vm = std::make_unique<Phasor::VM>();
 	Phasor::StdLib::registerFunctions(*vm);
-	Phasor::StdLib::argv = m_args.scriptArgv;
-	Phasor::StdLib::argc = m_args.scriptArgc;
+	Phasor::StdLib::setArguments(*vm, m_args.scriptArgc, m_args.scriptArgv);
 
 #if defined(_WIN32)
 	vm->initFFI("plugins");
@@ -90,14 +90,8 @@ std::unique_ptr<Phasor::VM> Interpreter::createVm()
 	vm->initFFI("/opt/Phasor/plugins");
 #endif
 
-	vm->setImportHandler([this, vm_ptr = vm.get()](const std::filesystem::path &path) {
-		std::ifstream file(path);
-		if (!file.is_open())
-			throw std::runtime_error("Could not open imported file: " + path.string());
-		std::stringstream buffer;
-		buffer << file.rdbuf();
-		runSourceString(buffer.str(), *vm_ptr);
-	});
+	vm->setImportHandler(
+	    [vm_ptr = vm.get()](const std::filesystem::path &path) { Frontend::runModule(path, vm_ptr); });
 
 	return vm;
 }
@@ -1,5 +1,5 @@
 #include "BinaryRuntime.hpp"
-#include "../../Codegen/Bytecode/BytecodeDeserializer.hpp"
+#include "../../Codegen/Bytecode/BytecodeImage.hpp"
 #include "../../Runtime/Stdlib/StdLib.hpp"
 #include "../../Runtime/VM/VM.hpp"
 #include <filesystem>
@@ -10,6 +10,11 @@
 namespace Phasor
 {
 
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
 BinaryRuntime::BinaryRuntime(int argc, char *argv[])
 {
 	parseArguments(argc, argv);
@@ -17,6 +22,9 @@ BinaryRuntime::BinaryRuntime(int argc, char *argv[])
 
 int BinaryRuntime::run()
 {
+	if (!m_args.fromSnapshot.empty())
+		return runSnapshot();
+
 	if (m_args.inputFile.empty())
 	{
 		std::cerr << "Error: No input file provided\n";
@@ -28,20 +36,19 @@ int BinaryRuntime::run()
 		if (m_args.verbose)
 			std::cerr << "DEBUG: Loading bytecode from: " << m_args.inputFile << std::endl;
 
-		BytecodeDeserializer deserializer;
-		Bytecode             bytecode = deserializer.loadFromFile(m_args.inputFile);
+		// Mapped, not read: instructions run from the file and constants are decoded on first use
+		BytecodeImage image(m_args.inputFile, {.verifyChecksums = !m_args.trusted});
 
 		if (m_args.verbose)
 		{
-			std::cerr << "DEBUG: Bytecode loaded successfully" << std::endl;
-			std::cerr << "DEBUG: Instructions: " << bytecode.instructions.size() << std::endl;
-			std::cerr << "DEBUG: Constants: " << bytecode.constants.size() << std::endl;
+			std::cerr << "DEBUG: Bytecode loaded successfully" << (image.isMapped() ? " (mapped)" : "") << std::endl;
+			std::cerr << "DEBUG: Instructions: " << image.instructionCount() << std::endl;
+			std::cerr << "DEBUG: Constants: " << image.constantCount() << std::endl;
 		}
 
 		auto vm = std::make_unique<VM>();
 		StdLib::registerFunctions(*vm);
-		StdLib::argv = m_args.scriptArgv;
-		StdLib::argc = m_args.scriptArgc;
+		StdLib::setArguments(*vm, m_args.scriptArgc, m_args.scriptArgv);
 
 #if defined(_WIN32)
 		vm->initFFI("plugins");
@@ -56,9 +63,66 @@ int BinaryRuntime::run()
 		});
 
 		if (m_args.verbose)
+		{
 			std::cerr << "DEBUG: About to run bytecode" << std::endl;
+			std::println(std::cerr, "DEBUG: Time to first instruction: {:.3f} ms", elapsedMs(m_start));
+		}
+
+		if (!m_args.snapshotFile.empty())
+			vm->setSnapshotPath(m_args.snapshotFile);
+
+		int status = vm->run(image);
+
+		if (!m_args.snapshotFile.empty())
+		{
+			if (!vm->snapshotTaken())
+				throw std::runtime_error("Program finished without calling snapshot(), no snapshot written");
+			std::println(std::cerr, "Snapshot written to {}, {:.3f} ms after start", m_args.snapshotFile,
+			             elapsedMs(m_start));
+		}
+
+		if (m_args.verbose)
+			std::cerr << "DEBUG: Bytecode execution complete with return " << status << std::endl;
+
+		return status;
+	}
+	catch (const std::exception &e)
+	{
+		error(e.what());
+		return 1;
+	}
+}
 
-		int status = vm->run(bytecode);
+int BinaryRuntime::runSnapshot()
+{
+	try
+	{
+		Snapshot snapshot = Snapshot::load(m_args.fromSnapshot);
+
+		if (m_args.verbose)
+		{
+			std::cerr << "DEBUG: Snapshot loaded from: " << m_args.fromSnapshot << std::endl;
+			std::cerr << "DEBUG: Instructions: " << snapshot.bytecode.instructions.size() << std::endl;
+			std::cerr << "DEBUG: Variables: " << snapshot.variables.size() << std::endl;
+			std::cerr << "DEBUG: Natives: " << snapshot.natives.size() << ", plugins: " << snapshot.plugins.size()
+			          << std::endl;
+		}
+
+		// No using() or plugin folder scan to replay: resume() keeps the natives the snapshot names
+		auto vm = std::make_unique<VM>();
+		StdLib::registerFunctions(*vm);
+		StdLib::registerAllFunctions(*vm);
+		StdLib::setArguments(*vm, m_args.scriptArgc, m_args.scriptArgv);
+		vm->initFFI(snapshot.plugins);
+
+		vm->setImportHandler([](const std::filesystem::path &path) {
+			throw std::runtime_error("Imports not supported when resuming a snapshot: " + path.string());
+		});
+
+		if (m_args.verbose)
+			std::println(std::cerr, "DEBUG: Time to first instruction: {:.3f} ms (snapshot)", elapsedMs(m_start));
+
+		int status = vm->resume(snapshot);
 
 		if (m_args.verbose)
 			std::cerr << "DEBUG: Bytecode execution complete with return " << status << std::endl;
@@ -83,6 +147,21 @@ void BinaryRuntime::parseArguments(int argc, char *argv[])
 		{
 			m_args.verbose = true;
 		}
+		else if (arg == "--trusted")
+		{
+			m_args.trusted = true;
+		}
+		else if (arg == "--snapshot" && i + 1 < argc)
+		{
+			m_args.snapshotFile = argv[++i];
+		}
+		else if (arg == "--from-snapshot" && i + 1 < argc)
+		{
+			// Everything after the snapshot is for the program
+			m_args.fromSnapshot = argv[++i];
+			defaultArgLocation = i;
+			break;
+		}
 		else if (arg == "-h" || arg == "--help")
 		{
 			showHelp(argv[0]);
@@ -105,11 +184,15 @@ void BinaryRuntime::showHelp(const std::string &programName)
 	std::println("Phasor Runtime v{}\n"
 	             "(C) 2026 Daniel McGuire - Licensed under Apache 2.0\n\n"
 	             "Usage:\n"
-	             "  {} [options] <file.phsb> [...script args]\n\n"
+	             "  {} [options] <file.phsb> [...script args]\n"
+	             "  {} [options] --from-snapshot <file> [...script args]\n\n"
 	             "Options:\n"
-	             "  -v, --verbose       Enable verbose output\n"
-	             "  -h, --help          Show this help message",
-	             PHASOR_VERSION_STRING, filename);
+	             "  -v, --verbose            Enable verbose output\n"
+	             "  --trusted                Skip checksum verification, for images your build produced\n"
+	             "  --snapshot <file>        Stop at the program's snapshot() call and save the VM to file\n"
+	             "  --from-snapshot <file>   Resume a saved VM instead of running a .phsb\n"
+	             "  -h, --help               Show this help message",
+	             PHASOR_VERSION_STRING, filename, filename);
 }
 
 } // namespace Phasor
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <string>
 #include <vector>
 /// @brief The Phasor Programming Language and Runtime
@@ -10,7 +11,8 @@ namespace Phasor
  * @class BinaryRuntime
  * @brief CLI wrapper for running Phasor bytecode binaries
  *
- * Loads and executes Phasor bytecode binaries (.phsb files).
+ * Loads and executes Phasor bytecode binaries (.phsb files), and writes and
+ * resumes VM snapshots (see Snapshot).
  */
 class BinaryRuntime
 {
@@ -23,10 +25,16 @@ class BinaryRuntime
 	{
 		std::string inputFile;
 		bool        verbose = false;
+		bool        trusted = false; ///< Skip checksum verification
+		std::string snapshotFile;    ///< Write a snapshot here when the program calls snapshot()
+		std::string fromSnapshot;    ///< Resume this snapshot instead of running inputFile
 		int         scriptArgc = 0;
 		char      **scriptArgv = nullptr;
 	} m_args;
 
+	std::chrono::steady_clock::time_point m_start = std::chrono::steady_clock::now();
+
+	int  runSnapshot();
 	void parseArguments(int argc, char *argv[]);
 	void showHelp(const std::string &programName);
 };
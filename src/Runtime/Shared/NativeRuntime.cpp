@@ -36,10 +36,11 @@ NativeRuntime::NativeRuntime(const std::string &script, const int argc, const ch
 	Lexer lexer(m_script);
 	auto  tokens = lexer.tokenize();
 
-	Parser parser(tokens);
+	Parser parser(std::move(tokens));
 	auto   program = parser.parse();
 
 	CodeGenerator codegen;
+	codegen.setPureCallEvaluator(StdLib::pureCallEvaluator());
 	m_bytecode = codegen.generate(*program);
 	m_vm = std::make_unique<VM>();
 }
@@ -50,6 +51,7 @@ NativeRuntime::NativeRuntime(const Phasor::VM &vm, const std::string &script, co
 	Lexer         lexer(m_script);
 	Parser        parser(lexer.tokenize());
 	CodeGenerator codegen;
+	codegen.setPureCallEvaluator(StdLib::pureCallEvaluator());
 	m_bytecode = codegen.generate(*parser.parse());
 }
 
@@ -66,6 +68,20 @@ NativeRuntime::NativeRuntime(Phasor::VM *vm, const std::vector<u8> &bytecodeData
 	m_bytecode = deserializer.deserialize(m_bytecodeData);
 }
 
+NativeRuntime::NativeRuntime(Phasor::VM *vm, std::span<const u8> bytecodeData, const EmbeddedImage &image,
+                             const int argc, const char **argv)
+    : m_argc(argc), m_argv(const_cast<char **>(argv))
+{
+	if (vm)
+		m_vm = std::shared_ptr<VM>(vm, [](VM *) {}); // non-owning, caller manages lifetime
+	else
+		m_vm = std::make_shared<VM>(); // owning, we manage lifetime
+
+	// Compiled into the same executable as the tables, so there is nothing to checksum against
+	m_image = std::make_unique<BytecodeImage>(bytecodeData, image,
+	                                          BytecodeDeserializer::Options{.verifyChecksums = false});
+}
+
 NativeRuntime::~NativeRuntime()
 {
 	m_vm.reset();
@@ -85,23 +101,22 @@ int NativeRuntime::eval(VM *vm, const std::string &script)
 	Lexer lexer(script);
 	auto  tokens = lexer.tokenize();
 
-	Parser parser(tokens);
+	Parser parser(std::move(tokens));
 	auto   program = parser.parse();
 
 	CodeGenerator codegen;
+	codegen.setPureCallEvaluator(StdLib::pureCallEvaluator());
 	auto          bytecode = codegen.generate(*program);
 
 	return vm->run(bytecode);
 }
 
-int NativeRuntime::run()
+void NativeRuntime::prepare()
 {
-
-	try
+	StdLib::setArguments(*m_vm, m_argc, m_argv);
+	StdLib::registerFunctions(*m_vm);
+	if (!m_vm->hasFFI())
 	{
-		StdLib::argc = m_argc;
-		StdLib::argv = m_argv;
-		StdLib::registerFunctions(*m_vm);
 #if defined(_WIN32)
 		m_vm->initFFI("plugins");
 #elif defined(__APPLE__)
@@ -109,83 +124,49 @@ int NativeRuntime::run()
 #elif defined(__linux__)
 		m_vm->initFFI("/usr/lib/phasor/plugins/");
 #endif
-		m_vm->setImportHandler([](const std::filesystem::path &path) {
-			throw std::runtime_error("Imports not supported in pure binary runtime yet: " + path.string());
-		});
-
-		int status = m_vm->run(m_bytecode);
-
-		if (status != 0)
-		{
-			m_vm->reset(true, false, false);
-			m_vm->resetStatus();
-		}
-
-		return status;
 	}
-	catch (const std::exception &)
-	{
-		throw;
-	}
-	return 0;
+	m_vm->setImportHandler([](const std::filesystem::path &path) {
+		throw std::runtime_error("Imports not supported in pure binary runtime yet: " + path.string());
+	});
 }
 
-int NativeRuntime::runFunctionInt(std::string functionName)
+int NativeRuntime::run(CompiledProgram program)
 {
-	try
-	{
-		StdLib::argc = m_argc;
-		StdLib::argv = m_argv;
-		StdLib::registerFunctions(*m_vm);
-#if defined(_WIN32)
-		m_vm->initFFI("plugins");
-#elif defined(__APPLE__)
-		m_vm->initFFI("/Library/Application Support/org.Phasor.Phasor/plugins");
-#elif defined(__linux__)
-		m_vm->initFFI("/usr/lib/phasor/plugins/");
-#endif
-		m_vm->setImportHandler([](const std::filesystem::path &path) {
-			throw std::runtime_error("Imports not supported in pure binary runtime yet: " + path.string());
-		});
+	prepare();
 
-		Value ret = m_vm->runFunction(functionName, m_bytecode);
+	int status;
+	if (m_image)
+		status = m_vm->run(*m_image, program);
+	else
+		status = program != nullptr ? m_vm->run(m_bytecode, program) : m_vm->run(m_bytecode);
 
-		return static_cast<int>(ret.asInt());
-	}
-	catch (const std::exception &)
+	if (status != 0)
 	{
-		throw;
+		m_vm->reset(true, false, false);
+		m_vm->resetStatus();
 	}
-	return 0;
+
+	return status;
 }
 
-std::optional<std::string> NativeRuntime::runFunctionString(std::string functionName)
+Value NativeRuntime::callFunction(const std::string &functionName, std::span<const Value> args)
 {
-	try
-	{
-		StdLib::argc = m_argc;
-		StdLib::argv = m_argv;
-		StdLib::registerFunctions(*m_vm);
-#if defined(_WIN32)
-		m_vm->initFFI("plugins");
-#elif defined(__APPLE__)
-		m_vm->initFFI("/Library/Application Support/org.Phasor.Phasor/plugins");
-#elif defined(__linux__)
-		m_vm->initFFI("/usr/lib/phasor/plugins/");
-#endif
-		m_vm->setImportHandler([](const std::filesystem::path &path) {
-			throw std::runtime_error("Imports not supported in pure binary runtime yet: " + path.string());
-		});
+	if (m_image)
+		throw std::runtime_error("Calling functions of an embedded image is not supported");
+	prepare();
+	if (!m_vm->isLoaded(m_bytecode))
+		m_vm->load(m_bytecode);
+	return m_vm->call(functionName, args);
+}
 
-		Value ret = m_vm->runFunction(functionName, m_bytecode);
+int NativeRuntime::runFunctionInt(std::string functionName, std::span<const Value> args)
+{
+	return static_cast<int>(callFunction(functionName, args).asInt());
+}
 
-		return ret.asString();
-	}
-	catch (const std::exception &)
-	{
-		throw;
-	}
-	return std::nullopt;
+std::optional<std::string> NativeRuntime::runFunctionString(std::string functionName, std::span<const Value> args)
+{
+	return callFunction(functionName, args).asString();
 }
 
 } // namespace Phasor
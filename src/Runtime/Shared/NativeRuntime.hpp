@@ -2,7 +2,9 @@
 
 #include <vector>
 #include <cstdint>
+#include <span>
 #include <string>
+#include "../../Codegen/Bytecode/BytecodeImage.hpp"
 #include "../../Codegen/Bytecode/BytecodeSerializer.hpp"
 #include "../../Runtime/VM/VM.hpp"
 #include <phsint.hpp>
@@ -25,10 +27,14 @@ class NativeRuntime
 	NativeRuntime(const std::string &script, const int argc, const char **argv);
 	NativeRuntime(const Phasor::VM &vm, const std::string &script, const int argc, const char **argv);
 	NativeRuntime(Phasor::VM *vm, const std::vector<u8> &bytecodeData, const int argc, const char **argv);
+	/// @brief Runs embedded bytecode in place through the tables phasornative generates for it
+	NativeRuntime(Phasor::VM *vm, std::span<const u8> bytecodeData, const EmbeddedImage &image, const int argc,
+	              const char **argv);
 	~NativeRuntime();
-	int                        run();
-	int                        runFunctionInt(std::string functionName);
-	std::optional<std::string> runFunctionString(std::string functionName);
+	int                        run(CompiledProgram program = nullptr);
+	/// @brief Call a function of the program with args, keeping the VM's globals between calls
+	int                        runFunctionInt(std::string functionName, std::span<const Value> args = {});
+	std::optional<std::string> runFunctionString(std::string functionName, std::span<const Value> args = {});
 	void                       addNativeFunction(const std::string &name, void *function);
 
 	static int eval(VM *vm, const std::string &script);
@@ -36,10 +42,16 @@ class NativeRuntime
   private:
 	std::shared_ptr<Phasor::VM> m_vm;
 	Bytecode                    m_bytecode;
+	std::unique_ptr<BytecodeImage> m_image; ///< Set instead of m_bytecode for embedded images
 	std::vector<u8>        m_bytecodeData;
 	std::string                 m_script;
 	int                         m_argc;
 	char                      **m_argv;
+
+	/// @brief Register the natives and arguments, and the FFI plugins if the VM has none yet
+	void prepare();
+	/// @brief Load the program if the VM isn't already on it and call functionName
+	Value callFunction(const std::string &functionName, std::span<const Value> args);
 };
 
 } // namespace Phasor
@@ -9,9 +9,6 @@
 namespace Phasor
 {
 
-char **StdLib::argv = nullptr;
-int    StdLib::argc = 0;
-
 StdLib::dupenv_ret StdLib::dupenv(PhsString &out, const char *name)
 {
 	if (!name || name[0] == '\0')
@@ -56,11 +53,64 @@ void StdLib::checkArgCount(const std::vector<Value> &args, size_t minimumArgumen
 	}
 }
 
-bool StdLib::std_import(const std::vector<Value> &args, VM *vm)
+void StdLib::registerAllFunctions(VM &vm)
 {
-	checkArgCount(args, 1, "using", true);
+	std_import({Value("std*")}, &vm);
+}
+
+CodeGenerator::PureCallEvaluator StdLib::pureCallEvaluator()
+{
+	// Only natives registered with NativeTraits::Pure are ever invoked on the scratch VMs, and those
+	// leave them as they are, so one VM per module serves every code generator on every thread
+	static const CodeGenerator::PureCallEvaluator evaluator =
+	    [](const std::string &name, const std::vector<Value> &args,
+	       const std::unordered_set<std::string> &imported) -> std::optional<Value> {
+		using ScratchVMs = std::unordered_map<std::string, std::unique_ptr<VM>>;
+		// Never destroyed, as natives' state in other statics may be gone by the time it would be
+		static const ScratchVMs &scratch = *[] {
+			auto *vms = new ScratchVMs();
+			for (const auto &[module, registerModule] : modules())
+			{
+				if (module.view() == "std*")
+				{
+					continue;
+				}
+				auto vm = std::make_unique<VM>();
+				registerModule(vm.get());
+				vms->emplace(module.str(), std::move(vm));
+			}
+			return vms;
+		}();
+
+		const bool everything = imported.contains("std*");
+		for (const auto &[module, vm] : scratch)
+		{
+			if (!everything && !imported.contains(module))
+			{
+				continue;
+			}
+			const VM::NativeFunction *fn = vm->findPureNative(name);
+			if (fn == nullptr)
+			{
+				continue;
+			}
+			try
+			{
+				return (*fn)(args, vm.get());
+			}
+			catch (const std::exception &)
+			{
+				return std::nullopt; // leave the call in so the error is raised at runtime as before
+			}
+		}
+		return std::nullopt;
+	};
+	return evaluator;
+}
 
-	std::unordered_map<PhsString, std::function<void(Phasor::VM *)>> modules{
+const std::unordered_map<PhsString, std::function<void(VM *)>> &StdLib::modules()
+{
+	static const std::unordered_map<PhsString, std::function<void(VM *)>> modules{
 	    {"stdio", registerIOFunctions},
 	    {"stdsys", registerSysFunctions},
 	    {"stdmath", registerMathFunctions},
@@ -70,6 +120,8 @@ bool StdLib::std_import(const std::vector<Value> &args, VM *vm)
 	    {"stdmem", registerMemoryFunctions},
 	    {"stdrand", registerRandomFunctions},
 		{"stdarray", registerArrayFunctions},
+	    {"stdtask", registerTaskFunctions},
+	    {"stdfiber", registerFiberFunctions},
 #ifndef SANDBOXED
 	    {"stdfile", registerFileFunctions},
 #endif
@@ -84,16 +136,24 @@ bool StdLib::std_import(const std::vector<Value> &args, VM *vm)
 		     registerMemoryFunctions(vm);
 		     registerRandomFunctions(vm);
 			 registerArrayFunctions(vm);
+		     registerTaskFunctions(vm);
+		     registerFiberFunctions(vm);
 #ifndef SANDBOXED
 		     registerFileFunctions(vm);
 #endif
 	     }},
 	};
+	return modules;
+}
+
+bool StdLib::std_import(const std::vector<Value> &args, VM *vm)
+{
+	checkArgCount(args, 1, "using", true);
 
 	for (const auto &arg : args)
 	{
-		auto it = modules.find(arg.string());
-		if (it != modules.end())
+		auto it = modules().find(arg.string());
+		if (it != modules().end())
 		{
 			it->second(vm);
 		}
@@ -2,6 +2,7 @@
 #include <functional>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <algorithm>
 #include <cmath>
@@ -45,13 +46,37 @@ class StdLib
 #endif
 	}
 
-	static char **argv; ///< Command line arguments
-	static int    argc; ///< Number of command line arguments
+	/// @brief Register every module, as `using("std*")` does
+	///
+	/// For hosts resuming a snapshot, which binds the natives the program had registered by name.
+	static void registerAllFunctions(VM &vm);
+
+	/// @brief Set the command line arguments vm's scripts see through sys_argc(), sys_argv() and sys_args()
+	static void setArguments(VM &vm, int argc, char **argv)
+	{
+		vm.stdlib().argc = argc;
+		vm.stdlib().argv = argv;
+	}
 
 	static void checkArgCount(const std::vector<Value> &args, size_t minimumArguments, const std::string &name,
 	                          bool allowMoreArguments = false);
 
+	/// @brief Compile-time evaluator for stdlib natives registered as pure
+	///
+	/// Hand to CodeGenerator::setPureCallEvaluator so calls like to_upper("a") or math_sqrt(2.0)
+	/// are run through the real implementation while compiling and emitted as constants. Only natives
+	/// of modules the script has imported with `using()` are folded. Every evaluator shares one set of
+	/// scratch VMs, built on the first call that might fold.
+	static CodeGenerator::PureCallEvaluator pureCallEvaluator();
+
+	/// @brief Tell the stdtask pool this thread is about to block, or has stopped, for code that waits on
+	/// other threads; while a task's thread is blocked the pool may start another to run queued tasks
+	static void setTaskBlocked(bool blocked);
+
   private:
+	/// @brief Module name -> function registering its natives, as `using()` takes them
+	static const std::unordered_map<PhsString, std::function<void(VM *)>> &modules();
+
 	static bool std_import(const std::vector<Value> &args, VM *vm);
 #ifndef SANDBOXED
 	static Value std_assert(const std::vector<Value> &args, VM *vm);
@@ -77,6 +102,9 @@ class StdLib
 	static void registerSysFunctions(VM *vm);
 	static void registerIOFunctions(VM *vm);
 	static void registerArrayFunctions(VM *vm);
+	static void registerTaskFunctions(VM *vm);
+	static void registerChannelFunctions(VM *vm);
+	static void registerFiberFunctions(VM *vm);
 
 #pragma region stdmeta
 #ifndef SANDBOXED
@@ -189,6 +217,28 @@ class StdLib
 
 #pragma endregion
 
+#pragma region stdtask
+	static i64   task_spawn(const std::vector<Value> &args, VM *vm);     ///< Run a function on the task pool
+	static Value task_join(const std::vector<Value> &args, VM *vm);      ///< Wait for a spawned function's result
+	static Value task_par_map(const std::vector<Value> &args, VM *vm);   ///< Run a function on each element in parallel
+	static Value task_freeze(const std::vector<Value> &args, VM *vm);    ///< Make a value immutable, to share across tasks
+	static bool  task_is_frozen(const std::vector<Value> &args, VM *vm); ///< Whether a value can't change
+	static i64   chan_new(const std::vector<Value> &args, VM *vm);       ///< Create a bounded channel
+	static Value chan_send(const std::vector<Value> &args, VM *vm);      ///< Send, waiting while the channel is full
+	static Value chan_recv(const std::vector<Value> &args, VM *vm);      ///< Receive, waiting while the channel is empty
+	static Value chan_try_recv(const std::vector<Value> &args, VM *vm);  ///< Receive if there is anything to
+	static Value chan_close(const std::vector<Value> &args, VM *vm);     ///< Stop sends and let receivers drain
+#pragma endregion
+
+#pragma region stdfiber
+	static i64   fiber_new(const std::vector<Value> &args, VM *vm);    ///< Create a fiber that calls a function
+	static Value fiber_resume(const std::vector<Value> &args, VM *vm); ///< Run a fiber until it yields or returns
+	static Value fiber_yield(const std::vector<Value> &args, VM *vm);  ///< Suspend the running fiber
+	static bool  fiber_done(const std::vector<Value> &args, VM *vm);   ///< Whether a fiber has returned
+	static i64   fiber_spawn(const std::vector<Value> &args, VM *vm);  ///< Create a fiber and queue it for fiber_run()
+	static Value fiber_run(const std::vector<Value> &args, VM *vm);    ///< Run queued fibers in turn until all return
+#pragma endregion
+
 #pragma region stdstr
 	static i64     str_find(const std::vector<Value> &args, VM *vm);        ///< Find string in string
 	static i64     str_len(const std::vector<Value> &args, VM *vm);         ///< Get string length
@@ -21,6 +21,8 @@ Value StdLib::array_resize(const std::vector<Value> &args, VM *)
     auto arr = std::const_pointer_cast<Value::ArrayInstance>(args[0].asArray());
     if (!arr)
         throw std::runtime_error("arr_resize called on non-array");
+    if (arr->frozen)
+        throw std::runtime_error("arr_resize called on frozen array");
 
     i64 newSize = args[1].asInt();
     if (newSize < 0)
@@ -47,6 +49,8 @@ Value StdLib::array_push(const std::vector<Value> &args, VM *)
     auto arr = std::const_pointer_cast<Value::ArrayInstance>(args[0].asArray());
     if (!arr)
         throw std::runtime_error("arr_push called on non-array");
+    if (arr->frozen)
+        throw std::runtime_error("arr_push called on frozen array");
 
     arr->push_back(args[1]);
     return arr;
@@ -58,6 +62,8 @@ Value StdLib::array_pop(const std::vector<Value> &args, VM *)
     auto arr = std::const_pointer_cast<Value::ArrayInstance>(args[0].asArray());
     if (!arr)
         throw std::runtime_error("arr_pop called on non-array");
+    if (arr->frozen)
+        throw std::runtime_error("arr_pop called on frozen array");
 
     if (arr->empty())
         throw std::runtime_error("arr_pop called on empty array");
@@ -74,6 +80,8 @@ Value StdLib::array_insert(const std::vector<Value> &args, VM *)
     auto arr = std::const_pointer_cast<Value::ArrayInstance>(args[0].asArray());
     if (!arr)
         throw std::runtime_error("arr_insert called on non-array");
+    if (arr->frozen)
+        throw std::runtime_error("arr_insert called on frozen array");
 
     i64 index = args[1].asInt();
     if (index < 0 || index > static_cast<i64>(arr->size()))
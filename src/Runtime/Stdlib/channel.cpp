@@ -0,0 +1,311 @@
+#include "StdLib.hpp"
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <phsint.hpp>
+
+namespace Phasor
+{
+
+/**
+ * @class Channel
+ * @brief Bounded multi-producer multi-consumer queue of values, shared by VMs on any thread
+ *
+ * A ring of cells, each with a sequence number that says whether it is ready to be written or
+ * read on the current lap (Vyukov's bounded MPMC queue), so sending and receiving take no lock
+ * and only contend on their own index. Senders and receivers that find the channel full or
+ * empty spin briefly, then sleep until the other side wakes them. They never run queued tasks
+ * meanwhile, as the task could be the other side and need this one to go on; the task pool
+ * starts a spare thread for it instead.
+ */
+class Channel
+{
+  public:
+	explicit Channel(size_t capacity) : m_cells(std::bit_ceil(std::max<size_t>(capacity, 2))), m_mask(m_cells.size() - 1)
+	{
+		for (size_t i = 0; i < m_cells.size(); ++i)
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	/// @brief Send value, which must be shared with nothing else
+	/// @throws std::runtime_error if the channel is closed
+	void send(Value value)
+	{
+		for (int attempt = 0;; ++attempt)
+		{
+			if (m_closed.load(std::memory_order_acquire))
+				throw std::runtime_error("chan_send(): channel is closed");
+			if (tryPush(value))
+				break;
+			wait(attempt, [&] { return !full() || m_closed.load(); });
+		}
+		wake();
+	}
+
+	/// @brief Receive the oldest value, waiting for one
+	/// @return false once the channel is closed and empty
+	bool receive(Value &value)
+	{
+		for (int attempt = 0;; ++attempt)
+		{
+			if (tryReceive(value))
+				return true;
+			if (m_closed.load(std::memory_order_acquire))
+				return tryReceive(value);
+			wait(attempt, [&] { return !empty() || m_closed.load(); });
+		}
+	}
+
+	bool tryReceive(Value &value)
+	{
+		if (!tryPop(value))
+			return false;
+		wake();
+		return true;
+	}
+
+	/// @brief Whether the channel is closed and has nothing left to receive
+	bool drained() const
+	{
+		return m_closed.load(std::memory_order_acquire) && empty();
+	}
+
+	void close()
+	{
+		m_closed.store(true, std::memory_order_release);
+		std::lock_guard lock(m_mutex);
+		m_changed.notify_all();
+	}
+
+  private:
+	struct alignas(64) Cell
+	{
+		std::atomic<size_t> sequence;
+		Value               value;
+	};
+
+	std::vector<Cell> m_cells;
+	const size_t      m_mask;
+
+	alignas(64) std::atomic<size_t> m_sendIndex = 0;
+	alignas(64) std::atomic<size_t> m_receiveIndex = 0;
+
+	alignas(64) std::atomic<int> m_waiting = 0; ///< Threads asleep on m_changed
+	std::atomic<bool>            m_closed = false;
+	std::mutex                   m_mutex;
+	std::condition_variable      m_changed;
+
+	bool tryPush(Value &value)
+	{
+		size_t index = m_sendIndex.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell     &cell = m_cells[index & m_mask];
+			size_t    sequence = cell.sequence.load(std::memory_order_acquire);
+			ptrdiff_t lap = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(index);
+			if (lap == 0)
+			{
+				if (m_sendIndex.compare_exchange_weak(index, index + 1, std::memory_order_relaxed))
+				{
+					cell.value = std::move(value);
+					cell.sequence.store(index + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (lap < 0)
+				return false;
+			else
+				index = m_sendIndex.load(std::memory_order_relaxed);
+		}
+	}
+
+	bool tryPop(Value &value)
+	{
+		size_t index = m_receiveIndex.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell     &cell = m_cells[index & m_mask];
+			size_t    sequence = cell.sequence.load(std::memory_order_acquire);
+			ptrdiff_t lap = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(index + 1);
+			if (lap == 0)
+			{
+				if (m_receiveIndex.compare_exchange_weak(index, index + 1, std::memory_order_relaxed))
+				{
+					value = std::move(cell.value);
+					cell.value = Value();
+					cell.sequence.store(index + m_mask + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (lap < 0)
+				return false;
+			else
+				index = m_receiveIndex.load(std::memory_order_relaxed);
+		}
+	}
+
+	bool full() const
+	{
+		size_t index = m_sendIndex.load(std::memory_order_relaxed);
+		return m_cells[index & m_mask].sequence.load(std::memory_order_acquire) != index;
+	}
+
+	bool empty() const
+	{
+		size_t index = m_receiveIndex.load(std::memory_order_relaxed);
+		return m_cells[index & m_mask].sequence.load(std::memory_order_acquire) != index + 1;
+	}
+
+	/// @brief Back off after a failed attempt until ready() may hold
+	template <typename Ready> void wait(int attempt, Ready ready)
+	{
+		if (attempt < 32)
+			return std::this_thread::yield();
+
+		StdLib::setTaskBlocked(true);
+		{
+			std::unique_lock lock(m_mutex);
+			m_waiting.fetch_add(1);
+			// Pairs with the fence in wake(): a change made before it is seen here, or the waker sees us
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			m_changed.wait(lock, ready);
+			m_waiting.fetch_sub(1);
+		}
+		StdLib::setTaskBlocked(false);
+	}
+
+	void wake()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (m_waiting.load(std::memory_order_relaxed) > 0)
+		{
+			std::lock_guard lock(m_mutex);
+			m_changed.notify_all();
+		}
+	}
+};
+
+namespace
+{
+
+/// @brief Every channel not yet closed and drained, by handle
+struct ChannelRegistry
+{
+	std::mutex                                        mutex;
+	std::unordered_map<i64, std::shared_ptr<Channel>> channels;
+	i64                                               next = 0;
+
+	/// Stands in for every dropped channel: closed and empty, like the channel was when dropped
+	std::shared_ptr<Channel> drained = [] {
+		auto channel = std::make_shared<Channel>(1);
+		channel->close();
+		return channel;
+	}();
+
+	static ChannelRegistry &instance()
+	{
+		// Never destroyed, like the task pool whose threads may still use it at exit
+		static ChannelRegistry *registry = new ChannelRegistry();
+		return *registry;
+	}
+};
+
+/// @brief The channel a handle names, from vm's cache or else the registry
+Channel &channel(VM *vm, const Value &handle, const char *function)
+{
+	auto &cache = vm->stdlib().channels;
+	auto  it = cache.find(handle.asInt());
+	if (it != cache.end())
+		return *it->second;
+
+	ChannelRegistry &registry = ChannelRegistry::instance();
+	std::lock_guard  lock(registry.mutex);
+	auto             found = registry.channels.find(handle.asInt());
+	if (found != registry.channels.end())
+		return *cache.emplace(handle.asInt(), found->second).first->second;
+	if (handle.asInt() >= 0 && handle.asInt() < registry.next)
+		return *cache.emplace(handle.asInt(), registry.drained).first->second;
+	throw std::runtime_error(std::string(function) + "(): no channel with handle " + std::to_string(handle.asInt()));
+}
+
+/// @brief Drop a closed and drained channel from the registry; VMs that cached it keep it alive
+void forget(const Value &handle)
+{
+	ChannelRegistry &registry = ChannelRegistry::instance();
+	std::lock_guard  lock(registry.mutex);
+	registry.channels.erase(handle.asInt());
+}
+
+} // namespace
+
+void StdLib::registerChannelFunctions(VM *vm)
+{
+	vm->registerNativeFunction("chan_new", StdLib::chan_new);
+	vm->registerNativeFunction("chan_send", StdLib::chan_send);
+	vm->registerNativeFunction("chan_recv", StdLib::chan_recv);
+	vm->registerNativeFunction("chan_try_recv", StdLib::chan_try_recv);
+	vm->registerNativeFunction("chan_close", StdLib::chan_close);
+}
+
+i64 StdLib::chan_new(const std::vector<Value> &args, VM *vm)
+{
+	checkArgCount(args, 0, "chan_new", true);
+	i64 capacity = args.empty() ? 64 : args[0].asInt();
+	if (capacity < 1 || capacity > (i64(1) << 30))
+		throw std::runtime_error("chan_new(): capacity must be between 1 and 2^30");
+
+	auto             created = std::make_shared<Channel>(static_cast<size_t>(capacity));
+	ChannelRegistry &registry = ChannelRegistry::instance();
+	i64              handle;
+	{
+		std::lock_guard lock(registry.mutex);
+		handle = registry.next++;
+		registry.channels.emplace(handle, created);
+	}
+	vm->stdlib().channels.emplace(handle, std::move(created));
+	return handle;
+}
+
+Value StdLib::chan_send(const std::vector<Value> &args, VM *vm)
+{
+	checkArgCount(args, 2, "chan_send");
+	Channel &target = channel(vm, args[0], "chan_send");
+
+	// args is this call's own vector, so a value nothing else references is moved rather than copied
+	Value &value = const_cast<Value &>(args[1]);
+	target.send(value.isUnique() ? std::move(value) : value.clone());
+	return Value();
+}
+
+Value StdLib::chan_recv(const std::vector<Value> &args, VM *vm)
+{
+	checkArgCount(args, 1, "chan_recv");
+	Value value;
+	if (!channel(vm, args[0], "chan_recv").receive(value))
+		forget(args[0]);
+	return value;
+}
+
+Value StdLib::chan_try_recv(const std::vector<Value> &args, VM *vm)
+{
+	checkArgCount(args, 1, "chan_try_recv");
+	Value    value;
+	Channel &source = channel(vm, args[0], "chan_try_recv");
+	if (!source.tryReceive(value) && source.drained())
+		forget(args[0]);
+	return value;
+}
+
+Value StdLib::chan_close(const std::vector<Value> &args, VM *vm)
+{
+	checkArgCount(args, 1, "chan_close");
+	// The channel stays registered until a receiver finds it drained, so tasks that first use it
+	// after this still get the values left in it
+	channel(vm, args[0], "chan_close").close();
+	return Value();
+}
+
+} // namespace Phasor
@@ -5,7 +5,9 @@
 
 #include <phsint.hpp>
 
-extern "C" void     PHASORstd_rand_seed(Phasor::u64 s0, Phasor::u64 s1);
-extern "C" Phasor::u64      PHASORstd_rand_next();
-extern "C" Phasor::f64      PHASORstd_rand_next_double();
-extern "C" Phasor::i64      PHASORstd_rand_next_range(Phasor::i64 min, Phasor::i64 max);
\ No newline at end of file
+// The generator state is passed in, so each VM keeps its own sequence
+
+extern "C" void     PHASORstd_rand_seed(Phasor::u64 s[2], Phasor::u64 s0, Phasor::u64 s1);
+extern "C" Phasor::u64      PHASORstd_rand_next(Phasor::u64 s[2]);
+extern "C" Phasor::f64      PHASORstd_rand_next_double(Phasor::u64 s[2]);
+extern "C" Phasor::i64      PHASORstd_rand_next_range(Phasor::u64 s[2], Phasor::i64 min, Phasor::i64 max);
\ No newline at end of file
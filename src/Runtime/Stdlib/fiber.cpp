@@ -0,0 +1,111 @@
+#include "StdLib.hpp"
+
+namespace Phasor
+{
+
+namespace
+{
+
+/// @brief fiber_new() and fiber_spawn()'s arguments as a fiber
+i64 makeFiber(const std::vector<Value> &args, VM *vm, const char *function)
+{
+	StdLib::checkArgCount(args, 1, function, true);
+	if (args.size() > 2 || (args.size() == 2 && !args[1].isArray()))
+		throw std::runtime_error(std::string(function) + "(): expected a function name and an array of arguments");
+
+	size_t entry = vm->findFunction(args[0].asString().str());
+	if (args.size() == 1)
+		return vm->newFiber(entry);
+	return vm->newFiber(entry, *args[1].asArray());
+}
+
+} // namespace
+
+void StdLib::registerFiberFunctions(VM *vm)
+{
+	vm->registerNativeFunction("fiber_new", StdLib::fiber_new);
+	vm->registerNativeFunction("resume", StdLib::fiber_resume);
+	vm->registerNativeFunction("yield", StdLib::fiber_yield);
+	vm->registerNativeFunction("fiber_done", StdLib::fiber_done);
+	vm->registerNativeFunction("fiber_spawn", StdLib::fiber_spawn);
+	vm->registerNativeFunction("fiber_run", StdLib::fiber_run);
+}
+
+i64 StdLib::fiber_new(const std::vector<Value> &args, VM *vm)
+{
+	return makeFiber(args, vm, "fiber_new");
+}
+
+Value StdLib::fiber_resume(const std::vector<Value> &args, VM *vm)
+{
+	checkArgCount(args, 1, "resume", true);
+	if (args.size() > 2)
+		throw std::runtime_error("resume(): expected a fiber and a value to send it");
+	try
+	{
+		return vm->resumeFiber(args[0].asInt(), args.size() == 2 ? args[1] : Value());
+	}
+	catch (const std::exception &e)
+	{
+		throw std::runtime_error(std::string("resume(): ") + e.what());
+	}
+}
+
+Value StdLib::fiber_yield(const std::vector<Value> &args, VM *vm)
+{
+	checkArgCount(args, 0, "yield", true);
+	if (args.size() > 1)
+		throw std::runtime_error("yield(): expected at most one value");
+	try
+	{
+		vm->yieldFiber(args.empty() ? Value() : args[0]);
+	}
+	catch (const std::exception &e)
+	{
+		throw std::runtime_error(std::string("yield(): ") + e.what());
+	}
+	return Value();
+}
+
+bool StdLib::fiber_done(const std::vector<Value> &args, VM *vm)
+{
+	checkArgCount(args, 1, "fiber_done");
+	return vm->fiberDone(args[0].asInt());
+}
+
+i64 StdLib::fiber_spawn(const std::vector<Value> &args, VM *vm)
+{
+	i64 fiber = makeFiber(args, vm, "fiber_spawn");
+	vm->stdlib().fiberQueue.push_back(fiber);
+	return fiber;
+}
+
+Value StdLib::fiber_run(const std::vector<Value> &args, VM *vm)
+{
+	checkArgCount(args, 0, "fiber_run");
+
+	// Round robin: each fiber runs until it yields, then goes to the back of the queue
+	auto &queue = vm->stdlib().fiberQueue;
+	while (!queue.empty())
+	{
+		i64 fiber = queue.front();
+		queue.pop_front();
+		if (vm->fiberDone(fiber))
+			continue;
+		try
+		{
+			vm->resumeFiber(fiber);
+		}
+		catch (const std::exception &e)
+		{
+			throw std::runtime_error(std::string("fiber_run(): ") + e.what());
+		}
+		if (vm->haltRequested())
+			break;
+		if (!vm->fiberDone(fiber))
+			queue.push_back(fiber);
+	}
+	return Value();
+}
+
+} // namespace Phasor
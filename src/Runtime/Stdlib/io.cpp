@@ -6,7 +6,7 @@ namespace Phasor
 
 void StdLib::registerIOFunctions(VM *vm)
 {
-	vm->registerNativeFunction("c_fmt", StdLib::io_c_format);
+	vm->registerNativeFunction("c_fmt", StdLib::io_c_format, VM::NativeTraits::Pure);
 	vm->registerNativeFunction("prints", StdLib::io_prints);
 	vm->registerNativeFunction("printf", StdLib::io_printf);
 	vm->registerNativeFunction("puts", StdLib::io_puts);
@@ -6,19 +6,19 @@ namespace Phasor
 
 void StdLib::registerMathFunctions(VM *vm)
 {
-	vm->registerNativeFunction("math_sqrt", StdLib::math_sqrt);
-	vm->registerNativeFunction("math_pow", StdLib::math_pow);
-	vm->registerNativeFunction("math_abs", StdLib::math_abs);
-	vm->registerNativeFunction("math_floor", StdLib::math_floor);
-	vm->registerNativeFunction("math_ceil", StdLib::math_ceil);
-	vm->registerNativeFunction("math_round", StdLib::math_round);
-	vm->registerNativeFunction("math_min", StdLib::math_min);
-	vm->registerNativeFunction("math_max", StdLib::math_max);
-	vm->registerNativeFunction("math_log", StdLib::math_log);
-	vm->registerNativeFunction("math_exp", StdLib::math_exp);
-	vm->registerNativeFunction("math_sin", StdLib::math_sin);
-	vm->registerNativeFunction("math_cos", StdLib::math_cos);
-	vm->registerNativeFunction("math_tan", StdLib::math_tan);
+	vm->registerNativeFunction("math_sqrt", StdLib::math_sqrt, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("math_pow", StdLib::math_pow, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("math_abs", StdLib::math_abs, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("math_floor", StdLib::math_floor, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("math_ceil", StdLib::math_ceil, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("math_round", StdLib::math_round, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("math_min", StdLib::math_min, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("math_max", StdLib::math_max, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("math_log", StdLib::math_log, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("math_exp", StdLib::math_exp, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("math_sin", StdLib::math_sin, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("math_cos", StdLib::math_cos, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("math_tan", StdLib::math_tan, VM::NativeTraits::Pure);
 }
 
 f64 StdLib::math_sqrt(const std::vector<Value> &args, VM *)
@@ -11,7 +11,7 @@ void StdLib::registerRandomFunctions(VM *vm)
 	vm->registerNativeFunction("rand_next_float", StdLib::rand_next_float);
 }
 
-Value StdLib::rand_seed(const std::vector<Value> &args, VM *)
+Value StdLib::rand_seed(const std::vector<Value> &args, VM *vm)
 {
 	checkArgCount(args, 2, "rand_seed");
 	i64 s1 = args[0].asInt();
@@ -22,11 +22,11 @@ Value StdLib::rand_seed(const std::vector<Value> &args, VM *)
 		throw std::runtime_error("rand_seed(): Both values must be positive integers");
 	}
 
-	PHASORstd_rand_seed(static_cast<u64>(s1), static_cast<u64>(s2));
+	PHASORstd_rand_seed(vm->stdlib().random, static_cast<u64>(s1), static_cast<u64>(s2));
 	return phsnull;
 }
 
-i64 StdLib::rand_next_range(const std::vector<Value> &args, VM *)
+i64 StdLib::rand_next_range(const std::vector<Value> &args, VM *vm)
 {
 	checkArgCount(args, 2, "rand_next_range");
 	i64 min = args[0].asInt();
@@ -37,13 +37,13 @@ i64 StdLib::rand_next_range(const std::vector<Value> &args, VM *)
 		throw std::runtime_error("rand_get(): min value cannot be greater than max value");
 	}
 
-	return PHASORstd_rand_next_range(static_cast<u64>(min), static_cast<u64>(max));
+	return PHASORstd_rand_next_range(vm->stdlib().random, static_cast<u64>(min), static_cast<u64>(max));
 }
 
-f64 StdLib::rand_next_float(const std::vector<Value> &args, VM *)
+f64 StdLib::rand_next_float(const std::vector<Value> &args, VM *vm)
 {
 	checkArgCount(args, 0, "rand_next_float");
-	return PHASORstd_rand_next_double();
+	return PHASORstd_rand_next_double(vm->stdlib().random);
 }
 
 } // namespace Phasor
\ No newline at end of file
@@ -7,15 +7,15 @@ namespace Phasor
 
 void StdLib::registerStringFunctions(VM *vm)
 {
-	vm->registerNativeFunction("find", StdLib::str_find);
-	vm->registerNativeFunction("len", StdLib::str_len);
-	vm->registerNativeFunction("char_at", StdLib::str_char_at);
-	vm->registerNativeFunction("substr", StdLib::str_substr);
-	vm->registerNativeFunction("concat", StdLib::str_concat);
-	vm->registerNativeFunction("to_upper", StdLib::str_upper);
-	vm->registerNativeFunction("to_lower", StdLib::str_lower);
-	vm->registerNativeFunction("starts_with", StdLib::str_starts_with);
-	vm->registerNativeFunction("ends_with", StdLib::str_ends_with);
+	vm->registerNativeFunction("find", StdLib::str_find, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("len", StdLib::str_len, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("char_at", StdLib::str_char_at, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("substr", StdLib::str_substr, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("concat", StdLib::str_concat, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("to_upper", StdLib::str_upper, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("to_lower", StdLib::str_lower, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("starts_with", StdLib::str_starts_with, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("ends_with", StdLib::str_ends_with, VM::NativeTraits::Pure);
 
 	vm->registerNativeFunction("sb_new", StdLib::sb_new);
 	vm->registerNativeFunction("sb_append", StdLib::sb_append);
@@ -24,18 +24,6 @@ void StdLib::registerStringFunctions(VM *vm)
 	vm->registerNativeFunction("sb_clear", StdLib::sb_clear);
 }
 
-static std::vector<PhsString>& getSbPool()
-{
-	static std::vector<PhsString> pool;
-	return pool;
-}
-
-static std::vector<size_t>& getSbFreeIndices()
-{
-	static std::vector<size_t> freeIndices;
-	return freeIndices;
-}
-
 i64 StdLib::str_find(const std::vector<Value> &args, VM *)
 {
 	checkArgCount(args, 2, "find", true);
@@ -70,61 +58,61 @@ i64 StdLib::str_find(const std::vector<Value> &args, VM *)
 	return pos != PhsString::npos ? static_cast<i64>(pos) : false;
 }
 
-i64 StdLib::sb_new(const std::vector<Value> &args, VM *)
+i64 StdLib::sb_new(const std::vector<Value> &args, VM *vm)
 {
 	StdLib::checkArgCount(args, 0, "sb_new");
 	size_t idx;
-	if (!getSbFreeIndices().empty())
+	if (!vm->stdlib().freeStringBuilders.empty())
 	{
-		idx = getSbFreeIndices().back();
-		getSbFreeIndices().pop_back();
-		getSbPool()[idx] = "";
+		idx = vm->stdlib().freeStringBuilders.back();
+		vm->stdlib().freeStringBuilders.pop_back();
+		vm->stdlib().stringBuilders[idx] = "";
 	}
 	else
 	{
-		idx = getSbPool().size();
-		getSbPool().push_back("");
+		idx = vm->stdlib().stringBuilders.size();
+		vm->stdlib().stringBuilders.push_back("");
 	}
 	return static_cast<i64>(idx);
 }
 
-Value StdLib::sb_append(const std::vector<Value> &args, VM *)
+Value StdLib::sb_append(const std::vector<Value> &args, VM *vm)
 {
 	StdLib::checkArgCount(args, 2, "sb_append");
 	i64 idx = args[0].asInt();
-	if (idx < 0 || idx >= static_cast<i64>(getSbPool().size()))
+	if (idx < 0 || idx >= static_cast<i64>(vm->stdlib().stringBuilders.size()))
 		throw std::runtime_error("Invalid StringBuilder handle");
 
-	getSbPool()[idx] += args[1].toString();
+	vm->stdlib().stringBuilders[idx] += args[1].toString();
 	return args[0]; // Return handle for chaining
 }
 
-PhsString StdLib::sb_to_string(const std::vector<Value> &args, VM *)
+PhsString StdLib::sb_to_string(const std::vector<Value> &args, VM *vm)
 {
 	StdLib::checkArgCount(args, 1, "sb_to_string");
 	i64 idx = args[0].asInt();
-	if (idx < 0 || idx >= static_cast<i64>(getSbPool().size()))
+	if (idx < 0 || idx >= static_cast<i64>(vm->stdlib().stringBuilders.size()))
 		throw std::runtime_error("Invalid StringBuilder handle");
 
-	return getSbPool()[idx];
+	return vm->stdlib().stringBuilders[idx];
 }
 
-PhsString StdLib::sb_free(const std::vector<Value> &args, VM *)
+PhsString StdLib::sb_free(const std::vector<Value> &args, VM *vm)
 {
 	StdLib::checkArgCount(args, 1, "sb_free");
 	size_t      idx = args[0].asInt();
-	PhsString value = getSbPool()[idx];
-	getSbFreeIndices().push_back(idx);
+	PhsString value = vm->stdlib().stringBuilders[idx];
+	vm->stdlib().freeStringBuilders.push_back(idx);
 	return value;
 }
 
-Value StdLib::sb_clear(const std::vector<Value> &args, VM *)
+Value StdLib::sb_clear(const std::vector<Value> &args, VM *vm)
 {
 	StdLib::checkArgCount(args, 1, "sb_clear");
 	size_t idx = args[0].asInt();
-	if (idx >= getSbPool().size())
+	if (idx >= vm->stdlib().stringBuilders.size())
 		throw std::runtime_error("Invalid StringBuilder handle");
-	getSbPool()[idx].clear();
+	vm->stdlib().stringBuilders[idx].clear();
 	return args[0]; // Return handle for chaining
 }
 
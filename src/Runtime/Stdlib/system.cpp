@@ -141,27 +141,27 @@ Value StdLib::sys_env(const std::vector<Value> &args, VM *)
 	else return phsnull;
 }
 
-i64 StdLib::sys_argc(const std::vector<Value> &args, VM *)
+i64 StdLib::sys_argc(const std::vector<Value> &args, VM *vm)
 {
 	checkArgCount(args, 0, "sys_args");
-	return static_cast<i64>(argc);
+	return static_cast<i64>(vm->stdlib().argc);
 }
 
-Value StdLib::sys_argv(const std::vector<Value> &args, VM *)
+Value StdLib::sys_argv(const std::vector<Value> &args, VM *vm)
 {
 	checkArgCount(args, 1, "sys_argv");
 	i64 index = args[0].asInt();
-	if (index < 0 || index >= argc) return phsnull;
-	return argv[index];
+	if (index < 0 || index >= vm->stdlib().argc) return phsnull;
+	return vm->stdlib().argv[index];
 }
 
-Value StdLib::sys_args(const std::vector<Value> &args, VM *)
+Value StdLib::sys_args(const std::vector<Value> &args, VM *vm)
 {
 	checkArgCount(args, 0, "sys_args");
 	std::vector<Value> arguments;
-	for (int i = 0; i < argc; ++i)
+	for (int i = 0; i < vm->stdlib().argc; ++i)
 	{
-		arguments.push_back(Value(argv[i]));
+		arguments.push_back(Value(vm->stdlib().argv[i]));
 	}
 	return Value::createArray(std::move(arguments));
 }
@@ -171,7 +171,8 @@ Value StdLib::sys_shutdown(const std::vector<Value> &args, VM *vm)
 	checkArgCount(args, 1, "shutdown");
 	int ret = static_cast<int>(args[0].asInt());
 	vm->setStatus(ret);
-	throw VM::Halt();
+	vm->halt();
+	return Value();
 }
 
 #ifndef SANDBOXED
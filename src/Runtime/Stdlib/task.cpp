@@ -0,0 +1,442 @@
+#include "StdLib.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <phsint.hpp>
+
+namespace Phasor
+{
+
+namespace
+{
+
+/// @brief Calls of one function, run one after another on one thread
+///
+/// Everything a task holds was cloned for it, so it shares no arrays or structs with the VM that
+/// spawned it or with other tasks, except arrays and structs frozen with freeze().
+struct Task
+{
+	std::shared_ptr<const VM::SharedProgram>  program;
+	size_t                                    entry = 0;
+	std::shared_ptr<const std::vector<Value>> globals; ///< The spawner's variables when it spawned
+	bool                                      sharedGlobals = false; ///< globals is shared, clone it to run
+	std::vector<std::vector<Value>>           calls;   ///< Arguments of each call
+	std::vector<Value>                        results;
+	std::string                               error;   ///< Set if a call failed, the rest are skipped
+
+	std::atomic<bool>       claimed = false; ///< Set by the thread that runs it
+	std::atomic<bool>       done = false;
+	std::mutex              mutex;
+	std::condition_variable finished;
+};
+
+/**
+ * @brief Work-stealing pool the tasks of every VM run on
+ *
+ * A worker takes tasks from the back of its own queue, so what a task spawns runs next while its
+ * data is still in cache, and once that is empty steals from the front of the others. A thread
+ * waiting for a task that is still queued runs it itself. Any other task could be waiting on
+ * what that thread was doing, so instead of running one it blocks, and the pool starts a spare
+ * thread while tasks are queued and no worker is free, so blocked tasks can't leave it with
+ * nobody to run them.
+ *
+ * Each thread keeps a VM per nesting level, which loads a program once and is reused by every
+ * task of that program it runs.
+ */
+class TaskPool
+{
+  public:
+	static TaskPool &instance()
+	{
+		// Never destroyed, as a task may still be running when the process exits
+		static TaskPool *pool = s_instance = new TaskPool(std::max(std::thread::hardware_concurrency(), 1u));
+		return *pool;
+	}
+
+	/// @brief The pool if anything has started it, without starting it
+	static TaskPool *existing()
+	{
+		return s_instance.load(std::memory_order_acquire);
+	}
+
+	size_t size() const
+	{
+		return m_queues.size();
+	}
+
+	void submit(std::shared_ptr<Task> task)
+	{
+		size_t index = t_worker >= 0 ? static_cast<size_t>(t_worker) : m_next++ % m_queues.size();
+		{
+			std::lock_guard lock(m_queues[index]->mutex);
+			m_queues[index]->tasks.push_back(std::move(task));
+		}
+		{
+			std::lock_guard lock(m_sleepMutex);
+			++m_queued;
+			addSpareIfNeeded();
+		}
+		m_wake.notify_one();
+	}
+
+	/// @brief Wait until task is done, running it on this thread if nobody has started it
+	void wait(Task &task)
+	{
+		if (!task.claimed.exchange(true))
+			return run(task);
+		if (task.done.load(std::memory_order_acquire))
+			return;
+		setBlocked(true);
+		{
+			std::unique_lock lock(task.mutex);
+			task.finished.wait(lock, [&] { return task.done.load(); });
+		}
+		setBlocked(false);
+	}
+
+	/// @brief Note that this thread is blocking, or has stopped, starting a spare thread if needed
+	void setBlocked(bool blocked)
+	{
+		if (!t_pooled)
+			return;
+		std::lock_guard lock(m_sleepMutex);
+		m_blocked += blocked ? 1 : -1;
+		if (blocked)
+			addSpareIfNeeded();
+	}
+
+  private:
+	struct Queue
+	{
+		std::mutex                        mutex;
+		std::deque<std::shared_ptr<Task>> tasks;
+	};
+
+	struct Isolate
+	{
+		VM                                       vm;
+		std::shared_ptr<const VM::SharedProgram> program; ///< Loaded in vm
+	};
+
+	std::vector<std::unique_ptr<Queue>> m_queues;
+	std::atomic<size_t>                 m_next = 0;
+	std::mutex                          m_sleepMutex;
+	std::condition_variable             m_wake;
+	size_t                              m_queued = 0;  ///< Tasks in all queues, guarded by m_sleepMutex
+	size_t                              m_idle = 0;    ///< Workers waiting for tasks, likewise
+	size_t                              m_blocked = 0; ///< Pool threads blocked in a task, likewise
+	size_t                              m_spares = 0;  ///< Threads started for blocked ones, likewise
+
+	inline static std::atomic<TaskPool *> s_instance = nullptr;
+
+	static thread_local int                 t_worker; ///< This thread's queue, -1 off the pool
+	static thread_local bool                t_pooled; ///< Whether this is a worker or a spare
+	static thread_local std::deque<Isolate> t_isolates;
+	static thread_local size_t              t_depth;
+
+	explicit TaskPool(unsigned threads)
+	{
+		for (unsigned i = 0; i < threads; ++i)
+			m_queues.push_back(std::make_unique<Queue>());
+		for (unsigned i = 0; i < threads; ++i)
+			std::thread([this, i] { work(static_cast<int>(i)); }).detach();
+	}
+
+	void work(int index)
+	{
+		t_worker = index;
+		t_pooled = true;
+		for (;;)
+		{
+			if (runOne())
+				continue;
+			std::unique_lock lock(m_sleepMutex);
+			++m_idle;
+			m_wake.wait(lock, [&] { return m_queued > 0; });
+			--m_idle;
+		}
+	}
+
+	/// @brief Run queued tasks until there are none, then exit
+	void spare()
+	{
+		t_pooled = true;
+		for (;;)
+		{
+			if (runOne())
+				continue;
+			std::lock_guard lock(m_sleepMutex);
+			if (m_queued == 0)
+			{
+				--m_spares;
+				return;
+			}
+		}
+	}
+
+	/// @brief Start a spare thread if tasks are queued with no worker free to run them, and fewer
+	/// spares run than pool threads are blocked. Call with m_sleepMutex held.
+	void addSpareIfNeeded()
+	{
+		if (m_queued == 0 || m_idle > 0 || m_spares >= m_blocked)
+			return;
+		++m_spares;
+		std::thread([this] { spare(); }).detach();
+	}
+
+	bool runOne()
+	{
+		for (;;)
+		{
+			std::shared_ptr<Task> task = take();
+			if (!task)
+				return false;
+			// Skip tasks a thread waiting for them already ran
+			if (task->claimed.exchange(true))
+				continue;
+			run(*task);
+			return true;
+		}
+	}
+
+	std::shared_ptr<Task> take()
+	{
+		const size_t count = m_queues.size();
+		const size_t own = t_worker >= 0 ? static_cast<size_t>(t_worker) : 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			std::shared_ptr<Task> task;
+			{
+				Queue          &queue = *m_queues[(own + i) % count];
+				std::lock_guard lock(queue.mutex);
+				if (queue.tasks.empty())
+					continue;
+				if (i == 0 && t_worker >= 0)
+				{
+					task = std::move(queue.tasks.back());
+					queue.tasks.pop_back();
+				}
+				else
+				{
+					task = std::move(queue.tasks.front());
+					queue.tasks.pop_front();
+				}
+			}
+			std::lock_guard lock(m_sleepMutex);
+			--m_queued;
+			return task;
+		}
+		return nullptr;
+	}
+
+	void run(Task &task)
+	{
+		if (t_depth == t_isolates.size())
+			t_isolates.emplace_back();
+		Isolate &isolate = t_isolates[t_depth++];
+		try
+		{
+			if (isolate.program != task.program)
+			{
+				isolate.vm.load(*task.program);
+				isolate.program = task.program;
+			}
+			size_t variables = std::min(task.globals->size(), isolate.vm.getVariableCount());
+			for (size_t i = 0; i < variables; ++i)
+				isolate.vm.setVariable(i, task.sharedGlobals ? (*task.globals)[i].clone() : (*task.globals)[i]);
+			for (const std::vector<Value> &args : task.calls)
+				task.results.push_back(isolate.vm.call(task.entry, args).clone());
+		}
+		catch (const VM::Halt &)
+		{
+			task.error = "Task halted, e.g. through shutdown()";
+		}
+		catch (const std::exception &e)
+		{
+			task.error = *e.what() ? e.what() : "Task failed";
+		}
+		// What the task spawned and never joined finishes with it
+		isolate.vm.stdlib().tasks.reset();
+		isolate.vm.stdlib().unjoinedTasks = 0;
+		--t_depth;
+		task.globals.reset();
+		task.calls.clear();
+
+		{
+			std::lock_guard lock(task.mutex);
+			task.done.store(true, std::memory_order_release);
+		}
+		task.finished.notify_all();
+	}
+};
+
+thread_local int                           TaskPool::t_worker = -1;
+thread_local bool                          TaskPool::t_pooled = false;
+thread_local std::deque<TaskPool::Isolate> TaskPool::t_isolates;
+thread_local size_t                        TaskPool::t_depth = 0;
+
+} // namespace
+
+/// @brief A VM's spawned tasks, and the program it shares with them
+struct TaskState
+{
+	std::shared_ptr<const VM::SharedProgram>       program;
+	std::unordered_map<i64, std::shared_ptr<Task>> spawned;
+	i64                                            next = 0;
+
+	~TaskState()
+	{
+		for (auto &[handle, task] : spawned)
+			TaskPool::instance().wait(*task);
+	}
+};
+
+namespace
+{
+
+/// @brief A copy of vm's variables for tasks; tasks on several threads may clone it at once
+std::shared_ptr<const std::vector<Value>> copyGlobals(VM *vm)
+{
+	auto globals = std::make_shared<std::vector<Value>>();
+	globals->reserve(vm->getVariableCount());
+	for (size_t i = 0; i < vm->getVariableCount(); ++i)
+		globals->push_back(vm->getVariable(i).clone());
+	return globals;
+}
+
+/// @brief A task calling function with the given variables, and the program shared
+std::shared_ptr<Task> makeTask(VM *vm, const std::string &function, std::shared_ptr<const std::vector<Value>> globals)
+{
+	auto &state = vm->stdlib().tasks;
+	if (!state)
+		state = std::make_shared<TaskState>();
+	if (!state->program || !vm->isShared(*state->program))
+		state->program = std::make_shared<const VM::SharedProgram>(vm->share());
+
+	auto task = std::make_shared<Task>();
+	task->program = state->program;
+	task->entry = vm->findFunction(function);
+	task->globals = std::move(globals);
+	return task;
+}
+
+} // namespace
+
+void StdLib::registerTaskFunctions(VM *vm)
+{
+	vm->registerNativeFunction("spawn", StdLib::task_spawn);
+	vm->registerNativeFunction("join", StdLib::task_join);
+	vm->registerNativeFunction("par_map", StdLib::task_par_map);
+	vm->registerNativeFunction("freeze", StdLib::task_freeze);
+	vm->registerNativeFunction("is_frozen", StdLib::task_is_frozen);
+	registerChannelFunctions(vm);
+}
+
+void StdLib::setTaskBlocked(bool blocked)
+{
+	if (TaskPool *pool = TaskPool::existing())
+		pool->setBlocked(blocked);
+}
+
+i64 StdLib::task_spawn(const std::vector<Value> &args, VM *vm)
+{
+	checkArgCount(args, 1, "spawn", true);
+	if (args.size() > 2 || (args.size() == 2 && !args[1].isArray()))
+		throw std::runtime_error("spawn(): expected a function name and an array of arguments");
+
+	std::shared_ptr<Task> task = makeTask(vm, args[0].asString().str(), copyGlobals(vm));
+	std::vector<Value>   &callArgs = task->calls.emplace_back();
+	if (args.size() == 2)
+	{
+		for (const Value &arg : *args[1].asArray())
+			callArgs.push_back(arg.clone());
+	}
+
+	TaskState &state = *vm->stdlib().tasks;
+	i64        handle = state.next++;
+	state.spawned.emplace(handle, task);
+	vm->stdlib().unjoinedTasks++;
+	TaskPool::instance().submit(std::move(task));
+	return handle;
+}
+
+Value StdLib::task_join(const std::vector<Value> &args, VM *vm)
+{
+	checkArgCount(args, 1, "join");
+	TaskState *state = vm->stdlib().tasks.get();
+	auto       it = state != nullptr ? state->spawned.find(args[0].asInt()) : decltype(state->spawned)::iterator{};
+	if (state == nullptr || it == state->spawned.end())
+		throw std::runtime_error("join(): no task with handle " + std::to_string(args[0].asInt()));
+
+	std::shared_ptr<Task> task = std::move(it->second);
+	state->spawned.erase(it);
+	vm->stdlib().unjoinedTasks--;
+	TaskPool::instance().wait(*task);
+	if (!task->error.empty())
+		throw std::runtime_error("join(): " + task->error);
+	return task->results.front();
+}
+
+Value StdLib::task_par_map(const std::vector<Value> &args, VM *vm)
+{
+	checkArgCount(args, 2, "par_map");
+	if (!args[0].isArray())
+		throw std::runtime_error("par_map(): first argument must be an array");
+	const auto &items = *args[0].asArray();
+	if (items.empty())
+		return Value::createArray();
+
+	// A few tasks per worker, so the pool can even out items that take longer than others. They
+	// share one copy of the variables, which nothing changes, and each clones it on its own thread.
+	TaskPool                                 &pool = TaskPool::instance();
+	const size_t                              tasks = std::min(items.size(), pool.size() * 4);
+	std::shared_ptr<const std::vector<Value>> globals = copyGlobals(vm);
+	std::vector<std::shared_ptr<Task>>        chunks;
+	chunks.reserve(tasks);
+	for (size_t t = 0, begin = 0; t < tasks; ++t)
+	{
+		size_t end = items.size() * (t + 1) / tasks;
+		auto   task = makeTask(vm, args[1].asString().str(), globals);
+		task->sharedGlobals = true;
+		task->calls.reserve(end - begin);
+		for (; begin < end; ++begin)
+			task->calls.push_back({items[begin].clone()});
+		chunks.push_back(task);
+		pool.submit(std::move(task));
+	}
+
+	std::vector<Value> results;
+	results.reserve(items.size());
+	for (const std::shared_ptr<Task> &task : chunks)
+	{
+		pool.wait(*task);
+		if (!task->error.empty())
+		{
+			for (const std::shared_ptr<Task> &rest : chunks)
+				pool.wait(*rest);
+			throw std::runtime_error("par_map(): " + task->error);
+		}
+		for (Value &result : task->results)
+			results.push_back(std::move(result));
+	}
+	return Value::createArray(std::move(results));
+}
+
+Value StdLib::task_freeze(const std::vector<Value> &args, VM *)
+{
+	checkArgCount(args, 1, "freeze");
+	Value value = args[0];
+	value.freeze();
+	return value;
+}
+
+bool StdLib::task_is_frozen(const std::vector<Value> &args, VM *)
+{
+	checkArgCount(args, 1, "is_frozen");
+	return args[0].isFrozen();
+}
+
+} // namespace Phasor
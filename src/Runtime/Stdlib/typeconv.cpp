@@ -6,12 +6,12 @@ namespace Phasor
 
 void StdLib::registerTypeConvFunctions(VM *vm)
 {
-	vm->registerNativeFunction("to_int", StdLib::to_int);
-	vm->registerNativeFunction("to_float", StdLib::to_float);
-	vm->registerNativeFunction("to_string", StdLib::to_string);
-	vm->registerNativeFunction("to_bool", StdLib::to_bool);
-	vm->registerNativeFunction("to_json", StdLib::to_json);
-	vm->registerNativeFunction("from_json", StdLib::from_json);
+	vm->registerNativeFunction("to_int", StdLib::to_int, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("to_float", StdLib::to_float, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("to_string", StdLib::to_string, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("to_bool", StdLib::to_bool, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("to_json", StdLib::to_json, VM::NativeTraits::Pure);
+	vm->registerNativeFunction("from_json", StdLib::from_json, VM::NativeTraits::Pure);
 }
 
 i64 StdLib::to_int(const std::vector<Value> &args, VM *)
@@ -45,6 +45,8 @@ Value VM::native_set_elem(const std::vector<Value>& args, VM* /*vm*/)
     if (args[0].isArray())
     {
         auto arr = std::const_pointer_cast<Value::ArrayInstance>(args[0].asArray());
+        if (arr->frozen)
+            throw std::runtime_error("Cannot modify a frozen array");
         i64 idx = args[1].asInt();
         if (idx < 0 || idx >= static_cast<i64>(arr->size()))
             throw std::runtime_error("Index out of bounds");
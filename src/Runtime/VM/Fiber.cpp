@@ -0,0 +1,112 @@
+#ifndef CMAKE_PCH
+#include "VM.hpp"
+#endif
+#include <iterator>
+
+namespace Phasor
+{
+
+namespace
+{
+
+/// @brief Swap the resumer's registers with a fiber's
+/// Most of both are null, and skipping those makes a switch several times cheaper than std::swap
+void swapRegisters(std::array<Value, MAX_REGISTERS> &a, std::array<Value, MAX_REGISTERS> &b)
+{
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		if (!a[i].isNull() || !b[i].isNull())
+			std::swap(a[i], b[i]);
+	}
+}
+
+} // namespace
+
+i64 VM::newFiber(size_t entry, std::span<const Value> args)
+{
+	if (m_code == nullptr || entry >= m_codeSize)
+		throw std::runtime_error("Invalid function entry point");
+
+	// Set up as call() would, with its stacks kept aside until it is first resumed. Only the stacks,
+	// registers and pc are per fiber; the function's variables are the program's, shared with every call
+	i64    handle = m_nextFiber++;
+	Fiber &fiber = m_fibers[handle];
+	fiber.stack.assign(args.begin(), args.end());
+	fiber.stack.push_back(Value(static_cast<i64>(args.size())));
+	fiber.callStack.push_back(static_cast<int>(m_codeSize));
+	fiber.pc = entry;
+	return handle;
+}
+
+Value VM::resumeFiber(i64 handle, const Value &sent)
+{
+	auto it = m_fibers.find(handle);
+	if (it == m_fibers.end())
+		throw std::runtime_error(handle >= 0 && handle < m_nextFiber ? "Fiber has finished"
+		                                                              : "No fiber with handle " + std::to_string(handle));
+	Fiber &fiber = it->second;
+	if (fiber.running)
+		throw std::runtime_error("Fiber is already running");
+
+	// Its frames go on top of ours, so the loop runs it like a call until it yields or returns
+	const size_t savedPC = pc;
+	const size_t stackBase = stack.size();
+	const size_t callDepth = callStack.size();
+	const i64    savedFiber = m_runningFiber;
+	stack.insert(stack.end(), std::make_move_iterator(fiber.stack.begin()), std::make_move_iterator(fiber.stack.end()));
+	callStack.insert(callStack.end(), fiber.callStack.begin(), fiber.callStack.end());
+	if (fiber.started)
+		stack.back() = sent;
+	swapRegisters(registers, fiber.registers);
+	pc = fiber.pc;
+	fiber.started = true;
+	fiber.running = true;
+	m_runningFiber = handle;
+
+	ExitReason exit = evalLoop();
+
+	m_runningFiber = savedFiber;
+	fiber.running = false;
+	swapRegisters(registers, fiber.registers);
+	if (exit == ExitReason::Yield)
+	{
+		// Clearing rather than reallocating, so a fiber that yields often keeps its buffers
+		fiber.stack.clear();
+		fiber.stack.insert(fiber.stack.end(), std::make_move_iterator(stack.begin() + stackBase),
+		                   std::make_move_iterator(stack.end()));
+		fiber.callStack.assign(callStack.begin() + callDepth, callStack.end());
+		fiber.pc = m_yieldPC;
+		stack.resize(stackBase);
+		callStack.resize(callDepth);
+		pc = savedPC;
+		m_yielded = false;
+		return std::move(m_yieldValue);
+	}
+
+	m_fibers.erase(it);
+	if (exit != ExitReason::Return || callStack.size() != callDepth || stack.size() <= stackBase) [[unlikely]]
+	{
+		stack.resize(std::min(stack.size(), stackBase));
+		callStack.resize(std::min(callStack.size(), callDepth));
+		if (exit == ExitReason::Halt)
+			return Value();
+		pc = savedPC;
+		throw std::runtime_error(exit == ExitReason::Error ? m_error.message : "Fiber did not return properly!");
+	}
+	pc = savedPC;
+	Value ret = pop();
+	stack.resize(stackBase);
+	return ret;
+}
+
+void VM::yieldFiber(Value value)
+{
+	if (m_runningFiber < 0)
+		throw std::runtime_error("Not running in a fiber");
+	m_yieldValue = std::move(value);
+	m_yieldPC = pc;
+	m_yielded = true;
+	pc = m_codeSize;
+}
+
+} // namespace Phasor
@@ -2,11 +2,23 @@
 #include "VM.hpp"
 #endif
 
-void Phasor::VM::registerNativeFunction(const std::string &name, NativeFunction fn)
+void Phasor::VM::registerNativeFunction(const std::string &name, NativeFunction fn, NativeTraits traits)
 {
 #ifdef TRACING
 	log(std::format("VM::{}(\"{}\")\n", __func__, name));
 	flush();
 #endif
 	nativeFunctions[name] = fn;
+	if (traits == NativeTraits::Pure)
+		pureNativeFunctions.insert(name);
+	else
+		pureNativeFunctions.erase(name);
+}
+
+const Phasor::VM::NativeFunction *Phasor::VM::findPureNative(const std::string &name) const
+{
+	if (!pureNativeFunctions.contains(name))
+		return nullptr;
+	auto it = nativeFunctions.find(name);
+	return it != nativeFunctions.end() ? &it->second : nullptr;
 }
\ No newline at end of file
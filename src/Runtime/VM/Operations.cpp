@@ -1,18 +1,23 @@
 #ifndef CMAKE_PCH
 #include "VM.hpp" // avoid breaking IDEs
 #endif
+#include <atomic>
+#include <mutex>
 #include <phsint.hpp>
 
 namespace Phasor
 {
 
-void VM::evalLoop()
+// Errors the loop finds itself are returned through fail(); the ones helpers and natives throw are
+// caught once here, so nothing is thrown out of the loop and callers only look at the ExitReason
+VM::ExitReason VM::evalLoop()
+try
 {
 #if defined(__GNUC__) || defined(__clang__)
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wpedantic"
 
-    if (pc >= m_bytecode->instructions.size()) return;
+    if (pc >= m_codeSize) return stopReason();
 
 #ifdef TRACING
 #define TRACE_INSTR(_op) \
@@ -28,141 +33,151 @@ void VM::evalLoop()
 
     static constexpr unsigned TABLE_SIZE = 512;
     static void*              s_table[TABLE_SIZE];
-    static bool               s_ready = false;
+    static std::atomic<bool>  s_ready = false;
+    static std::mutex         s_tableMutex;
 
-    if (!s_ready) [[unlikely]]
+    // VMs on other threads may get here first; the table is filled once and only read after
+    if (!s_ready.load(std::memory_order_acquire)) [[unlikely]]
     {
-        for (auto& e : s_table) e = &&LABEL_UNKNOWN;
-
-        s_table[(unsigned)OpCode::JUMP]                       = &&LABEL_JUMP;
-        s_table[(unsigned)OpCode::CALL]                       = &&LABEL_CALL;
-        s_table[(unsigned)OpCode::RETURN]                     = &&LABEL_RETURN;
-        s_table[(unsigned)OpCode::CALL_NATIVE]                = &&LABEL_CALL_NATIVE;
-        s_table[(unsigned)OpCode::JUMP_IF_FALSE]              = &&LABEL_JUMP_IF_FALSE;
-        s_table[(unsigned)OpCode::JUMP_IF_TRUE]               = &&LABEL_JUMP_IF_TRUE;
-        s_table[(unsigned)OpCode::JUMP_BACK]                  = &&LABEL_JUMP_BACK;
-        s_table[(unsigned)OpCode::IMPORT]                     = &&LABEL_IMPORT;
-        s_table[(unsigned)OpCode::HALT]                       = &&LABEL_HALT;
-
-        s_table[(unsigned)OpCode::PUSH_CONST]                 = &&LABEL_PUSH_CONST;
-        s_table[(unsigned)OpCode::POP]                        = &&LABEL_POP;
-        s_table[(unsigned)OpCode::STORE_VAR]                  = &&LABEL_STORE_VAR;
-        s_table[(unsigned)OpCode::LOAD_VAR]                   = &&LABEL_LOAD_VAR;
-        s_table[(unsigned)OpCode::TRUE_P]                     = &&LABEL_TRUE_P;
-        s_table[(unsigned)OpCode::FALSE_P]                    = &&LABEL_FALSE_P;
-        s_table[(unsigned)OpCode::NULL_VAL]                   = &&LABEL_NULL_VAL;
-
-        s_table[(unsigned)OpCode::IADD]                       = &&LABEL_IADD;
-        s_table[(unsigned)OpCode::ISUBTRACT]                  = &&LABEL_ISUBTRACT;
-        s_table[(unsigned)OpCode::IMULTIPLY]                  = &&LABEL_IMULTIPLY;
-        s_table[(unsigned)OpCode::IDIVIDE]                    = &&LABEL_IDIVIDE;
-        s_table[(unsigned)OpCode::IMODULO]                    = &&LABEL_IMODULO;
-        s_table[(unsigned)OpCode::FLADD]                      = &&LABEL_FLADD;
-        s_table[(unsigned)OpCode::FLSUBTRACT]                 = &&LABEL_FLSUBTRACT;
-        s_table[(unsigned)OpCode::FLMULTIPLY]                 = &&LABEL_FLMULTIPLY;
-        s_table[(unsigned)OpCode::FLDIVIDE]                   = &&LABEL_FLDIVIDE;
-        s_table[(unsigned)OpCode::FLMODULO]                   = &&LABEL_FLMODULO;
-        s_table[(unsigned)OpCode::SQRT]                       = &&LABEL_SQRT;
-        s_table[(unsigned)OpCode::POW]                        = &&LABEL_POW;
-        s_table[(unsigned)OpCode::LOG]                        = &&LABEL_LOG;
-        s_table[(unsigned)OpCode::EXP]                        = &&LABEL_EXP;
-        s_table[(unsigned)OpCode::SIN]                        = &&LABEL_SIN;
-        s_table[(unsigned)OpCode::COS]                        = &&LABEL_COS;
-        s_table[(unsigned)OpCode::TAN]                        = &&LABEL_TAN;
-
-        s_table[(unsigned)OpCode::NEGATE]                     = &&LABEL_NEGATE;
-        s_table[(unsigned)OpCode::NOT]                        = &&LABEL_NOT;
-        s_table[(unsigned)OpCode::IAND]                       = &&LABEL_IAND;
-        s_table[(unsigned)OpCode::IOR]                        = &&LABEL_IOR;
-        s_table[(unsigned)OpCode::IEQUAL]                     = &&LABEL_IEQUAL;
-        s_table[(unsigned)OpCode::INOT_EQUAL]                 = &&LABEL_INOT_EQUAL;
-        s_table[(unsigned)OpCode::ILESS_THAN]                 = &&LABEL_ILESS_THAN;
-        s_table[(unsigned)OpCode::IGREATER_THAN]              = &&LABEL_IGREATER_THAN;
-        s_table[(unsigned)OpCode::ILESS_EQUAL]                = &&LABEL_ILESS_EQUAL;
-        s_table[(unsigned)OpCode::IGREATER_EQUAL]             = &&LABEL_IGREATER_EQUAL;
-        s_table[(unsigned)OpCode::FLAND]                      = &&LABEL_FLAND;
-        s_table[(unsigned)OpCode::FLOR]                       = &&LABEL_FLOR;
-        s_table[(unsigned)OpCode::FLEQUAL]                    = &&LABEL_FLEQUAL;
-        s_table[(unsigned)OpCode::FLNOT_EQUAL]                = &&LABEL_FLNOT_EQUAL;
-        s_table[(unsigned)OpCode::FLLESS_THAN]                = &&LABEL_FLLESS_THAN;
-        s_table[(unsigned)OpCode::FLGREATER_THAN]             = &&LABEL_FLGREATER_THAN;
-        s_table[(unsigned)OpCode::FLLESS_EQUAL]               = &&LABEL_FLLESS_EQUAL;
-        s_table[(unsigned)OpCode::FLGREATER_EQUAL]            = &&LABEL_FLGREATER_EQUAL;
-
-        s_table[(unsigned)OpCode::PRINT]                      = &&LABEL_PRINT;
-        s_table[(unsigned)OpCode::PRINTERROR]                 = &&LABEL_PRINTERROR;
-        s_table[(unsigned)OpCode::READLINE]                   = &&LABEL_READLINE;
-
-        s_table[(unsigned)OpCode::SYSTEM]                     = &&LABEL_SYSTEM;
-        s_table[(unsigned)OpCode::SYSTEM_OUT]                 = &&LABEL_SYSTEM_OUT;
-        s_table[(unsigned)OpCode::SYSTEM_ERR]                 = &&LABEL_SYSTEM_ERR;
-
-        s_table[(unsigned)OpCode::LEN]                        = &&LABEL_LEN;
-        s_table[(unsigned)OpCode::CHAR_AT]                    = &&LABEL_CHAR_AT;
-        s_table[(unsigned)OpCode::SUBSTR]                     = &&LABEL_SUBSTR;
-
-        s_table[(unsigned)OpCode::NEW_STRUCT_INSTANCE_STATIC] = &&LABEL_NEW_STRUCT_INSTANCE_STATIC;
-        s_table[(unsigned)OpCode::GET_FIELD_STATIC]           = &&LABEL_GET_FIELD_STATIC;
-        s_table[(unsigned)OpCode::SET_FIELD_STATIC]           = &&LABEL_SET_FIELD_STATIC;
-        s_table[(unsigned)OpCode::NEW_STRUCT]                 = &&LABEL_NEW_STRUCT;
-        s_table[(unsigned)OpCode::SET_FIELD]                  = &&LABEL_SET_FIELD;
-        s_table[(unsigned)OpCode::GET_FIELD]                  = &&LABEL_GET_FIELD;
-
-        s_table[(unsigned)OpCode::MOV]                        = &&LABEL_MOV;
-        s_table[(unsigned)OpCode::LOAD_CONST_R]               = &&LABEL_LOAD_CONST_R;
-        s_table[(unsigned)OpCode::LOAD_VAR_R]                 = &&LABEL_LOAD_VAR_R;
-        s_table[(unsigned)OpCode::STORE_VAR_R]                = &&LABEL_STORE_VAR_R;
-        s_table[(unsigned)OpCode::PUSH_R]                     = &&LABEL_PUSH_R;
-        s_table[(unsigned)OpCode::PUSH2_R]                    = &&LABEL_PUSH2_R;
-        s_table[(unsigned)OpCode::POP_R]                      = &&LABEL_POP_R;
-        s_table[(unsigned)OpCode::POP2_R]                     = &&LABEL_POP2_R;
-
-        s_table[(unsigned)OpCode::IADD_R]                     = &&LABEL_IADD_R;
-        s_table[(unsigned)OpCode::ISUB_R]                     = &&LABEL_ISUB_R;
-        s_table[(unsigned)OpCode::IMUL_R]                     = &&LABEL_IMUL_R;
-        s_table[(unsigned)OpCode::IDIV_R]                     = &&LABEL_IDIV_R;
-        s_table[(unsigned)OpCode::IMOD_R]                     = &&LABEL_IMOD_R;
-        s_table[(unsigned)OpCode::FLADD_R]                    = &&LABEL_FLADD_R;
-        s_table[(unsigned)OpCode::FLSUB_R]                    = &&LABEL_FLSUB_R;
-        s_table[(unsigned)OpCode::FLMUL_R]                    = &&LABEL_FLMUL_R;
-        s_table[(unsigned)OpCode::FLDIV_R]                    = &&LABEL_FLDIV_R;
-        s_table[(unsigned)OpCode::FLMOD_R]                    = &&LABEL_FLMOD_R;
-        s_table[(unsigned)OpCode::SQRT_R]                     = &&LABEL_SQRT_R;
-        s_table[(unsigned)OpCode::POW_R]                      = &&LABEL_POW_R;
-        s_table[(unsigned)OpCode::LOG_R]                      = &&LABEL_LOG_R;
-        s_table[(unsigned)OpCode::EXP_R]                      = &&LABEL_EXP_R;
-        s_table[(unsigned)OpCode::SIN_R]                      = &&LABEL_SIN_R;
-        s_table[(unsigned)OpCode::COS_R]                      = &&LABEL_COS_R;
-        s_table[(unsigned)OpCode::TAN_R]                      = &&LABEL_TAN_R;
-
-        s_table[(unsigned)OpCode::NEG_R]                      = &&LABEL_NEG_R;
-        s_table[(unsigned)OpCode::NOT_R]                      = &&LABEL_NOT_R;
-        s_table[(unsigned)OpCode::IEQ_R]                      = &&LABEL_IEQ_R;
-        s_table[(unsigned)OpCode::INE_R]                      = &&LABEL_INE_R;
-        s_table[(unsigned)OpCode::ILT_R]                      = &&LABEL_ILT_R;
-        s_table[(unsigned)OpCode::IGT_R]                      = &&LABEL_IGT_R;
-        s_table[(unsigned)OpCode::ILE_R]                      = &&LABEL_ILE_R;
-        s_table[(unsigned)OpCode::IGE_R]                      = &&LABEL_IGE_R;
-        s_table[(unsigned)OpCode::IAND_R]                     = &&LABEL_IAND_R;
-        s_table[(unsigned)OpCode::IOR_R]                      = &&LABEL_IOR_R;
-        s_table[(unsigned)OpCode::FLEQ_R]                     = &&LABEL_FLEQ_R;
-        s_table[(unsigned)OpCode::FLNE_R]                     = &&LABEL_FLNE_R;
-        s_table[(unsigned)OpCode::FLLT_R]                     = &&LABEL_FLLT_R;
-        s_table[(unsigned)OpCode::FLGT_R]                     = &&LABEL_FLGT_R;
-        s_table[(unsigned)OpCode::FLLE_R]                     = &&LABEL_FLLE_R;
-        s_table[(unsigned)OpCode::FLGE_R]                     = &&LABEL_FLGE_R;
-        s_table[(unsigned)OpCode::FLAND_R]                    = &&LABEL_FLAND_R;
-        s_table[(unsigned)OpCode::FLOR_R]                     = &&LABEL_FLOR_R;
-
-        s_table[(unsigned)OpCode::PRINT_R]                    = &&LABEL_PRINT_R;
-        s_table[(unsigned)OpCode::PRINTERROR_R]               = &&LABEL_PRINTERROR_R;
-        s_table[(unsigned)OpCode::READLINE_R]                 = &&LABEL_READLINE_R;
-
-        s_table[(unsigned)OpCode::SYSTEM_R]                   = &&LABEL_SYSTEM_R;
-        s_table[(unsigned)OpCode::SYSTEM_OUT_R]               = &&LABEL_SYSTEM_OUT_R;
-        s_table[(unsigned)OpCode::SYSTEM_ERR_R]               = &&LABEL_SYSTEM_ERR_R;
-
-        s_ready = true;
+        std::lock_guard lock(s_tableMutex);
+        if (!s_ready.load(std::memory_order_relaxed))
+        {
+            for (auto& e : s_table) e = &&LABEL_UNKNOWN;
+
+            s_table[(unsigned)OpCode::JUMP]                       = &&LABEL_JUMP;
+            s_table[(unsigned)OpCode::CALL]                       = &&LABEL_CALL;
+            s_table[(unsigned)OpCode::RETURN]                     = &&LABEL_RETURN;
+            s_table[(unsigned)OpCode::CALL_NATIVE]                = &&LABEL_CALL_NATIVE;
+            s_table[(unsigned)OpCode::JUMP_IF_FALSE]              = &&LABEL_JUMP_IF_FALSE;
+            s_table[(unsigned)OpCode::JUMP_IF_TRUE]               = &&LABEL_JUMP_IF_TRUE;
+            s_table[(unsigned)OpCode::JUMP_BACK]                  = &&LABEL_JUMP_BACK;
+            s_table[(unsigned)OpCode::SWITCH_TABLE]               = &&LABEL_SWITCH_TABLE;
+            s_table[(unsigned)OpCode::SWITCH_HASH]                = &&LABEL_SWITCH_HASH;
+            s_table[(unsigned)OpCode::IMPORT]                     = &&LABEL_IMPORT;
+            s_table[(unsigned)OpCode::HALT]                       = &&LABEL_HALT;
+
+            s_table[(unsigned)OpCode::PUSH_CONST]                 = &&LABEL_PUSH_CONST;
+            s_table[(unsigned)OpCode::POP]                        = &&LABEL_POP;
+            s_table[(unsigned)OpCode::STORE_VAR]                  = &&LABEL_STORE_VAR;
+            s_table[(unsigned)OpCode::LOAD_VAR]                   = &&LABEL_LOAD_VAR;
+            s_table[(unsigned)OpCode::TRUE_P]                     = &&LABEL_TRUE_P;
+            s_table[(unsigned)OpCode::FALSE_P]                    = &&LABEL_FALSE_P;
+            s_table[(unsigned)OpCode::NULL_VAL]                   = &&LABEL_NULL_VAL;
+            s_table[(unsigned)OpCode::PUSH_INT_IMM]               = &&LABEL_PUSH_INT_IMM;
+
+            s_table[(unsigned)OpCode::IADD]                       = &&LABEL_IADD;
+            s_table[(unsigned)OpCode::ISUBTRACT]                  = &&LABEL_ISUBTRACT;
+            s_table[(unsigned)OpCode::IMULTIPLY]                  = &&LABEL_IMULTIPLY;
+            s_table[(unsigned)OpCode::IDIVIDE]                    = &&LABEL_IDIVIDE;
+            s_table[(unsigned)OpCode::IMODULO]                    = &&LABEL_IMODULO;
+            s_table[(unsigned)OpCode::FLADD]                      = &&LABEL_FLADD;
+            s_table[(unsigned)OpCode::FLSUBTRACT]                 = &&LABEL_FLSUBTRACT;
+            s_table[(unsigned)OpCode::FLMULTIPLY]                 = &&LABEL_FLMULTIPLY;
+            s_table[(unsigned)OpCode::FLDIVIDE]                   = &&LABEL_FLDIVIDE;
+            s_table[(unsigned)OpCode::FLMODULO]                   = &&LABEL_FLMODULO;
+            s_table[(unsigned)OpCode::SQRT]                       = &&LABEL_SQRT;
+            s_table[(unsigned)OpCode::POW]                        = &&LABEL_POW;
+            s_table[(unsigned)OpCode::LOG]                        = &&LABEL_LOG;
+            s_table[(unsigned)OpCode::EXP]                        = &&LABEL_EXP;
+            s_table[(unsigned)OpCode::SIN]                        = &&LABEL_SIN;
+            s_table[(unsigned)OpCode::COS]                        = &&LABEL_COS;
+            s_table[(unsigned)OpCode::TAN]                        = &&LABEL_TAN;
+
+            s_table[(unsigned)OpCode::NEGATE]                     = &&LABEL_NEGATE;
+            s_table[(unsigned)OpCode::NOT]                        = &&LABEL_NOT;
+            s_table[(unsigned)OpCode::IAND]                       = &&LABEL_IAND;
+            s_table[(unsigned)OpCode::IOR]                        = &&LABEL_IOR;
+            s_table[(unsigned)OpCode::IEQUAL]                     = &&LABEL_IEQUAL;
+            s_table[(unsigned)OpCode::INOT_EQUAL]                 = &&LABEL_INOT_EQUAL;
+            s_table[(unsigned)OpCode::ILESS_THAN]                 = &&LABEL_ILESS_THAN;
+            s_table[(unsigned)OpCode::IGREATER_THAN]              = &&LABEL_IGREATER_THAN;
+            s_table[(unsigned)OpCode::ILESS_EQUAL]                = &&LABEL_ILESS_EQUAL;
+            s_table[(unsigned)OpCode::IGREATER_EQUAL]             = &&LABEL_IGREATER_EQUAL;
+            s_table[(unsigned)OpCode::FLAND]                      = &&LABEL_FLAND;
+            s_table[(unsigned)OpCode::FLOR]                       = &&LABEL_FLOR;
+            s_table[(unsigned)OpCode::FLEQUAL]                    = &&LABEL_FLEQUAL;
+            s_table[(unsigned)OpCode::FLNOT_EQUAL]                = &&LABEL_FLNOT_EQUAL;
+            s_table[(unsigned)OpCode::FLLESS_THAN]                = &&LABEL_FLLESS_THAN;
+            s_table[(unsigned)OpCode::FLGREATER_THAN]             = &&LABEL_FLGREATER_THAN;
+            s_table[(unsigned)OpCode::FLLESS_EQUAL]               = &&LABEL_FLLESS_EQUAL;
+            s_table[(unsigned)OpCode::FLGREATER_EQUAL]            = &&LABEL_FLGREATER_EQUAL;
+
+            s_table[(unsigned)OpCode::PRINT]                      = &&LABEL_PRINT;
+            s_table[(unsigned)OpCode::PRINTERROR]                 = &&LABEL_PRINTERROR;
+            s_table[(unsigned)OpCode::READLINE]                   = &&LABEL_READLINE;
+
+            s_table[(unsigned)OpCode::SYSTEM]                     = &&LABEL_SYSTEM;
+            s_table[(unsigned)OpCode::SYSTEM_OUT]                 = &&LABEL_SYSTEM_OUT;
+            s_table[(unsigned)OpCode::SYSTEM_ERR]                 = &&LABEL_SYSTEM_ERR;
+
+            s_table[(unsigned)OpCode::LEN]                        = &&LABEL_LEN;
+            s_table[(unsigned)OpCode::CHAR_AT]                    = &&LABEL_CHAR_AT;
+            s_table[(unsigned)OpCode::SUBSTR]                     = &&LABEL_SUBSTR;
+
+            s_table[(unsigned)OpCode::NEW_STRUCT_INSTANCE_STATIC] = &&LABEL_NEW_STRUCT_INSTANCE_STATIC;
+            s_table[(unsigned)OpCode::GET_FIELD_STATIC]           = &&LABEL_GET_FIELD_STATIC;
+            s_table[(unsigned)OpCode::SET_FIELD_STATIC]           = &&LABEL_SET_FIELD_STATIC;
+            s_table[(unsigned)OpCode::NEW_STRUCT]                 = &&LABEL_NEW_STRUCT;
+            s_table[(unsigned)OpCode::SET_FIELD]                  = &&LABEL_SET_FIELD;
+            s_table[(unsigned)OpCode::GET_FIELD]                  = &&LABEL_GET_FIELD;
+
+            s_table[(unsigned)OpCode::MOV]                        = &&LABEL_MOV;
+            s_table[(unsigned)OpCode::LOAD_CONST_R]               = &&LABEL_LOAD_CONST_R;
+            s_table[(unsigned)OpCode::LOAD_INT_IMM_R]             = &&LABEL_LOAD_INT_IMM_R;
+            s_table[(unsigned)OpCode::LOAD_VAR_R]                 = &&LABEL_LOAD_VAR_R;
+            s_table[(unsigned)OpCode::STORE_VAR_R]                = &&LABEL_STORE_VAR_R;
+            s_table[(unsigned)OpCode::PUSH_R]                     = &&LABEL_PUSH_R;
+            s_table[(unsigned)OpCode::PUSH2_R]                    = &&LABEL_PUSH2_R;
+            s_table[(unsigned)OpCode::POP_R]                      = &&LABEL_POP_R;
+            s_table[(unsigned)OpCode::POP2_R]                     = &&LABEL_POP2_R;
+
+            s_table[(unsigned)OpCode::IADD_R]                     = &&LABEL_IADD_R;
+            s_table[(unsigned)OpCode::ISUB_R]                     = &&LABEL_ISUB_R;
+            s_table[(unsigned)OpCode::IMUL_R]                     = &&LABEL_IMUL_R;
+            s_table[(unsigned)OpCode::IDIV_R]                     = &&LABEL_IDIV_R;
+            s_table[(unsigned)OpCode::IMOD_R]                     = &&LABEL_IMOD_R;
+            s_table[(unsigned)OpCode::FLADD_R]                    = &&LABEL_FLADD_R;
+            s_table[(unsigned)OpCode::FLSUB_R]                    = &&LABEL_FLSUB_R;
+            s_table[(unsigned)OpCode::FLMUL_R]                    = &&LABEL_FLMUL_R;
+            s_table[(unsigned)OpCode::FLDIV_R]                    = &&LABEL_FLDIV_R;
+            s_table[(unsigned)OpCode::FLMOD_R]                    = &&LABEL_FLMOD_R;
+            s_table[(unsigned)OpCode::SQRT_R]                     = &&LABEL_SQRT_R;
+            s_table[(unsigned)OpCode::POW_R]                      = &&LABEL_POW_R;
+            s_table[(unsigned)OpCode::LOG_R]                      = &&LABEL_LOG_R;
+            s_table[(unsigned)OpCode::EXP_R]                      = &&LABEL_EXP_R;
+            s_table[(unsigned)OpCode::SIN_R]                      = &&LABEL_SIN_R;
+            s_table[(unsigned)OpCode::COS_R]                      = &&LABEL_COS_R;
+            s_table[(unsigned)OpCode::TAN_R]                      = &&LABEL_TAN_R;
+
+            s_table[(unsigned)OpCode::NEG_R]                      = &&LABEL_NEG_R;
+            s_table[(unsigned)OpCode::NOT_R]                      = &&LABEL_NOT_R;
+            s_table[(unsigned)OpCode::IEQ_R]                      = &&LABEL_IEQ_R;
+            s_table[(unsigned)OpCode::INE_R]                      = &&LABEL_INE_R;
+            s_table[(unsigned)OpCode::ILT_R]                      = &&LABEL_ILT_R;
+            s_table[(unsigned)OpCode::IGT_R]                      = &&LABEL_IGT_R;
+            s_table[(unsigned)OpCode::ILE_R]                      = &&LABEL_ILE_R;
+            s_table[(unsigned)OpCode::IGE_R]                      = &&LABEL_IGE_R;
+            s_table[(unsigned)OpCode::IAND_R]                     = &&LABEL_IAND_R;
+            s_table[(unsigned)OpCode::IOR_R]                      = &&LABEL_IOR_R;
+            s_table[(unsigned)OpCode::FLEQ_R]                     = &&LABEL_FLEQ_R;
+            s_table[(unsigned)OpCode::FLNE_R]                     = &&LABEL_FLNE_R;
+            s_table[(unsigned)OpCode::FLLT_R]                     = &&LABEL_FLLT_R;
+            s_table[(unsigned)OpCode::FLGT_R]                     = &&LABEL_FLGT_R;
+            s_table[(unsigned)OpCode::FLLE_R]                     = &&LABEL_FLLE_R;
+            s_table[(unsigned)OpCode::FLGE_R]                     = &&LABEL_FLGE_R;
+            s_table[(unsigned)OpCode::FLAND_R]                    = &&LABEL_FLAND_R;
+            s_table[(unsigned)OpCode::FLOR_R]                     = &&LABEL_FLOR_R;
+
+            s_table[(unsigned)OpCode::PRINT_R]                    = &&LABEL_PRINT_R;
+            s_table[(unsigned)OpCode::PRINTERROR_R]               = &&LABEL_PRINTERROR_R;
+            s_table[(unsigned)OpCode::READLINE_R]                 = &&LABEL_READLINE_R;
+
+            s_table[(unsigned)OpCode::SYSTEM_R]                   = &&LABEL_SYSTEM_R;
+            s_table[(unsigned)OpCode::SYSTEM_OUT_R]               = &&LABEL_SYSTEM_OUT_R;
+            s_table[(unsigned)OpCode::SYSTEM_ERR_R]               = &&LABEL_SYSTEM_ERR_R;
+
+            s_ready.store(true, std::memory_order_release);
+        }
     }
 
     int operand1 = 0, operand2 = 0, operand3 = 0;
@@ -170,9 +185,9 @@ void VM::evalLoop()
 
 #define NEXT() \
     do { \
-        if (pc >= m_bytecode->instructions.size()) [[unlikely]] return; \
+        if (pc >= m_codeSize) [[unlikely]] return stopReason(); \
         { \
-            const Instruction& _i = m_bytecode->instructions[pc++]; \
+            const Instruction& _i = m_code[pc++]; \
             operand1 = _i.operand1; \
             operand2 = _i.operand2; \
             operand3 = _i.operand3; \
@@ -201,11 +216,11 @@ void VM::evalLoop()
     LABEL_CALL:
     {
         {
-            Value       funcNameVal = m_bytecode->constants[operand1];
+            Value       funcNameVal = constant(operand1);
             std::string funcName    = funcNameVal.asString();
             auto        it          = m_bytecode->functionEntries.find(funcName);
             if (it == m_bytecode->functionEntries.end())
-                throw std::runtime_error("Unknown function: " + funcName);
+                return fail("Unknown function: " + funcName);
 #ifdef TRACING
             log(std::format("CALL: {} -> {}: {}\n", pc - 1, funcName, it->second));
             flush();
@@ -218,16 +233,8 @@ void VM::evalLoop()
 
     LABEL_RETURN:
     {
-        if (isDirectCall)
-        {
-            pc = 0;
-            throw VM::Halt();
-        }
         if (callStack.empty()) [[unlikely]]
-        {
-            pc = m_bytecode->instructions.size();
-            throw std::runtime_error("Cannot return from outside a function");
-        }
+            return fail("Cannot return from outside a function");
 #ifdef TRACING
         log(std::format("RETURN: {} -> {}\n", pc - 1, callStack.back()));
         flush();
@@ -240,11 +247,11 @@ void VM::evalLoop()
     LABEL_CALL_NATIVE:
     {
         {
-            Value       funcNameVal = m_bytecode->constants[operand1];
+            Value       funcNameVal = constant(operand1);
             std::string funcName    = funcNameVal.asString();
             auto        it          = nativeFunctions.find(funcName);
             if (it == nativeFunctions.end())
-                throw std::runtime_error("Unknown native function: " + funcName);
+                return fail("Unknown native function: " + funcName);
 
             int                argCount = static_cast<int>(pop().asInt());
             std::vector<Value> args(argCount);
@@ -298,30 +305,53 @@ void VM::evalLoop()
         NEXT();
     }
 
+    LABEL_SWITCH_TABLE:
+    {
+        if (operand1 < 0 || operand1 >= static_cast<int>(m_bytecode->switchTables.size()))
+            return fail("Invalid switch table index");
+        pc = m_bytecode->switchTables[operand1].resolveDense(pop());
+#ifdef TRACING
+        log(std::format("SWITCH_TABLE: -> {}\n", pc));
+        flush();
+#endif
+        NEXT();
+    }
+
+    LABEL_SWITCH_HASH:
+    {
+        if (operand1 < 0 || operand1 >= static_cast<int>(m_bytecode->switchTables.size()))
+            return fail("Invalid switch table index");
+        pc = m_bytecode->switchTables[operand1].resolveHash(pop());
+#ifdef TRACING
+        log(std::format("SWITCH_HASH: -> {}\n", pc));
+        flush();
+#endif
+        NEXT();
+    }
+
     LABEL_IMPORT:
     {
-        {
-            Value       pathVal = m_bytecode->constants[operand1];
-            std::string path    = pathVal.asString();
-            if (importHandler)
-                importHandler(path);
-            else
-                throw std::runtime_error("Import handler not set");
-        }
+        runImport(constant(operand1).asString());
         NEXT();
     }
 
     LABEL_HALT:
     {
-        pc = m_bytecode->instructions.size();
-        throw VM::Halt();
+        pc = m_codeSize;
+        return ExitReason::Halt;
     }
 
     LABEL_PUSH_CONST:
     {
-        if (operand1 < 0 || operand1 >= static_cast<int>(m_bytecode->constants.size()))
-            throw std::runtime_error("Invalid constant index");
-        push(m_bytecode->constants[operand1]);
+        if (operand1 < 0 || operand1 >= static_cast<int>(constantCount()))
+            return fail("Invalid constant index");
+        push(constant(operand1));
+        NEXT();
+    }
+
+    LABEL_PUSH_INT_IMM:
+    {
+        push(Value(static_cast<i64>(operand1)));
         NEXT();
     }
 
@@ -334,7 +364,7 @@ void VM::evalLoop()
     LABEL_STORE_VAR:
     {
         if (operand1 < 0 || operand1 >= static_cast<int>(variables.size()))
-            throw std::runtime_error("Invalid variable index");
+            return fail("Invalid variable index");
         variables[operand1] = pop();
         NEXT();
     }
@@ -342,7 +372,7 @@ void VM::evalLoop()
     LABEL_LOAD_VAR:
     {
         if (operand1 < 0 || operand1 >= static_cast<int>(variables.size()))
-            throw std::runtime_error("Invalid variable index");
+            return fail("Invalid variable index");
         push(variables[operand1]);
         NEXT();
     }
@@ -559,9 +589,9 @@ void VM::evalLoop()
             else if (idxVal.isString())
             {
                 try { idx = std::stoll(idxVal.asString()); }
-                catch (...) { throw std::runtime_error("char_at() expects index convertible to integer"); }
+                catch (...) { return fail("char_at() expects index convertible to integer"); }
             }
-            else throw std::runtime_error("char_at() expects string and integer");
+            else return fail("char_at() expects string and integer");
 
             if (idx < 0 || idx >= static_cast<i64>(s.length()))
                 push(Value(""));
@@ -589,7 +619,7 @@ void VM::evalLoop()
             }
             else
             {
-                throw std::runtime_error("substr() expects string, int, int");
+                return fail("substr() expects string, int, int");
             }
         }
         NEXT();
@@ -603,15 +633,15 @@ void VM::evalLoop()
     {
         {
             if (operand1 < 0 || operand1 >= static_cast<int>(m_bytecode->structs.size()))
-                throw std::runtime_error("Invalid struct index for NEW_STRUCT_INSTANCE_STATIC");
+                return fail("Invalid struct index for NEW_STRUCT_INSTANCE_STATIC");
             const StructInfo& info     = m_bytecode->structs[operand1];
             Value             instance = Value::createStruct(info.name);
             for (int i = 0; i < info.fieldCount; ++i)
             {
                 int constIndex = info.firstConstIndex + i;
-                if (constIndex < 0 || constIndex >= static_cast<int>(m_bytecode->constants.size()))
-                    throw std::runtime_error("Invalid default constant index for struct field");
-                instance.setField(info.fieldNames[i], m_bytecode->constants[constIndex]);
+                if (constIndex < 0 || constIndex >= static_cast<int>(constantCount()))
+                    return fail("Invalid default constant index for struct field");
+                instance.setField(info.fieldNames[i], constant(constIndex));
             }
             push(instance);
         }
@@ -622,11 +652,11 @@ void VM::evalLoop()
     {
         {
             if (operand1 < 0 || operand1 >= static_cast<int>(m_bytecode->structs.size()))
-                throw std::runtime_error("Invalid struct index for GET_FIELD_STATIC");
+                return fail("Invalid struct index for GET_FIELD_STATIC");
             const StructInfo& info        = m_bytecode->structs[operand1];
             int               fieldOffset = operand2;
             if (fieldOffset < 0 || fieldOffset >= info.fieldCount)
-                throw std::runtime_error("Invalid field offset for GET_FIELD_STATIC");
+                return fail("Invalid field offset for GET_FIELD_STATIC");
             Value obj = pop();
             push(obj.getField(info.fieldNames[fieldOffset]));
         }
@@ -637,11 +667,11 @@ void VM::evalLoop()
     {
         {
             if (operand1 < 0 || operand1 >= static_cast<int>(m_bytecode->structs.size()))
-                throw std::runtime_error("Invalid struct index for SET_FIELD_STATIC");
+                return fail("Invalid struct index for SET_FIELD_STATIC");
             const StructInfo& info        = m_bytecode->structs[operand1];
             int               fieldOffset = operand2;
             if (fieldOffset < 0 || fieldOffset >= info.fieldCount)
-                throw std::runtime_error("Invalid field offset for SET_FIELD_STATIC");
+                return fail("Invalid field offset for SET_FIELD_STATIC");
             Value value = pop();
             Value obj   = pop();
             obj.setField(info.fieldNames[fieldOffset], value);
@@ -652,18 +682,18 @@ void VM::evalLoop()
 
     LABEL_NEW_STRUCT:
     {
-        if (operand1 < 0 || operand1 >= static_cast<int>(m_bytecode->constants.size()))
-            throw std::runtime_error("Invalid constant index for NEW_STRUCT");
-        push(Value::createStruct(m_bytecode->constants[operand1].asString()));
+        if (operand1 < 0 || operand1 >= static_cast<int>(constantCount()))
+            return fail("Invalid constant index for NEW_STRUCT");
+        push(Value::createStruct(constant(operand1).asString()));
         NEXT();
     }
 
     LABEL_SET_FIELD:
     {
         {
-            if (operand1 < 0 || operand1 >= static_cast<int>(m_bytecode->constants.size()))
-                throw std::runtime_error("Invalid constant index for SET_FIELD");
-            std::string fieldName = m_bytecode->constants[operand1].asString();
+            if (operand1 < 0 || operand1 >= static_cast<int>(constantCount()))
+                return fail("Invalid constant index for SET_FIELD");
+            std::string fieldName = constant(operand1).asString();
             Value       value     = pop();
             Value       obj       = pop();
             obj.setField(fieldName, value);
@@ -675,10 +705,10 @@ void VM::evalLoop()
     LABEL_GET_FIELD:
     {
         {
-            if (operand1 < 0 || operand1 >= static_cast<int>(m_bytecode->constants.size()))
-                throw std::runtime_error("Invalid constant index for GET_FIELD");
+            if (operand1 < 0 || operand1 >= static_cast<int>(constantCount()))
+                return fail("Invalid constant index for GET_FIELD");
             Value obj = pop();
-            push(obj.getField(m_bytecode->constants[operand1].asString()));
+            push(obj.getField(constant(operand1).asString()));
         }
         NEXT();
     }
@@ -692,9 +722,15 @@ void VM::evalLoop()
     LABEL_LOAD_CONST_R:
     {
         int constIndex = operand2;
-        if (constIndex < 0 || constIndex >= static_cast<int>(m_bytecode->constants.size()))
-            throw std::runtime_error("Invalid constant index");
-        registers[rA] = m_bytecode->constants[constIndex];
+        if (constIndex < 0 || constIndex >= static_cast<int>(constantCount()))
+            return fail("Invalid constant index");
+        registers[rA] = constant(constIndex);
+        NEXT();
+    }
+
+    LABEL_LOAD_INT_IMM_R:
+    {
+        registers[rA] = Value(static_cast<i64>(operand2));
         NEXT();
     }
 
@@ -702,7 +738,7 @@ void VM::evalLoop()
     {
         int varIndex = operand2;
         if (varIndex < 0 || varIndex >= static_cast<int>(variables.size()))
-            throw std::runtime_error("Invalid variable index");
+            return fail("Invalid variable index");
         registers[rA] = variables[varIndex];
         NEXT();
     }
@@ -711,7 +747,7 @@ void VM::evalLoop()
     {
         int varIndex = operand2;
         if (varIndex < 0 || varIndex >= static_cast<int>(variables.size()))
-            throw std::runtime_error("Invalid variable index");
+            return fail("Invalid variable index");
         variables[varIndex] = registers[rA];
         NEXT();
     }
@@ -905,25 +941,42 @@ void VM::evalLoop()
     // UNKNOWN
     
     LABEL_UNKNOWN:
-        throw std::runtime_error("Unknown opcode");
+        return fail("Unknown opcode");
 
 #undef NEXT
 #undef TRACE_INSTR
 
 #else
-    while (pc < m_bytecode->instructions.size())
+    while (pc < m_codeSize)
     {
-        const Instruction& instr = m_bytecode->instructions[pc++];
+        const Instruction& instr = m_code[pc++];
 #ifdef TRACING
         log(std::format("\nVM::{}(): RUN (pc={})\n", __func__, pc - 1));
         flush();
 #endif
         operation(instr.op, instr.operand1, instr.operand2, instr.operand3);
     }
+    return stopReason();
 
 #pragma GCC diagnostic pop
 #endif // defined(__GNUC__) || defined(__clang__)
 }
+catch (const Halt &)
+{
+    // A function a native called back into halted the program
+    return ExitReason::Halt;
+}
+catch (const std::exception &e)
+{
+    return fail(e.what());
+}
+
+VM::ExitReason VM::fail(std::string message)
+{
+	m_error.message = std::move(message);
+	m_error.pc = pc > 0 ? pc - 1 : 0;
+	return ExitReason::Error;
+}
 
 Value VM::operation(const OpCode &op, const int &operand1, const int &operand2, const int &operand3)
 {
@@ -949,7 +1002,7 @@ Value VM::operation(const OpCode &op, const int &operand1, const int &operand2,
 	}
 
 	[[likely]] case OpCode::CALL: {
-		Value       funcNameVal = m_bytecode->constants[operand1];
+		Value       funcNameVal = constant(operand1);
 		std::string funcName = funcNameVal.asString();
 		auto        it = m_bytecode->functionEntries.find(funcName);
 		if (it == m_bytecode->functionEntries.end())
@@ -963,15 +1016,9 @@ Value VM::operation(const OpCode &op, const int &operand1, const int &operand2,
 		break;
 	}
 	[[likely]] case OpCode::RETURN: {
-		if (isDirectCall)
-		{
-			pc = 0;
-			throw VM::Halt();
-			break;
-		}
 		if (callStack.empty()) [[unlikely]]
 		{
-			pc = m_bytecode->instructions.size();
+			pc = m_codeSize;
 			throw std::runtime_error("Cannot return from outside a function");
 			break;
 		}
@@ -985,7 +1032,7 @@ Value VM::operation(const OpCode &op, const int &operand1, const int &operand2,
 	}
 
 	[[likely]] case OpCode::CALL_NATIVE: {
-		Value       funcNameVal = m_bytecode->constants[operand1];
+		Value       funcNameVal = constant(operand1);
 		std::string funcName = funcNameVal.asString();
 		auto        it = nativeFunctions.find(funcName);
 		if (it == nativeFunctions.end())
@@ -1042,19 +1089,35 @@ Value VM::operation(const OpCode &op, const int &operand1, const int &operand2,
 		break;
 	}
 
+	case OpCode::SWITCH_TABLE: {
+		if (operand1 < 0 || operand1 >= static_cast<int>(m_bytecode->switchTables.size()))
+			throw std::runtime_error("Invalid switch table index");
+		pc = m_bytecode->switchTables[operand1].resolveDense(pop());
+#ifdef TRACING
+		log(std::format("SWITCH_TABLE: -> {}\n", pc));
+		flush();
+#endif
+		break;
+	}
+
+	case OpCode::SWITCH_HASH: {
+		if (operand1 < 0 || operand1 >= static_cast<int>(m_bytecode->switchTables.size()))
+			throw std::runtime_error("Invalid switch table index");
+		pc = m_bytecode->switchTables[operand1].resolveHash(pop());
+#ifdef TRACING
+		log(std::format("SWITCH_HASH: -> {}\n", pc));
+		flush();
+#endif
+		break;
+	}
+
 	[[unlikely]] case OpCode::IMPORT: {
-		Value       pathVal = m_bytecode->constants[operand1];
-		std::string path = pathVal.asString();
-		if (importHandler)
-			importHandler(path);
-		else
-			throw std::runtime_error("Import handler not set");
+		runImport(constant(operand1).asString());
 		break;
 	}
 
 	[[unlikely]] case OpCode::HALT: {
-		pc = m_bytecode->instructions.size();
-		throw VM::Halt();
+		halt();
 		break;
 	}
 
@@ -1062,9 +1125,14 @@ Value VM::operation(const OpCode &op, const int &operand1, const int &operand2,
 #pragma region STACK CORE
 
 	[[likely]] case OpCode::PUSH_CONST: {
-		if (operand1 < 0 || operand1 >= static_cast<int>(m_bytecode->constants.size()))
+		if (operand1 < 0 || operand1 >= static_cast<int>(constantCount()))
 			throw std::runtime_error("Invalid constant index");
-		push(m_bytecode->constants[operand1]);
+		push(constant(operand1));
+		break;
+	}
+
+	[[likely]] case OpCode::PUSH_INT_IMM: {
+		push(Value(static_cast<i64>(operand1)));
 		break;
 	}
 
@@ -1529,9 +1597,9 @@ Value VM::operation(const OpCode &op, const int &operand1, const int &operand2,
 		for (int i = 0; i < info.fieldCount; ++i)
 		{
 			int constIndex = info.firstConstIndex + i;
-			if (constIndex < 0 || constIndex >= static_cast<int>(m_bytecode->constants.size()))
+			if (constIndex < 0 || constIndex >= static_cast<int>(constantCount()))
 				throw std::runtime_error("Invalid default constant index for struct field");
-			const Value       &defVal    = m_bytecode->constants[constIndex];
+			const Value       &defVal    = constant(constIndex);
 			const std::string &fieldName = info.fieldNames[i];
 			instance.setField(fieldName, defVal);
 		}
@@ -1568,18 +1636,18 @@ Value VM::operation(const OpCode &op, const int &operand1, const int &operand2,
 	}
 
 	case OpCode::NEW_STRUCT: {
-		if (operand1 < 0 || operand1 >= static_cast<int>(m_bytecode->constants.size()))
+		if (operand1 < 0 || operand1 >= static_cast<int>(constantCount()))
 			throw std::runtime_error("Invalid constant index for NEW_STRUCT");
-		Value       nameVal    = m_bytecode->constants[operand1];
+		Value       nameVal    = constant(operand1);
 		std::string structName = nameVal.asString();
 		push(Value::createStruct(structName));
 		break;
 	}
 
 	case OpCode::SET_FIELD: {
-		if (operand1 < 0 || operand1 >= static_cast<int>(m_bytecode->constants.size()))
+		if (operand1 < 0 || operand1 >= static_cast<int>(constantCount()))
 			throw std::runtime_error("Invalid constant index for SET_FIELD");
-		std::string fieldName = m_bytecode->constants[operand1].asString();
+		std::string fieldName = constant(operand1).asString();
 		Value       value     = pop();
 		Value       obj       = pop();
 		obj.setField(fieldName, value);
@@ -1588,9 +1656,9 @@ Value VM::operation(const OpCode &op, const int &operand1, const int &operand2,
 	}
 
 	case OpCode::GET_FIELD: {
-		if (operand1 < 0 || operand1 >= static_cast<int>(m_bytecode->constants.size()))
+		if (operand1 < 0 || operand1 >= static_cast<int>(constantCount()))
 			throw std::runtime_error("Invalid constant index for GET_FIELD");
-		std::string fieldName = m_bytecode->constants[operand1].asString();
+		std::string fieldName = constant(operand1).asString();
 		Value       obj       = pop();
 		push(obj.getField(fieldName));
 		break;
@@ -1606,9 +1674,14 @@ Value VM::operation(const OpCode &op, const int &operand1, const int &operand2,
 
 	[[likely]] case OpCode::LOAD_CONST_R: {
 		int constIndex = operand2;
-		if (constIndex < 0 || constIndex >= static_cast<int>(m_bytecode->constants.size()))
+		if (constIndex < 0 || constIndex >= static_cast<int>(constantCount()))
 			throw std::runtime_error("Invalid constant index");
-		registers[rA] = m_bytecode->constants[constIndex];
+		registers[rA] = constant(constIndex);
+		break;
+	}
+
+	[[likely]] case OpCode::LOAD_INT_IMM_R: {
+		registers[rA] = Value(static_cast<i64>(operand2));
 		break;
 	}
 
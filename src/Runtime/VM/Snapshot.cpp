@@ -0,0 +1,510 @@
+#include "Snapshot.hpp"
+#include "../../Codegen/Bytecode/BytecodeDeserializer.hpp"
+#include "../../Codegen/Bytecode/BytecodeSerializer.hpp"
+#include "../../Codegen/Bytecode/Checksum.hpp"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+// Layout, all integers little-endian, "varuint" unsigned LEB128 and "varint" zigzag LEB128:
+//
+//   "PHSS"  u32 version  u32 crc32c of everything after it
+//   varuint size, .phsb image          linked bytecode
+//   varuint pc, varint status
+//   varuint count, string * count      native names
+//   varuint count, string * count      plugin files
+//   varuint count, u8 kind * count     objects: 5 struct, 6 array, | 0x80 if frozen
+//   objects, in order: struct = string name, varuint count, (string key, value) * count
+//                      array  = varuint count, value * count
+//   varuint count, varint * count      call stack
+//   varuint count, value * count       variables
+//   varuint count, value * count       stack
+//   varuint count, value * count       registers
+//   varuint count, string * count      string builders (version 3 on)
+//   varuint count, varuint * count     free string builder handles
+//   varuint * 2                        random generator state
+//
+// A value is a ValueType byte followed by nothing (Null), u8 (Bool), varint (Int),
+// f64 (Float), string (String) or the varuint index of an object (Struct, Array).
+// Objects come before anything refers to them and are all created before any is
+// filled in, so shared and cyclic references survive the round trip.
+
+namespace Phasor
+{
+
+namespace
+{
+
+constexpr char   SNAPSHOT_MAGIC[4] = {'P', 'H', 'S', 'S'};
+constexpr u32    SNAPSHOT_VERSION = 3; ///< 2 added the frozen bit, 3 stdlib state; 1 and 2 are read as well
+constexpr u8     SNAPSHOT_FROZEN = 0x80;
+constexpr size_t SNAPSHOT_HEADER_SIZE = 12;
+
+class SnapshotWriter
+{
+  public:
+	std::vector<u8> buffer;
+
+	void writeUInt8(u8 value)
+	{
+		buffer.push_back(value);
+	}
+
+	void writeUInt32(u32 value)
+	{
+		for (int i = 0; i < 4; i++)
+			buffer.push_back(static_cast<u8>(value >> (i * 8)));
+	}
+
+	void writeVarUInt(u64 value)
+	{
+		while (value >= 0x80)
+		{
+			buffer.push_back(static_cast<u8>(value | 0x80));
+			value >>= 7;
+		}
+		buffer.push_back(static_cast<u8>(value));
+	}
+
+	void writeVarInt(i64 value)
+	{
+		writeVarUInt((static_cast<u64>(value) << 1) ^ static_cast<u64>(value >> 63));
+	}
+
+	/// @brief Append size bytes; resize and copy, as GCC 12 sees an insert() overflowing an empty buffer
+	void writeBytes(const void *data, size_t size)
+	{
+		if (size == 0)
+			return;
+		size_t offset = buffer.size();
+		buffer.resize(offset + size);
+		std::memcpy(buffer.data() + offset, data, size);
+	}
+
+	void writeString(std::string_view text)
+	{
+		writeVarUInt(text.size());
+		writeBytes(text.data(), text.size());
+	}
+
+	/// @brief Give every struct and array reachable from values an index, parents first
+	void collect(const Value &root)
+	{
+		addObject(root);
+		while (m_scanned < m_objects.size())
+		{
+			// A copy, adding children may move m_objects
+			const Value object = m_objects[m_scanned++];
+			if (object.isStruct())
+			{
+				for (const auto &[key, field] : object.asStruct()->fields)
+					addObject(field);
+			}
+			else
+			{
+				for (const Value &element : *object.asArray())
+					addObject(element);
+			}
+		}
+	}
+
+	void writeObjects()
+	{
+		writeVarUInt(m_objects.size());
+		for (const Value &object : m_objects)
+			writeUInt8(static_cast<u8>(object.getType()) | (object.isFrozen() ? SNAPSHOT_FROZEN : 0));
+		for (const Value &object : m_objects)
+		{
+			if (object.isStruct())
+			{
+				auto instance = object.asStruct();
+				writeString(instance->structName.view());
+				writeVarUInt(instance->fields.size());
+				for (const auto &[key, field] : instance->fields)
+				{
+					writeString(key.view());
+					writeValue(field);
+				}
+			}
+			else
+			{
+				auto elements = object.asArray();
+				writeVarUInt(elements->size());
+				for (const Value &element : *elements)
+					writeValue(element);
+			}
+		}
+	}
+
+	void writeValue(const Value &value)
+	{
+		writeUInt8(static_cast<u8>(value.getType()));
+		switch (value.getType())
+		{
+		case ValueType::Null:
+			break;
+		case ValueType::Bool:
+			writeUInt8(value.asBool() ? 1 : 0);
+			break;
+		case ValueType::Int:
+			writeVarInt(value.asInt());
+			break;
+		case ValueType::Float: {
+			u64 bits;
+			f64 number = value.asFloat();
+			std::memcpy(&bits, &number, sizeof(bits));
+			for (int i = 0; i < 8; i++)
+				buffer.push_back(static_cast<u8>(bits >> (i * 8)));
+			break;
+		}
+		case ValueType::String:
+			writeString(value.asString().view());
+			break;
+		case ValueType::Struct:
+		case ValueType::Array:
+			writeVarUInt(m_ids.at(identity(value)));
+			break;
+		}
+	}
+
+  private:
+	std::vector<Value>                       m_objects;
+	std::unordered_map<const void *, size_t> m_ids;
+	size_t                                   m_scanned = 0;
+
+	static const void *identity(const Value &value)
+	{
+		return value.isStruct() ? static_cast<const void *>(value.asStruct().get())
+		                        : static_cast<const void *>(value.asArray().get());
+	}
+
+	void addObject(const Value &value)
+	{
+		if (!value.isStruct() && !value.isArray())
+			return;
+		if (m_ids.try_emplace(identity(value), m_objects.size()).second)
+			m_objects.push_back(value);
+	}
+};
+
+class SnapshotReader
+{
+  public:
+	SnapshotReader(const u8 *data, size_t size) : m_data(data), m_size(size)
+	{
+	}
+
+	bool atEnd() const
+	{
+		return m_position == m_size;
+	}
+
+	u8 readUInt8()
+	{
+		need(1);
+		return m_data[m_position++];
+	}
+
+	u64 readVarUInt()
+	{
+		u64 value = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			u8 byte = readUInt8();
+			value |= static_cast<u64>(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+				return value;
+		}
+		throw std::runtime_error("Snapshot corrupted: varint too long");
+	}
+
+	i64 readVarInt()
+	{
+		u64 value = readVarUInt();
+		return static_cast<i64>((value >> 1) ^ (~(value & 1) + 1));
+	}
+
+	/// @brief A count of items each at least one byte long, so a corrupt count can't allocate much
+	size_t readCount()
+	{
+		u64 count = readVarUInt();
+		if (count > m_size - m_position)
+			throw std::runtime_error("Snapshot corrupted: count out of range");
+		return static_cast<size_t>(count);
+	}
+
+	std::string_view readBytes(size_t size)
+	{
+		need(size);
+		std::string_view bytes(reinterpret_cast<const char *>(m_data + m_position), size);
+		m_position += size;
+		return bytes;
+	}
+
+	std::string_view readString()
+	{
+		return readBytes(readCount());
+	}
+
+	void readObjects()
+	{
+		size_t            count = readCount();
+		std::vector<bool> frozen(count);
+		m_objects.reserve(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			u8 kind = readUInt8();
+			frozen[i] = (kind & SNAPSHOT_FROZEN) != 0;
+			switch (static_cast<ValueType>(kind & ~SNAPSHOT_FROZEN))
+			{
+			case ValueType::Struct:
+				m_objects.push_back(Value(std::make_shared<Value::StructInstance>()));
+				break;
+			case ValueType::Array:
+				m_objects.push_back(Value::createArray());
+				break;
+			default:
+				throw std::runtime_error("Snapshot corrupted: invalid object kind");
+			}
+		}
+		for (Value &object : m_objects)
+		{
+			if (object.isStruct())
+			{
+				auto instance = object.asStruct();
+				instance->structName = PhsString(readString());
+				size_t fields = readCount();
+				for (size_t i = 0; i < fields; i++)
+				{
+					PhsString key(readString());
+					instance->fields[key] = readValue();
+				}
+			}
+			else
+			{
+				auto   elements = object.asArray();
+				size_t size = readCount();
+				elements->reserve(size);
+				for (size_t i = 0; i < size; i++)
+					elements->push_back(readValue());
+			}
+		}
+		// Only once filled in; a frozen object's children are all frozen as well
+		for (size_t i = 0; i < count; i++)
+		{
+			if (!frozen[i])
+				continue;
+			if (m_objects[i].isStruct())
+				m_objects[i].asStruct()->frozen = true;
+			else
+				m_objects[i].asArray()->frozen = true;
+		}
+	}
+
+	Value readValue()
+	{
+		switch (static_cast<ValueType>(readUInt8()))
+		{
+		case ValueType::Null:
+			return Value();
+		case ValueType::Bool:
+			return Value(readUInt8() != 0);
+		case ValueType::Int:
+			return Value(readVarInt());
+		case ValueType::Float: {
+			need(8);
+			u64 bits = 0;
+			for (int i = 0; i < 8; i++)
+				bits |= static_cast<u64>(m_data[m_position++]) << (i * 8);
+			f64 number;
+			std::memcpy(&number, &bits, sizeof(number));
+			return Value(number);
+		}
+		case ValueType::String:
+			return Value(PhsString(readString()));
+		case ValueType::Struct:
+		case ValueType::Array: {
+			u64 index = readVarUInt();
+			if (index >= m_objects.size())
+				throw std::runtime_error("Snapshot corrupted: object index out of range");
+			return m_objects[index];
+		}
+		}
+		throw std::runtime_error("Snapshot corrupted: invalid value type");
+	}
+
+	std::vector<Value> readValues()
+	{
+		std::vector<Value> values(readCount());
+		for (Value &value : values)
+			value = readValue();
+		return values;
+	}
+
+  private:
+	const u8          *m_data;
+	size_t             m_size;
+	size_t             m_position = 0;
+	std::vector<Value> m_objects;
+
+	void need(size_t size) const
+	{
+		if (size > m_size - m_position)
+			throw std::runtime_error("Snapshot corrupted: unexpected end of file");
+	}
+};
+
+} // namespace
+
+std::vector<u8> Snapshot::serialize() const
+{
+	BytecodeSerializer serializer;
+	std::vector<u8>    image = serializer.serialize(bytecode);
+
+	SnapshotWriter writer;
+	writer.buffer.reserve(SNAPSHOT_HEADER_SIZE + 10 + image.size());
+	writer.writeBytes(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+	writer.writeUInt32(SNAPSHOT_VERSION);
+	writer.writeUInt32(0); // checksum, filled in last
+
+	writer.writeVarUInt(image.size());
+	writer.writeBytes(image.data(), image.size());
+
+	writer.writeVarUInt(pc);
+	writer.writeVarInt(status);
+	writer.writeVarUInt(natives.size());
+	for (const std::string &name : natives)
+		writer.writeString(name);
+	writer.writeVarUInt(plugins.size());
+	for (const std::string &plugin : plugins)
+		writer.writeString(plugin);
+
+	for (const Value &value : variables)
+		writer.collect(value);
+	for (const Value &value : stack)
+		writer.collect(value);
+	for (const Value &value : registers)
+		writer.collect(value);
+	writer.writeObjects();
+
+	writer.writeVarUInt(callStack.size());
+	for (int address : callStack)
+		writer.writeVarInt(address);
+	for (const auto *values : {&variables, &stack})
+	{
+		writer.writeVarUInt(values->size());
+		for (const Value &value : *values)
+			writer.writeValue(value);
+	}
+	writer.writeVarUInt(registers.size());
+	for (const Value &value : registers)
+		writer.writeValue(value);
+
+	writer.writeVarUInt(stringBuilders.size());
+	for (const std::string &builder : stringBuilders)
+		writer.writeString(builder);
+	writer.writeVarUInt(freeStringBuilders.size());
+	for (size_t handle : freeStringBuilders)
+		writer.writeVarUInt(handle);
+	for (u64 state : random)
+		writer.writeVarUInt(state);
+
+	u32 checksum = Checksum::crc32c(writer.buffer.data() + SNAPSHOT_HEADER_SIZE,
+	                                writer.buffer.size() - SNAPSHOT_HEADER_SIZE);
+	for (int i = 0; i < 4; i++)
+		writer.buffer[8 + i] = static_cast<u8>(checksum >> (i * 8));
+	return std::move(writer.buffer);
+}
+
+Snapshot Snapshot::deserialize(const u8 *data, size_t size)
+{
+	if (size < SNAPSHOT_HEADER_SIZE || std::memcmp(data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+		throw std::runtime_error("Not a Phasor snapshot");
+	auto readUInt32 = [data](size_t offset) {
+		return static_cast<u32>(data[offset]) | static_cast<u32>(data[offset + 1]) << 8 |
+		       static_cast<u32>(data[offset + 2]) << 16 | static_cast<u32>(data[offset + 3]) << 24;
+	};
+	const u32 version = readUInt32(4);
+	if (version < 1 || version > SNAPSHOT_VERSION)
+		throw std::runtime_error("Unsupported snapshot version " + std::to_string(version));
+	if (Checksum::crc32c(data + SNAPSHOT_HEADER_SIZE, size - SNAPSHOT_HEADER_SIZE) != readUInt32(8))
+		throw std::runtime_error("Snapshot corrupted: checksum mismatch");
+
+	SnapshotReader reader(data + SNAPSHOT_HEADER_SIZE, size - SNAPSHOT_HEADER_SIZE);
+	Snapshot       snapshot;
+
+	// Covered by the snapshot's own checksum
+	std::string_view     image = reader.readString();
+	BytecodeDeserializer deserializer({.verifyChecksums = false});
+	snapshot.bytecode = deserializer.deserialize(std::vector<u8>(image.begin(), image.end()));
+
+	snapshot.pc = static_cast<size_t>(reader.readVarUInt());
+	if (snapshot.pc > snapshot.bytecode.instructions.size())
+		throw std::runtime_error("Snapshot corrupted: program counter out of range");
+	snapshot.status = static_cast<int>(reader.readVarInt());
+	for (auto *names : {&snapshot.natives, &snapshot.plugins})
+	{
+		names->resize(reader.readCount());
+		for (std::string &name : *names)
+			name = reader.readString();
+	}
+
+	reader.readObjects();
+
+	snapshot.callStack.resize(reader.readCount());
+	for (int &address : snapshot.callStack)
+	{
+		i64 value = reader.readVarInt();
+		if (value < 0 || value > static_cast<i64>(snapshot.bytecode.instructions.size()))
+			throw std::runtime_error("Snapshot corrupted: return address out of range");
+		address = static_cast<int>(value);
+	}
+	snapshot.variables = reader.readValues();
+	snapshot.stack = reader.readValues();
+	std::vector<Value> registers = reader.readValues();
+	if (registers.size() != snapshot.registers.size())
+		throw std::runtime_error("Snapshot was taken on a VM with " + std::to_string(registers.size()) +
+		                         " registers, this one has " + std::to_string(snapshot.registers.size()));
+	std::move(registers.begin(), registers.end(), snapshot.registers.begin());
+
+	if (version >= 3)
+	{
+		snapshot.stringBuilders.resize(reader.readCount());
+		for (std::string &builder : snapshot.stringBuilders)
+			builder = reader.readString();
+		snapshot.freeStringBuilders.resize(reader.readCount());
+		for (size_t &handle : snapshot.freeStringBuilders)
+		{
+			handle = static_cast<size_t>(reader.readVarUInt());
+			if (handle >= snapshot.stringBuilders.size())
+				throw std::runtime_error("Snapshot corrupted: string builder handle out of range");
+		}
+		for (u64 &state : snapshot.random)
+			state = reader.readVarUInt();
+	}
+	if (!reader.atEnd())
+		throw std::runtime_error("Snapshot corrupted: trailing data");
+	return snapshot;
+}
+
+void Snapshot::save(const std::filesystem::path &path) const
+{
+	std::vector<u8> data = serialize();
+	std::ofstream   file(path, std::ios::binary);
+	if (!file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size())))
+		throw std::runtime_error("Failed to write snapshot: " + path.string());
+}
+
+Snapshot Snapshot::load(const std::filesystem::path &path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open snapshot: " + path.string());
+	std::vector<u8> data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+	return deserialize(data.data(), data.size());
+}
+
+} // namespace Phasor
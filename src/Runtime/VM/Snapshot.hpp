@@ -0,0 +1,61 @@
+#pragma once
+#include "../../Codegen/CodeGen.hpp"
+#ifndef CMAKE_PCH
+#include <Value.hpp>
+#endif
+#include <array>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <phsint.hpp>
+#include <platform.h>
+
+/// @brief The Phasor Programming Language and Runtime
+namespace Phasor
+{
+
+/**
+ * @struct Snapshot
+ * @brief A VM paused at a call to snapshot(), as written by `--snapshot` and resumed by `--from-snapshot`
+ *
+ * Holds everything the VM needs to carry on where the program called snapshot():
+ * the linked bytecode, variables, stack, registers, call stack and program
+ * counter. Structs and arrays are stored once each with the references between
+ * them, so values that shared an array before share it after a resume, cycles
+ * included.
+ *
+ * Native functions can't be stored, so only their names are: the host registers
+ * its natives and plugins as usual (the plugin files are listed here, so the
+ * plugin folder needn't be scanned again) and VM::resume() binds the names to
+ * them. The standard library's string builders and random generator are stored
+ * too; state outside the VM, such as open files, isn't captured, and snapshot()
+ * refuses while tasks or channels are in use.
+ *
+ * The file is a "PHSS" magic, a version and a CRC-32C over the rest; see Snapshot.cpp.
+ */
+struct Snapshot
+{
+	Bytecode                         bytecode;
+	std::vector<Value>               variables;
+	std::vector<Value>               stack;
+	std::array<Value, MAX_REGISTERS> registers;
+	std::vector<int>                 callStack;
+	size_t                           pc = 0;             ///< Instruction after the CALL_NATIVE of snapshot()
+	int                              status = 0;
+	std::vector<std::string>         natives;            ///< Names of the natives registered when it was taken
+	std::vector<std::string>         plugins;            ///< FFI plugin files that were loaded
+	std::vector<std::string>         stringBuilders;     ///< sb_new() buffers, by handle
+	std::vector<size_t>              freeStringBuilders; ///< Handles sb_free() released
+	std::array<u64, 2>               random = {};        ///< rand_seed() state
+
+	/// @throws std::runtime_error if the file can't be written
+	void save(const std::filesystem::path &path) const;
+
+	/// @throws std::runtime_error if the file can't be read or isn't a valid snapshot
+	static Snapshot load(const std::filesystem::path &path);
+
+	std::vector<u8> serialize() const;
+	static Snapshot deserialize(const u8 *data, size_t size);
+};
+
+} // namespace Phasor
@@ -1,9 +1,11 @@
 #ifndef CMAKE_PCH
 #include "VM.hpp"
 #endif
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 #include <format>
+#include <span>
 #include <cassert>
 #include "core/core.h"
 #include <phsint.hpp>
@@ -60,13 +62,37 @@ void VM::initFFI(const std::filesystem::path &path)
 #endif
 }
 
-void VM::setup(const Bytecode &bc, const size_t initialPC) {
+void VM::initFFI(const std::vector<std::string> &plugins)
+{
+#ifndef SANDBOXED
+	ffi = std::make_unique<FFI>(plugins, this);
+#else
+	(void)plugins;
+#endif
+}
+
+bool VM::hasFFI() const
+{
+#ifndef SANDBOXED
+	return ffi != nullptr;
+#else
+	return true;
+#endif
+}
+
+void VM::setup(const Bytecode &bc, const size_t initialPC, const BytecodeImage *image) {
 	m_bytecode = &bc;
+	m_image = image;
+	m_code = image != nullptr ? image->instructions() : bc.instructions.data();
+	m_codeSize = image != nullptr ? image->instructionCount() : bc.instructions.size();
 	pc = initialPC;
 	stack.clear();
 	callStack.clear();
+	m_fibers.clear();
+	m_yielded = false;
 
 	registerArrayFunctions();
+	registerSnapshotFunctions();
 
 #ifdef TRACING
 	log(std::format("\nVM::{}():\n\n{}\n", __func__, getBytecodeInformation()));
@@ -80,7 +106,112 @@ void VM::setup(const Bytecode &bc, const size_t initialPC) {
 int VM::run(const Bytecode &bc, const size_t startPC)
 {
 	setup(bc, startPC);
+	return execute();
+}
+
+int VM::run(const BytecodeImage &image, CompiledProgram program)
+{
+	setup(image.tables(), 0, &image);
+	return execute(program);
+}
+
+int VM::run(const Bytecode &bc, CompiledProgram program)
+{
+	setup(bc, 0);
+	return execute(program);
+}
+
+void VM::setSnapshotPath(const std::filesystem::path &path)
+{
+	m_snapshotPath = path;
+}
+
+int VM::resume(const Snapshot &snapshot)
+{
+	// Natives are bound by name to what the host registered, and only the ones the program had
+	registerArrayFunctions();
+	registerSnapshotFunctions();
+	std::map<std::string, NativeFunction> bound;
+	for (const std::string &name : snapshot.natives)
+	{
+		auto it = nativeFunctions.find(name);
+		if (it == nativeFunctions.end())
+			throw std::runtime_error("Snapshot needs native function '" + name + "', which isn't registered");
+		bound.insert(*it);
+	}
+	nativeFunctions = std::move(bound);
+	std::erase_if(pureNativeFunctions, [this](const std::string &name) { return !nativeFunctions.contains(name); });
+
+	setup(snapshot.bytecode, snapshot.pc);
+	variables = snapshot.variables;
+	stack.assign(snapshot.stack.begin(), snapshot.stack.end());
+	registers = snapshot.registers;
+	callStack = snapshot.callStack;
+	status = snapshot.status;
+	m_stdlib.stringBuilders.clear();
+	for (const std::string &builder : snapshot.stringBuilders)
+		m_stdlib.stringBuilders.emplace_back(builder);
+	m_stdlib.freeStringBuilders = snapshot.freeStringBuilders;
+	std::ranges::copy(snapshot.random, m_stdlib.random);
+	push(Value(true)); // what snapshot() returns
+	return execute();
+}
+
+void VM::registerSnapshotFunctions()
+{
+	registerNativeFunction("snapshot", &VM::native_snapshot);
+}
+
+Value VM::native_snapshot(const std::vector<Value> &args, VM *vm)
+{
+	if (!args.empty())
+		throw std::runtime_error("snapshot() takes no arguments");
+	if (vm->m_snapshotPath.empty())
+		return false;
+	if (vm->m_importDepth > 0)
+		throw std::runtime_error("snapshot() can't be called from an imported module");
+	if (!vm->m_fibers.empty())
+		throw std::runtime_error("snapshot() can't be called while there are unfinished fibers");
+	// Tasks run and channels live outside this VM, so there is nothing to store for them
+	if (vm->m_stdlib.unjoinedTasks > 0)
+		throw std::runtime_error("snapshot() can't be called while spawned tasks haven't been joined");
+	if (!vm->m_stdlib.channels.empty())
+		throw std::runtime_error("snapshot() can't be called once channels have been used");
+
+	// The CALL_NATIVE has popped its arguments and pc is past it, so this is
+	// the state to continue from once the result is pushed
+	Snapshot snapshot;
+	snapshot.bytecode = vm->getBytecode();
+	snapshot.variables = vm->variables;
+	snapshot.stack.assign(vm->stack.begin(), vm->stack.end());
+	snapshot.registers = vm->registers;
+	snapshot.callStack = vm->callStack;
+	snapshot.pc = vm->pc;
+	snapshot.status = vm->status;
+	for (const PhsString &builder : vm->m_stdlib.stringBuilders)
+		snapshot.stringBuilders.push_back(builder.str());
+	snapshot.freeStringBuilders = vm->m_stdlib.freeStringBuilders;
+	std::ranges::copy(vm->m_stdlib.random, snapshot.random.begin());
+	for (const auto &[name, function] : vm->nativeFunctions)
+		snapshot.natives.push_back(name);
+#ifndef SANDBOXED
+	if (vm->ffi)
+		snapshot.plugins = vm->ffi->pluginPaths();
+#endif
+	snapshot.save(vm->m_snapshotPath);
+	vm->m_snapshotTaken = true;
+	vm->halt();
+	return true;
+}
 
+void VM::halt()
+{
+	m_halted = true;
+	pc = m_codeSize;
+}
+
+int VM::execute(CompiledProgram program)
+{
 #ifdef TRACING
 	log(std::format("\nVM::{}():\n\n", __func__));
 	flush();
@@ -91,28 +222,34 @@ int VM::run(const Bytecode &bc, const size_t startPC)
 	auto start = clock::now();
 #endif
 
+	m_halted = false;
 	try
 	{
-		evalLoop();
-		return status;
-	}
-	catch (const VM::Halt &)
-	{
-#ifdef TIMING
-		auto end = clock::now();
-		auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-		log(std::format("VM::{}(): Duration of bytecode execution: {}us\n\n", __func__, us));
-		flush();
-#endif
-#ifdef TRACING
-		log(std::format("\nVM::{}(): HALT (status={})\n\n{}\n", __func__, status, getInformation()));
-		flush();
-#endif
-#ifdef _DEBUG
-		if (isDebuggerAttached())
-			assert(status == 0);
-#endif
-		return status;
+		if (program != nullptr)
+		{
+			CompiledFrame frame{
+			    this, stack, variables, registers.data(),
+			    [](VM *vm, int op, int operand1, int operand2, int operand3) {
+				    vm->operation(static_cast<OpCode>(op), operand1, operand2, operand3);
+				    if (vm->m_halted) [[unlikely]]
+					    throw VM::Halt();
+			    },
+			    [](VM *vm, int table, bool hash, const Value &value) {
+				    if (table < 0 || table >= static_cast<int>(vm->m_bytecode->switchTables.size()))
+					    throw std::runtime_error("Invalid switch table index");
+				    const SwitchTable &switchTable = vm->m_bytecode->switchTables[table];
+				    return hash ? switchTable.resolveHash(value) : switchTable.resolveDense(value);
+			    }};
+			try
+			{
+				program(frame);
+			}
+			catch (const VM::Halt &)
+			{
+			}
+		}
+		else if (evalLoop() == ExitReason::Error)
+			throw std::runtime_error(m_error.message);
 	}
 #if defined(TRACING) || defined(_DEBUG)
 	catch (const std::exception &e)
@@ -124,6 +261,8 @@ int VM::run(const Bytecode &bc, const size_t startPC)
 		logerr(std::format("\nVM::{}(): UNCAUGHT EXCEPTION!\n\n{}\n{}\n\n", __func__, e.what(), getInformation()));
 		flusherr();
 #endif
+		m_stdlib.tasks.reset();
+		m_stdlib.unjoinedTasks = 0;
 		status = BAD_STATUS;
 #ifdef _DEBUG
 		logerr(std::format("{}\n", e.what()));
@@ -131,33 +270,117 @@ int VM::run(const Bytecode &bc, const size_t startPC)
 #endif
 		throw;
 	}
+	// Tasks the program spawned and never joined finish here, while their bytecode is still around
+	m_stdlib.tasks.reset();
+	m_stdlib.unjoinedTasks = 0;
+
+#ifdef TIMING
+	auto end = clock::now();
+	auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+	log(std::format("VM::{}(): Duration of bytecode execution: {}us\n\n", __func__, us));
+	flush();
+#endif
+#ifdef TRACING
+	log(std::format("\nVM::{}(): HALT (status={})\n\n{}\n", __func__, status, getInformation()));
+	flush();
+#endif
+#ifdef _DEBUG
+	if (isDebuggerAttached())
+		assert(status == 0);
+#endif
+	return status;
 }
 
-Value VM::runFunction(const std::string &name, const Bytecode &bytecode, const bool &argsInit)
+Value VM::runFunction(const std::string &name, const Bytecode &bytecode)
 {
-    isDirectCall = true;
-    setup(bytecode, bytecode.functionEntries.find(name)->second);
+	load(bytecode);
+	Value ret = call(name);
+	status = ret.isInt() ? static_cast<int>(ret.asInt()) : 0;
+	reset(true, false, true);
+	return ret;
+}
 
-	if (!argsInit) push(0);
+void VM::load(const Bytecode &bytecode)
+{
+	setup(bytecode, bytecode.instructions.size());
+}
 
-    try {
-        evalLoop();
-    }
-    catch (const VM::Halt &) {
-		if (isDirectCall) {
-			Value ret = pop();
-			if (ret.isInt()) status = ret.asInt();
-			else status = 0;
-			reset(true, false, true);
-			return ret;
-		} else {
-			throw std::runtime_error("Function call was not properly handled!");
-		}
+VM::SharedProgram VM::share() const
+{
+	if (m_bytecode == nullptr)
+		throw std::runtime_error("No program loaded");
+	SharedProgram program{.bytecode = m_bytecode,
+	                      .image = m_image,
+	                      .natives = nativeFunctions,
+	                      .nativeCount = nativeFunctions.size(),
+	                      .argc = m_stdlib.argc,
+	                      .argv = m_stdlib.argv};
+	// Loads into this VM's FFI, which belongs to this thread
+	program.natives.erase("load_plugin");
+	return program;
+}
+
+void VM::load(const SharedProgram &program)
+{
+	nativeFunctions = program.natives;
+	pureNativeFunctions.clear();
+	m_stdlib.argc = program.argc;
+	m_stdlib.argv = program.argv;
+	setup(*program.bytecode, 0, program.image);
+	pc = m_codeSize;
+}
+
+size_t VM::findFunction(const std::string &name) const
+{
+	if (m_bytecode == nullptr)
+		throw std::runtime_error("No program loaded");
+	auto it = m_bytecode->functionEntries.find(name);
+	if (it == m_bytecode->functionEntries.end())
+		throw std::runtime_error("Unknown function: " + name);
+	return static_cast<size_t>(it->second);
+}
+
+Value VM::call(const std::string &name, std::span<const Value> args)
+{
+	return call(findFunction(name), args);
+}
+
+Value VM::call(size_t entry, std::span<const Value> args)
+{
+	if (m_code == nullptr || entry >= m_codeSize)
+		throw std::runtime_error("Invalid function entry point");
+
+	// Arguments then their count, as CALL expects. The return address is one past the last
+	// instruction, so the function's RETURN ends evalLoop() like the end of the program does
+	const size_t savedPC = pc;
+	const size_t stackBase = stack.size();
+	const size_t callDepth = callStack.size();
+	for (const Value &arg : args)
+		push(arg);
+	push(Value(static_cast<i64>(args.size())));
+	callStack.push_back(static_cast<int>(m_codeSize));
+	pc = entry;
+
+	// The function is not part of a fiber that may be running, so it can't yield out of it
+	const i64 savedFiber = m_runningFiber;
+	m_runningFiber = -1;
+	m_halted = false;
+	ExitReason exit = evalLoop();
+	m_runningFiber = savedFiber;
+	if (exit != ExitReason::Return || callStack.size() != callDepth || stack.size() <= stackBase) [[unlikely]]
+	{
+		stack.resize(std::min(stack.size(), stackBase));
+		callStack.resize(std::min(callStack.size(), callDepth));
+		// pc stays past the end, so a dispatch loop this was called from stops too
+		if (exit == ExitReason::Halt)
+			throw Halt();
+		pc = savedPC;
+		throw std::runtime_error(exit == ExitReason::Error ? m_error.message : "Function did not return properly!");
 	}
-	throw std::runtime_error("Function did not return properly!");
-	status = BAD_STATUS;
-	isError = true;
-	return Value();
+	pc = savedPC;
+	Value ret = pop();
+	stack.resize(stackBase);
+	return ret;
 }
 
 void VM::setImportHandler(const ImportHandler &handler)
@@ -169,6 +392,57 @@ void VM::setImportHandler(const ImportHandler &handler)
 	importHandler = handler;
 }
 
+void VM::runImport(const std::string &path)
+{
+	if (!importHandler)
+		throw std::runtime_error("Import handler not set");
+
+	// The module is compiled separately and numbers its variables from 0,
+	// so it runs against its own state and the importer's is put back after
+	const Bytecode      *savedBytecode = m_bytecode;
+	const BytecodeImage *savedImage = m_image;
+	const Instruction   *savedCode = m_code;
+	size_t               savedCodeSize = m_codeSize;
+	size_t               savedPC = pc;
+	std::vector<Value>   savedStack(stack.begin(), stack.end());
+	std::vector<int>     savedCallStack = std::move(callStack);
+	auto                 savedRegisters = registers;
+	std::vector<Value>   savedVariables = std::move(variables);
+	auto                 savedFibers = std::move(m_fibers);
+	i64                  savedFiber = m_runningFiber;
+	variables.clear();
+	m_fibers.clear();
+	m_runningFiber = -1;
+	m_importDepth++;
+
+	auto restore = [&] {
+		m_importDepth--;
+		m_bytecode = savedBytecode;
+		m_image = savedImage;
+		m_code = savedCode;
+		m_codeSize = savedCodeSize;
+		pc = savedPC;
+		stack.assign(savedStack.begin(), savedStack.end());
+		callStack = std::move(savedCallStack);
+		registers = savedRegisters;
+		variables = std::move(savedVariables);
+		m_fibers = std::move(savedFibers);
+		m_runningFiber = savedFiber;
+		m_halted = false; // A module that halts only ends itself
+	};
+
+	try
+	{
+		importHandler(path);
+	}
+	catch (...)
+	{
+		restore();
+		throw;
+	}
+	restore();
+}
+
 void VM::cleanup()
 {
 #ifdef TRACING
@@ -197,12 +471,14 @@ void VM::reset(const bool &resetStack, const bool &resetFunctions, const bool &r
 	if (resetStack)
 	{
 		callStack.clear();
+		m_fibers.clear();
 		stack_pool.release();
 		stack = std::pmr::vector<Value>(&stack_pool);
 	}
 	if (resetFunctions)
 	{
 		nativeFunctions.clear();
+		pureNativeFunctions.clear();
 	}
 	if (resetVariables)
 	{
@@ -211,7 +487,30 @@ void VM::reset(const bool &resetStack, const bool &resetFunctions, const bool &r
 	pc = 0;
 	status = 0;
 	m_bytecode = nullptr;
-	isDirectCall = false;
+	m_image = nullptr;
+	m_code = nullptr;
+	m_codeSize = 0;
+}
+
+void VM::saveBaseline()
+{
+	m_baselineNatives = nativeFunctions;
+	m_baselinePureNatives = pureNativeFunctions;
+}
+
+void VM::resetToBaseline()
+{
+	registers.fill(Value());
+	reset(true, false, true);
+	nativeFunctions = m_baselineNatives;
+	pureNativeFunctions = m_baselinePureNatives;
+	isError = false;
+	m_importDepth = 0;
+	m_stdlib.stringBuilders.clear();
+	m_stdlib.freeStringBuilders.clear();
+	m_stdlib.channels.clear();
+	m_stdlib.fiberQueue.clear();
+	m_snapshotTaken = false;
 }
 
 std::string VM::getInformation()
@@ -249,9 +548,9 @@ std::string VM::getBytecodeInformation()
 	std::string functions;
 	std::string instructions;
 
-	for (const auto &constant : m_bytecode->constants)
+	for (size_t i = 0; i < constantCount(); i++)
 	{
-		constants += std::format("{:T}\n", constant);
+		constants += std::format("{:T}\n", constant(i));
 	}
 	for (const auto &variable : m_bytecode->variables)
 	{
@@ -262,7 +561,7 @@ std::string VM::getBytecodeInformation()
 		functions += std::format("{}() PC = {}\n", function.first, function.second);
 	}
 #ifdef TRACING
-	for (const auto &instruction : m_bytecode->instructions)
+	for (const auto &instruction : std::span(m_code, m_codeSize))
 	{
 		instructions += std::format("{}({}, {}, {})\n", opCodeToString(instruction.op), instruction.operand1,
 		                            instruction.operand2, instruction.operand3);
@@ -271,8 +570,8 @@ std::string VM::getBytecodeInformation()
 
 	info = std::format(
 	    "BYTECODE INFORMATION:\n\nConstants: {}\n{}\nVariables: {}\n{}\nFunctions: {}\n{}\nInstructions: {}\n{}",
-	    m_bytecode->constants.size(), constants, m_bytecode->variables.size(), variables,
-	    m_bytecode->functionEntries.size(), functions, m_bytecode->instructions.size(), instructions);
+	    constantCount(), constants, m_bytecode->variables.size(), variables, m_bytecode->functionEntries.size(),
+	    functions, m_codeSize, instructions);
 	return info;
 }
 
@@ -1,5 +1,8 @@
 #pragma once
 #include "../../Codegen/CodeGen.hpp"
+#include "../../Codegen/Bytecode/BytecodeImage.hpp"
+#include "Snapshot.hpp"
+#include <Phasor/PhasorAOT.hpp>
 #ifndef CMAKE_PCH
 #include <Value.hpp>
 #endif
@@ -7,6 +10,9 @@
 #include <filesystem>
 #include <functional>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
 #include <array>
 #include <ranges>
 #include "core/core.h"
@@ -14,6 +20,7 @@
 #include <phsint.hpp>
 #include <stdexcept>
 #include <memory_resource>
+#include <span>
 #ifdef TRACING
 #include <format>
 #include "../../ISA/map.hpp"
@@ -30,6 +37,9 @@
 namespace Phasor
 {
 
+struct TaskState; ///< stdtask's tasks in flight, see Stdlib/task.cpp
+class Channel;    ///< stdtask's channels, see Stdlib/channel.cpp
+
 /// @class VM
 /// @brief Virtual Machine
 class VM
@@ -43,32 +53,211 @@ class VM
 	/// @brief Initialize the FFI plugins
 	void initFFI(const std::filesystem::path &path);
 
+	/// @brief Initialize exactly these FFI plugins, e.g. a snapshot's, without scanning a folder
+	void initFFI(const std::vector<std::string> &plugins);
+
+	/// @brief Whether initFFI() has run, for hosts that reuse a VM and only want to scan for plugins once
+	bool hasFFI() const;
+
 	/// @brief Get Phasor VM version
 	std::string getVersion();
 
 	/// @class Halt
-	/// @brief Throws when the HALT opcode is reached
+	/// @brief Thrown out of a compiled program, or out of call(), when the program halts
+	/// The interpreter returns ExitReason::Halt instead; compiled code is unwound with this, as it
+	/// can't return through the C++ frames of its functions
 	class Halt : public std::exception
 	{
 	  public:
 		const char *what() const noexcept override
 		{
-			return "";
+			return "Program halted";
 		}
 	};
 
+	/// @brief Why the dispatch loop stopped
+	enum class ExitReason : u8
+	{
+		Halt,   ///< HALT, or a native called halt()
+		Return, ///< Ran past the last instruction, which is also how call() gets its function's return
+		Error,  ///< The VM raised an error, described by lastError()
+		Yield,  ///< The running fiber yielded, see yieldFiber()
+	};
+
+	/// @brief What went wrong in the last run that stopped with ExitReason::Error
+	struct ErrorRecord
+	{
+		std::string message;
+		size_t      pc = 0; ///< Instruction that failed
+	};
+
+	const ErrorRecord &lastError() const
+	{
+		return m_error;
+	}
+
+	/// @brief Stop the program once the current instruction is done, as HALT does
+	/// For natives such as shutdown(); the run then returns the status as usual
+	void halt();
+
+	/// @brief Whether halt() or HALT has stopped the program, for natives that loop over script calls
+	bool haltRequested() const
+	{
+		return m_halted;
+	}
+
 	/// @brief Run the virtual machine
 	/// Exits -1 on uncaught exception
 	int run(const Bytecode &bytecode, const size_t startPC = 0);
 
-	/// @brief Run a function from bytecode on the virtual machine
-	Value runFunction(const std::string &name, const Bytecode &bytecode, const bool &argsInit = false);
+	/// @brief Run a mapped or embedded bytecode image in place, the image must outlive the run
+	/// With a program compiled ahead of time from the same bytecode, run that instead of interpreting
+	int run(const BytecodeImage &image, CompiledProgram program = nullptr);
+
+	/// @brief Run a program compiled ahead of time from bytecode, which supplies its tables and constants
+	int run(const Bytecode &bytecode, CompiledProgram program);
+
+	/// @brief Write a snapshot to path when the program calls snapshot(), and stop there
+	/// Without one, snapshot() does nothing and returns false
+	void setSnapshotPath(const std::filesystem::path &path);
+
+	/// @brief Continue a program from a snapshot, as if its snapshot() call had just returned true
+	/// The natives the snapshot names must be registered first, and are the only ones kept.
+	/// The snapshot must outlive the run
+	int resume(const Snapshot &snapshot);
+
+	/// @brief Whether the last run stopped because snapshot() wrote one
+	bool snapshotTaken() const
+	{
+		return m_snapshotTaken;
+	}
+
+	/// @brief Run a function from bytecode on a freshly set up virtual machine, then clear the variables
+	Value runFunction(const std::string &name, const Bytecode &bytecode);
+
+	/// @brief Make bytecode the program whose functions call() runs, without running it
+	/// Clears the stacks and registers but keeps the variables, so globals an earlier run set survive
+	void load(const Bytecode &bytecode);
+
+	/// @brief Whether bytecode is the program loaded or last run, and call() can use it as is
+	bool isLoaded(const Bytecode &bytecode) const
+	{
+		return m_bytecode == &bytecode && m_image == nullptr;
+	}
+
+	/// @brief Entry point of a function of the loaded program, to call() it without looking it up again
+	/// @throws std::runtime_error if there is no such function
+	size_t findFunction(const std::string &name) const;
+
+	/// @brief Call a function of the loaded program with args and return what it returns
+	///
+	/// Variables are left as the function leaves them. The function returns the way script calls
+	/// do, to an address that ends the dispatch loop, so a call throws nothing unless the script
+	/// fails and, once the stacks have grown, allocates nothing. Natives may use it to call back
+	/// into the running program. If the function halts the program, e.g. through shutdown(),
+	/// the stacks are unwound and Halt is thrown, which stops the dispatch loop of a native's caller.
+	/// @throws std::runtime_error with lastError()'s message if the script fails
+	/// @throws Halt if the function halts the program
+	Value call(size_t entry, std::span<const Value> args = {});
+	Value call(const std::string &name, std::span<const Value> args = {});
+
+	/// @brief Create a fiber: a call of a function of the loaded program that can stop part way
+	/// through with yieldFiber() and go on when resumed, keeping its own value stack, call stack,
+	/// registers and pc meanwhile. Variables are not its own: a function's parameters and locals
+	/// live in the same slots for every call, so fibers running the same function share them.
+	/// @return Handle for resumeFiber(); handles are not reused
+	i64 newFiber(size_t entry, std::span<const Value> args = {});
+
+	/// @brief Run a fiber until it yields or returns
+	///
+	/// The fiber runs on top of the calling code's stacks, which it is moved onto and, when it
+	/// yields, back off again. Once it returns, its handle is no longer valid. If it halts the
+	/// program, null is returned and the program stops as for halt().
+	/// @param sent What its pending yield returns; not used the first time it is resumed
+	/// @return What it yielded, or what its function returned
+	/// @throws std::runtime_error if the fiber is unknown, finished or running, or fails
+	Value resumeFiber(i64 fiber, const Value &sent = Value());
+
+	/// @brief Suspend the running fiber once the current instruction is done, as halt() stops the program
+	/// For natives; resumeFiber() then returns value, and what the native itself returns is replaced
+	/// with what the fiber is resumed with. Functions natives call through call() are not part of
+	/// the fiber and can't yield.
+	/// @throws std::runtime_error if no fiber is running
+	void yieldFiber(Value value);
+
+	/// @brief Whether a fiber has finished, or never existed
+	bool fiberDone(i64 fiber) const
+	{
+		return !m_fibers.contains(fiber);
+	}
+
+	/// @brief What the standard library keeps for each VM
+	///
+	/// Kept here rather than in statics so VMs share nothing but read-only bytecode and can run
+	/// on as many threads at once.
+	struct StdLibState
+	{
+		int                                               argc = 0;       ///< Script arguments, for sys_argc() and friends
+		char                                            **argv = nullptr;
+		std::vector<PhsString>                            stringBuilders; ///< sb_new() handles index this
+		std::vector<size_t>                               freeStringBuilders;
+		u64                                               random[2] = {}; ///< xorshift+ state, set by rand_seed()
+		std::shared_ptr<TaskState>                        tasks;          ///< Created by the first spawn() or par_map()
+		size_t                                            unjoinedTasks = 0; ///< spawn()ed and not join()ed yet
+		std::unordered_map<i64, std::shared_ptr<Channel>> channels;       ///< Used here, looked up without the registry's lock
+		std::deque<i64>                                   fiberQueue;     ///< fiber_spawn()ed, run by fiber_run()
+	};
+
+	StdLibState &stdlib()
+	{
+		return m_stdlib;
+	}
 
 	/// @brief Native function signature
 	using NativeFunction = std::function<Value(const std::vector<Value> &args, VM *vm)>;
 
+	/// @brief Properties a native function is registered with
+	enum class NativeTraits : u8
+	{
+		None = 0,
+		Pure = 1, ///< No side effects, result depends only on the arguments; may be evaluated at compile time
+	};
+
 	/// @brief Register a native function
-	void registerNativeFunction(const std::string &name, NativeFunction fn);
+	void registerNativeFunction(const std::string &name, NativeFunction fn, NativeTraits traits = NativeTraits::None);
+
+	/// @brief The loaded program and its natives, for VMs on other threads to run its functions
+	///
+	/// Taken with share() on the thread that runs this VM, since natives may be registered while it
+	/// runs. The bytecode is not copied and must outlive every VM that loads it.
+	struct SharedProgram
+	{
+		const Bytecode                       *bytecode = nullptr;
+		const BytecodeImage                  *image = nullptr;
+		std::map<std::string, NativeFunction> natives;
+		size_t                                nativeCount = 0; ///< This VM's, when shared
+		int                                   argc = 0;
+		char                                **argv = nullptr;
+	};
+
+	/// @brief Take what another VM needs to call the loaded program's functions
+	/// @throws std::runtime_error if no program is loaded
+	SharedProgram share() const;
+
+	/// @brief Whether program still matches the loaded program and natives, or share() should be taken again
+	bool isShared(const SharedProgram &program) const
+	{
+		return program.bytecode == m_bytecode && program.image == m_image &&
+		       program.nativeCount == nativeFunctions.size();
+	}
+
+	/// @brief Load a program another VM shared, replacing the natives with its ones
+	/// The variables are sized for the program but not set; as with load(), call() can run it then
+	void load(const SharedProgram &program);
+
+	/// @brief Find a native registered with NativeTraits::Pure
+	/// @return The function, or nullptr if there is none or it isn't pure
+	const NativeFunction *findPureNative(const std::string &name) const;
 
 	using ImportHandler = std::function<void(const std::filesystem::path &path)>;
 	/// @brief Set the import handler for importing modules
@@ -115,7 +304,7 @@ class VM
 	size_t getRegisterCount();
 
 	inline Bytecode getBytecode() {
-		return *m_bytecode;
+		return m_image != nullptr ? m_image->materialize() : *m_bytecode;
 	}
 
 	/// @brief Enum for registers
@@ -182,6 +371,13 @@ class VM
 	/// @brief Reset the virtual machine
 	void reset(const bool &resetStack = true, const bool &resetFunctions = true, const bool &resetVariables = true);
 
+	/// @brief Remember the natives registered now, for a VM that is reused between programs
+	void saveBaseline();
+
+	/// @brief Clear everything a run left behind and go back to the natives at saveBaseline()
+	/// Natives a program added with using(), or removed through reset(), are put back as they were
+	void resetToBaseline();
+
 	/// @brief Get VM information for debugging
 	std::string getInformation();
 
@@ -243,10 +439,46 @@ class VM
 	static Value native_get_elem(const std::vector<Value> &args, VM *vm);
 	static Value native_set_elem(const std::vector<Value> &args, VM *vm);
 
-	void setup(const Bytecode &bc, const size_t initialPC);
-	void evalLoop();
+	void         registerSnapshotFunctions();
+	static Value native_snapshot(const std::vector<Value> &args, VM *vm);
+
+	/// @brief A fiber's state, kept off the VM's stacks while it is suspended
+	struct Fiber
+	{
+		std::vector<Value>               stack;     ///< Its part of the value stack, bottom first
+		std::vector<int>                 callStack; ///< Likewise; the first frame returns to m_codeSize
+		std::array<Value, MAX_REGISTERS> registers;
+		size_t                           pc = 0;
+		bool                             started = false; ///< Whether the top of stack is a pending yield's result
+		bool                             running = false;
+	};
+
+	void setup(const Bytecode &bc, const size_t initialPC, const BytecodeImage *image = nullptr);
+	int  execute(CompiledProgram program = nullptr);
+	ExitReason evalLoop();
+
+	/// @brief Why the dispatch loop stops, now that pc is past the last instruction
+	ExitReason stopReason() const
+	{
+		return m_halted ? ExitReason::Halt : m_yielded ? ExitReason::Yield : ExitReason::Return;
+	}
 
-	bool isDirectCall = false; ///< is a direct call to a function
+	/// @brief Record an error for lastError() and return ExitReason::Error, for the dispatch loop
+	ExitReason fail(std::string message);
+
+	/// @brief Constant pool entry, decoded on first use when running an image
+	const Value &constant(size_t index) const
+	{
+		return m_image != nullptr ? m_image->constant(index) : m_bytecode->constants[index];
+	}
+
+	size_t constantCount() const
+	{
+		return m_image != nullptr ? m_image->constantCount() : m_bytecode->constants.size();
+	}
+
+	/// @brief Run a module through the import handler, then resume the importer where it left off
+	void runImport(const std::string &path);
 
 #ifndef SANDBOXED
 	/// @brief FFI
@@ -258,9 +490,34 @@ class VM
 	/// @brief Is status an error code
 	bool isError = false;
 
+	/// @brief Set by halt(), so the dispatch loop reports a halt once it sees pc past the end
+	bool m_halted = false;
+
+	/// @brief The last error the dispatch loop stopped on
+	ErrorRecord m_error;
+
+	/// @brief Fibers created and not yet finished, by handle
+	std::unordered_map<i64, Fiber> m_fibers;
+	i64                            m_nextFiber = 0;
+	i64                            m_runningFiber = -1; ///< Whose code the innermost dispatch loop runs, -1 for none
+
+	/// @brief Set by yieldFiber(), so the dispatch loop reports a yield once it sees pc past the end
+	bool   m_yielded = false;
+	size_t m_yieldPC = 0; ///< Where the fiber goes on from
+	Value  m_yieldValue;
+
+	StdLibState m_stdlib;
+
 	/// @brief Import handler for loading modules
 	ImportHandler importHandler;
 
+	/// @brief Modules being imported, snapshot() only works outside them
+	int m_importDepth = 0;
+
+	/// @brief Where snapshot() writes to, empty if it shouldn't
+	std::filesystem::path m_snapshotPath;
+	bool                  m_snapshotTaken = false;
+
 	/// @brief Virtual registers for register-based operations (v2.0)
 	std::array<Value, MAX_REGISTERS> registers;
 	
@@ -277,10 +534,24 @@ class VM
 	/// @brief Bytecode to execute
 	const Bytecode *m_bytecode{};
 
+	/// @brief Image m_bytecode's tables came from, which then holds the constants
+	const BytecodeImage *m_image{};
+
+	/// @brief Instructions being executed, m_bytecode's or the image's
+	const Instruction *m_code{};
+	size_t             m_codeSize = 0;
+
 	/// @brief Program counter
 	size_t pc = 0;
 
 	/// @brief Native function registry
 	std::map<std::string, NativeFunction> nativeFunctions;
+
+	/// @brief Names in nativeFunctions registered with NativeTraits::Pure
+	std::unordered_set<std::string> pureNativeFunctions;
+
+	/// @brief nativeFunctions and pureNativeFunctions at saveBaseline()
+	std::map<std::string, NativeFunction> m_baselineNatives;
+	std::unordered_set<std::string>       m_baselinePureNatives;
 };
 } // namespace Phasor
\ No newline at end of file
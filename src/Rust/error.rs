@@ -9,6 +9,9 @@ pub enum PhasorError {
     #[error("Compilation failed")]
     CompileError,
 
+    #[error("Bytecode could not be loaded")]
+    LoadError,
+
     #[error("Execution exception (Code: {0})")]
     ExecutionException(i32),
 
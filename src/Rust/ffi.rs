@@ -1,5 +1,11 @@
 use libc::{c_char, c_int, c_uchar, c_void, size_t};
 
+/// Opaque `PhasorProgram` from PhasorRT.h, only ever used behind a pointer
+#[repr(C)]
+pub struct PhasorProgram {
+    _private: [u8; 0],
+}
+
 #[cfg(feature = "dynamic")]
 pub type GetVersionFn = unsafe extern "C" fn() -> *const c_char;
 
@@ -70,6 +76,55 @@ pub type CompilePULFn = unsafe extern "C" fn(
     out_size: *mut size_t,
 ) -> bool;
 
+#[cfg(feature = "dynamic")]
+pub type CompileProgramPHSFn = unsafe extern "C" fn(
+    script: *const c_char,
+    module_name: *const c_char,
+    module_path: *const c_char,
+) -> *mut PhasorProgram;
+
+#[cfg(feature = "dynamic")]
+pub type CompileProgramPULFn = unsafe extern "C" fn(
+    script: *const c_char,
+    module_name: *const c_char,
+) -> *mut PhasorProgram;
+
+#[cfg(feature = "dynamic")]
+pub type LoadProgramFn = unsafe extern "C" fn(
+    bytecode: *const c_uchar,
+    bytecode_size: size_t,
+    module_name: *const c_char,
+) -> *mut PhasorProgram;
+
+#[cfg(feature = "dynamic")]
+pub type ExecProgramFn = unsafe extern "C" fn(
+    state: *mut c_void,
+    program: *const PhasorProgram,
+    argc: c_int,
+    argv: *const *const c_char,
+) -> c_int;
+
+#[cfg(feature = "dynamic")]
+pub type ExecProgramFuncIntFn = unsafe extern "C" fn(
+    state: *mut c_void,
+    program: *const PhasorProgram,
+    argc: c_int,
+    argv: *const *const c_char,
+    function_name: *const c_char,
+) -> c_int;
+
+#[cfg(feature = "dynamic")]
+pub type ExecProgramFuncStringFn = unsafe extern "C" fn(
+    state: *mut c_void,
+    program: *const PhasorProgram,
+    argc: c_int,
+    argv: *const *const c_char,
+    function_name: *const c_char,
+) -> *const c_char;
+
+#[cfg(feature = "dynamic")]
+pub type FreeProgramFn = unsafe extern "C" fn(program: *mut PhasorProgram);
+
 #[cfg(feature = "dynamic")]
 pub type CreateStateFn = unsafe extern "C" fn() -> *mut c_void;
 
@@ -154,4 +209,39 @@ unsafe extern "C" {
         module_name: *const c_char,
     ) -> c_int;
     pub fn isErrorStatus(state: *mut c_void) -> bool;
+    pub fn compileProgramPHS(
+        script: *const c_char,
+        module_name: *const c_char,
+        module_path: *const c_char,
+    ) -> *mut PhasorProgram;
+    pub fn compileProgramPUL(
+        script: *const c_char,
+        module_name: *const c_char,
+    ) -> *mut PhasorProgram;
+    pub fn loadProgram(
+        bytecode: *const c_uchar,
+        bytecode_size: size_t,
+        module_name: *const c_char,
+    ) -> *mut PhasorProgram;
+    pub fn execProgram(
+        state: *mut c_void,
+        program: *const PhasorProgram,
+        argc: c_int,
+        argv: *const *const c_char,
+    ) -> c_int;
+    pub fn execProgramFuncInt(
+        state: *mut c_void,
+        program: *const PhasorProgram,
+        argc: c_int,
+        argv: *const *const c_char,
+        function_name: *const c_char,
+    ) -> c_int;
+    pub fn execProgramFuncString(
+        state: *mut c_void,
+        program: *const PhasorProgram,
+        argc: c_int,
+        argv: *const *const c_char,
+        function_name: *const c_char,
+    ) -> *const c_char;
+    pub fn freeProgram(program: *mut PhasorProgram);
 }
\ No newline at end of file
@@ -1,8 +1,10 @@
 pub mod error;
 pub mod ffi;
+pub mod program;
 pub mod vm;
 
 pub use error::PhasorError;
+pub use program::PhasorProgram;
 pub use vm::PhasorVM;
 
 #[cfg(feature = "dynamic")]
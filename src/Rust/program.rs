@@ -0,0 +1,115 @@
+use std::ffi::CString;
+
+#[cfg(feature = "dynamic")]
+use libloading::{Library, Symbol};
+
+use crate::error::PhasorError;
+use crate::ffi;
+
+/// A script compiled, or bytecode loaded, once and run with `PhasorVM::exec_program` as often as needed.
+pub struct PhasorProgram {
+    pub(crate) ptr: *mut ffi::PhasorProgram,
+    #[cfg(feature = "dynamic")]
+    _lib: Library,
+}
+
+impl PhasorProgram {
+    pub fn compile_phs(script: &str, module: &str, path: Option<&str>) -> Result<Self, PhasorError> {
+        let c_script = CString::new(script)?;
+        let c_module = CString::new(module)?;
+        let c_path = CString::new(path.unwrap_or(""))?;
+
+        #[cfg(feature = "dynamic")]
+        unsafe {
+            let lib = Library::new(crate::dll_path())?;
+            let ptr = {
+                let f: Symbol<ffi::CompileProgramPHSFn> = lib.get(b"compileProgramPHS")?;
+                f(c_script.as_ptr(), c_module.as_ptr(), c_path.as_ptr())
+            };
+            Self::wrap(ptr, lib, PhasorError::CompileError)
+        }
+
+        #[cfg(not(feature = "dynamic"))]
+        unsafe {
+            let ptr = ffi::compileProgramPHS(c_script.as_ptr(), c_module.as_ptr(), c_path.as_ptr());
+            Self::wrap(ptr, PhasorError::CompileError)
+        }
+    }
+
+    pub fn compile_pul(script: &str, module: &str) -> Result<Self, PhasorError> {
+        let c_script = CString::new(script)?;
+        let c_module = CString::new(module)?;
+
+        #[cfg(feature = "dynamic")]
+        unsafe {
+            let lib = Library::new(crate::dll_path())?;
+            let ptr = {
+                let f: Symbol<ffi::CompileProgramPULFn> = lib.get(b"compileProgramPUL")?;
+                f(c_script.as_ptr(), c_module.as_ptr())
+            };
+            Self::wrap(ptr, lib, PhasorError::CompileError)
+        }
+
+        #[cfg(not(feature = "dynamic"))]
+        unsafe {
+            let ptr = ffi::compileProgramPUL(c_script.as_ptr(), c_module.as_ptr());
+            Self::wrap(ptr, PhasorError::CompileError)
+        }
+    }
+
+    /// The bytecode is copied, it needn't outlive the program.
+    pub fn load(bytecode: &[u8], module: &str) -> Result<Self, PhasorError> {
+        let c_module = CString::new(module)?;
+
+        #[cfg(feature = "dynamic")]
+        unsafe {
+            let lib = Library::new(crate::dll_path())?;
+            let ptr = {
+                let f: Symbol<ffi::LoadProgramFn> = lib.get(b"loadProgram")?;
+                f(bytecode.as_ptr(), bytecode.len(), c_module.as_ptr())
+            };
+            Self::wrap(ptr, lib, PhasorError::LoadError)
+        }
+
+        #[cfg(not(feature = "dynamic"))]
+        unsafe {
+            let ptr = ffi::loadProgram(bytecode.as_ptr(), bytecode.len(), c_module.as_ptr());
+            Self::wrap(ptr, PhasorError::LoadError)
+        }
+    }
+
+    #[cfg(feature = "dynamic")]
+    fn wrap(ptr: *mut ffi::PhasorProgram, lib: Library, error: PhasorError) -> Result<Self, PhasorError> {
+        if ptr.is_null() {
+            Err(error)
+        } else {
+            Ok(PhasorProgram { ptr, _lib: lib })
+        }
+    }
+
+    #[cfg(not(feature = "dynamic"))]
+    fn wrap(ptr: *mut ffi::PhasorProgram, error: PhasorError) -> Result<Self, PhasorError> {
+        if ptr.is_null() {
+            Err(error)
+        } else {
+            Ok(PhasorProgram { ptr })
+        }
+    }
+}
+
+impl Drop for PhasorProgram {
+    fn drop(&mut self) {
+        unsafe {
+            #[cfg(feature = "dynamic")]
+            {
+                if let Ok(free) = self._lib.get::<ffi::FreeProgramFn>(b"freeProgram") {
+                    free(self.ptr);
+                }
+            }
+            #[cfg(not(feature = "dynamic"))]
+            {
+                ffi::freeProgram(self.ptr);
+            }
+        }
+    }
+}
@@ -6,6 +6,7 @@ use libloading::{Library, Symbol};
 
 use crate::error::PhasorError;
 use crate::ffi::*;
+use crate::program::PhasorProgram;
 
 pub struct PhasorVM {
     state: *mut std::ffi::c_void,
@@ -210,6 +211,106 @@ impl PhasorVM {
         }
     }
 
+    /// Run a program made once with `PhasorProgram`, with no deserialization or compilation.
+    pub fn exec_program(&mut self, program: &PhasorProgram, args: &[&str]) -> Result<i32, PhasorError> {
+        let c_args: Vec<CString> = args.iter().map(|&s| CString::new(s).unwrap()).collect();
+        let arg_ptrs: Vec<*const libc::c_char> = c_args.iter().map(|s| s.as_ptr()).collect();
+
+        unsafe {
+            #[cfg(feature = "dynamic")]
+            let res = {
+                let f: Symbol<ExecProgramFn> = self._lib.get(b"execProgram")?;
+                f(self.state, program.ptr, arg_ptrs.len() as c_int, arg_ptrs.as_ptr())
+            };
+            #[cfg(not(feature = "dynamic"))]
+            let res = execProgram(self.state, program.ptr, arg_ptrs.len() as c_int, arg_ptrs.as_ptr());
+
+            if self.is_error_status()? {
+                Err(PhasorError::ExecutionException(res))
+            } else {
+                Ok(res)
+            }
+        }
+    }
+
+    pub fn exec_program_func_int(
+        &mut self,
+        program: &PhasorProgram,
+        function: &str,
+        args: &[&str],
+    ) -> Result<i32, PhasorError> {
+        let c_function = CString::new(function)?;
+        let c_args: Vec<CString> = args.iter().map(|&s| CString::new(s).unwrap()).collect();
+        let arg_ptrs: Vec<*const libc::c_char> = c_args.iter().map(|s| s.as_ptr()).collect();
+
+        unsafe {
+            #[cfg(feature = "dynamic")]
+            let res = {
+                let f: Symbol<ExecProgramFuncIntFn> = self._lib.get(b"execProgramFuncInt")?;
+                f(
+                    self.state,
+                    program.ptr,
+                    arg_ptrs.len() as c_int,
+                    arg_ptrs.as_ptr(),
+                    c_function.as_ptr(),
+                )
+            };
+            #[cfg(not(feature = "dynamic"))]
+            let res = execProgramFuncInt(
+                self.state,
+                program.ptr,
+                arg_ptrs.len() as c_int,
+                arg_ptrs.as_ptr(),
+                c_function.as_ptr(),
+            );
+
+            if self.is_error_status()? {
+                Err(PhasorError::ExecutionException(res))
+            } else {
+                Ok(res)
+            }
+        }
+    }
+
+    pub fn exec_program_func_string(
+        &mut self,
+        program: &PhasorProgram,
+        function: &str,
+        args: &[&str],
+    ) -> Result<String, PhasorError> {
+        let c_function = CString::new(function)?;
+        let c_args: Vec<CString> = args.iter().map(|&s| CString::new(s).unwrap()).collect();
+        let arg_ptrs: Vec<*const libc::c_char> = c_args.iter().map(|s| s.as_ptr()).collect();
+
+        unsafe {
+            #[cfg(feature = "dynamic")]
+            let res_ptr = {
+                let f: Symbol<ExecProgramFuncStringFn> = self._lib.get(b"execProgramFuncString")?;
+                f(
+                    self.state,
+                    program.ptr,
+                    arg_ptrs.len() as c_int,
+                    arg_ptrs.as_ptr(),
+                    c_function.as_ptr(),
+                )
+            };
+            #[cfg(not(feature = "dynamic"))]
+            let res_ptr = execProgramFuncString(
+                self.state,
+                program.ptr,
+                arg_ptrs.len() as c_int,
+                arg_ptrs.as_ptr(),
+                c_function.as_ptr(),
+            );
+
+            if res_ptr.is_null() {
+                Err(PhasorError::NullReturn)
+            } else {
+                Ok(CStr::from_ptr(res_ptr).to_str()?.to_owned())
+            }
+        }
+    }
+
     pub fn evaluate_phs(
         &mut self,
         script: &str,
@@ -8,6 +8,7 @@ pub const PhasorError = error{
     VmException,
     NullStringReturn,
     CompilationFailed,
+    LoadFailed,
     StateFailed,
     OutOfMemory,
 };
@@ -31,6 +32,13 @@ const Sym = struct {
     initStdLib: *const fn (?*anyopaque) callconv(.C) void,
     freeState: *const fn (?*anyopaque) callconv(.C) bool,
     resetState: *const fn (?*anyopaque, bool, bool) callconv(.C) bool,
+    compileProgramPHS: *const fn ([*:0]const u8, [*:0]const u8, [*:0]const u8) callconv(.C) ?*anyopaque,
+    compileProgramPUL: *const fn ([*:0]const u8, [*:0]const u8) callconv(.C) ?*anyopaque,
+    loadProgram: *const fn ([*]const u8, usize, [*:0]const u8) callconv(.C) ?*anyopaque,
+    execProgram: *const fn (?*anyopaque, *const anyopaque, c_int, [*]const [*:0]const u8) callconv(.C) c_int,
+    execProgramFuncInt: *const fn (?*anyopaque, *const anyopaque, c_int, [*]const [*:0]const u8, [*:0]const u8) callconv(.C) c_int,
+    execProgramFuncString: *const fn (?*anyopaque, *const anyopaque, c_int, [*]const [*:0]const u8, [*:0]const u8) callconv(.C) ?[*:0]const u8,
+    freeProgram: *const fn (?*anyopaque) callconv(.C) void,
 };
 
 var lib_once = std.once(loadLib);
@@ -117,6 +125,38 @@ pub fn compilePUL(
     return allocator.realloc(buf, actual) catch buf[0..actual];
 }
 
+/// A script compiled, or bytecode loaded, once and run with `State.execProgram` as often as needed.
+pub const Program = struct {
+    ptr: *anyopaque,
+
+    pub fn compilePHS(
+        script: [:0]const u8,
+        module_name: [:0]const u8,
+        module_path: [:0]const u8,
+    ) PhasorError!Program {
+        const raw = (try sym()).compileProgramPHS(script, module_name, module_path) orelse
+            return PhasorError.CompilationFailed;
+        return .{ .ptr = raw };
+    }
+
+    pub fn compilePUL(script: [:0]const u8, module_name: [:0]const u8) PhasorError!Program {
+        const raw = (try sym()).compileProgramPUL(script, module_name) orelse
+            return PhasorError.CompilationFailed;
+        return .{ .ptr = raw };
+    }
+
+    /// The bytecode is copied, it needn't outlive the program.
+    pub fn load(bytecode: []const u8, module_name: [:0]const u8) PhasorError!Program {
+        const raw = (try sym()).loadProgram(bytecode.ptr, bytecode.len, module_name) orelse
+            return PhasorError.LoadFailed;
+        return .{ .ptr = raw };
+    }
+
+    pub fn deinit(self: Program) void {
+        (sym() catch return).freeProgram(self.ptr);
+    }
+};
+
 /// Phasor VM state
 pub const State = struct {
     ptr: *anyopaque,
@@ -192,6 +232,53 @@ pub const State = struct {
         return std.mem.span(raw);
     }
 
+    /// Runs a program made once with `Program`, with no deserialization or compilation.
+    pub fn execProgram(
+        self: State,
+        program: Program,
+        args: []const [*:0]const u8,
+    ) PhasorError!i32 {
+        return check((try sym()).execProgram(
+            self.ptr,
+            program.ptr,
+            @intCast(args.len),
+            argv_ptr(args),
+        ));
+    }
+
+    pub fn execProgramFuncInt(
+        self: State,
+        program: Program,
+        args: []const [*:0]const u8,
+        function_name: [:0]const u8,
+    ) PhasorError!i32 {
+        return check((try sym()).execProgramFuncInt(
+            self.ptr,
+            program.ptr,
+            @intCast(args.len),
+            argv_ptr(args),
+            function_name,
+        ));
+    }
+
+    /// The return is owned by the Phasor runtime, it is overwritten
+    /// on the next call. Copy it before calling again.
+    pub fn execProgramFuncString(
+        self: State,
+        program: Program,
+        args: []const [*:0]const u8,
+        function_name: [:0]const u8,
+    ) PhasorError![:0]const u8 {
+        const raw = (try sym()).execProgramFuncString(
+            self.ptr,
+            program.ptr,
+            @intCast(args.len),
+            argv_ptr(args),
+            function_name,
+        ) orelse return PhasorError.NullStringReturn;
+        return std.mem.span(raw);
+    }
+
     pub fn evaluatePHS(
         self: State,
         script: [:0]const u8,